@@ -40,7 +40,9 @@ enum
 	OPT_JOYPAD,
 	OPT_DEPTH, OPT_SCREENS, 
 	OPT_LANGUAGE, OPT_RESOLUTION,
-	OPT_SONGPATH, OPT_CONFIGFILE, OPT_SCOREFILE
+	OPT_SONGPATH, OPT_CONFIGFILE, OPT_SCOREFILE,
+	OPT_HEADLESS, OPT_FRAMES, OPT_SCREENLIST,
+	OPT_RENDERER, OPT_TRACE, OPT_SONGBENCH
 };
 
 CSimpleOptA::SOption g_rgOptions[] =
@@ -78,13 +80,25 @@ CSimpleOptA::SOption g_rgOptions[] =
 	{ OPT_CONFIGFILE,	"--configfile",	SO_OPT },
 	{ OPT_SCOREFILE,	"-scorefile",	SO_OPT },
 	{ OPT_SCOREFILE,	"--scorefile",	SO_OPT },
+	{ OPT_HEADLESS,		"-headless",	SO_NONE },
+	{ OPT_HEADLESS,		"--headless",	SO_NONE },
+	{ OPT_FRAMES,		"-frames",		SO_OPT },
+	{ OPT_FRAMES,		"--frames",		SO_OPT },
+	{ OPT_SCREENLIST,	"-screenlist",	SO_OPT },
+	{ OPT_SCREENLIST,	"--screenlist",	SO_OPT },
+	{ OPT_RENDERER,		"-renderer",	SO_OPT },
+	{ OPT_RENDERER,		"--renderer",	SO_OPT },
+	{ OPT_TRACE,		"-trace",		SO_NONE },
+	{ OPT_TRACE,		"--trace",		SO_NONE },
+	{ OPT_SONGBENCH,	"-songbench",	SO_OPT },
+	{ OPT_SONGBENCH,	"--songbench",	SO_OPT },
 
 	SO_END_OF_OPTIONS
 };
 
 CMDParams::CMDParams() :
-	Debug(false), Benchmark(false), NoLog(false), Joypad(false),
-	ScreenMode(scmDefault), Depth(32), Screens(1)
+	Debug(false), Benchmark(false), NoLog(false), Joypad(false), Headless(false), Trace(false),
+	ScreenMode(scmDefault), Depth(32), Screens(1), HeadlessFrames(300), SongBenchmarkFiles(0)
 {
 }
 
@@ -177,6 +191,34 @@ void CMDParams::Load(int argc, char ** argv)
 		case OPT_SCOREFILE:
 			ScoreFile = args.OptionArg();
 			break;
+
+		case OPT_HEADLESS:
+			Headless = true;
+			break;
+
+		case OPT_FRAMES:
+			HeadlessFrames = atoi(args.OptionArg());
+			if (HeadlessFrames < 1)
+				HeadlessFrames = 1;
+			break;
+
+		case OPT_SCREENLIST:
+			HeadlessScreens = args.OptionArg();
+			break;
+
+		case OPT_RENDERER:
+			RendererName = args.OptionArg();
+			break;
+
+		case OPT_TRACE:
+			Trace = true;
+			break;
+
+		case OPT_SONGBENCH:
+			SongBenchmarkFiles = atoi(args.OptionArg());
+			if (SongBenchmarkFiles < 0)
+				SongBenchmarkFiles = 0;
+			break;
 		}
 	}
 }
@@ -187,7 +229,7 @@ void CMDParams::ShowUsage()
 		"Usage: ultrastardeluxe.exe [OPTIONS]\n"
 		"\n"
 		"-d  -debug  --debug       Enables debug.\n"
-		"-benchmark  --benchmark   Enables performance benchmarking.\n"
+		"-benchmark  --benchmark   Writes startup timings to Benchmark.csv/.json.\n"
 		"-nolog      --nolog       Disables logging.\n"
 		"-fullscreen --fullscreen  Starts in fullscreen mode.\n"
 		"-windowed   --windowed    Starts in windowed mode.\n"
@@ -199,6 +241,12 @@ void CMDParams::ShowUsage()
 		"-songpath   --songpath    Sets the song path to use.\n"
 		"-configfile --configfile  Sets the config file to use.\n"
 		"-scorefile  --scorefile   Sets the score file to use.\n"
+		"-headless   --headless    Renders offscreen and runs the render benchmark.\n"
+		"-frames     --frames      Sets the number of frames rendered per screen in headless mode.\n"
+		"-screenlist --screenlist  Sets the screens (comma-separated) rendered in headless mode.\n"
+		"-renderer   --renderer    Sets the render backend to use (legacy or gl33).\n"
+		"-trace      --trace       Records a Chrome trace, written on exit and with F11.\n"
+		"-songbench  --songbench   Parses that many generated song files (e.g. 50000) and quits.\n"
 		"\n"
 		"-?  -h  -help  --help     Output this help.\n"
 		"\n"
@@ -43,14 +43,24 @@ public:
 	bool		Benchmark;
 	bool		NoLog;
 	bool		Joypad;
+	bool		Headless;
+	bool		Trace;
 
 	ScreenMode	ScreenMode;
 
 	int			Depth;
 	int			Screens;
+	int			HeadlessFrames;
+	int			SongBenchmarkFiles;	// 0 unless the song parser benchmark was requested
+
+	// comma-separated screen names rendered in headless mode, empty for all screens
+	std::string		HeadlessScreens;
 
 	std::string		LanguageName;
 	std::string		Resolution;
+
+	// render backend ("legacy" or "gl33"), empty for the default
+	std::string		RendererName;
 };
 
 #endif
@@ -61,6 +61,18 @@ bool Database::Init(const path& scorePath)
 	return false;
 }
 
+void Database::LoadSongIndex(SongIndex * index)
+{
+	std::lock_guard<std::mutex> lock(_songIndexLock);
+	_database.LoadSongIndex(index);
+}
+
+void Database::WriteSongIndex(const std::vector<SongIndexUpdate *>& updates, const std::vector<std::string>& removedFolders)
+{
+	std::lock_guard<std::mutex> lock(_songIndexLock);
+	_database.WriteSongIndex(updates, removedFolders);
+}
+
 Database::~Database()
 {
 }
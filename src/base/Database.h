@@ -2,6 +2,7 @@
 #define _DATABASE_H
 #pragma once
 
+#include <mutex>
 #include "UsdxDatabase.h"
 
 class Database : public Singleton<Database>
@@ -9,10 +10,16 @@ class Database : public Singleton<Database>
 public:
 	Database();
 	bool Init(const path& scorePath);
+
+	// Song index, safe to use from any thread.
+	void LoadSongIndex(SongIndex * index);
+	void WriteSongIndex(const std::vector<SongIndexUpdate *>& updates, const std::vector<std::string>& removedFolders);
+
 	~Database();
 
 private:
 	UsdxDatabase _database;
+	std::mutex _songIndexLock;
 };
 
 #define sDatabase (Database::getSingleton())
@@ -0,0 +1,158 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "stdafx.h"
+#include <time.h>
+
+#include "FlightRecorder.h"
+#include "Log.h"
+#include "PathUtils.h"
+#include "Profiler.h"
+
+initialiseSingleton(FlightRecorder);
+
+static const char * EventTypeNames[fetCount] =
+{
+	"LOG", "SCREEN", "TEXLOAD", "TEXFREE", "GLYPH", "AUDIO"
+};
+
+FlightRecorder::FlightRecorder()
+	: _next(0)
+{
+	_events = new FlightEvent[FLIGHT_RECORDER_SIZE];
+	for (Uint32 i = 0; i < FLIGHT_RECORDER_SIZE; i++)
+		_events[i].Sequence.store(0, std::memory_order_relaxed);
+}
+
+void FlightRecorder::Record(FlightEventType type, const char * format, ...)
+{
+	FlightRecorder * recorder = getSingletonPtr();
+	if (recorder == NULL)
+		return;
+
+	va_list args;
+	va_start(args, format);
+	recorder->RecordV(type, NULL, NULL, format, args);
+	va_end(args);
+}
+
+void FlightRecorder::RecordLog(const char * prefix, const char * context, const char * format, va_list args)
+{
+	FlightRecorder * recorder = getSingletonPtr();
+	if (recorder == NULL)
+		return;
+
+	recorder->RecordV(fetLog, prefix, context, format, args);
+}
+
+void FlightRecorder::RecordV(FlightEventType type, const char * prefix, const char * context, const char * format, va_list args)
+{
+	Uint32 ticket = _next.fetch_add(1, std::memory_order_relaxed);
+	FlightEvent& event = _events[ticket % FLIGHT_RECORDER_SIZE];
+
+	// mark the slot as being written, Dump() skips it until it's published again
+	event.Sequence.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	event.Time = SDL_GetPerformanceCounter();
+	event.Type = type;
+
+	int length = 0;
+	if (prefix != NULL && context != NULL)
+		length = snprintf(event.Text, FLIGHT_RECORDER_TEXT_SIZE, "%s[%s] ", prefix, context);
+	else if (prefix != NULL)
+		length = snprintf(event.Text, FLIGHT_RECORDER_TEXT_SIZE, "%s", prefix);
+
+	length = std::max(std::min(length, FLIGHT_RECORDER_TEXT_SIZE - 1), 0);
+	vsnprintf(event.Text + length, FLIGHT_RECORDER_TEXT_SIZE - length, format, args);
+
+	event.Sequence.store(ticket + 1, std::memory_order_release);
+}
+
+bool FlightRecorder::Dump(const char * reason)
+{
+	time_t unixTime = time(NULL);
+	tm localTime = *localtime(&unixTime);
+	char filename[64];
+
+	snprintf(filename, sizeof(filename), "flight_%04u%02u%02u_%02u%02u%02u.txt",
+		1900 + localTime.tm_year, localTime.tm_mon + 1, localTime.tm_mday,
+		localTime.tm_hour, localTime.tm_min, localTime.tm_sec);
+
+	path dumpPath = LogPath / filename;
+	FILE * fp = fopen(dumpPath.generic_string().c_str(), "w");
+	if (fp == NULL)
+		return false;
+
+	Uint64 now = SDL_GetPerformanceCounter();
+	double frequency = (double) SDL_GetPerformanceFrequency();
+	Uint32 next = _next.load(std::memory_order_acquire);
+	Uint32 count = std::min(next, (Uint32) FLIGHT_RECORDER_SIZE);
+
+	fprintf(fp, "%s flight recorder\n", USDXVersionStr());
+	fprintf(fp, "Reason: %s\n", reason);
+	fprintf(fp, "Date: %02u/%02u/%04u Time: %02u:%02u:%02u\n\n",
+		localTime.tm_mday, localTime.tm_mon + 1, 1900 + localTime.tm_year,
+		localTime.tm_hour, localTime.tm_min, localTime.tm_sec);
+
+	fprintf(fp, "Events (oldest first, seconds before the dump):\n");
+
+	for (Uint32 ticket = next - count; ticket != next; ticket++)
+	{
+		FlightEvent& event = _events[ticket % FLIGHT_RECORDER_SIZE];
+
+		// copy first, then make sure nobody started overwriting it in the meantime
+		if (event.Sequence.load(std::memory_order_acquire) != ticket + 1)
+			continue;
+
+		Uint64 eventTime = event.Time;
+		FlightEventType type = event.Type;
+		char text[FLIGHT_RECORDER_TEXT_SIZE];
+		memcpy(text, event.Text, sizeof(text));
+		text[FLIGHT_RECORDER_TEXT_SIZE - 1] = '\0';
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (event.Sequence.load(std::memory_order_relaxed) != ticket + 1)
+			continue;
+
+		double age = (eventTime <= now ? (now - eventTime) / frequency : 0.0);
+		fprintf(fp, "[%9.3f] %-8s %s\n", -age, EventTypeNames[type], text);
+	}
+
+	if (Profiler::getSingletonPtr() != NULL)
+	{
+		fprintf(fp, "\nFrames:\n");
+		sProfiler.WriteCSV(fp);
+	}
+
+	fclose(fp);
+
+	if (Log::getSingletonPtr() != NULL)
+		sLog.Status("FlightRecorder", "Dumped %u events to %s", count, dumpPath.generic_string().c_str());
+	return true;
+}
+
+FlightRecorder::~FlightRecorder()
+{
+	delete [] _events;
+	_events = NULL;
+}
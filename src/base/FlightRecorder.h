@@ -0,0 +1,88 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _FLIGHTRECORDER_H
+#define _FLIGHTRECORDER_H
+#pragma once
+
+#include <atomic>
+
+// events kept in memory; older ones are overwritten
+#define FLIGHT_RECORDER_SIZE	2048
+
+#define FLIGHT_RECORDER_TEXT_SIZE	128
+
+enum FlightEventType
+{
+	fetLog,
+	fetScreen,
+	fetTextureLoad,
+	fetTextureUnload,
+	fetGlyphMiss,
+	fetAudio,
+
+	fetCount
+};
+
+struct FlightEvent
+{
+	// 0 while being written, otherwise the event's ticket + 1
+	std::atomic<Uint32>	Sequence;
+	Uint64				Time;	// performance counter
+	FlightEventType		Type;
+	char				Text[FLIGHT_RECORDER_TEXT_SIZE];
+};
+
+/**
+ * Keeps the most recent log lines, screen changes and resource events in a
+ * fixed ring, so there's something to look at after a crash on a machine
+ * without a debugger. Dumped along with the profiler's frame history to
+ * LogPath on critical errors and with Ctrl+Shift+F11.
+ *
+ * Recording never blocks or allocates and is safe from any thread.
+ */
+class FlightRecorder : public Singleton<FlightRecorder>
+{
+public:
+	FlightRecorder();
+
+	// Does nothing if there is no flight recorder.
+	static void Record(FlightEventType type, const char * format, ...);
+
+	// The same for a log message, formatted behind its level prefix and context (if any).
+	static void RecordLog(const char * prefix, const char * context, const char * format, va_list args);
+
+	// Writes flight_<date>.txt to LogPath, `reason` ends up in its header.
+	bool Dump(const char * reason);
+
+	~FlightRecorder();
+
+private:
+	void RecordV(FlightEventType type, const char * prefix, const char * context, const char * format, va_list args);
+
+	FlightEvent *			_events;
+	std::atomic<Uint32>		_next;
+};
+
+#define sFlightRecorder (FlightRecorder::getSingleton())
+
+#endif
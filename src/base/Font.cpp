@@ -23,6 +23,11 @@
 #include "stdafx.h"
 #include "Font.h"
 #include "Log.h"
+#include "Profiler.h"
+#include "Tracer.h"
+#include "FlightRecorder.h"
+#include "Renderer.h"
+#include "QualityGovernor.h"
 
 static FreeType s_ftLibrary;
 
@@ -114,66 +119,65 @@ void FontBase::PrintLines(const LineArray& lines, bool reflectionPass /*= false*
 {
 	// Recursively call this function to draw reflected text.
 	if (!reflectionPass
-		&& (Style & fsReflect))
+		&& (Style & fsReflect)
+		&& QualityGovernor::ReflectionsEnabled())
 		PrintLines(lines, true);
 
-	// Store current colour, enable flags, matrix mode
-	glPushAttrib(GL_CURRENT_BIT | GL_ENABLE_BIT | GL_TRANSFORM_BIT);
+	// Store current colour and enable flags
+	sRenderer.PushState();
 
-	// Set OpenGL state
-	glMatrixMode(GL_MODELVIEW);
-	glDisable(GL_DEPTH_TEST);
-	glEnable(GL_BLEND);
-	glEnable(GL_TEXTURE_2D);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	// Set render state
+	sRenderer.SetDepthTest(false);
+	sRenderer.SetBlending(true);
+	sRenderer.SetTexturing(true);
 
 #ifdef FLIP_YAXIS
-	glPushMatrix();
-	glScalef(1.0f, -1.0f, 1.0f);
+	sRenderer.PushMatrix();
+	sRenderer.Scale(1.0f, -1.0f, 1.0f);
 #endif
 
 	// Display text
 	for (size_t lineIndex = 0; lineIndex < lines.size(); lineIndex++)
 	{
-		glPushMatrix();
+		sRenderer.PushMatrix();
 
 		// Move to baseline
-		glTranslatef(0.0f, -LineSpacing * lineIndex, 0.0f);
+		sRenderer.Translate(0.0f, -LineSpacing * lineIndex, 0.0f);
 
 		// Draw underline
 		if (!reflectionPass
 			&& (Style & fsUnderline))
 		{
-			glDisable(GL_TEXTURE_2D);
+			sRenderer.SetTexturing(false);
 			DrawUnderline(lines[lineIndex]);
-			glEnable(GL_TEXTURE_2D);
+			sRenderer.SetTexturing(true);
 		}
 
 		// Draw reflection
 		if (reflectionPass)
 		{
 			// Set reflection spacing
-			glTranslatef(0.0f, -ReflectionSpacing, 0.0f);
+			sRenderer.Translate(0.0f, -ReflectionSpacing, 0.0f);
 
 			// Flip y-axis
-			glScalef(1.0f, -1.0f, 1.0f);
+			sRenderer.Scale(1.0f, -1.0f, 1.0f);
 		}
 
 		// Shear for italic effect
 		if (Style & fsItalic)
-			glMultMatrixf((const GLfloat *)&cShearMatrix);
+			sRenderer.MultMatrix((const GLfloat *)&cShearMatrix);
 
 		// Render text line
 		Render(lines[lineIndex], reflectionPass);
 
-		glPopMatrix();
+		sRenderer.PopMatrix();
 	}
 
 	// Restore settings
 #ifdef FLIP_YAXIS
-	glPopMatrix();
+	sRenderer.PopMatrix();
 #endif
-	glPopAttrib();
+	sRenderer.PopState();
 }
 
 void FontBase::Print(const std::string& text)
@@ -188,7 +192,7 @@ void FontBase::DrawUnderline(const std::string& line)
 	float	y1 = GetUnderlinePosition(),
 			y2 = y1 + GetUnderlineThickness();
 	FontBounds bounds = BBox(line, false);
-	glRectf(bounds.Left, y1, bounds.Right, y2);
+	sRenderer.DrawRect(bounds.Left, y1, bounds.Right, y2);
 }
 
 FontBounds FontBase::BBox(const std::string& text, bool advance /*= true*/)
@@ -279,7 +283,7 @@ FontBase * ScalableFont::ChooseMipmapFont()
 	// since the mipmap font (if level > 0) is smaller than the base-font
 	// we have to scale to get its size right.
 	float MipmapScale = MipmapFonts[0]->GetHeight() / result->GetHeight();
-	glScalef(MipmapScale, MipmapScale, 0);
+	sRenderer.Scale(MipmapScale, MipmapScale, 0);
 
 	return result;
 }
@@ -342,8 +346,8 @@ int ScalableFont::GetMipmapLevel()
 	double Dist, Dist2, DistSum, WidthScale, HeightScale;
 
 	// 1. Retrieve current transformation matrices for gluProject
-	glGetDoublev(GL_MODELVIEW_MATRIX, ModelMatrix);
-	glGetDoublev(GL_PROJECTION_MATRIX, ProjMatrix);
+	sRenderer.GetModelView(ModelMatrix);
+	sRenderer.GetProjection(ProjMatrix);
 	glGetIntegerv(GL_VIEWPORT, ViewportArray);
 
 	// 2. Project 3 of the corner points of a square with size cTestSize
@@ -406,10 +410,10 @@ int ScalableFont::GetMipmapLevel()
 
 void ScalableFont::PrintLines(const LineArray& lines, bool reflectionPass /*= false*/)
 {
-	glPushMatrix();
+	sRenderer.PushMatrix();
 
 	// set scale and stretching
-	glScalef(Scale * Stretch, Scale, 0.0f);
+	sRenderer.Scale(Scale * Stretch, Scale, 0.0f);
 
 	// print text
 	if (UseMipmaps)
@@ -417,7 +421,7 @@ void ScalableFont::PrintLines(const LineArray& lines, bool reflectionPass /*= fa
 	else
 		BaseFont->PrintLines(lines);
 
-	glPopMatrix();
+	sRenderer.PopMatrix();
 }
 
 void ScalableFont::Render(const std::string& text, bool reflectionPass)
@@ -591,6 +595,8 @@ FTGlyph::FTGlyph(FTFont * font, char ch, float outset, Uint32 loadFlags)
 
 void FTGlyph::CreateTexture(Uint32 loadFlags)
 {
+	TRACE_SCOPE("Rasterize glyph");
+
 	FT_Glyph glyph;
 	FT_BitmapGlyph BitmapGlyph;
 	FT_Bitmap * Bitmap;
@@ -707,7 +713,7 @@ void FTGlyph::CreateTexture(Uint32 loadFlags)
 	glGenTextures(1, &Texture);
 
 	// setup texture parameters
-	glBindTexture(GL_TEXTURE_2D, Texture);
+	sRenderer.BindTexture(Texture);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -720,19 +726,22 @@ void FTGlyph::CreateTexture(Uint32 loadFlags)
 	// (1,1) to the bottom right pixel. So the glyph is flipped as OpenGL uses
 	// a cartesian (y-axis up) coordinate system for textures.   
 	// See the cTexSmoothBorder comment for info on texture borders.
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, TexSize.Width, TexSize.Height,
-		0, GL_ALPHA, GL_UNSIGNED_BYTE, &TexBuffer[0]);
+	sRenderer.TexImageAlpha(TexSize.Width, TexSize.Height, &TexBuffer[0]);
+	PROFILE_COUNT(pcTextureUploads);
 
 	// free expanded data
 	delete [] TexBuffer;
 
-	// create the display list
-	DisplayList = glGenLists(1);
+	// create the display list (not available with every renderer)
+	if (sRenderer.SupportsDisplayLists())
+	{
+		DisplayList = glGenLists(1);
 
-	// render to display-list
-	glNewList(DisplayList, GL_COMPILE);
-	Render(false);
-	glEndList();
+		// render to display-list
+		glNewList(DisplayList, GL_COMPILE);
+		Render(false);
+		glEndList();
+	}
 
 	// free glyph data (bitmap, etc.)
 	FT_Done_Glyph(glyph);
@@ -859,37 +868,37 @@ void FTGlyph::Render(bool useDisplayLists)
 	if (useDisplayLists)
 	{
 		glCallList(DisplayList);
+		PROFILE_COUNT(pcDrawCalls);
 		return;
 	}
 
-	glBindTexture(GL_TEXTURE_2D, Texture);
-	glPushMatrix();
+	sRenderer.BindTexture(Texture);
+	PROFILE_COUNT(pcTextureBinds);
+	sRenderer.PushMatrix();
 
 	// move to top left glyph position
-	glTranslated(BitmapCoords.Left, BitmapCoords.Top, 0);
+	sRenderer.Translate((float) BitmapCoords.Left, (float) BitmapCoords.Top, 0);
 
 	// draw glyph texture
-	glBegin(GL_QUADS);
-
-	// top right
-	glTexCoord2f(TexOffset.X, 0);
-	glVertex2i(BitmapCoords.Width, 0);
+	RenderVertex vertices[4] =
+	{
+		// top right
+		sRenderer.MakeVertex((float) BitmapCoords.Width, 0, 0, TexOffset.X, 0),
 
-	// top left
-	glTexCoord2f(0, 0);
-	glVertex2f(0, 0);
+		// top left
+		sRenderer.MakeVertex(0, 0, 0, 0, 0),
 
-	// bottom left
-	glTexCoord2f(0, TexOffset.Y);
-	glVertex2i(0, -BitmapCoords.Height);
+		// bottom left
+		sRenderer.MakeVertex(0, (float) -BitmapCoords.Height, 0, 0, TexOffset.Y),
 
-	// bottom right
-	glTexCoord2f(TexOffset.X, TexOffset.Y);
-	glVertex2i(BitmapCoords.Width, -BitmapCoords.Height);
+		// bottom right
+		sRenderer.MakeVertex((float) BitmapCoords.Width, (float) -BitmapCoords.Height, 0, TexOffset.X, TexOffset.Y)
+	};
 
-	glEnd();
+	sRenderer.DrawQuads(vertices, 4);
+	PROFILE_COUNT(pcDrawCalls);
 
-	glPopMatrix();
+	sRenderer.PopMatrix();
 }
 
 void FTGlyph::RenderReflection()
@@ -900,12 +909,13 @@ void FTGlyph::RenderReflection()
 	float Descender;
 	double UpperPos, TexUpperPos, TexLowerPos;
 
-	glPushMatrix();
-	glBindTexture(GL_TEXTURE_2D, Texture);
-	glGetFloatv(GL_CURRENT_COLOR, Color.vals);
+	sRenderer.PushMatrix();
+	sRenderer.BindTexture(Texture);
+	PROFILE_COUNT(pcTextureBinds);
+	memcpy(Color.vals, sRenderer.GetColor(), sizeof(Color.vals));
 
 	// add extra space to the left of the glyph
-	glTranslated(BitmapCoords.Left, 0.0, 0.0);
+	sRenderer.Translate((float) BitmapCoords.Left, 0.0f, 0.0f);
 
 	Descender = Font->GetDescender();
 
@@ -930,32 +940,29 @@ void FTGlyph::RenderReflection()
 					BitmapCoords.Height + 1) * TexOffset.Y;
 
 	// draw glyph texture
-	glBegin(GL_QUADS);
+	RenderVertex vertices[4];
+
 	// top right
-	glColor4f(Color.R, Color.G, Color.B, 0);
-	glTexCoord2d(TexOffset.X, TexUpperPos);
-	glVertex2d(BitmapCoords.Width, UpperPos);
+	sRenderer.SetColor(Color.R, Color.G, Color.B, 0);
+	vertices[0] = sRenderer.MakeVertex((float) BitmapCoords.Width, (float) UpperPos, 0, TexOffset.X, (float) TexUpperPos);
 
 	// top left
-	glTexCoord2d(0.0, TexUpperPos);
-	glVertex2d(0.0, UpperPos);
+	vertices[1] = sRenderer.MakeVertex(0.0f, (float) UpperPos, 0, 0.0f, (float) TexUpperPos);
 
 	// bottom left
-	glColor4f(Color.R, Color.G, Color.B, Color.A - 0.3f);
-	glTexCoord2d(0.0, TexLowerPos);
-	glVertex2f(0.0f, Descender);
+	sRenderer.SetColor(Color.R, Color.G, Color.B, Color.A - 0.3f);
+	vertices[2] = sRenderer.MakeVertex(0.0f, Descender, 0, 0.0f, (float) TexLowerPos);
 
 	// bottom right
-	glTexCoord2d(TexOffset.X, TexLowerPos);
-	glVertex2f((GLfloat) BitmapCoords.Width, Descender);
-	glEnd();
+	vertices[3] = sRenderer.MakeVertex((float) BitmapCoords.Width, Descender, 0, TexOffset.X, (float) TexLowerPos);
+
+	sRenderer.DrawQuads(vertices, 4);
+	PROFILE_COUNT(pcDrawCalls);
 
-	glPopMatrix();
+	sRenderer.PopMatrix();
 
 	// restore old color
-	// Note: glPopAttrib(GL_CURRENT_BIT)/glPopAttrib() is much slower then
-	// glGetFloatv(GL_CURRENT_COLOR, ...)/glColor4fv(...)
-	glColor4fv(Color.vals);
+	sRenderer.SetColorv(Color.vals);
 }
 
 const FontPosition& FTGlyph::GetAdvance()
@@ -984,6 +991,8 @@ Glyph * CachedFont::GetGlyph(char ch)
 	if (glyph != NULL)
 		return glyph;
 
+	PROFILE_COUNT(pcGlyphCacheMisses);
+	FlightRecorder::Record(fetGlyphMiss, "'%c' (0x%02X) in %s", (ch >= 0x20 ? ch : '?'), (Uint8) ch, Filename.filename().generic_string().c_str());
 	glyph = LoadGlyph(ch);
 	if (Cache.AddGlyph(ch, glyph))
 		return glyph;
@@ -1142,7 +1151,7 @@ void FTOutlineFont::DrawUnderline(const std::string& line)
 	GLColor currentColor, outlineColor;
 
 	// save current color
-	glGetFloatv(GL_CURRENT_COLOR, currentColor.vals);
+	memcpy(currentColor.vals, sRenderer.GetColor(), sizeof(currentColor.vals));
 
 	// if the outline's alpha component is < 0 use the current alpha
 	outlineColor = OutlineColor;
@@ -1150,17 +1159,17 @@ void FTOutlineFont::DrawUnderline(const std::string& line)
 		outlineColor.A = currentColor.A;
 
 	// draw underline outline (in outline color)
-	glColor4fv(outlineColor.vals);
-	glPushMatrix();
+	sRenderer.SetColorv(outlineColor.vals);
+	sRenderer.PushMatrix();
 	OutlineFont->DrawUnderline(line);
-	glPopMatrix();
+	sRenderer.PopMatrix();
 
 	// draw underline inner part (in current color)
-	glColor4fv(currentColor.vals);
-	glTranslatef(Outset, 0.0f, 0.0f);
-	glPushMatrix();
+	sRenderer.SetColorv(currentColor.vals);
+	sRenderer.Translate(Outset, 0.0f, 0.0f);
+	sRenderer.PushMatrix();
 	InnerFont->DrawUnderline(line);
-	glPopMatrix();
+	sRenderer.PopMatrix();
 }
 
 void FTOutlineFont::Render(const std::string& line, bool reflectionPass)
@@ -1168,7 +1177,7 @@ void FTOutlineFont::Render(const std::string& line, bool reflectionPass)
 	GLColor currentColor, outlineColor;
 
 	// save current color
-	glGetFloatv(GL_CURRENT_COLOR, currentColor.vals);
+	memcpy(currentColor.vals, sRenderer.GetColor(), sizeof(currentColor.vals));
 
 	// if the outline's alpha component is < 0 use the current alpha
 	outlineColor = OutlineColor;
@@ -1176,17 +1185,17 @@ void FTOutlineFont::Render(const std::string& line, bool reflectionPass)
 		outlineColor.A = currentColor.A;
 
 	// setup and render outline font
-	glColor4fv(outlineColor.vals);
-	glPushMatrix();
+	sRenderer.SetColorv(outlineColor.vals);
+	sRenderer.PushMatrix();
 	OutlineFont->Render(line, reflectionPass);
-	glPopMatrix();
+	sRenderer.PopMatrix();
 
 	// setup and render inner font
-	glColor4fv(currentColor.vals);
-	glTranslatef(Outset, Outset, 0.0f);
-	glPushMatrix();
+	sRenderer.SetColorv(currentColor.vals);
+	sRenderer.Translate(Outset, Outset, 0.0f);
+	sRenderer.PushMatrix();
 	InnerFont->Render(line, reflectionPass);
-	glPopMatrix();
+	sRenderer.PopMatrix();
 }
 
 FontBounds FTOutlineFont::BBoxLines(const LineArray& lines, bool advance)
@@ -1312,7 +1321,7 @@ FTFont::FTFont(const path& filename,
 	Outset = outset;
 	PreCache = preCache;
 	LoadFlags = loadFlags;
-	UseDisplayLists = true;
+	UseDisplayLists = sRenderer.SupportsDisplayLists();
 	Part = fpNone;
 	Face = GetFaceCache().LoadFace(filename, size);
 	Face->IncRef();
@@ -1491,7 +1500,7 @@ void FTFont::Render(const std::string& text, bool reflectionPass /*= false*/)
 				FT_Vector KernDelta;
 				FT_Get_Kerning(Face->Face, PrevGlyph->CharIndex, Glyph->CharIndex,
 							   FT_KERNING_UNSCALED, &KernDelta);
-				glTranslatef(KernDelta.x * Face->FontUnitScale.X, 0, 0);
+				sRenderer.Translate(KernDelta.x * Face->FontUnitScale.X, 0, 0);
 			}
 
 			if (reflectionPass)
@@ -1499,7 +1508,7 @@ void FTFont::Render(const std::string& text, bool reflectionPass /*= false*/)
 			else
 				Glyph->Render(UseDisplayLists);
 
-			glTranslatef(Glyph->Advance.X + GlyphSpacing, 0.0f, 0.0f);
+			sRenderer.Translate(Glyph->Advance.X + GlyphSpacing, 0.0f, 0.0f);
 		}
 
 		PrevGlyph = Glyph;
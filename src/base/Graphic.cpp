@@ -30,6 +30,7 @@
 #include "Themes.h"
 #include "TextureMgr.h"
 #include "Skins.h"
+#include "Renderer.h"
 
 #include "../menu/Display.h"
 #include "../menu/Menu.h"
@@ -38,6 +39,10 @@
 
 #define WINDOW_ICON "ultrastardx-icon.png"
 
+// fixed per-screen resolution used in headless mode unless --resolution is given
+#define HEADLESS_WIDTH	800
+#define HEADLESS_HEIGHT	600
+
 using namespace boost::filesystem;
 
 extern path ResourcesPath;
@@ -61,50 +66,50 @@ int Screens, ScreenAct, ScreenX;
 bool Fullscreen;
 
 // Screens
-ScreenLoading			* UILoading = NULL;
-ScreenMain				* UIMain = NULL;
-ScreenName				* UIName = NULL;
-ScreenLevel				* UILevel = NULL;
-ScreenSong				* UISong = NULL;
-ScreenSing				* UISing = NULL;
-ScreenScore				* UIScore = NULL;
-ScreenTop5				* UITop5 = NULL;
-ScreenOptions			* UIOptions = NULL;
-ScreenOptionsGame		* UIOptionsGame = NULL;
-ScreenOptionsGraphics	* UIOptionsGraphics = NULL;
-ScreenOptionsSound		* UIOptionsSound = NULL;
-ScreenOptionsLyrics		* UIOptionsLyrics = NULL;
-ScreenOptionsThemes		* UIOptionsThemes = NULL;
-ScreenOptionsRecord		* UIOptionsRecord = NULL;
-ScreenOptionsAdvanced	* UIOptionsAdvanced = NULL;
-ScreenEditSub			* UIEditSub = NULL;
-ScreenEdit				* UIEdit = NULL;
-ScreenEditConvert		* UIEditConvert = NULL;
-ScreenEditHeader		* UIEditHeader = NULL;
-ScreenOpen				* UIOpen = NULL;
-
-ScreenSongMenu			* UISongMenu = NULL;
-ScreenSongJumpTo		* UISongJumpTo = NULL;
+LazyScreen<ScreenLoading>			UILoading("Loading");
+LazyScreen<ScreenMain>				UIMain("Main");
+LazyScreen<ScreenName>				UIName("Name");
+LazyScreen<ScreenLevel>				UILevel("Level");
+LazyScreen<ScreenSong>				UISong("Song");
+LazyScreen<ScreenSing>				UISing("Sing");
+LazyScreen<ScreenScore>				UIScore("Score");
+LazyScreen<ScreenTop5>				UITop5("Top5");
+LazyScreen<ScreenOptions>			UIOptions("Options");
+LazyScreen<ScreenOptionsGame>		UIOptionsGame("OptionsGame");
+LazyScreen<ScreenOptionsGraphics>	UIOptionsGraphics("OptionsGraphics");
+LazyScreen<ScreenOptionsSound>		UIOptionsSound("OptionsSound");
+LazyScreen<ScreenOptionsLyrics>		UIOptionsLyrics("OptionsLyrics");
+LazyScreen<ScreenOptionsThemes>		UIOptionsThemes("OptionsThemes");
+LazyScreen<ScreenOptionsRecord>		UIOptionsRecord("OptionsRecord");
+LazyScreen<ScreenOptionsAdvanced>	UIOptionsAdvanced("OptionsAdvanced");
+LazyScreen<ScreenEditSub>			UIEditSub("EditSub");
+LazyScreen<ScreenEdit>				UIEdit("Edit");
+LazyScreen<ScreenEditConvert>		UIEditConvert("EditConvert");
+LazyScreen<ScreenEditHeader>		UIEditHeader("EditHeader");
+LazyScreen<ScreenOpen>				UIOpen("Open");
+
+LazyScreen<ScreenSongMenu>			UISongMenu("SongMenu");
+LazyScreen<ScreenSongJumpTo>		UISongJumpTo("SongJumpTo");
 
 // Party screens
-ScreenPartyNewRound		* UIPartyNewRound = NULL;
-ScreenPartyScore		* UIPartyScore = NULL;
-ScreenPartyWin			* UIPartyWin = NULL;
-ScreenPartyOptions		* UIPartyOptions = NULL;
-ScreenPartyPlayer		* UIPartyPlayer = NULL;
-ScreenPartyRounds		* UIPartyRounds = NULL;
+LazyScreen<ScreenPartyNewRound>		UIPartyNewRound("PartyNewRound");
+LazyScreen<ScreenPartyScore>		UIPartyScore("PartyScore");
+LazyScreen<ScreenPartyWin>			UIPartyWin("PartyWin");
+LazyScreen<ScreenPartyOptions>		UIPartyOptions("PartyOptions");
+LazyScreen<ScreenPartyPlayer>		UIPartyPlayer("PartyPlayer");
+LazyScreen<ScreenPartyRounds>		UIPartyRounds("PartyRounds");
 
 // Stats screens
-ScreenStatMain			* UIStatMain = NULL;
-ScreenStatDetail		* UIStatDetail = NULL;
+LazyScreen<ScreenStatMain>			UIStatMain("StatMain");
+LazyScreen<ScreenStatDetail>		UIStatDetail("StatDetail");
 
 // Credits screen
-ScreenCredits			* UICredits = NULL;
+LazyScreen<ScreenCredits>			UICredits("Credits");
 
 // Popups
-ScreenPopupCheck		* UIPopupCheck = NULL;
-ScreenPopupError		* UIPopupError = NULL;
-ScreenPopupInfo			* UIPopupInfo = NULL;
+LazyScreen<ScreenPopupCheck>		UIPopupCheck("PopupCheck");
+LazyScreen<ScreenPopupError>		UIPopupError("PopupError");
+LazyScreen<ScreenPopupInfo>			UIPopupInfo("PopupInfo");
 
 // Notes
 Texture TexNoteLeft[6];      // formerly Tex_Left
@@ -153,9 +158,6 @@ Texture TexCursorUnpressed, TexCursorPressed;
 
 bool PboSupported = false;
 
-typedef std::set<Menu *> ScreenCollection;
-ScreenCollection		g_screenCollection;
-
 static const struct SDL_PixelFormat PixelFmt_RGBA =
 {
 	/*format:*/         SDL_PIXELFORMAT_RGBA8888,
@@ -288,18 +290,45 @@ void Initialize3D(const char * windowTitle)
 	SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE,    16); // Z-Buffer depth
 	SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER,  1);
 
+	// Select the render backend, its context attributes have to be set before the window is created
+	RenderBackend backend = rbLegacy;
+	if (!Params.RendererName.empty()
+		&& !Renderer::ParseBackend(Params.RendererName, &backend))
+		sLog.Error("Initialize3D", "Unknown renderer \"%s\", using the legacy renderer.", Params.RendererName.c_str());
+
+	Renderer::SetContextAttributes(backend);
+
 	// Specify fullscreen mode
 	if (Params.ScreenMode != scmDefault)
 		Fullscreen = (Params.ScreenMode == scmFullscreen);
 	else
 		Fullscreen = (sIni.FullScreen == Switch::On);
 
-	sLog.Status("Initialize3D", "SDL_CreateWindow (%s)", Fullscreen ? "fullscreen" : "windowed");
 	Uint32 flags = SDL_WINDOW_OPENGL;
-	if (Fullscreen)
-		flags |= SDL_WINDOW_FULLSCREEN;
+
+	// Headless mode renders into a hidden window of the offscreen video driver
+	// (selected in usdxMain) at a fixed resolution, so results are comparable between machines.
+	if (Params.Headless)
+	{
+		Fullscreen = false;
+		if (Params.Resolution.empty()
+			|| !ExtractResolution(Params.Resolution, &resolution.first, &resolution.second))
+			resolution = ResolutionWH(HEADLESS_WIDTH, HEADLESS_HEIGHT);
+
+		resolution.first *= Screens;
+		flags |= SDL_WINDOW_HIDDEN;
+
+		sLog.Status("Initialize3D", "SDL_CreateWindow (headless %dx%d, video driver: %s)",
+			resolution.first, resolution.second, SDL_GetCurrentVideoDriver());
+	}
 	else
-		flags |= SDL_WINDOW_RESIZABLE;
+	{
+		sLog.Status("Initialize3D", "SDL_CreateWindow (%s)", Fullscreen ? "fullscreen" : "windowed");
+		if (Fullscreen)
+			flags |= SDL_WINDOW_FULLSCREEN;
+		else
+			flags |= SDL_WINDOW_RESIZABLE;
+	}
 
 	Screen = SDL_CreateWindow(windowTitle, 
 		SDL_WINDOWPOS_CENTERED,
@@ -316,6 +345,38 @@ void Initialize3D(const char * windowTitle)
 
 	// Create an OpenGL context
 	GLContext = SDL_GL_CreateContext(Screen);
+	if (backend != rbLegacy)
+	{
+		if (GLContext != NULL
+			&& Renderer::Create(backend) == NULL)
+		{
+			SDL_GL_DeleteContext(GLContext);
+			GLContext = NULL;
+		}
+
+		// The legacy renderer needs a compatibility context, so start over with one.
+		if (GLContext == NULL)
+		{
+			sLog.Warn("Initialize3D", "Renderer \"%s\" is not available, falling back to the legacy renderer.",
+				Params.RendererName.c_str());
+
+			backend = rbLegacy;
+			Renderer::SetContextAttributes(backend);
+			GLContext = SDL_GL_CreateContext(Screen);
+		}
+	}
+
+	if (GLContext == NULL)
+		return sLog.Critical("Initialize3D", "SDL_GL_CreateContext() failed: %s", SDL_GetError());
+
+	if (backend == rbLegacy)
+		Renderer::Create(backend);
+
+	sLog.Status("Initialize3D", "Renderer: %s (OpenGL %s)", sRenderer.GetName(), (const char *) glGetString(GL_VERSION));
+
+	// Don't let vsync skew headless render timings
+	if (Params.Headless)
+		SDL_GL_SetSwapInterval(0);
 
 	// Hide cursor
 	SDL_ShowCursor(0);
@@ -340,7 +401,10 @@ void Initialize3D(const char * windowTitle)
 	LoadTextures();
 
 	sLog.Status("Initialize3D", "Loading screens");
-	LoadScreens();
+	{
+		BenchmarkScope benchmark(2, "Loading screens");
+		LoadScreens();
+	}
 
 	// TODO:
 	// Here should be a loop which
@@ -356,12 +420,8 @@ void Initialize3D(const char * windowTitle)
 	// for itself, it should change mutex
 	// the mainthread have to know somehow what opengl function have to be called with which parameters like
 	// texturetype, textureobject, texture-buffer-adress, ...
-	
-	assert(sDisplay.CurrentScreen != NULL);
-	sDisplay.CurrentScreen->FadeTo(UIMain);
 
-	sLog.BenchmarkEnd(2);
-	sLog.Benchmark(2, "Loading screens");
+	// NOTE: The loading screen stays up until usdxMain() has finished the remaining startup steps.
 
 	sLog.Status("Initialize3D", "Finished");
 }
@@ -378,27 +438,10 @@ void UnloadFontTextures()
 	KillFonts();
 }
 
-#define LOAD_SCREEN(name) \
-	LoadScreen(UI ## name, #name)
-
-template <typename T>
-void LoadScreen(T *& p, char * name)
-{
-	assert(p == NULL);
-	sLog.BenchmarkStart(3);
-	sLog.Benchmark(3, "====> Screen %s", name);
-	p = new T();
-	sLog.BenchmarkEnd(3);
-
-	// Add screen to collection.
-	g_screenCollection.insert(p);
-}
-
 void LoadLoadingScreen()
 {
-	assert(UILoading == NULL);
+	assert(!UILoading.IsCreated());
 
-	LOAD_SCREEN(Loading);
 	UILoading->OnShow();
 
 	sDisplay.CurrentScreen = UILoading;
@@ -415,6 +458,7 @@ void LoadTextures()
 	sLog.Status("LoadTextures", "Loading textures");
 	
 	// TODO: Do it once for each player...
+	// Note: theme colours are numbered from 1, the texture arrays from 0.
 	for (int player = 1; player <= MAX_PLAYERS; player++)
 	{
 		sThemes.LoadColor(rgb, "P%dLight", player);
@@ -422,24 +466,24 @@ void LoadTextures()
 			+ 0x100 * (Uint32) Round(rgb.G * 255)
 			+ (Uint32) Round(rgb.B * 255);
 
-		TexNoteLeft[player]			= sTextureMgr.LoadTexture(sSkins.GetTextureFileName("GrayLeft"), TextureType::Colorized, Col);
-		TexNoteMid[player]			= sTextureMgr.LoadTexture(sSkins.GetTextureFileName("GrayMid"), TextureType::Colorized, Col);
-		TexNoteRight[player]		= sTextureMgr.LoadTexture(sSkins.GetTextureFileName("GrayRight"), TextureType::Colorized, Col);
+		TexNoteLeft[player - 1]			= sTextureMgr.LoadTexture(sSkins.GetTextureFileName("GrayLeft"), TextureType::Colorized, Col);
+		TexNoteMid[player - 1]			= sTextureMgr.LoadTexture(sSkins.GetTextureFileName("GrayMid"), TextureType::Colorized, Col);
+		TexNoteRight[player - 1]		= sTextureMgr.LoadTexture(sSkins.GetTextureFileName("GrayRight"), TextureType::Colorized, Col);
 
-		TexNoteBGLeft[player]		= sTextureMgr.LoadTexture(sSkins.GetTextureFileName("NotePlainLeft"), TextureType::Colorized, Col);
-		TexNoteBGMid[player]		= sTextureMgr.LoadTexture(sSkins.GetTextureFileName("NotePlainMid"), TextureType::Colorized, Col);
-		TexNoteBGRight[player]		= sTextureMgr.LoadTexture(sSkins.GetTextureFileName("NotePlainRight"), TextureType::Colorized, Col);
+		TexNoteBGLeft[player - 1]		= sTextureMgr.LoadTexture(sSkins.GetTextureFileName("NotePlainLeft"), TextureType::Colorized, Col);
+		TexNoteBGMid[player - 1]		= sTextureMgr.LoadTexture(sSkins.GetTextureFileName("NotePlainMid"), TextureType::Colorized, Col);
+		TexNoteBGRight[player - 1]		= sTextureMgr.LoadTexture(sSkins.GetTextureFileName("NotePlainRight"), TextureType::Colorized, Col);
 
-		TexNoteGlowLeft[player]		= sTextureMgr.LoadTexture(sSkins.GetTextureFileName("NoteBGLeft"), TextureType::Colorized, Col);
-		TexNoteGlowMid[player]		= sTextureMgr.LoadTexture(sSkins.GetTextureFileName("NoteBGMid"), TextureType::Colorized, Col);
-		TexNoteGlowRight[player]	= sTextureMgr.LoadTexture(sSkins.GetTextureFileName("NoteBGRight"), TextureType::Colorized, Col);
+		TexNoteGlowLeft[player - 1]		= sTextureMgr.LoadTexture(sSkins.GetTextureFileName("NoteBGLeft"), TextureType::Colorized, Col);
+		TexNoteGlowMid[player - 1]		= sTextureMgr.LoadTexture(sSkins.GetTextureFileName("NoteBGMid"), TextureType::Colorized, Col);
+		TexNoteGlowRight[player - 1]	= sTextureMgr.LoadTexture(sSkins.GetTextureFileName("NoteBGRight"), TextureType::Colorized, Col);
 
 		// Backgrounds for the scores
-		TexScoreBG[player]			= sTextureMgr.LoadTexture(sSkins.GetTextureFileName("ScoreBG"), TextureType::Colorized, Col);
+		TexScoreBG[player - 1]			= sTextureMgr.LoadTexture(sSkins.GetTextureFileName("ScoreBG"), TextureType::Colorized, Col);
 
 		// Line bonus score bar
-		TexScoreNoteBarLevelLight[player]	= sTextureMgr.LoadTexture(sSkins.GetTextureFileName("ScoreLevel_Light"), TextureType::Colorized, Col);
-		TexScoreNoteBarRoundLight[player]	= sTextureMgr.LoadTexture(sSkins.GetTextureFileName("ScoreLevel_Light_Round"), TextureType::Colorized, Col);
+		TexScoreNoteBarLevelLight[player - 1]	= sTextureMgr.LoadTexture(sSkins.GetTextureFileName("ScoreLevel_Light"), TextureType::Colorized, Col);
+		TexScoreNoteBarRoundLight[player - 1]	= sTextureMgr.LoadTexture(sSkins.GetTextureFileName("ScoreLevel_Light_Round"), TextureType::Colorized, Col);
 
 		// Note bar score bar
 		sThemes.LoadColor(rgb, "P%dDark", player);
@@ -447,8 +491,8 @@ void LoadTextures()
 			+ 0x100 * (Uint32) Round(rgb.G * 255)
 			+ (Uint32) Round(rgb.B * 255);
 
-		TexScoreNoteBarLevelDark[player]	= sTextureMgr.LoadTexture(sSkins.GetTextureFileName("ScoreLevel_Dark"), TextureType::Colorized, Col);
-		TexScoreNoteBarRoundDark[player]	= sTextureMgr.LoadTexture(sSkins.GetTextureFileName("ScoreLevel_Dark_Round"), TextureType::Colorized, Col);
+		TexScoreNoteBarLevelDark[player - 1]	= sTextureMgr.LoadTexture(sSkins.GetTextureFileName("ScoreLevel_Dark"), TextureType::Colorized, Col);
+		TexScoreNoteBarRoundDark[player - 1]	= sTextureMgr.LoadTexture(sSkins.GetTextureFileName("ScoreLevel_Dark_Round"), TextureType::Colorized, Col);
 
 		// Golden notes score bar
 		sThemes.LoadColor(rgb, "P%dLightest", player);
@@ -456,8 +500,8 @@ void LoadTextures()
 			+ 0x100 * (Uint32) Round(rgb.G * 255)
 			+ (Uint32) Round(rgb.B * 255);
 
-		TexScoreNoteBarLevelLightest[player]	= sTextureMgr.LoadTexture(sSkins.GetTextureFileName("ScoreLevel_Lightest"), TextureType::Colorized, Col);
-		TexScoreNoteBarRoundLightest[player]	= sTextureMgr.LoadTexture(sSkins.GetTextureFileName("ScoreLevel_Lightest_Round"), TextureType::Colorized, Col);
+		TexScoreNoteBarLevelLightest[player - 1]	= sTextureMgr.LoadTexture(sSkins.GetTextureFileName("ScoreLevel_Lightest"), TextureType::Colorized, Col);
+		TexScoreNoteBarRoundLightest[player - 1]	= sTextureMgr.LoadTexture(sSkins.GetTextureFileName("ScoreLevel_Lightest_Round"), TextureType::Colorized, Col);
 	}
 
 	TexNotePerfectStar	= sTextureMgr.LoadTexture(sSkins.GetTextureFileName("NotePerfectStar"), TextureType::Transparent, 0);
@@ -529,48 +573,18 @@ void LoadTextures()
 
 void LoadScreens()
 {
-	LOAD_SCREEN(Main);
-	LOAD_SCREEN(Name);
-	LOAD_SCREEN(Level);
-	LOAD_SCREEN(Song);
-	LOAD_SCREEN(SongMenu);
-	LOAD_SCREEN(Sing);
-	LOAD_SCREEN(Score);
-	LOAD_SCREEN(Top5);
-	LOAD_SCREEN(Options);
-	LOAD_SCREEN(OptionsGame);
-	LOAD_SCREEN(OptionsGraphics);
-	LOAD_SCREEN(OptionsSound);
-	LOAD_SCREEN(OptionsLyrics);
-	LOAD_SCREEN(OptionsThemes);
-	LOAD_SCREEN(OptionsRecord);
-	LOAD_SCREEN(OptionsAdvanced);
-	LOAD_SCREEN(EditSub);
-	LOAD_SCREEN(Edit);
-	LOAD_SCREEN(EditConvert);
-	LOAD_SCREEN(Open);
-	LOAD_SCREEN(SongJumpTo);
-	LOAD_SCREEN(PopupCheck);
-	LOAD_SCREEN(PopupError);
-	LOAD_SCREEN(PopupInfo);
-	LOAD_SCREEN(PartyNewRound);
-	LOAD_SCREEN(PartyScore);
-	LOAD_SCREEN(PartyWin);
-	LOAD_SCREEN(PartyOptions);
-	LOAD_SCREEN(PartyPlayer);
-	LOAD_SCREEN(PartyRounds);
-	LOAD_SCREEN(StatMain);
-	LOAD_SCREEN(StatDetail);
-	LOAD_SCREEN(Credits);
+	// Screens are constructed on first use (see ScreenRegistry).
+	// Only the main menu is needed right away, the screens usually
+	// reached from it are constructed during idle frames.
+	UIMain.Get();
+	QueueLikelyNextScreens(UIMain);
 }
 
 void SwapBuffers()
 {
+	sRenderer.Flush();
 	SDL_GL_SwapWindow(Screen);
-	glMatrixMode(GL_PROJECTION);
-		glLoadIdentity();
-		glOrtho(0, RenderW, RenderH, 0, -1, 100);
-	glMatrixMode(GL_MODELVIEW);
+	sRenderer.SetOrtho(0, (float) RenderW, (float) RenderH, 0, -1, 100);
 }
 
 SDL_Surface * LoadSurfaceFromFile(const path& filename)
@@ -862,42 +876,42 @@ void ColorizeImage(SDL_Surface * imgSurface, Uint32 newColor)
 
 void glColorRGB(const RGB& color)
 {
-	glColor3f(color.R, color.G, color.B);
+	sRenderer.SetColor(color.R, color.G, color.B);
 }
 
 void glColorRGB(const RGB& color, float alpha)
 {
-	glColor4f(color.R, color.G, color.B, alpha);
+	sRenderer.SetColor(color.R, color.G, color.B, alpha);
 }
 
 void glColorRGB(const RGBA& color)
 {
-	glColor4f(color.R, color.G, color.B, color.A);
+	sRenderer.SetColor(color.R, color.G, color.B, color.A);
 }
 
 void glColorRGB(const RGBA& color, float alpha)
 {
-	glColor4f(color.R, color.G, color.B, std::min(color.A, alpha));
+	sRenderer.SetColor(color.R, color.G, color.B, std::min(color.A, alpha));
 }
 
 void glColorRGBInt(const RGB& color, float intensity)
 {
-	glColor3f(color.R * intensity, color.G * intensity, color.B * intensity);
+	sRenderer.SetColor(color.R * intensity, color.G * intensity, color.B * intensity);
 }
 
 void glColorRGBInt(const RGB& color, float alpha, float intensity)
 {
-	glColor4f(color.R * intensity, color.G * intensity, color.B * intensity, alpha);
+	sRenderer.SetColor(color.R * intensity, color.G * intensity, color.B * intensity, alpha);
 }
 
 void glColorRGBInt(const RGBA& color, float intensity)
 {
-	glColor4f(color.R * intensity, color.G * intensity, color.B * intensity, color.A);
+	sRenderer.SetColor(color.R * intensity, color.G * intensity, color.B * intensity, color.A);
 }
 
 void glColorRGBInt(const RGBA& color, float alpha, float intensity)
 {
-	glColor4f(color.R * intensity, color.G * intensity, color.B * intensity, std::min(color.A, alpha));
+	sRenderer.SetColor(color.R * intensity, color.G * intensity, color.B * intensity, std::min(color.A, alpha));
 }
 
 void FreeGfxResources()
@@ -906,12 +920,14 @@ void FreeGfxResources()
 		SDL_FreeSurface(*itr);
 	g_surfaces.clear();
 
-	for (ScreenCollection::const_iterator itr = g_screenCollection.begin(); itr != g_screenCollection.end(); ++itr)
-		delete (*itr);
-	g_screenCollection.clear();
+	LogScreenConstructTimes();
+	DestroyScreens();
 
 	UnloadFontTextures();
 
+	// frees its GL objects, so needs to go before the context
+	delete Renderer::getSingletonPtr();
+
 	if (Screen != NULL)
 	{
 		SDL_DestroyWindow(Screen);
@@ -25,6 +25,8 @@
 #pragma once
 
 #include "Texture.h"
+#include "Renderer.h"
+#include "../menu/ScreenRegistry.h"
 
 void Initialize3D(const char * windowTitle);
 void LoadFontTextures();
@@ -70,50 +72,50 @@ extern int Screens, ScreenAct, ScreenX;
 extern bool Fullscreen;
 
 // Screens
-extern class ScreenLoading			* UILoading;
-extern class ScreenMain				* UIMain;
-extern class ScreenName				* UIName;
-extern class ScreenLevel			* UILevel;
-extern class ScreenSong				* UISong;
-extern class ScreenSing				* UISing;
-extern class ScreenScore			* UIScore;
-extern class ScreenTop5				* UITop5;
-extern class ScreenOptions			* UIOptions;
-extern class ScreenOptionsGame		* UIOptionsGame;
-extern class ScreenOptionsGraphics	* UIOptionsGraphics;
-extern class ScreenOptionsSound		* UIOptionsSound;
-extern class ScreenOptionsLyrics	* UIOptionsLyrics;
-extern class ScreenOptionsThemes	* UIOptionsThemes;
-extern class ScreenOptionsRecord	* UIOptionsRecord;
-extern class ScreenOptionsAdvanced	* UIOptionsAdvanced;
-extern class ScreenEditSub			* UIEditSub;
-extern class ScreenEdit				* UIEdit;
-extern class ScreenEditConvert		* UIEditConvert;
-extern class ScreenEditHeader		* UIEditHeader;
-extern class ScreenOpen				* UIOpen;
-
-extern class ScreenSongMenu			* UISongMenu;
-extern class ScreenSongJumpTo		* UISongJumpTo;
+extern LazyScreen<class ScreenLoading>			UILoading;
+extern LazyScreen<class ScreenMain>				UIMain;
+extern LazyScreen<class ScreenName>				UIName;
+extern LazyScreen<class ScreenLevel>			UILevel;
+extern LazyScreen<class ScreenSong>				UISong;
+extern LazyScreen<class ScreenSing>				UISing;
+extern LazyScreen<class ScreenScore>			UIScore;
+extern LazyScreen<class ScreenTop5>				UITop5;
+extern LazyScreen<class ScreenOptions>			UIOptions;
+extern LazyScreen<class ScreenOptionsGame>		UIOptionsGame;
+extern LazyScreen<class ScreenOptionsGraphics>	UIOptionsGraphics;
+extern LazyScreen<class ScreenOptionsSound>		UIOptionsSound;
+extern LazyScreen<class ScreenOptionsLyrics>	UIOptionsLyrics;
+extern LazyScreen<class ScreenOptionsThemes>	UIOptionsThemes;
+extern LazyScreen<class ScreenOptionsRecord>	UIOptionsRecord;
+extern LazyScreen<class ScreenOptionsAdvanced>	UIOptionsAdvanced;
+extern LazyScreen<class ScreenEditSub>			UIEditSub;
+extern LazyScreen<class ScreenEdit>				UIEdit;
+extern LazyScreen<class ScreenEditConvert>		UIEditConvert;
+extern LazyScreen<class ScreenEditHeader>		UIEditHeader;
+extern LazyScreen<class ScreenOpen>				UIOpen;
+
+extern LazyScreen<class ScreenSongMenu>			UISongMenu;
+extern LazyScreen<class ScreenSongJumpTo>		UISongJumpTo;
 
 // Party screens
-extern class ScreenPartyNewRound	* UIPartyNewRound;
-extern class ScreenPartyScore		* UIPartyScore;
-extern class ScreenPartyWin			* UIPartyWin;
-extern class ScreenPartyOptions		* UIPartyOptions;
-extern class ScreenPartyPlayer		* UIPartyPlayer;
-extern class ScreenPartyRounds		* UIPartyRounds;
+extern LazyScreen<class ScreenPartyNewRound>	UIPartyNewRound;
+extern LazyScreen<class ScreenPartyScore>		UIPartyScore;
+extern LazyScreen<class ScreenPartyWin>			UIPartyWin;
+extern LazyScreen<class ScreenPartyOptions>		UIPartyOptions;
+extern LazyScreen<class ScreenPartyPlayer>		UIPartyPlayer;
+extern LazyScreen<class ScreenPartyRounds>		UIPartyRounds;
 
 // Stats screens
-extern class ScreenStatMain			* UIStatMain;
-extern class ScreenStatDetail		* UIStatDetail;
+extern LazyScreen<class ScreenStatMain>			UIStatMain;
+extern LazyScreen<class ScreenStatDetail>		UIStatDetail;
 
 // Credits Screen
-extern class ScreenCredits			* UICredits;
+extern LazyScreen<class ScreenCredits>			UICredits;
 
 // Popups
-extern class ScreenPopupCheck		* UIPopupCheck;
-extern class ScreenPopupError		* UIPopupError;
-extern class ScreenPopupInfo		* UIPopupInfo;
+extern LazyScreen<class ScreenPopupCheck>		UIPopupCheck;
+extern LazyScreen<class ScreenPopupError>		UIPopupError;
+extern LazyScreen<class ScreenPopupInfo>		UIPopupInfo;
 
 // Notes
 extern Texture TexNoteLeft[6];      // formerly Tex_Left
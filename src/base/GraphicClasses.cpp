@@ -21,3 +21,347 @@
  */
 
 #include "stdafx.h"
+#include "GraphicClasses.h"
+#include "Graphic.h"
+#include "Profiler.h"
+#include "QualityGovernor.h"
+
+initialiseSingleton(EffectManager);
+
+static const float PI = 3.14159265f;
+
+ParticlePool::ParticlePool() : Capacity(0), Count(0)
+{
+}
+
+void ParticlePool::Init(Uint32 capacity)
+{
+	Capacity = capacity;
+	Count = 0;
+
+	X.resize(capacity);
+	Y.resize(capacity);
+	VelX.resize(capacity);
+	VelY.resize(capacity);
+	Gravity.resize(capacity);
+	Age.resize(capacity);
+	Life.resize(capacity);
+	Size.resize(capacity);
+	Rotation.resize(capacity);
+	Spin.resize(capacity);
+	R.resize(capacity);
+	G.resize(capacity);
+	B.resize(capacity);
+	Type.resize(capacity);
+	Screen.resize(capacity);
+	Player.resize(capacity);
+
+	Vertices.resize(capacity * 4);
+}
+
+bool ParticlePool::Spawn(ParticleType type, float x, float y, float velX, float velY,
+	float life, float size, const RGB& color, int screen, int player)
+{
+	if (Count >= Capacity)
+		return false;
+
+	Uint32 i = Count++;
+	X[i] = x;
+	Y[i] = y;
+	VelX[i] = velX;
+	VelY[i] = velY;
+	Gravity[i] = (type == ptPerfectLineTwinkle) ? 300.0f : 0.0f;
+	Age[i] = 0.0f;
+	Life[i] = life;
+	Size[i] = size;
+	Rotation[i] = 0.0f;
+	Spin[i] = (type == ptGoldenNote || type == ptPerfectLineTwinkle) ? PI : 0.0f;
+	R[i] = color.R;
+	G[i] = color.G;
+	B[i] = color.B;
+	Type[i] = (Uint8) type;
+	Screen[i] = (Uint8) screen;
+	Player[i] = (Uint8) player;
+	return true;
+}
+
+void ParticlePool::Remove(Uint32 index)
+{
+	Uint32 last = --Count;
+	if (index == last)
+		return;
+
+	X[index] = X[last];
+	Y[index] = Y[last];
+	VelX[index] = VelX[last];
+	VelY[index] = VelY[last];
+	Gravity[index] = Gravity[last];
+	Age[index] = Age[last];
+	Life[index] = Life[last];
+	Size[index] = Size[last];
+	Rotation[index] = Rotation[last];
+	Spin[index] = Spin[last];
+	R[index] = R[last];
+	G[index] = G[last];
+	B[index] = B[last];
+	Type[index] = Type[last];
+	Screen[index] = Screen[last];
+	Player[index] = Player[last];
+}
+
+void ParticlePool::Update(float deltaTime)
+{
+	if (Count == 0)
+		return;
+
+	float * x = &X[0], * y = &Y[0];
+	float * velX = &VelX[0], * velY = &VelY[0];
+	const float * gravity = &Gravity[0];
+	float * age = &Age[0];
+	float * rotation = &Rotation[0];
+	const float * spin = &Spin[0];
+	const int count = (int) Count;
+
+	// branch-free integration over plain arrays
+	for (int i = 0; i < count; i++)
+	{
+		age[i] += deltaTime;
+		velY[i] += gravity[i] * deltaTime;
+		x[i] += velX[i] * deltaTime;
+		y[i] += velY[i] * deltaTime;
+		rotation[i] += spin[i] * deltaTime;
+	}
+
+	// backwards, so the particle swapped in has already been checked
+	for (int i = count - 1; i >= 0; i--)
+	{
+		if (age[i] >= Life[i])
+			Remove((Uint32) i);
+	}
+}
+
+void ParticlePool::Draw(const Texture& texture, int screen)
+{
+	Uint32 quads = 0;
+	for (Uint32 i = 0; i < Count; i++)
+	{
+		if (Screen[i] != screen)
+			continue;
+
+		float t = Age[i] / Life[i];
+		float alpha, size;
+
+		switch (Type[i])
+		{
+			// grow and shrink again
+			case ptGoldenNote:
+			case ptNoteHitTwinkle:
+				alpha = sin(PI * t);
+				size = Size[i] * alpha;
+				break;
+
+			// shown at full size, shrinking while fading out
+			case ptPerfectNote:
+				alpha = 1.0f - t;
+				size = Size[i] * (1.0f - 0.5f * t);
+				break;
+
+			case ptFlare:
+				alpha = 1.0f - t * t;
+				size = Size[i] * (1.0f + t);
+				break;
+
+			default:
+				alpha = 1.0f - t;
+				size = Size[i];
+				break;
+		}
+
+		// rotated corner offsets
+		float half = size * 0.5f;
+		float c = cos(Rotation[i]) * half, s = sin(Rotation[i]) * half;
+
+		RenderVertex * v = &Vertices[quads * 4];
+		RenderVertex corner = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, R[i], G[i], B[i], alpha };
+		v[0] = v[1] = v[2] = v[3] = corner;
+
+		v[0].X = X[i] - c + s; v[0].Y = Y[i] - s - c;
+		v[0].U = 0.0f; v[0].V = 0.0f;
+
+		v[1].X = X[i] - c - s; v[1].Y = Y[i] - s + c;
+		v[1].U = 0.0f; v[1].V = texture.TexH;
+
+		v[2].X = X[i] + c - s; v[2].Y = Y[i] + s + c;
+		v[2].U = texture.TexW; v[2].V = texture.TexH;
+
+		v[3].X = X[i] + c + s; v[3].Y = Y[i] + s - c;
+		v[3].U = texture.TexW; v[3].V = 0.0f;
+
+		++quads;
+	}
+
+	if (quads == 0)
+		return;
+
+	sRenderer.SetTexturing(true);
+	sRenderer.SetBlending(true);
+	sRenderer.SetDepthTest(false);
+	sRenderer.BindTexture(texture.TexNum);
+	PROFILE_COUNT(pcTextureBinds);
+
+	sRenderer.DrawQuads(&Vertices[0], quads * 4);
+	PROFILE_COUNT(pcDrawCalls);
+
+	sRenderer.SetBlending(false);
+	sRenderer.SetTexturing(false);
+}
+
+void ParticlePool::KillPlayer(int player)
+{
+	for (int i = (int) Count - 1; i >= 0; i--)
+	{
+		if (Player[i] == player)
+			Remove((Uint32) i);
+	}
+}
+
+void ParticlePool::KillType(ParticleType type)
+{
+	for (int i = (int) Count - 1; i >= 0; i--)
+	{
+		if (Type[i] == type)
+			Remove((Uint32) i);
+	}
+}
+
+EffectManager::EffectManager() : _lastUpdate(0), _randomState(0x9E3779B9)
+{
+	_starPool.Init(EFFECT_POOL_CAPACITY);
+	_perfectPool.Init(EFFECT_POOL_CAPACITY);
+
+	for (int i = 0; i < MAX_PLAYERS; i++)
+		_twinkleDelay[i] = 0.0f;
+}
+
+// xorshift, we only need cheap randomness for placement
+float EffectManager::Random(float min, float max)
+{
+	_randomState ^= _randomState << 13;
+	_randomState ^= _randomState >> 17;
+	_randomState ^= _randomState << 5;
+	return min + (max - min) * ((_randomState & 0xFFFFFF) / (float) 0xFFFFFF);
+}
+
+ParticlePool& EffectManager::GetPool(ParticleType type)
+{
+	if (type == ptPerfectNote || type == ptPerfectLineTwinkle)
+		return _perfectPool;
+
+	return _starPool;
+}
+
+void EffectManager::Draw()
+{
+	// Advance the simulation once per frame (on the first screen), by the real time passed.
+	if (ScreenAct == 1)
+	{
+		Uint64 now = SDL_GetPerformanceCounter();
+		float deltaTime = 0.0f;
+		if (_lastUpdate != 0)
+			deltaTime = std::min((float) (now - _lastUpdate) / SDL_GetPerformanceFrequency(), EFFECT_MAX_TIMESTEP);
+		_lastUpdate = now;
+
+		_starPool.Update(deltaTime);
+		_perfectPool.Update(deltaTime);
+
+		for (int i = 0; i < MAX_PLAYERS; i++)
+			_twinkleDelay[i] = std::max(_twinkleDelay[i] - deltaTime, 0.0f);
+	}
+
+	_starPool.Draw(TexNoteStar, ScreenAct);
+	_perfectPool.Draw(TexNotePerfectStar, ScreenAct);
+}
+
+void EffectManager::Spawn(float x, float y, int screen, float life, ParticleType type, int player, const RGB& color)
+{
+	float size = (type == ptFlare) ? 32.0f : 16.0f;
+	GetPool(type).Spawn(type, x, y, 0.0f, 0.0f, life, size, color, screen, player);
+}
+
+void EffectManager::GoldenNoteTwinkle(float top, float bottom, float left, float right, int player, int screen)
+{
+	if (player < 0 || player >= MAX_PLAYERS
+		|| _twinkleDelay[player] > 0.0f)
+		return;
+
+	static const RGB white = { 1.0f, 1.0f, 1.0f };
+	_starPool.Spawn(ptGoldenNote,
+		Random(left, right), Random(top, bottom), 0.0f, 0.0f,
+		Random(0.4f, 0.8f), Random(10.0f, 20.0f), white, screen, player);
+
+	// fewer twinkles if the quality governor asks for it
+	_twinkleDelay[player] = Random(0.05f, 0.15f) / QualityGovernor::EffectDensity();
+}
+
+void EffectManager::SpawnGoldenNoteHit(float top, float bottom, float left, float right, int player, Uint32 sparkles)
+{
+	static const RGB gold = { 1.0f, 0.9f, 0.5f };
+	sparkles = std::max((Uint32) (sparkles * QualityGovernor::EffectDensity()), (Uint32) 1);
+	for (Uint32 i = 0; i < sparkles; i++)
+	{
+		if (!_starPool.Spawn(ptNoteHitTwinkle,
+			Random(left, right), Random(top, bottom), Random(-20.0f, 20.0f), Random(-40.0f, 0.0f),
+			Random(0.3f, 0.7f), Random(6.0f, 14.0f), gold, ScreenAct, player))
+			break;
+	}
+}
+
+void EffectManager::SpawnPerfectNote(float x, float y, int player)
+{
+	static const RGB white = { 1.0f, 1.0f, 1.0f };
+	_perfectPool.Spawn(ptPerfectNote, x, y, 0.0f, 0.0f, 0.8f, 24.0f, white, ScreenAct, player);
+}
+
+void EffectManager::SpawnPerfectLineTwinkle(float top, float bottom, float left, float right, int player)
+{
+	static const RGB white = { 1.0f, 1.0f, 1.0f };
+	float step = 8.0f / QualityGovernor::EffectDensity();
+	for (float x = left; x < right; x += step)
+	{
+		if (!_perfectPool.Spawn(ptPerfectLineTwinkle,
+			x, Random(top, bottom), Random(-30.0f, 30.0f), Random(-200.0f, -80.0f),
+			Random(0.8f, 1.5f), Random(8.0f, 16.0f), white, ScreenAct, player))
+			break;
+	}
+}
+
+void EffectManager::SentenceChange()
+{
+	// golden note twinkles belong to the notes of the old line; everything else fades out on its own
+	_starPool.KillType(ptGoldenNote);
+
+	for (int i = 0; i < MAX_PLAYERS; i++)
+		_twinkleDelay[i] = 0.0f;
+}
+
+void EffectManager::KillPlayer(int player)
+{
+	_starPool.KillPlayer(player);
+	_perfectPool.KillPlayer(player);
+}
+
+void EffectManager::KillAll()
+{
+	_starPool.KillAll();
+	_perfectPool.KillAll();
+	_lastUpdate = 0;
+}
+
+Uint32 EffectManager::GetParticleCount() const
+{
+	return _starPool.GetCount() + _perfectPool.GetCount();
+}
+
+EffectManager::~EffectManager()
+{
+}
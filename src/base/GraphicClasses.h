@@ -0,0 +1,141 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _GRAPHICCLASSES_H
+#define _GRAPHICCLASSES_H
+#pragma once
+
+#include "Texture.h"
+#include "Renderer.h"
+
+// maximum number of live particles per texture pool
+#define EFFECT_POOL_CAPACITY	4096
+
+// longest frame step the simulation takes at once (in seconds), so particles
+// don't jump after a stall (loading, window drag, ...)
+#define EFFECT_MAX_TIMESTEP		0.1f
+
+enum ParticleType
+{
+	ptGoldenNote,			// twinkling star on a golden note
+	ptPerfectNote,			// star shown when a note was hit perfectly
+	ptNoteHitTwinkle,		// small twinkle on the note currently sung
+	ptPerfectLineTwinkle,	// stars thrown up after a perfect line
+	ptColoredStar,			// star tinted in the player's colour
+	ptFlare					// short bright flash
+};
+
+// Fixed-capacity particle storage, one array per attribute (structure of arrays),
+// so the update loops run over contiguous floats and can be vectorized by the compiler.
+// Dead particles are replaced by the last live one, so live particles are always [0, Count).
+class ParticlePool
+{
+public:
+	ParticlePool();
+
+	void Init(Uint32 capacity);
+
+	// Returns false if the pool is full.
+	bool Spawn(ParticleType type, float x, float y, float velX, float velY,
+		float life, float size, const RGB& color, int screen, int player);
+
+	void Update(float deltaTime);
+
+	// Submits all particles of the given screen as a single batch.
+	void Draw(const Texture& texture, int screen);
+
+	void KillPlayer(int player);
+	void KillType(ParticleType type);
+	INLINE void KillAll() { Count = 0; }
+
+	INLINE Uint32 GetCount() const { return Count; }
+
+protected:
+	void Remove(Uint32 index);
+
+	Uint32 Capacity;
+	Uint32 Count;
+
+	std::vector<float>	X, Y;
+	std::vector<float>	VelX, VelY;
+	std::vector<float>	Gravity;
+	std::vector<float>	Age, Life;		// seconds
+	std::vector<float>	Size;			// full size in pixels
+	std::vector<float>	Rotation, Spin;	// radians, radians per second
+	std::vector<float>	R, G, B;
+	std::vector<Uint8>	Type;
+	std::vector<Uint8>	Screen;
+	std::vector<Uint8>	Player;
+
+	// scratch buffer for a pool's quads, allocated once
+	std::vector<RenderVertex>	Vertices;
+};
+
+// Spawns, animates and draws the sing screen effects (golden note twinkles,
+// perfect note stars, ...). Particles never allocate once the pools are set up.
+class EffectManager : public Singleton<EffectManager>
+{
+public:
+	EffectManager();
+
+	// Advances all particles by the time passed since the last call and draws them.
+	void Draw();
+
+	// Single particle at the given position
+	void Spawn(float x, float y, int screen, float life, ParticleType type, int player, const RGB& color);
+
+	// Spawns the occasional twinkle over a golden note on the given screen (call once per frame per note).
+	void GoldenNoteTwinkle(float top, float bottom, float left, float right, int player, int screen);
+
+	// Burst of sparkles over a golden note that was hit.
+	void SpawnGoldenNoteHit(float top, float bottom, float left, float right, int player, Uint32 sparkles);
+
+	void SpawnPerfectNote(float x, float y, int player);
+	void SpawnPerfectLineTwinkle(float top, float bottom, float left, float right, int player);
+
+	// Removes the per-line effects of all players when the sentence changes.
+	void SentenceChange();
+
+	void KillPlayer(int player);
+	void KillAll();
+
+	Uint32 GetParticleCount() const;
+
+	~EffectManager();
+
+protected:
+	float Random(float min, float max);
+	ParticlePool& GetPool(ParticleType type);
+
+	ParticlePool	_starPool;		// TexNoteStar
+	ParticlePool	_perfectPool;	// TexNotePerfectStar
+
+	Uint64			_lastUpdate;	// performance counter
+	Uint32			_randomState;
+
+	// time (in seconds) until the next golden note twinkle, per player
+	float			_twinkleDelay[MAX_PLAYERS];
+};
+
+#define sEffects (EffectManager::getSingleton())
+
+#endif
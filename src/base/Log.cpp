@@ -25,10 +25,10 @@
 
 #include "Log.h"
 #include "CommandLine.h"
-#include "Time.h"
 #include "Platform.h"
+#include "PathUtils.h"
+#include "FlightRecorder.h"
 
-extern Time USTime;
 extern CMDParams Params;
 
 initialiseSingleton(Log);
@@ -40,95 +40,457 @@ initialiseSingleton(Log);
 	vsnprintf(buffer, bufferSize, formatBuffer, ap); \
 	va_end(ap)
 
+// formats the message only where it's queued, without a buffer in between
+#define LOG_VA_MESSAGE(level, context, formatArg) \
+	va_list ap; \
+	va_start(ap, formatArg); \
+	MsgV(level, context, formatArg, ap); \
+	va_end(ap)
+
 Log::Log() :
 	_logFile(NULL), _benchmarkFile(NULL),
-	_logLevel(LOG_LEVEL_DEFAULT), _logFileLevel(LOG_FILE_LEVEL_DEFAULT)
+	_logLevel(LOG_LEVEL_DEFAULT), _logFileLevel(LOG_FILE_LEVEL_DEFAULT),
+	_enqueuePos(0), _dequeuePos(0), _dropped(0), _droppedTotal(0),
+	_stopWriter(false)
 {
+	// Seconds alone repeat when scripted runs start within the same one, so the
+	// microseconds of the performance counter follow them.
+	Uint64 microseconds = (Uint64) (SDL_GetPerformanceCounter() * 1000000.0 / SDL_GetPerformanceFrequency());
+	_benchmarkRun = (Uint64) time(NULL) * 1000000 + microseconds % 1000000;
+
 	memset(&_benchmarkTimeStart,  0, sizeof(_benchmarkTimeStart));
 	memset(&_benchmarkTimeLength, 0, sizeof(_benchmarkTimeLength));
+
+	_records = new LogRecord[LOG_QUEUE_SIZE];
+	for (Uint32 i = 0; i < LOG_QUEUE_SIZE; i++)
+		_records[i].Sequence.store(i, std::memory_order_relaxed);
+
+	_writerThread = std::thread(&Log::WriterThread, this);
 }
 
 void Log::BenchmarkStart(int benchmarkNo)
 {
 	assert(benchmarkNo >= 0 && benchmarkNo < MAX_BENCHMARK_COUNT);
-	_benchmarkTimeStart[benchmarkNo] = USTime.GetTime();
+	_benchmarkTimeStart[benchmarkNo] = SDL_GetPerformanceCounter();
 }
 
 void Log::BenchmarkEnd(int benchmarkNo)
 {
 	assert(benchmarkNo >= 0 && benchmarkNo < MAX_BENCHMARK_COUNT);
-	_benchmarkTimeLength[benchmarkNo] = USTime.GetTime() - _benchmarkTimeStart[benchmarkNo];
+
+	// NOTE: Going through double avoids overflowing the multiplication for long phases.
+	Uint64 ticks = SDL_GetPerformanceCounter() - _benchmarkTimeStart[benchmarkNo];
+	_benchmarkTimeLength[benchmarkNo] = (Uint64) (ticks * 1000000000.0 / SDL_GetPerformanceFrequency());
 }
 
 void Log::Benchmark(int benchmarkNo, const char * message, ...)
 {
+	assert(benchmarkNo >= 0 && benchmarkNo < MAX_BENCHMARK_COUNT);
+
 	BUILD_VA_BUFFER(message, message, buffer, 1024);
-	// TODO
+	BenchmarkResult(benchmarkNo, _benchmarkTimeLength[benchmarkNo], buffer);
 }
 
-void Log::Msg(int level, const char * message)
+void Log::BenchmarkResult(int depth, Uint64 timeNs, const char * phase)
 {
-	char buffer[1024] = {0};
+	// Indent nested phases so the log reads like a tree.
+	Status("Benchmark", "%*s%s: %.3f ms", depth * 2, "", phase, timeNs / 1000000.0);
 
-	if (level <= GetLogLevel()
-		|| level <= GetLogFileLevel())
+	if (!Params.Benchmark)
+		return;
+
+	BenchmarkEntry entry;
+	entry.Depth = depth;
+	entry.Phase = phase;
+	entry.TimeNs = timeNs;
+	_benchmarkResults.push_back(entry);
+}
+
+/**
+ * Appends this run's phases to BENCHMARK_FILE, as
+ * run,version,depth,phase,ms
+ */
+void Log::WriteBenchmarkFile()
+{
+	path benchmarkPath = LogPath / BENCHMARK_FILE;
+	bool exists = boost::filesystem::exists(benchmarkPath);
+
+	_benchmarkFile = fopen(benchmarkPath.generic_string().c_str(), "a");
+	if (_benchmarkFile == NULL)
 	{
-		if (level < LOG_LEVEL_CRITICAL_MAX)
-			snprintf(buffer, 1024, "CRITICAL: %s", message);
-		else if (level < LOG_LEVEL_ERROR_MAX)
-			snprintf(buffer, 1024, "ERROR:    %s", message);
-		else if (level < LOG_LEVEL_WARN_MAX)
-			snprintf(buffer, 1024, "WARN:     %s", message);
-		else if (level < LOG_LEVEL_STATUS_MAX)
-			snprintf(buffer, 1024, "STATUS:   %s", message);
-		else if (level < LOG_LEVEL_INFO_MAX)
-			snprintf(buffer, 1024, "INFO:     %s", message);
+		Error("Log::WriteBenchmarkFile", "Failed to open %s for writing.", benchmarkPath.generic_string().c_str());
+		return;
+	}
+
+	if (!exists)
+		fprintf(_benchmarkFile, "run,version,depth,phase,ms\n");
+
+	for (size_t i = 0; i < _benchmarkResults.size(); i++)
+	{
+		const BenchmarkEntry& entry = _benchmarkResults[i];
+
+		// phases are free text, so keep them from breaking the quoting
+		std::string phase = entry.Phase;
+		std::replace(phase.begin(), phase.end(), '"', '\'');
+
+		fprintf(_benchmarkFile, "%llu,\"%s\",%d,\"%s\",%.6f\n",
+			(unsigned long long) _benchmarkRun, USDXVersionStr(), entry.Depth, phase.c_str(),
+			entry.TimeNs / 1000000.0);
+	}
+
+	fclose(_benchmarkFile);
+	_benchmarkFile = NULL;
+}
+
+// Splits a BENCHMARK_FILE row, honouring double quotes.
+static void SplitBenchmarkRow(const char * line, std::vector<std::string>& fields)
+{
+	std::string field;
+	bool quoted = false;
+
+	fields.clear();
+	for (const char * p = line; *p != '\0' && *p != '\n' && *p != '\r'; p++)
+	{
+		if (*p == '"')
+			quoted = !quoted;
+		else if (*p == ',' && !quoted)
+		{
+			fields.push_back(field);
+			field.clear();
+		}
 		else
-			snprintf(buffer, 1024, "DEBUG:    %s", message);
+			field += *p;
+	}
 
-		if (level <= GetLogLevel())
-			DebugWriteLn(buffer);
+	fields.push_back(field);
+}
 
-		if (level <= GetLogFileLevel())
-			LogToFile(buffer);
+// Only backslashes are left to escape for JSON, quotes were replaced when writing the rows.
+static std::string EscapeBenchmarkString(const std::string& text)
+{
+	std::string result;
+	for (size_t c = 0; c < text.size(); c++)
+	{
+		if (text[c] == '\\')
+			result += '\\';
+		result += text[c];
 	}
 
+	return result;
+}
+
+/**
+ * Rebuilds BENCHMARK_SUMMARY_FILE from all runs in BENCHMARK_FILE,
+ * so startup times can be compared between builds.
+ * Runs are summarised per version, so builds never share a figure.
+ */
+void Log::WriteBenchmarkSummary()
+{
+	struct PhaseStats
+	{
+		std::string	Phase;
+		int			Depth;
+		Uint32		Count;
+		double		Min, Max, Sum, Last;
+	};
+
+	struct VersionStats
+	{
+		std::string						Version;
+		std::set<std::string>			Runs;
+		std::vector<PhaseStats>			Phases; // in order of first appearance
+		std::map<std::pair<int, std::string>, size_t>	PhaseMap;	// by depth and phase
+	};
+
+	path benchmarkPath = LogPath / BENCHMARK_FILE;
+	FILE * fp = fopen(benchmarkPath.generic_string().c_str(), "r");
+	if (fp == NULL)
+		return;
+
+	std::vector<VersionStats> versions; // in order of first appearance
+	std::map<std::string, size_t> versionMap;
+	std::vector<std::string> fields;
+	char line[2048];
+
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		SplitBenchmarkRow(line, fields);
+		if (fields.size() != 5
+			|| fields[0] == "run")
+			continue;
+
+		std::map<std::string, size_t>::iterator versionItr = versionMap.find(fields[1]);
+		if (versionItr == versionMap.end())
+		{
+			versionItr = versionMap.insert(std::make_pair(fields[1], versions.size())).first;
+			versions.push_back(VersionStats());
+			versions.back().Version = fields[1];
+		}
+
+		VersionStats& version = versions[versionItr->second];
+		version.Runs.insert(fields[0]);
+
+		// the same name can time different things at different depths
+		double ms = atof(fields[4].c_str());
+		std::pair<int, std::string> key(atoi(fields[2].c_str()), fields[3]);
+		std::map<std::pair<int, std::string>, size_t>::iterator itr = version.PhaseMap.find(key);
+		if (itr == version.PhaseMap.end())
+		{
+			PhaseStats stats;
+			stats.Phase = key.second;
+			stats.Depth = key.first;
+			stats.Count = 0;
+			stats.Min = stats.Max = ms;
+			stats.Sum = 0.0;
+
+			itr = version.PhaseMap.insert(std::make_pair(key, version.Phases.size())).first;
+			version.Phases.push_back(stats);
+		}
+
+		PhaseStats& stats = version.Phases[itr->second];
+		stats.Count++;
+		stats.Min = std::min(stats.Min, ms);
+		stats.Max = std::max(stats.Max, ms);
+		stats.Sum += ms;
+		stats.Last = ms;
+	}
+
+	fclose(fp);
+
+	path summaryPath = LogPath / BENCHMARK_SUMMARY_FILE;
+	fp = fopen(summaryPath.generic_string().c_str(), "w");
+	if (fp == NULL)
+	{
+		Error("Log::WriteBenchmarkSummary", "Failed to open %s for writing.", summaryPath.generic_string().c_str());
+		return;
+	}
+
+	fprintf(fp, "{\n\t\"version\": \"%s\",\n\t\"versions\": [\n",
+		EscapeBenchmarkString(USDXVersionStr()).c_str());
+
+	for (size_t v = 0; v < versions.size(); v++)
+	{
+		const VersionStats& version = versions[v];
+
+		fprintf(fp, "\t\t{\n\t\t\t\"version\": \"%s\",\n\t\t\t\"runs\": %u,\n\t\t\t\"phases\": [\n",
+			EscapeBenchmarkString(version.Version).c_str(), (Uint32) version.Runs.size());
+
+		for (size_t i = 0; i < version.Phases.size(); i++)
+		{
+			const PhaseStats& stats = version.Phases[i];
+
+			fprintf(fp, "\t\t\t\t{ \"phase\": \"%s\", \"depth\": %d, \"count\": %u, "
+				"\"min_ms\": %.3f, \"avg_ms\": %.3f, \"max_ms\": %.3f, \"last_ms\": %.3f }%s\n",
+				EscapeBenchmarkString(stats.Phase).c_str(), stats.Depth, stats.Count,
+				stats.Min, stats.Sum / stats.Count, stats.Max, stats.Last,
+				(i + 1 < version.Phases.size() ? "," : ""));
+		}
+
+		fprintf(fp, "\t\t\t]\n\t\t}%s\n", (v + 1 < versions.size() ? "," : ""));
+	}
+
+	fprintf(fp, "\t]\n}\n");
+	fclose(fp);
+}
+
+static const char * GetLevelPrefix(int level)
+{
+	if (level < LOG_LEVEL_CRITICAL_MAX)
+		return "CRITICAL: ";
+	else if (level < LOG_LEVEL_ERROR_MAX)
+		return "ERROR:    ";
+	else if (level < LOG_LEVEL_WARN_MAX)
+		return "WARN:     ";
+	else if (level < LOG_LEVEL_STATUS_MAX)
+		return "STATUS:   ";
+	else if (level < LOG_LEVEL_INFO_MAX)
+		return "INFO:     ";
+
+	return "DEBUG:    ";
+}
+
+void Log::Msg(int level, const char * message)
+{
+	Msg(level, NULL, message);
+}
+
+void Log::Msg(int level, const char * context, const char * message)
+{
+	MsgF(level, context, "%s", message);
+
 	if (level <= LOG_LEVEL_CRITICAL_MAX)
 	{
+		if (FlightRecorder::getSingletonPtr() != NULL)
+			sFlightRecorder.Dump(message);
+
+		// make sure the reason ends up in the log before we go down
+		Flush();
+
 		Platform::ShowMessage(message, mtError);
 		throw CriticalException(message);
 	}
 }
 
-void Log::Msg(int level, const char * context, const char * message)
+void Log::MsgF(int level, const char * context, const char * format, ...)
+{
+	LOG_VA_MESSAGE(level, context, format);
+}
+
+void Log::MsgV(int level, const char * context, const char * format, va_list args)
+{
+	if (level <= GetLogLevel()
+		|| level <= GetLogFileLevel())
+	{
+		va_list queued;
+		va_copy(queued, args);
+		Enqueue(level, context, format, queued);
+		va_end(queued);
+	}
+
+	// Keep status messages and worse for post-mortems, whatever the log levels are.
+	if (level <= LOG_LEVEL_STATUS_MAX)
+		FlightRecorder::RecordLog(GetLevelPrefix(level), context, format, args);
+}
+
+/**
+ * Formats the message straight into a free slot of the queue.
+ *
+ * This is a bounded multi-producer queue (after Dmitry Vyukov): producers claim
+ * a slot by advancing _enqueuePos and publish it by bumping the slot's sequence,
+ * so logging never takes a lock or waits on I/O and is safe from the audio callback.
+ * It's lock-free rather than wait-free: a producer losing the race for a slot
+ * retries with the next one.
+ * When the writer falls behind and the queue is full the message is dropped and counted.
+ */
+void Log::Enqueue(int level, const char * context, const char * format, va_list args)
 {
-	char buffer[1024] = {0};
-	snprintf(buffer, 1024, "[%s] %s", context, message);
-	Msg(level, buffer);
+	LogRecord * record;
+	Uint32 pos = _enqueuePos.load(std::memory_order_relaxed);
+
+	while (true)
+	{
+		record = &_records[pos & (LOG_QUEUE_SIZE - 1)];
+		Sint32 diff = (Sint32) (record->Sequence.load(std::memory_order_acquire) - pos);
+
+		if (diff == 0)
+		{
+			if (_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				break;
+		}
+		else if (diff < 0)
+		{
+			// still holds a message the writer hasn't picked up
+			_dropped.fetch_add(1, std::memory_order_relaxed);
+			_droppedTotal.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		else
+		{
+			pos = _enqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+
+	const char * prefix = GetLevelPrefix(level);
+	int length;
+	if (context != NULL)
+		length = snprintf(record->Text, LOG_RECORD_SIZE, "%s[%s] ", prefix, context);
+	else
+		length = snprintf(record->Text, LOG_RECORD_SIZE, "%s", prefix);
+
+	length = std::max(std::min(length, LOG_RECORD_SIZE - 1), 0);
+	vsnprintf(record->Text + length, LOG_RECORD_SIZE - length, format, args);
+
+	record->ToConsole = (level <= GetLogLevel());
+	record->ToFile = (level <= GetLogFileLevel());
+	record->Sequence.store(pos + 1, std::memory_order_release);
+}
+
+void Log::WriterThread()
+{
+	std::unique_lock<std::mutex> lock(_writerSleepLock);
+	while (!_stopWriter)
+	{
+		_writerSleepCond.wait_for(lock, std::chrono::milliseconds(LOG_WRITE_INTERVAL));
+
+		lock.unlock();
+		WriteQueued();
+		lock.lock();
+	}
+}
+
+/**
+ * Moves all published records into one batch per destination and writes
+ * each batch with a single call.
+ */
+void Log::WriteQueued()
+{
+	std::lock_guard<std::mutex> lock(_writeLock);
+
+	_fileBatch.clear();
+	_consoleBatch.clear();
+
+	Uint32 dropped = _dropped.exchange(0, std::memory_order_relaxed);
+	if (dropped > 0)
+	{
+		char buffer[128];
+		snprintf(buffer, sizeof(buffer), "WARN:     [Log] Queue overflow, dropped %u messages.\n", dropped);
+		_fileBatch += buffer;
+		_consoleBatch += buffer;
+	}
+
+	while (true)
+	{
+		LogRecord * record = &_records[_dequeuePos & (LOG_QUEUE_SIZE - 1)];
+		if (record->Sequence.load(std::memory_order_acquire) != _dequeuePos + 1)
+			break; // empty, or the next message is still being formatted
+
+		if (record->ToFile)
+		{
+			_fileBatch += record->Text;
+			_fileBatch += '\n';
+		}
+
+		if (record->ToConsole)
+		{
+			_consoleBatch += record->Text;
+			_consoleBatch += '\n';
+		}
+
+		// hand the slot back to the producers for the next lap around the queue
+		record->Sequence.store(_dequeuePos + LOG_QUEUE_SIZE, std::memory_order_release);
+		_dequeuePos++;
+	}
+
+	if (!_fileBatch.empty())
+		LogToFile(_fileBatch.c_str(), _fileBatch.size());
+
+	if (!_consoleBatch.empty())
+		DebugWriteLn(_consoleBatch.c_str(), _consoleBatch.size());
+}
+
+void Log::Flush()
+{
+	WriteQueued();
 }
 
 void Log::Debug(const char * context, const char * message, ...)
 {
-	BUILD_VA_BUFFER(message, message, buffer, 1024);
-	Msg(LOG_LEVEL_DEBUG, context, buffer);
+	LOG_VA_MESSAGE(LOG_LEVEL_DEBUG, context, message);
 }
 
 void Log::Info(const char * context, const char * message, ...)
 {
-	BUILD_VA_BUFFER(message, message, buffer, 1024);
-	Msg(LOG_LEVEL_INFO, context, buffer);
+	LOG_VA_MESSAGE(LOG_LEVEL_INFO, context, message);
 }
 
 void Log::Status(const char * context, const char * message, ...)
 {
-	BUILD_VA_BUFFER(message, message, buffer, 1024);
-	Msg(LOG_LEVEL_STATUS, context, buffer);
+	LOG_VA_MESSAGE(LOG_LEVEL_STATUS, context, message);
 }
 
 void Log::Warn(const char * context, const char * message, ...)
 {
-	BUILD_VA_BUFFER(message, message, buffer, 1024);
-	Msg(LOG_LEVEL_WARN, context, buffer);
+	LOG_VA_MESSAGE(LOG_LEVEL_WARN, context, message);
 }
 
 void Log::Error(const char * message)
@@ -138,8 +500,7 @@ void Log::Error(const char * message)
 
 void Log::Error(const char * context, const char * message, ...)
 {
-	BUILD_VA_BUFFER(message, message, buffer, 1024);
-	Msg(LOG_LEVEL_ERROR, context, buffer);
+	LOG_VA_MESSAGE(LOG_LEVEL_ERROR, context, message);
 }
 
 void Log::Critical(const char * message)
@@ -149,6 +510,7 @@ void Log::Critical(const char * message)
 
 void Log::Critical(const char * context, const char * message, ...)
 {
+	// the text is needed again for the message box and the exception
 	BUILD_VA_BUFFER(message, message, buffer, 1024);
 	Msg(LOG_LEVEL_CRITICAL, context, buffer);
 }
@@ -171,7 +533,7 @@ void Log::Buffer(const char * buffer, const size_t length, const path& filename)
 	fclose(fp);
 }
 
-void Log::LogToFile(const char * message)
+void Log::LogToFile(const char * messages, size_t length)
 {
 	if (Params.NoLog)
 		return;
@@ -181,7 +543,8 @@ void Log::LogToFile(const char * message)
 		_logFile = fopen(LOG_FILE, "a");
 		if (_logFile == NULL)
 		{
-			DebugWriteLn("Failed to write to log file.");
+			const char * error = "Failed to write to log file.\n";
+			DebugWriteLn(error, strlen(error));
 			return;
 		}
 
@@ -196,24 +559,43 @@ void Log::LogToFile(const char * message)
 		fprintf(_logFile, "-------------------\n");
 	}
 
-	fprintf(_logFile, "%s\n", message);
+	fwrite(messages, length, 1, _logFile);
 	fflush(_logFile);
 }
 
-void Log::DebugWriteLn(const char * message)
+void Log::DebugWriteLn(const char * messages, size_t length)
 {
 	if (Params.Debug)
-		printf("%s\n", message);
+	{
+		fwrite(messages, length, 1, stdout);
+		fflush(stdout);
+	}
 }
 
 Log::~Log()
 {
-	if (_benchmarkFile != NULL)
+	if (Params.Benchmark
+		&& !_benchmarkResults.empty())
+	{
+		WriteBenchmarkFile();
+		WriteBenchmarkSummary();
+	}
+
 	{
-		fclose(_benchmarkFile);
-		_benchmarkFile = NULL;
+		std::lock_guard<std::mutex> lock(_writerSleepLock);
+		_stopWriter = true;
+		_writerSleepCond.notify_one();
 	}
 
+	if (_writerThread.joinable())
+		_writerThread.join();
+
+	// write whatever came in since the writer's last pass
+	WriteQueued();
+
+	delete [] _records;
+	_records = NULL;
+
 	if (_logFile != NULL)
 	{
 		fclose(_logFile);
@@ -24,9 +24,23 @@
 #define _LOG_H
 #pragma once
 
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
 #define LOG_FILE			"error.log"
 #define MAX_BENCHMARK_COUNT	32
 
+// Messages are queued as fixed-size records and written out by a background thread.
+#define LOG_QUEUE_SIZE		1024	// records, must be a power of 2
+#define LOG_RECORD_SIZE		1024	// bytes per formatted message, longer ones are cut off
+#define LOG_WRITE_INTERVAL	10		// ms between writes (unless flushed)
+
+// written to LogPath when started with --benchmark
+#define BENCHMARK_FILE			"Benchmark.csv"	// one row per phase and run, appended to
+#define BENCHMARK_SUMMARY_FILE	"Benchmark.json"	// min/avg/max per version and phase over all runs in BENCHMARK_FILE
+
 enum LogLevel
 {
 	LOG_LEVEL_MAX          = 60,
@@ -54,10 +68,17 @@ class Log : public Singleton<Log>
 public:
 	Log();
 
+	// Benchmark slots nest: a phase timed in slot n is part of the phase running in slot n-1.
 	void BenchmarkStart(int benchmarkNo);
 	void BenchmarkEnd(int benchmarkNo);
 	void Benchmark(int benchmarkNo, const char * message, ...);
 
+	// Records a phase timed elsewhere (in nanoseconds), nested at the given depth.
+	// Like the slots, only to be used from the main thread.
+	void BenchmarkResult(int depth, Uint64 timeNs, const char * phase);
+
+	INLINE Uint64 GetBenchmarkTime(int benchmarkNo) { return _benchmarkTimeLength[benchmarkNo]; }
+
 	void Msg(int level, const char * message);
 	void Msg(int level, const char * context, const char * message);
 	void Debug(const char * context, const char * message, ...);
@@ -74,9 +95,11 @@ public:
 	void Voice(int soundNo);
 	void Buffer(const char * buffer, const size_t length, const path& filename);
 
-	void LogToFile(const char * message);
+	// Blocks until every message queued so far has been written.
+	void Flush();
 
-	void DebugWriteLn(const char * message);
+	// Messages dropped because the queue was full.
+	INLINE Uint32 GetDroppedCount() { return _droppedTotal.load(std::memory_order_relaxed); }
 
 	INLINE void SetLogLevel(int level) { _logLevel = level; }
 	INLINE int GetLogLevel() { return _logLevel; }
@@ -90,13 +113,81 @@ private:
 	int		_logLevel;
 	int		_logFileLevel;
 
+	struct BenchmarkEntry
+	{
+		int			Depth;
+		std::string	Phase;
+		Uint64		TimeNs;
+	};
+
+	// A formatted message waiting for the writer thread.
+	// Sequence is the slot's state in the bounded MPSC queue (see Enqueue()).
+	struct LogRecord
+	{
+		std::atomic<Uint32>	Sequence;
+		bool				ToConsole;
+		bool				ToFile;
+		char				Text[LOG_RECORD_SIZE];
+	};
+
+	void MsgF(int level, const char * context, const char * format, ...);
+	void MsgV(int level, const char * context, const char * format, va_list args);
+	void Enqueue(int level, const char * context, const char * format, va_list args);
+	void WriterThread();
+	void WriteQueued();
+
+	void LogToFile(const char * messages, size_t length);
+	void DebugWriteLn(const char * messages, size_t length);
+
+	void WriteBenchmarkFile();
+	void WriteBenchmarkSummary();
+
 	FILE *	_logFile;
 	FILE *	_benchmarkFile;
 
-	float	_benchmarkTimeStart [MAX_BENCHMARK_COUNT];
-	float	_benchmarkTimeLength[MAX_BENCHMARK_COUNT];
+	LogRecord *				_records;
+	std::atomic<Uint32>		_enqueuePos;
+	Uint32					_dequeuePos;	// only touched while holding _writeLock
+	std::atomic<Uint32>		_dropped;		// since the last write
+	std::atomic<Uint32>		_droppedTotal;
+
+	std::string				_fileBatch, _consoleBatch;
+	std::mutex				_writeLock;
+
+	std::thread				_writerThread;
+	std::mutex				_writerSleepLock;
+	std::condition_variable	_writerSleepCond;
+	bool					_stopWriter;
+
+	Uint64	_benchmarkRun;	// identifies this run's rows in BENCHMARK_FILE
+	Uint64	_benchmarkTimeStart [MAX_BENCHMARK_COUNT];	// performance counter
+	Uint64	_benchmarkTimeLength[MAX_BENCHMARK_COUNT];	// ns
+
+	// Kept until shutdown, LogPath isn't known yet when the first phases finish.
+	std::vector<BenchmarkEntry>	_benchmarkResults;
 };
 
 #define sLog (Log::getSingleton())
 
+// Times the enclosing scope in a benchmark slot.
+class BenchmarkScope
+{
+public:
+	BenchmarkScope(int benchmarkNo, const char * phase)
+		: _benchmarkNo(benchmarkNo), _phase(phase)
+	{
+		sLog.BenchmarkStart(_benchmarkNo);
+	}
+
+	~BenchmarkScope()
+	{
+		sLog.BenchmarkEnd(_benchmarkNo);
+		sLog.Benchmark(_benchmarkNo, "%s", _phase);
+	}
+
+private:
+	int				_benchmarkNo;
+	const char *	_phase;
+};
+
 #endif
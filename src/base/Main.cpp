@@ -38,10 +38,23 @@
 #include "Graphic.h"
 #include "TextureMgr.h"
 #include "Database.h"
+#include "Songs.h"
+#include "Profiler.h"
+#include "RenderBenchmark.h"
+#include "SongBenchmark.h"
+#include "Screenshot.h"
+#include "Renderer.h"
+#include "GraphicClasses.h"
+#include "QualityGovernor.h"
+#include "StartupGraph.h"
+#include "Tracer.h"
+#include "FlightRecorder.h"
+#include "../shared/JobSystem.h"
 
 #include "../menu/Display.h"
 #include "../menu/Menu.h"
 
+#include "../screens/ScreenMain.h"
 #include "../screens/ScreenPopup.h"
 
 void CheckEvents(float & mouseX, float & mouseY);
@@ -61,6 +74,8 @@ const int MAINTHREAD_EXEC_EVENT = SDL_USEREVENT + 2;
 
 int usdxMain(int argc, char ** argv)
 {
+	int result = 0;
+
 	try
 	{
 		const char * windowTitle = USDXVersionStr();
@@ -71,6 +86,17 @@ int usdxMain(int argc, char ** argv)
 		// fix the locale for string-to-float parsing in C-libs
 		Common::SetDefaultNumericLocale();
 
+		// load the command-line arguments
+		// NOTE: This must happen before SDL is initialized, so headless mode can pick its drivers.
+		Params.Load(argc, argv);
+
+		// Headless mode needs neither a display nor an audio device.
+		if (Params.Headless)
+		{
+			SDL_setenv("SDL_VIDEODRIVER", "offscreen", 1);
+			SDL_setenv("SDL_AUDIODRIVER", "dummy", 1);
+		}
+
 		// initialize SDL
 		// without SDL_INIT_TIMER SDL_GetTicks() might return strange values
 		if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_TIMER) == -1)
@@ -85,192 +111,238 @@ int usdxMain(int argc, char ** argv)
 		// create LuaCore first so other classes can register their events
 		new LuaCore();
 
-		// load the command-line arguments
-		Params.Load(argc, argv);
+		// Recent events for post-mortems; the log feeds it, so it has to outlive the log
+		new FlightRecorder();
 
 		// Setup the logger/benchmarker
 		new Log();
 		sLog.BenchmarkStart(0);
 
+		// Timeline of what every thread is doing, for chrome://tracing
+		if (Params.Trace)
+			new Tracer();
+
+		// Per-frame profiler for the debug overlay
+		new Profiler();
+
+		// Sheds expensive effects while frames take too long
+		new QualityGovernor();
+
+		// Worker threads for loading, decoding and scanning
+		new JobSystem();
+
 		// Setup the texture manager
 		new TextureMgr();
 
-		// Language
-		sLog.BenchmarkStart(1);
 		sLog.Status("Initialize Paths", "Initialization");
 		InitializePaths();
-		sLog.Status("Load Language", "Initialization");
-		new Language();
-
-		// Add const values
-		sLanguage.AddConst("US_VERSION", USDXVersionStr());
-		sLog.BenchmarkEnd(1);
-		sLog.Benchmark(1, "Loading Language");
-
-		// Skins
-		sLog.BenchmarkStart(1);
-		sLog.Status("Loading Skin List", "Initialization");
-		new Skins();
-		sLog.BenchmarkEnd(1);
-		sLog.Benchmark(1, "Loading Skin List");
-
-		// Themes
-		sLog.BenchmarkStart(1);
-		sLog.Status("Loading Theme List", "Initialization");
-		new Themes();
-		sLog.BenchmarkEnd(1);
-		sLog.Benchmark(1, "Loading Theme List");
 
-		// INI file
-		sLog.BenchmarkStart(1);
-		sLog.Status("Loading INI", "Initialization");
-		new Ini();
-		sIni.Load();
-
-		// Set the language.
-		// NOTE: Command-line takes precedence.
-		if (!Params.LanguageName.empty())
-			sLanguage.ChangeLanguage(Params.LanguageName);
-		else
-			sLanguage.ChangeLanguage(sIni.LanguageName);
-		
-		// It is possible that this is the first run, so create an .ini file if necessary.
-		sLog.Status("Writing INI", "Initialization");
-		sIni.Save();
+		// Everything else is loaded as a dependency graph: steps which don't depend
+		// on each other run concurrently, anything touching OpenGL runs on this thread.
+		StartupGraph startup;
+
+		int language = startup.Add("Language", []()
+		{
+			sLog.Status("Load Language", "Initialization");
+			new Language();
 
-		sLog.BenchmarkEnd(1);
-		sLog.Benchmark(1, "Loading INI");
+			// Add const values
+			sLanguage.AddConst("US_VERSION", USDXVersionStr());
+		});
 
-		// Sound
-		sLog.BenchmarkStart(1);
-		sLog.Status("Initialize Sound", "Initialization");
-		new SoundLibrary();
-		sLog.BenchmarkEnd(1);
-		sLog.Benchmark(1, "Initializing Sound");
+		int skins = startup.Add("Skins", []()
+		{
+			sLog.Status("Loading Skin List", "Initialization");
+			new Skins();
+		});
+
+		int themes = startup.Add("Themes", []()
+		{
+			sLog.Status("Loading Theme List", "Initialization");
+			new Themes();
+		});
+		// each theme's header looks up its default skin
+		startup.Depends(themes, skins);
+
+		// INI file
+		int ini = startup.Add("Ini", []()
+		{
+			sLog.Status("Loading INI", "Initialization");
+			new Ini();
+			sIni.Load();
+
+			// Set the language.
+			// NOTE: Command-line takes precedence.
+			if (!Params.LanguageName.empty())
+				sLanguage.ChangeLanguage(Params.LanguageName);
+			else
+				sLanguage.ChangeLanguage(sIni.LanguageName);
+
+			// It is possible that this is the first run, so create an .ini file if necessary.
+			sLog.Status("Writing INI", "Initialization");
+			sIni.Save();
+		});
+		startup.Depends(ini, language);
+		startup.Depends(ini, skins);
+		startup.Depends(ini, themes);
+
+		startup.Add("Sound", []()
+		{
+			sLog.Status("Initialize Sound", "Initialization");
+			new SoundLibrary();
+		});
 
 		// Lyrics engine with media reference timer
 		// new LyricsState();
-		
-		// Theme
-		sLog.BenchmarkStart(1);
-		sLog.Status("Load Theme", "Initialization");
-		sThemes.LoadTheme(sIni.Theme, sIni.ThemeColor);
-		sLog.BenchmarkEnd(1);
-		sLog.Benchmark(1, "Loading Theme");
-
-		// Covers cache
-		sLog.BenchmarkStart(1);
-		sLog.Status("Creating Covers cache", "Initialization");
-		// new Covers();
-		sLog.BenchmarkEnd(1);
-		sLog.Benchmark(1, "Loading Covers cache");
 
-		// Category covers
-		sLog.BenchmarkStart(1);
-		sLog.Status("Creating Category Covers array", "Initialization");
+		int theme = startup.Add("Theme", []()
+		{
+			sLog.Status("Load Theme", "Initialization");
+			sThemes.LoadTheme(sIni.Theme, sIni.ThemeColor);
+		});
+		startup.Depends(theme, ini);
+
+		// Covers cache, category covers and songs
+		// new Covers();
 		// new CatCovers();
-		sLog.BenchmarkEnd(1);
-		sLog.Benchmark(1, "Loading Category Covers array");
-
-		// Songs
-		sLog.BenchmarkStart(1);
-		sLog.Status("Creating song array", "Initialization");
-		// new Songs();
-		sLog.Status("Creating 2nd song array", "Initialization");
 		// new CatSongs();
-		sLog.BenchmarkEnd(1);
-		sLog.Benchmark(1, "Loading songs");
-
-		// Graphics
-		sLog.BenchmarkStart(1);
-		sLog.Status("Initialize 3D", "Initialization");
-		Initialize3D(windowTitle);
-		sLog.BenchmarkEnd(1);
-		sLog.Benchmark(1, "Initializing 3D");
-
-		// Score saving
-		sLog.BenchmarkStart(1);
-		sLog.Status("Loading database", "Initialization");
-		new Database();
-		if (ScoreFile.empty())
+
+		// Graphics (window, fonts, loading screen, textures and screens)
+		int graphics = startup.Add("Graphics", [windowTitle]()
 		{
-			Platform::GetGameUserPath(&ScoreFile);
-			ScoreFile /= "Ultrastar.db";
-		}
-		sDatabase.Init(ScoreFile);
-		sLog.BenchmarkEnd(1);
-		sLog.Benchmark(1, "Loading database");
+			sLog.Status("Initialize 3D", "Initialization");
+			Initialize3D(windowTitle);
+			new ScreenshotMgr();
+		}, true);
+		startup.Depends(graphics, theme);
+
+		// Score saving and the song index
+		int database = startup.Add("Database", []()
+		{
+			sLog.Status("Loading database", "Initialization");
+			new Database();
+			if (ScoreFile.empty())
+			{
+				Platform::GetGameUserPath(&ScoreFile);
+				ScoreFile /= "Ultrastar.db";
+			}
+			sDatabase.Init(ScoreFile);
+		});
+
+		// Song library; the scan keeps running on the workers after startup
+		int songs = startup.Add("Songs", []()
+		{
+			sLog.Status("Creating song array", "Initialization");
+			new Songs();
+			sSongs.StartScan();
+		});
+		startup.Depends(songs, ini);
+		startup.Depends(songs, database);
 
 		// Playlist manager
-		sLog.BenchmarkStart(1);
-		sLog.Status("Playlist manager", "Initialization");
 		// new PlaylistManager();
-		sLog.BenchmarkEnd(1);
-		sLog.Benchmark(1, "Loading playlist manager");
 
 		// Effect manager (for the twinkling golden stars and such)
-		sLog.BenchmarkStart(1);
-		sLog.Status("Effect manager", "Initialization");
-		// new EffectManager();
-		sLog.BenchmarkEnd(1);
-		sLog.Benchmark(1, "Loading effect manager");
+		startup.Add("Effects", []()
+		{
+			sLog.Status("Effect manager", "Initialization");
+			new EffectManager();
+		});
 
 		// Joypad
-		if (sIni.Joypad || Params.Joypad)
-		{
-			sLog.BenchmarkStart(1);
-			sLog.Status("Joystick", "Initialization");
-			// new Joystick();
-			sLog.BenchmarkEnd(1);
-			sLog.Benchmark(1, "Loading joystick");
-		}
+		// if (sIni.Joypad || Params.Joypad)
+		//	new Joystick();
 
 		// Party manager
-		sLog.BenchmarkStart(1);
-		sLog.Status("Party manager", "Initialization");
 		// new PartyGame();
-		sLog.BenchmarkEnd(1);
-		sLog.Benchmark(1, "Loading party manager");
 
 		// Lua
-		sLog.BenchmarkStart(1);
-		// sLuaCore.RegisterModule("Log",        LuaLog_Lib_f);
-		// sLuaCore.RegisterModule("Gl",         LuaGl_Lib_f);
-		// sLuaCore.RegisterModule("TextGl",     LuaTextGl_Lib_f);
-		// sLuaCore.RegisterModule("Party",      LuaParty_Lib_f);
-		// sLuaCore.RegisterModule("ScreenSing", LuaScreenSing_Lib_f);
-		sLog.BenchmarkEnd(1);
-		sLog.Benchmark(1, "Initializing LuaCore");
-
-		// Lua plugins
-		sLog.BenchmarkStart(1);
-		sLuaCore.LoadPlugins();
-		sLog.BenchmarkEnd(1);
-		sLog.Benchmark(1, "Loading Lua plugins");
-		sLuaCore.DumpPlugins();
+		int lua = startup.Add("Lua", []()
+		{
+			// sLuaCore.RegisterModule("Log",        LuaLog_Lib_f);
+			// sLuaCore.RegisterModule("Gl",         LuaGl_Lib_f);
+			// sLuaCore.RegisterModule("TextGl",     LuaTextGl_Lib_f);
+			// sLuaCore.RegisterModule("Party",      LuaParty_Lib_f);
+			// sLuaCore.RegisterModule("ScreenSing", LuaScreenSing_Lib_f);
+
+			// Lua plugins
+			sLuaCore.LoadPlugins();
+			sLuaCore.DumpPlugins();
+		});
+		startup.Depends(lua, ini);
+
+		// Keep the loading screen animated while the remaining steps finish.
+		Uint32 lastDraw = 0;
+		startup.Run([&lastDraw]()
+		{
+			SDL_PumpEvents();
+
+			if (!Params.Headless
+				&& Display::getSingletonPtr() != NULL
+				&& sDisplay.CurrentScreen != NULL
+				&& SDL_GetTicks() - lastDraw >= 16)
+			{
+				sDisplay.Draw();
+				SwapBuffers();
+				lastDraw = SDL_GetTicks();
+			}
+			else
+			{
+				SDL_Delay(1);
+			}
+		});
+
+		startup.LogTimings();
 
 		sLog.BenchmarkEnd(0);
 		sLog.Benchmark(0, "Loading time");
 
-		// Prepare software cursor
-		sDisplay.SetCursor();
+		// Leave the loading screen now that everything is ready
+		assert(sDisplay.CurrentScreen != NULL);
+		sDisplay.CurrentScreen->FadeTo(UIMain);
 
-		// Start background music
-		sSoundLib.StartBgMusic();
-		
-		// Check microphone settings, go to record options if they are incorrect
-		/*
-		int badPlayer = AudioInputProcessor::ValidateSettings();
-		if (badPlayer >= 0)
+		// Song parser benchmark on a generated library, then quit
+		if (Params.SongBenchmarkFiles > 0)
 		{
-			ScreenPopupError::ShowPopup("ERROR_PLAYER_DEVICE_ASSIGNMENT", BadPlayer + 1);
-			sDisplay.CurrentScreen->FadeTo(&ScreenOptionsRecord);
+			sLog.Status("Song parser benchmark", "Initialization");
+			if (!RunSongBenchmark(Params.SongBenchmarkFiles))
+			{
+				sLog.Error("usdxMain", "Song parser benchmark failed.");
+				result = 1;
+			}
 		}
-		*/
+		// Headless mode: render the requested screens and quit
+		else if (Params.Headless)
+		{
+			sLog.Status("Render benchmark", "Initialization");
+			if (!RunRenderBenchmark())
+			{
+				sLog.Error("usdxMain", "Render benchmark failed: no screens were rendered.");
+				result = 1;
+			}
+		}
+		else
+		{
+			// Prepare software cursor
+			sDisplay.SetCursor();
+
+			// Start background music
+			sSoundLib.StartBgMusic();
+		
+			// Check microphone settings, go to record options if they are incorrect
+			/*
+			int badPlayer = AudioInputProcessor::ValidateSettings();
+			if (badPlayer >= 0)
+			{
+				ScreenPopupError::ShowPopup("ERROR_PLAYER_DEVICE_ASSIGNMENT", BadPlayer + 1);
+				sDisplay.CurrentScreen->FadeTo(&ScreenOptionsRecord);
+			}
+			*/
 
-		// Start main loop
-		sLog.Status("Main loop", "Initialization");
-		usdxMainLoop();
+			// Start main loop
+			sLog.Status("Main loop", "Initialization");
+			usdxMainLoop();
+		}
 	}
 	catch (const CriticalException& e)
 	{
@@ -279,21 +351,31 @@ int usdxMain(int argc, char ** argv)
 	catch (const std::exception& e)
 	{
 		printf("Unhandled exception occurred: %s\n", e.what());
+		if (FlightRecorder::getSingletonPtr() != NULL)
+			sFlightRecorder.Dump(e.what());
 	}
 	catch (...)
 	{
 		printf("Unhandled exception occurred.\n");
+		if (FlightRecorder::getSingletonPtr() != NULL)
+			sFlightRecorder.Dump("Unhandled exception");
 	}
 
+	// The song scan waits for its folder jobs, so it goes while the workers are still up.
+	delete Songs::getSingletonPtr();
+
+	// Stop the workers first, their jobs may still use anything below.
+	delete JobSystem::getSingletonPtr();
+
+	delete ScreenshotMgr::getSingletonPtr();
 	FreeGfxResources();
 
 	// delete PartyGame::getSingletonPtr();
 	// delete Joystick::getSingletonPtr();
-	// delete EffectManager::getSingletonPtr();
+	delete EffectManager::getSingletonPtr();
 	// delete PlaylistManager::getSingletonPtr();
 	delete Database::getSingletonPtr();
 	// delete CatSongs::getSingletonPtr();
-	// delete Songs::getSingletonPtr();
 	// delete CatCovers::getSingletonPtr();
 	// delete Covers::getSingletonPtr();
 	// delete LyricsState::getSingletonPtr();
@@ -302,7 +384,15 @@ int usdxMain(int argc, char ** argv)
 	delete Skins::getSingletonPtr();
 	delete Language::getSingletonPtr();
 	delete TextureMgr::getSingletonPtr();
+	delete QualityGovernor::getSingletonPtr();
+	delete Profiler::getSingletonPtr();
+
+	if (Tracer::getSingletonPtr() != NULL)
+		sTracer.Export();
+
+	delete Tracer::getSingletonPtr();
 	delete Log::getSingletonPtr();
+	delete FlightRecorder::getSingletonPtr();
 	delete LuaCore::getSingletonPtr();
 	delete SoundLibrary::getSingletonPtr();
 
@@ -310,7 +400,7 @@ int usdxMain(int argc, char ** argv)
 	Mix_CloseAudio();
 	SDL_Quit();
 
-	return 0;
+	return result;
 }
 
 void usdxMainLoop()
@@ -329,26 +419,62 @@ void usdxMainLoop()
 
 	do
 	{
+		TRACE_SCOPE("Frame");
+
 		ticksBeforeFrame = SDL_GetTicks();
+		sProfiler.BeginFrame();
 
 		// Do we have a joypad?
 		// if (Joystick::getSingletonPtr() != NULL)
 		//	sJoystick.Update();
 
 		// Check keyboard events
-		CheckEvents(mouseX, mouseY);
+		{
+			PROFILE_SCOPE(psInput);
+			TRACE_SCOPE("Input");
+			CheckEvents(mouseX, mouseY);
+		}
+
+		// Results handed back from the worker threads (texture uploads, UI updates)
+		{
+			PROFILE_SCOPE(psJobs);
+			TRACE_SCOPE("Main thread jobs");
+			sJobs.RunMainThreadJobs();
+		}
 
 		// Display
 		done = !sDisplay.Draw();
-		SwapBuffers();
+
+		// Read back the frame for pending screenshots before it's swapped out
+		sScreenshots.OnFrameEnd();
+
+		{
+			PROFILE_SCOPE(psSwap);
+			TRACE_SCOPE("SwapBuffers");
+			SwapBuffers();
+		}
+
+		// Adjust rendering quality to the measured frame time
+		sQuality.OnFrame(sProfiler.GetFrameWorkTime());
 		
 		// FPS limiter
 		ticksCurrent = SDL_GetTicks();
 		delay = (Sint32)(MillisecondsInSecond / MaxFPS) - (ticksCurrent - ticksBeforeFrame);
+
+		// Use spare frame time to construct screens that will likely be needed soon
+		if (delay > 0)
+		{
+			PreloadScreens(delay);
+
+			ticksCurrent = SDL_GetTicks();
+			delay = (Sint32)(MillisecondsInSecond / MaxFPS) - (ticksCurrent - ticksBeforeFrame);
+		}
+
 		if (delay > 0)
 			SDL_Delay(delay); // dynamic, maximum is 100 fps
 
 		CountSkipTime();
+		sProfiler.EndFrame();
 	} while (!done);
 }
 
@@ -380,12 +506,10 @@ void CheckEvents(float & mouseX, float & mouseY)
 
 					SDL_SetWindowSize(Screen, ScreenW, ScreenH);
 					
+					sRenderer.Flush();
 					glViewport(0, 0, ScreenW, ScreenH);
-					glMatrixMode(GL_PROJECTION);
-					glLoadIdentity();
-					glOrtho(0, ScreenW, ScreenH, 0, -1, 1);
-					glMatrixMode(GL_MODELVIEW);
-					glLoadIdentity();
+					sRenderer.SetOrtho(0, (float) ScreenW, (float) ScreenH, 0, -1, 1);
+					sRenderer.LoadIdentity();
 					break;
 			}
 			break;
@@ -440,6 +564,8 @@ void CheckEvents(float & mouseX, float & mouseY)
 			break;
 
 		case MAINTHREAD_EXEC_EVENT:
+			if (event.user.data1 != NULL)
+				((MainThreadExecProc) event.user.data1)(event.user.data2);
 			break;
 		}
 
@@ -460,15 +586,68 @@ void CheckEvents(float & mouseX, float & mouseY)
 	}
 }
 
+void MainThreadExec(MainThreadExecProc proc, void * data)
+{
+	SDL_Event event;
+
+	memset(&event, 0, sizeof(event));
+	event.type = MAINTHREAD_EXEC_EVENT;
+	event.user.data1 = (void *) proc;
+	event.user.data2 = data;
+
+	if (SDL_PushEvent(&event) < 0)
+		sLog.Error("MainThreadExec", "Failed to push event: %s", SDL_GetError());
+}
+
 void OnKeyDownEvent(SDL_Keycode keyCode)
 {
+	// Screenshots: Print saves the next frame, Shift+Print starts/stops a burst capture
+	if (keyCode == SDLK_PRINTSCREEN)
+	{
+		if (SDL_GetModState() & KMOD_SHIFT)
+			sScreenshots.ToggleBurst();
+		else
+			sDisplay.SaveScreenshot();
+
+		return;
+	}
+
+	// Profiler overlay: F10 toggles it, Shift+F10 dumps the recorded frames to LogPath
+	if (keyCode == SDLK_F10
+		&& (sIni.Debug || Params.Debug))
+	{
+		if (SDL_GetModState() & KMOD_SHIFT)
+			sProfiler.DumpCSV();
+		else
+			sProfiler.Toggle();
+
+		return;
+	}
+
+	// Ctrl+Shift+F11 dumps the flight recorder, which no screen binds
+	if (keyCode == SDLK_F11
+		&& (SDL_GetModState() & KMOD_CTRL)
+		&& (SDL_GetModState() & KMOD_SHIFT)
+		&& FlightRecorder::getSingletonPtr() != NULL
+		&& sFlightRecorder.Dump("Requested with Ctrl+Shift+F11"))
+		return;
+
+	// F11 writes the trace recorded so far with --trace, else it's left to the screens
+	if (keyCode == SDLK_F11
+		&& Tracer::IsEnabled()
+		&& (SDL_GetModState() & (KMOD_CTRL | KMOD_ALT | KMOD_SHIFT)) == 0)
+	{
+		sTracer.Export();
+		return;
+	}
+
 	// If there is a visible popup then let it handle input instead of the underlying screen
 	// should be done in a way to be sure the topmost popup has preference (maybe error, then check)
-	if (UIPopupError != NULL && UIPopupError->Visible)
+	if (UIPopupError.IsCreated() && UIPopupError->Visible)
 		UIPopupError->ParseInput(keyCode, keyCode, true);
-	else if (UIPopupInfo != NULL && UIPopupInfo->Visible)
+	else if (UIPopupInfo.IsCreated() && UIPopupInfo->Visible)
 		UIPopupInfo->ParseInput(keyCode, keyCode, true);
-	else if (UIPopupCheck != NULL && UIPopupCheck->Visible)
+	else if (UIPopupCheck.IsCreated() && UIPopupCheck->Visible)
 		UIPopupCheck->ParseInput(keyCode, keyCode, true);
 	// if screen wants to exit
 	else if (!sDisplay.ParseInput(keyCode, keyCode, true))
@@ -481,11 +660,11 @@ void OnMouseEvent(int mouseBtn, bool mouseDown, float mouseX, float mouseY)
 	if (sDisplay.NextScreen != NULL)
 		return;
 
-	if (UIPopupError != NULL && UIPopupError->Visible)
+	if (UIPopupError.IsCreated() && UIPopupError->Visible)
 		UIPopupError->ParseMouse(mouseBtn, mouseDown, mouseX, mouseY);
-	else if (UIPopupInfo != NULL && UIPopupInfo->Visible)
+	else if (UIPopupInfo.IsCreated() && UIPopupInfo->Visible)
 		UIPopupInfo->ParseMouse(mouseBtn, mouseDown, mouseX, mouseY);
-	else if (UIPopupCheck != NULL && UIPopupCheck->Visible)
+	else if (UIPopupCheck.IsCreated() && UIPopupCheck->Visible)
 		UIPopupCheck->ParseMouse(mouseBtn, mouseDown, mouseX, mouseY);
 	else if (!sDisplay.ParseMouse(mouseBtn, mouseDown, mouseX, mouseY))
 		DoQuit();
@@ -495,11 +674,11 @@ void OnTextInputEvent(SDL_Event * event)
 {
 	// If there is a visible popup then let it handle input instead of the underlying screen
 	// should be done in a way to be sure the topmost popup has preference (maybe error, then check)
-	if (UIPopupError != NULL && UIPopupError->Visible)
+	if (UIPopupError.IsCreated() && UIPopupError->Visible)
 		UIPopupError->ParseTextInput(event);
-	else if (UIPopupInfo != NULL && UIPopupInfo->Visible)
+	else if (UIPopupInfo.IsCreated() && UIPopupInfo->Visible)
 		UIPopupInfo->ParseTextInput(event);
-	else if (UIPopupCheck != NULL && UIPopupCheck->Visible)
+	else if (UIPopupCheck.IsCreated() && UIPopupCheck->Visible)
 		UIPopupCheck->ParseTextInput(event);
 	// if screen wants to exit
 	else if (!sDisplay.ParseTextInput(event))
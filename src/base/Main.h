@@ -27,4 +27,9 @@
 int usdxMain(int argc, char ** argv);
 void usdxMainLoop();
 
+// Runs proc(data) on the main thread during the next event check (safe to call from any thread).
+// For anything more involved use JobSystem::RunOnMainThread().
+typedef void (*MainThreadExecProc)(void * data);
+void MainThreadExec(MainThreadExecProc proc, void * data);
+
 #endif
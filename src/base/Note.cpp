@@ -21,3 +21,102 @@
  */
 
 #include "stdafx.h"
+#include "Note.h"
+
+Uint32 NoteTrack::FindLine(float time) const
+{
+	std::vector<float>::const_iterator itr = std::upper_bound(LineStartTime.begin(), LineStartTime.end(), time);
+	return itr == LineStartTime.begin() ? 0 : (Uint32) (itr - LineStartTime.begin() - 1);
+}
+
+Uint32 NoteTrack::FindNote(float time) const
+{
+	// the notes don't overlap, so their ends are sorted too
+	return (Uint32) (std::upper_bound(EndTime.begin(), EndTime.end(), time) - EndTime.begin());
+}
+
+NoteTimeline::NoteTimeline()
+	: _gap(0.0f), _msPerBeat(0.0f), _endTime(0.0f)
+{
+}
+
+bool NoteTimeline::Build(const Song& song)
+{
+	Clear();
+
+	if (!song.NotesLoaded() || song.BPM <= 0.0f)
+		return false;
+
+	_gap = song.Gap;
+	_msPerBeat = 60000.0f / (song.BPM * 4);
+
+	_tracks.resize(song.Tracks.size());
+	for (size_t t = 0; t < song.Tracks.size(); t++)
+	{
+		const std::vector<SongLine>& lines = song.Tracks[t].Lines;
+		NoteTrack& track = _tracks[t];
+
+		size_t noteCount = 0, textLength = 0;
+		for (size_t l = 0; l < lines.size(); l++)
+		{
+			noteCount += lines[l].Notes.size();
+			for (size_t n = 0; n < lines[l].Notes.size(); n++)
+				textLength += lines[l].Notes[n].Text.length();
+		}
+
+		track.StartBeat.reserve(noteCount);
+		track.Length.reserve(noteCount);
+		track.StartTime.reserve(noteCount);
+		track.EndTime.reserve(noteCount);
+		track.Tone.reserve(noteCount);
+		track.Type.reserve(noteCount);
+		track.TextStart.reserve(noteCount + 1);
+		track.Text.reserve(textLength);
+
+		track.LineFirstNote.reserve(lines.size() + 1);
+		track.LineStartBeat.reserve(lines.size());
+		track.LineStartTime.reserve(lines.size());
+		track.LineEndTime.reserve(lines.size());
+
+		for (size_t l = 0; l < lines.size(); l++)
+		{
+			const SongLine& line = lines[l];
+
+			track.LineFirstNote.push_back(track.GetNoteCount());
+			track.LineStartBeat.push_back(line.Start);
+			track.LineStartTime.push_back(BeatToTime((float) line.Start));
+			track.LineEndTime.push_back(BeatToTime((float) line.End));
+
+			for (size_t n = 0; n < line.Notes.size(); n++)
+			{
+				const SongNote& note = line.Notes[n];
+
+				track.StartBeat.push_back(note.Start);
+				track.Length.push_back(note.Length);
+				track.StartTime.push_back(BeatToTime((float) note.Start));
+				track.EndTime.push_back(BeatToTime((float) (note.Start + note.Length)));
+				track.Tone.push_back((Sint16) note.Tone);
+				track.Type.push_back((Uint8) note.Type);
+
+				track.TextStart.push_back((Uint32) track.Text.length());
+				track.Text.append(note.Text);
+			}
+		}
+
+		track.LineFirstNote.push_back(track.GetNoteCount());
+		track.TextStart.push_back((Uint32) track.Text.length());
+
+		if (!track.EndTime.empty())
+			_endTime = std::max(_endTime, track.EndTime.back());
+	}
+
+	return true;
+}
+
+void NoteTimeline::Clear()
+{
+	_tracks.clear();
+	_gap = 0.0f;
+	_msPerBeat = 0.0f;
+	_endTime = 0.0f;
+}
@@ -0,0 +1,96 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _NOTE_H
+#define _NOTE_H
+#pragma once
+
+#include "Song.h"
+
+/**
+ * A track's notes as the sing loop reads them: flat arrays in song order
+ * rather than Song's lines of note structs, so a frame only touches the few
+ * values it compares. Times are in ms of song time, precomputed from the beats.
+ * The lyrics are kept apart since they're only needed when a line changes.
+ */
+struct NoteTrack
+{
+	// per note
+	std::vector<int>		StartBeat;
+	std::vector<int>		Length;		// beats
+	std::vector<float>		StartTime;
+	std::vector<float>		EndTime;
+	std::vector<Sint16>		Tone;
+	std::vector<Uint8>		Type;		// NoteType
+
+	// per line, LineFirstNote has an extra entry for the end of the last line
+	std::vector<Uint32>		LineFirstNote;
+	std::vector<int>		LineStartBeat;
+	std::vector<float>		LineStartTime;
+	std::vector<float>		LineEndTime;
+
+	// the notes' lyrics, note i is Text[TextStart[i], TextStart[i + 1])
+	std::string				Text;
+	std::vector<Uint32>		TextStart;
+
+	INLINE Uint32 GetNoteCount() const { return (Uint32) StartBeat.size(); }
+	INLINE Uint32 GetLineCount() const { return (Uint32) LineStartBeat.size(); }
+
+	// Index of the last line starting at or before the given time, 0 before the first.
+	Uint32 FindLine(float time) const;
+
+	// Index of the first note that hasn't ended at the given time, GetNoteCount() after the last.
+	Uint32 FindNote(float time) const;
+};
+
+// The notes of a song in time, built once the song's notes are loaded.
+class NoteTimeline
+{
+public:
+	NoteTimeline();
+
+	// Returns false if the song has no notes loaded or no usable BPM.
+	bool Build(const Song& song);
+	void Clear();
+
+	// A song's BPM counts quarter notes, its beats are sixteenths.
+	INLINE float BeatToTime(float beat) const { return _gap + beat * _msPerBeat; }
+	INLINE float TimeToBeat(float time) const { return (time - _gap) / _msPerBeat; }
+
+	INLINE Uint32 GetTrackCount() const { return (Uint32) _tracks.size(); }
+	INLINE const NoteTrack& GetTrack(Uint32 track) const { return _tracks[track]; }
+	INLINE bool IsEmpty() const { return _tracks.empty(); }
+
+	// Duets alternate the players between the tracks.
+	INLINE Uint32 GetPlayerTrack(int player) const { return _tracks.size() > 1 ? (Uint32) player % _tracks.size() : 0; }
+
+	// where the last note ends, in ms
+	INLINE float GetEndTime() const { return _endTime; }
+
+protected:
+	std::vector<NoteTrack>	_tracks;
+	float					_gap;		// ms
+	float					_msPerBeat;
+	float					_endTime;
+};
+
+#endif
@@ -0,0 +1,246 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "stdafx.h"
+#include "NoteLaneRenderer.h"
+#include "Graphic.h"
+#include "GraphicClasses.h"
+#include "Profiler.h"
+
+NoteLaneRenderer::NoteLaneRenderer()
+{
+	for (int player = 0; player < MAX_PLAYERS; player++)
+	{
+		_lanes[player].LineStartBeat = 0;
+		_lanes[player].Scroll = 0.0f;
+		_lanes[player].Active = false;
+	}
+}
+
+void NoteLaneRenderer::AddNoteQuads(std::vector<RenderVertex> * parts, const Texture * const * textures,
+	const NoteLaneLayout& layout, float x1, float x2, float y, float alpha)
+{
+	float	top = y - layout.NoteHeight / 2,
+			bottom = y + layout.NoteHeight / 2;
+
+	float	left[lpCount]  = { x1 - layout.CapWidth, x1, x2 },
+			right[lpCount] = { x1, x2, x2 + layout.CapWidth };
+
+	for (int part = 0; part < lpCount; part++)
+	{
+		const Texture& tex = *textures[part];
+		RenderVertex quad[4] =
+		{
+			{ left[part],  top,    0.0f, 0.0f,     0.0f,     1.0f, 1.0f, 1.0f, alpha },
+			{ left[part],  bottom, 0.0f, 0.0f,     tex.TexH, 1.0f, 1.0f, 1.0f, alpha },
+			{ right[part], bottom, 0.0f, tex.TexW, tex.TexH, 1.0f, 1.0f, 1.0f, alpha },
+			{ right[part], top,    0.0f, tex.TexW, 0.0f,     1.0f, 1.0f, 1.0f, alpha }
+		};
+
+		parts[part].insert(parts[part].end(), quad, quad + 4);
+	}
+}
+
+void NoteLaneRenderer::SetLine(int player, const LaneNote * notes, Uint32 count, int lineStartBeat, const NoteLaneLayout& layout)
+{
+	if (player < 0 || player >= MAX_PLAYERS)
+		return;
+
+	Lane& lane = _lanes[player];
+	const Texture * background[lpCount] = { &TexNoteBGLeft[player], &TexNoteBGMid[player], &TexNoteBGRight[player] };
+	const Texture * foreground[lpCount] = { &TexNoteLeft[player], &TexNoteMid[player], &TexNoteRight[player] };
+
+	lane.Layout = layout;
+	lane.LineStartBeat = lineStartBeat;
+	lane.Scroll = 0.0f;
+	lane.Active = true;
+	lane.HitRanges.clear();
+	lane.GoldenNotes.clear();
+
+	// clear() keeps the capacity, so after the first few lines no more allocations happen
+	for (int part = 0; part < lpCount; part++)
+	{
+		lane.Background[part].clear();
+		lane.Foreground[part].clear();
+	}
+
+	for (Uint32 i = 0; i < count; i++)
+	{
+		const LaneNote& note = notes[i];
+		float	x1 = (note.StartBeat - lineStartBeat) * layout.BeatWidth,
+				x2 = x1 + note.Length * layout.BeatWidth,
+				y  = layout.Top - (note.Tone - layout.BaseTone) * layout.ToneHeight;
+
+		// freestyle notes aren't rated, so they're only hinted at
+		float alpha = note.Freestyle ? 0.5f : 1.0f;
+
+		AddNoteQuads(lane.Background, background, layout, x1, x2, y, alpha);
+		AddNoteQuads(lane.Foreground, foreground, layout, x1, x2, y, alpha);
+
+		if (note.Golden)
+		{
+			GoldenSpan span = { x1, x2, y };
+			lane.GoldenNotes.push_back(span);
+		}
+	}
+}
+
+void NoteLaneRenderer::ClearLine(int player)
+{
+	if (player < 0 || player >= MAX_PLAYERS)
+		return;
+
+	_lanes[player].Active = false;
+	_lanes[player].HitRanges.clear();
+}
+
+void NoteLaneRenderer::SetScroll(int player, float offset)
+{
+	if (player >= 0 && player < MAX_PLAYERS)
+		_lanes[player].Scroll = offset;
+}
+
+void NoteLaneRenderer::AddHitRange(int player, float startBeat, float endBeat, int tone)
+{
+	if (player < 0 || player >= MAX_PLAYERS)
+		return;
+
+	std::vector<HitRange>& ranges = _lanes[player].HitRanges;
+
+	// extend the previous range while the same tone is held
+	if (!ranges.empty()
+		&& ranges.back().Tone == tone
+		&& ranges.back().EndBeat >= startBeat)
+	{
+		ranges.back().EndBeat = std::max(ranges.back().EndBeat, endBeat);
+		return;
+	}
+
+	HitRange range = { startBeat, endBeat, tone };
+	ranges.push_back(range);
+}
+
+void NoteLaneRenderer::ClearHitRanges(int player)
+{
+	if (player >= 0 && player < MAX_PLAYERS)
+		_lanes[player].HitRanges.clear();
+}
+
+void NoteLaneRenderer::DrawParts(const std::vector<RenderVertex> * parts, const Texture * const * textures)
+{
+	for (int part = 0; part < lpCount; part++)
+	{
+		if (parts[part].empty())
+			continue;
+
+		sRenderer.BindTexture(textures[part]->TexNum);
+		PROFILE_COUNT(pcTextureBinds);
+		sRenderer.DrawQuads(&parts[part][0], (Uint32) parts[part].size());
+		PROFILE_COUNT(pcDrawCalls);
+	}
+}
+
+void NoteLaneRenderer::Draw(int player)
+{
+	if (player < 0 || player >= MAX_PLAYERS
+		|| !_lanes[player].Active)
+		return;
+
+	Lane& lane = _lanes[player];
+	const NoteLaneLayout& layout = lane.Layout;
+
+	const Texture * background[lpCount] = { &TexNoteBGLeft[player], &TexNoteBGMid[player], &TexNoteBGRight[player] };
+	const Texture * foreground[lpCount] = { &TexNoteLeft[player], &TexNoteMid[player], &TexNoteRight[player] };
+	const Texture * glow[lpCount] = { &TexNoteGlowLeft[player], &TexNoteGlowMid[player], &TexNoteGlowRight[player] };
+
+	// the sung ranges change every frame, but there are only a few of them
+	for (int part = 0; part < lpCount; part++)
+		lane.Glow[part].clear();
+
+	for (size_t i = 0; i < lane.HitRanges.size(); i++)
+	{
+		const HitRange& range = lane.HitRanges[i];
+		AddNoteQuads(lane.Glow, glow, layout,
+			(range.StartBeat - lane.LineStartBeat) * layout.BeatWidth,
+			(range.EndBeat - lane.LineStartBeat) * layout.BeatWidth,
+			layout.Top - (range.Tone - layout.BaseTone) * layout.ToneHeight, 1.0f);
+	}
+
+	sRenderer.SetColor(1.0f, 1.0f, 1.0f, 1.0f);
+	sRenderer.SetTexturing(true);
+	sRenderer.SetBlending(true);
+	sRenderer.SetDepthTest(false);
+
+	sRenderer.PushMatrix();
+	sRenderer.Translate(layout.Left - lane.Scroll, 0.0f, 0.0f);
+
+	DrawParts(lane.Background, background);
+	DrawParts(lane.Glow, glow);
+	DrawParts(lane.Foreground, foreground);
+
+	sRenderer.PopMatrix();
+
+	sRenderer.SetBlending(false);
+	sRenderer.SetTexturing(false);
+}
+
+void NoteLaneRenderer::DrawScreen(int screen, int screenCount, int playerCount)
+{
+	for (int player = 0; player < MAX_PLAYERS; player++)
+	{
+		if (GetPlayerScreen(player, screenCount, playerCount) == screen)
+			Draw(player);
+	}
+}
+
+void NoteLaneRenderer::SpawnTwinkles(int screenCount, int playerCount)
+{
+	if (EffectManager::getSingletonPtr() == NULL)
+		return;
+
+	for (int player = 0; player < MAX_PLAYERS; player++)
+	{
+		const Lane& lane = _lanes[player];
+		if (!lane.Active)
+			continue;
+
+		const NoteLaneLayout& layout = lane.Layout;
+		float offset = layout.Left - lane.Scroll;
+		int screen = GetPlayerScreen(player, screenCount, playerCount);
+
+		for (size_t i = 0; i < lane.GoldenNotes.size(); i++)
+		{
+			const GoldenSpan& span = lane.GoldenNotes[i];
+			sEffects.GoldenNoteTwinkle(span.Y - layout.NoteHeight / 2, span.Y + layout.NoteHeight / 2,
+				span.X1 + offset, span.X2 + offset, player, screen);
+		}
+	}
+}
+
+int NoteLaneRenderer::GetPlayerScreen(int player, int screenCount, int playerCount)
+{
+	if (screenCount <= 1 || playerCount <= 0)
+		return 1;
+
+	int perScreen = (playerCount + screenCount - 1) / screenCount;
+	return std::min(player / perScreen, screenCount - 1) + 1;
+}
@@ -0,0 +1,123 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _NOTELANERENDERER_H
+#define _NOTELANERENDERER_H
+#pragma once
+
+#include "Texture.h"
+#include "Renderer.h"
+
+// A note of the active line, as needed for drawing.
+struct LaneNote
+{
+	int		StartBeat;
+	int		Length;		// in beats
+	int		Tone;
+	bool	Golden;
+	bool	Freestyle;
+};
+
+// Where and how large a player's notes are drawn.
+struct NoteLaneLayout
+{
+	float	Left, Top;		// position of the line's first beat and of BaseTone
+	float	BeatWidth;		// pixels per beat
+	float	ToneHeight;		// pixels per tone step (notes go up with the tone)
+	float	NoteHeight;
+	float	CapWidth;		// width of the left/right note end pieces
+	int		BaseTone;
+};
+
+// Draws the notes of each player's active line.
+// The quads of a line are built once by SetLine(), relative to the line's first beat.
+// Per frame only the scroll offset and the sung (highlighted) ranges change, and
+// Draw() submits a player's notes with one batch per note texture.
+class NoteLaneRenderer
+{
+public:
+	NoteLaneRenderer();
+
+	// Builds the geometry of a player's new line.
+	void SetLine(int player, const LaneNote * notes, Uint32 count, int lineStartBeat, const NoteLaneLayout& layout);
+	void ClearLine(int player);
+
+	// Horizontal offset (in pixels) applied to the whole line, e.g. for scrolling lyrics.
+	void SetScroll(int player, float offset);
+
+	// Highlights the beat range [startBeat, endBeat) sung at the given tone with the note glow.
+	void AddHitRange(int player, float startBeat, float endBeat, int tone);
+	void ClearHitRanges(int player);
+
+	void Draw(int player);
+
+	// Draws the players shown on the given screen (1-based).
+	void DrawScreen(int screen, int screenCount, int playerCount);
+
+	// Spawns the twinkles over golden notes, on each player's screen.
+	// Call once per frame, not once per screen.
+	void SpawnTwinkles(int screenCount, int playerCount);
+
+	// The players are split between the screens in order, the first ones on the first screen.
+	static int GetPlayerScreen(int player, int screenCount, int playerCount);
+
+protected:
+	enum LanePart { lpLeft, lpMid, lpRight, lpCount };
+
+	struct HitRange
+	{
+		float	StartBeat, EndBeat;
+		int		Tone;
+	};
+
+	// golden note in line coordinates, for the twinkle effect
+	struct GoldenSpan
+	{
+		float	X1, X2, Y;
+	};
+
+	struct Lane
+	{
+		NoteLaneLayout				Layout;
+		int							LineStartBeat;
+		float						Scroll;
+		bool						Active;
+
+		// [part] quads of the note background (plain) and foreground textures
+		std::vector<RenderVertex>	Background[lpCount];
+		std::vector<RenderVertex>	Foreground[lpCount];
+		std::vector<RenderVertex>	Glow[lpCount];
+
+		std::vector<HitRange>		HitRanges;
+		std::vector<GoldenSpan>		GoldenNotes;
+	};
+
+	// Appends the three textured pieces of a note (x in line coordinates).
+	static void AddNoteQuads(std::vector<RenderVertex> * parts, const Texture * const * textures,
+		const NoteLaneLayout& layout, float x1, float x2, float y, float alpha);
+
+	void DrawParts(const std::vector<RenderVertex> * parts, const Texture * const * textures);
+
+	Lane _lanes[MAX_PLAYERS];
+};
+
+#endif
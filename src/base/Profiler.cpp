@@ -0,0 +1,315 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "stdafx.h"
+#include <time.h>
+
+#include "Profiler.h"
+#include "Log.h"
+#include "PathUtils.h"
+#include "Graphic.h"
+#include "TextGL.h"
+
+initialiseSingleton(Profiler);
+
+static const char * SectionNames[psCount] =
+{
+	"Input", "Jobs", "Draw", "Popups", "Cursor", "Swap"
+};
+
+static const char * CounterNames[pcCount] =
+{
+	"DrawCalls", "TexBinds", "GlyphMiss", "TexUploads", "Allocs"
+};
+
+// frames averaged for the textual section/counter readout
+static const Uint32 PROFILER_AVERAGE_FRAMES = 30;
+
+// frame time (in ms) mapped to the full height of the graph
+static const float PROFILER_GRAPH_MAX_MS = 50.0f;
+
+std::atomic<Uint32> Profiler::_frameCounter[pcCount];
+std::atomic<Uint32> Profiler::_allocations(0);
+
+#if PROFILE_HEAP_ALLOCATIONS
+void * operator new(size_t size)
+{
+	Profiler::CountAllocation();
+
+	void * ptr = malloc(size > 0 ? size : 1);
+	if (ptr == NULL)
+		throw std::bad_alloc();
+
+	return ptr;
+}
+
+void * operator new[](size_t size)
+{
+	Profiler::CountAllocation();
+
+	void * ptr = malloc(size > 0 ? size : 1);
+	if (ptr == NULL)
+		throw std::bad_alloc();
+
+	return ptr;
+}
+
+void operator delete(void * ptr) throw()
+{
+	free(ptr);
+}
+
+void operator delete[](void * ptr) throw()
+{
+	free(ptr);
+}
+#endif
+
+Profiler::Profiler()
+	: _visible(false),
+	_frameStart(0), _allocationsAtFrameStart(0),
+	_frameNo(0), _historyPos(0), _historyCount(0)
+{
+	_frequency = SDL_GetPerformanceFrequency();
+
+	memset(_sectionStart, 0, sizeof(_sectionStart));
+	memset(_sectionTime, 0, sizeof(_sectionTime));
+	memset(_history, 0, sizeof(_history));
+
+	for (int i = 0; i < pcCount; i++)
+		_frameCounter[i].store(0, std::memory_order_relaxed);
+}
+
+void Profiler::BeginFrame()
+{
+	memset(_sectionTime, 0, sizeof(_sectionTime));
+
+	for (int i = 0; i < pcCount; i++)
+		_frameCounter[i].store(0, std::memory_order_relaxed);
+
+	_allocationsAtFrameStart = _allocations.load(std::memory_order_relaxed);
+	_frameStart = SDL_GetPerformanceCounter();
+}
+
+void Profiler::EndFrame()
+{
+	if (_frameStart == 0)
+		return;
+
+	Uint64 frameEnd = SDL_GetPerformanceCounter();
+	ProfileFrame& frame = _history[_historyPos];
+
+	frame.FrameNo = _frameNo++;
+	frame.FrameTime = (float) ((frameEnd - _frameStart) * 1000.0 / _frequency);
+	memcpy(frame.SectionTime, _sectionTime, sizeof(frame.SectionTime));
+
+	for (int i = 0; i < pcCount; i++)
+		frame.Counter[i] = _frameCounter[i].load(std::memory_order_relaxed);
+
+	frame.Counter[pcAllocations] = _allocations.load(std::memory_order_relaxed) - _allocationsAtFrameStart;
+
+	_historyPos = (_historyPos + 1) % PROFILER_FRAME_HISTORY;
+	if (_historyCount < PROFILER_FRAME_HISTORY)
+		++_historyCount;
+}
+
+float Profiler::GetFrameWorkTime()
+{
+	if (_frameStart == 0)
+		return 0.0f;
+
+	float elapsed = (float) ((SDL_GetPerformanceCounter() - _frameStart) * 1000.0 / _frequency);
+	return std::max(elapsed - _sectionTime[psSwap], 0.0f);
+}
+
+void Profiler::BeginSection(ProfileSection section)
+{
+	_sectionStart[section] = SDL_GetPerformanceCounter();
+}
+
+void Profiler::EndSection(ProfileSection section)
+{
+	// Sections may be entered several times per frame (once per screen), so accumulate.
+	_sectionTime[section] += (float) ((SDL_GetPerformanceCounter() - _sectionStart[section]) * 1000.0 / _frequency);
+}
+
+void Profiler::Draw(float x, float y, float w, float h)
+{
+	if (!_visible)
+		return;
+
+	const float graphH = h * 0.5f;
+	const float graphBottom = y + graphH;
+
+	// background
+	sRenderer.SetTexturing(false);
+	sRenderer.SetBlending(true);
+	sRenderer.SetColor(0, 0, 0, 0.6f);
+	sRenderer.DrawRect(x, y, x + w, y + h);
+	PROFILE_COUNT(pcDrawCalls);
+
+	// frame-time graph, oldest frame on the left
+	float barW = w / PROFILER_FRAME_HISTORY;
+	RenderVertex bars[PROFILER_FRAME_HISTORY * 4];
+	for (Uint32 i = 0; i < _historyCount; i++)
+	{
+		const ProfileFrame& frame = _history[(_historyPos + PROFILER_FRAME_HISTORY - _historyCount + i) % PROFILER_FRAME_HISTORY];
+		float barH = std::min(frame.FrameTime / PROFILER_GRAPH_MAX_MS, 1.0f) * graphH;
+		float barX = x + (PROFILER_FRAME_HISTORY - _historyCount + i) * barW;
+
+		if (frame.FrameTime <= 1000.0f / 60.0f)
+			sRenderer.SetColor(0.2f, 0.9f, 0.2f, 0.9f);
+		else if (frame.FrameTime <= 1000.0f / 30.0f)
+			sRenderer.SetColor(0.9f, 0.9f, 0.2f, 0.9f);
+		else
+			sRenderer.SetColor(0.9f, 0.2f, 0.2f, 0.9f);
+
+		bars[i * 4 + 0] = sRenderer.MakeVertex(barX,        graphBottom - barH);
+		bars[i * 4 + 1] = sRenderer.MakeVertex(barX,        graphBottom);
+		bars[i * 4 + 2] = sRenderer.MakeVertex(barX + barW, graphBottom);
+		bars[i * 4 + 3] = sRenderer.MakeVertex(barX + barW, graphBottom - barH);
+	}
+	sRenderer.DrawQuads(bars, _historyCount * 4);
+	PROFILE_COUNT(pcDrawCalls);
+
+	// 60 and 30 FPS markers
+	sRenderer.SetColor(1, 1, 1, 0.5f);
+	RenderVertex lines[4];
+	for (int i = 1; i <= 2; i++)
+	{
+		float lineY = graphBottom - (i * 1000.0f / 60.0f) / PROFILER_GRAPH_MAX_MS * graphH;
+		lines[(i - 1) * 2 + 0] = sRenderer.MakeVertex(x,     lineY);
+		lines[(i - 1) * 2 + 1] = sRenderer.MakeVertex(x + w, lineY);
+	}
+	sRenderer.DrawLines(lines, 4);
+	sRenderer.SetBlending(false);
+	PROFILE_COUNT(pcDrawCalls);
+
+	// averages over the most recent frames
+	float frameAvg = 0.0f, frameMax = 0.0f;
+	float sectionAvg[psCount] = {0};
+	Uint32 counterAvg[pcCount] = {0};
+	Uint32 frames = std::min(_historyCount, PROFILER_AVERAGE_FRAMES);
+
+	for (Uint32 i = 1; i <= frames; i++)
+	{
+		const ProfileFrame& frame = _history[(_historyPos + PROFILER_FRAME_HISTORY - i) % PROFILER_FRAME_HISTORY];
+
+		frameAvg += frame.FrameTime;
+		frameMax = std::max(frameMax, frame.FrameTime);
+
+		for (int s = 0; s < psCount; s++)
+			sectionAvg[s] += frame.SectionTime[s];
+
+		for (int c = 0; c < pcCount; c++)
+			counterAvg[c] += frame.Counter[c];
+	}
+
+	if (frames > 0)
+	{
+		frameAvg /= frames;
+		for (int s = 0; s < psCount; s++)
+			sectionAvg[s] /= frames;
+
+		for (int c = 0; c < pcCount; c++)
+			counterAvg[c] /= frames;
+	}
+
+	SetFontStyle(ftNormal);
+	SetFontSize(18);
+	SetFontItalic(false);
+	sRenderer.SetColor(1, 1, 1, 1);
+
+	float textY = graphBottom + 2;
+	SetFontPos(x + 4, textY);
+	glPrint("Frame: %.2f ms (max %.2f)", frameAvg, frameMax);
+
+	for (int s = 0; s < psCount; s++)
+	{
+		textY += 11;
+		SetFontPos(x + 4, textY);
+		glPrint("%s: %.2f ms", SectionNames[s], sectionAvg[s]);
+	}
+
+	textY = graphBottom + 2;
+	for (int c = 0; c < pcCount; c++)
+	{
+		SetFontPos(x + w / 2, textY);
+		glPrint("%s: %u", CounterNames[c], counterAvg[c]);
+		textY += 11;
+	}
+}
+
+bool Profiler::DumpCSV()
+{
+	time_t unixTime = time(NULL);
+	tm localTime = *localtime(&unixTime);
+	char filename[64];
+
+	snprintf(filename, sizeof(filename), "profile_%04u%02u%02u_%02u%02u%02u.csv",
+		1900 + localTime.tm_year, localTime.tm_mon + 1, localTime.tm_mday,
+		localTime.tm_hour, localTime.tm_min, localTime.tm_sec);
+
+	path csvPath = LogPath / filename;
+	FILE * fp = fopen(csvPath.generic_string().c_str(), "w");
+	if (fp == NULL)
+	{
+		sLog.Error("Profiler::DumpCSV", "Failed to open %s for writing.", csvPath.generic_string().c_str());
+		return false;
+	}
+
+	WriteCSV(fp);
+
+	fclose(fp);
+	sLog.Status("Profiler", "Dumped %u frames to %s", _historyCount, csvPath.generic_string().c_str());
+	return true;
+}
+
+void Profiler::WriteCSV(FILE * fp)
+{
+	fprintf(fp, "frame,frame_ms");
+	for (int s = 0; s < psCount; s++)
+		fprintf(fp, ",%s_ms", SectionNames[s]);
+
+	for (int c = 0; c < pcCount; c++)
+		fprintf(fp, ",%s", CounterNames[c]);
+
+	fprintf(fp, "\n");
+
+	for (Uint32 i = 0; i < _historyCount; i++)
+	{
+		const ProfileFrame& frame = _history[(_historyPos + PROFILER_FRAME_HISTORY - _historyCount + i) % PROFILER_FRAME_HISTORY];
+
+		fprintf(fp, "%u,%.3f", frame.FrameNo, frame.FrameTime);
+		for (int s = 0; s < psCount; s++)
+			fprintf(fp, ",%.3f", frame.SectionTime[s]);
+
+		for (int c = 0; c < pcCount; c++)
+			fprintf(fp, ",%u", frame.Counter[c]);
+
+		fprintf(fp, "\n");
+	}
+}
+
+Profiler::~Profiler()
+{
+}
@@ -0,0 +1,158 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _PROFILER_H
+#define _PROFILER_H
+#pragma once
+
+#include <atomic>
+
+// number of frames kept for the frame-time graph and the CSV dump
+#define PROFILER_FRAME_HISTORY	240
+
+// Count every global operator new/delete call as a heap allocation.
+// This replaces the default allocator, so it's only on in debug builds
+// unless the build defines it.
+#if !defined(PROFILE_HEAP_ALLOCATIONS)
+#	if defined(_DEBUG)
+#		define PROFILE_HEAP_ALLOCATIONS	1
+#	else
+#		define PROFILE_HEAP_ALLOCATIONS	0
+#	endif
+#endif
+
+enum ProfileSection
+{
+	psInput,
+	psJobs,
+	psDraw,
+	psPopups,
+	psCursor,
+	psSwap,
+
+	psCount
+};
+
+enum ProfileCounter
+{
+	pcDrawCalls,
+	pcTextureBinds,
+	pcGlyphCacheMisses,
+	pcTextureUploads,
+	pcAllocations,
+
+	pcCount
+};
+
+struct ProfileFrame
+{
+	Uint32	FrameNo;
+	float	FrameTime;              // whole frame in ms, including the FPS limiter
+	float	SectionTime[psCount];   // in ms
+	Uint32	Counter[pcCount];
+};
+
+class Profiler : public Singleton<Profiler>
+{
+public:
+	Profiler();
+
+	void BeginFrame();
+	void EndFrame();
+
+	// Time (in ms) spent on the current frame so far, without waiting in SwapBuffers (vsync).
+	float GetFrameWorkTime();
+
+	void BeginSection(ProfileSection section);
+	void EndSection(ProfileSection section);
+
+	// Counters are static so that they can be bumped from anywhere
+	// (including before the profiler exists and from job threads) with a single increment.
+	static INLINE void Count(ProfileCounter counter, Uint32 amount = 1)
+	{
+		_frameCounter[counter].fetch_add(amount, std::memory_order_relaxed);
+	}
+
+	static INLINE void CountAllocation()
+	{
+		_allocations.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void Draw(float x, float y, float w, float h);
+
+	// Writes the recorded frame history as CSV to LogPath.
+	bool DumpCSV();
+
+	// Writes the recorded frames (oldest first) as CSV.
+	void WriteCSV(FILE * fp);
+
+	INLINE void Toggle() { _visible = !_visible; }
+	INLINE bool IsVisible() { return _visible; }
+
+	~Profiler();
+
+private:
+	static std::atomic<Uint32> _frameCounter[pcCount];
+	static std::atomic<Uint32> _allocations;
+
+	bool	_visible;
+
+	Uint64	_frequency;
+	Uint64	_frameStart;
+	Uint64	_sectionStart[psCount];
+	float	_sectionTime[psCount];
+	Uint32	_allocationsAtFrameStart;
+
+	Uint32	_frameNo;
+	Uint32	_historyPos;    // next slot to write
+	Uint32	_historyCount;  // number of valid slots
+	ProfileFrame	_history[PROFILER_FRAME_HISTORY];
+};
+
+// Times the enclosing block into the given section, if the profiler exists.
+class ProfileScope
+{
+public:
+	INLINE ProfileScope(ProfileSection section)
+		: _section(section), _profiler(Profiler::getSingletonPtr())
+	{
+		if (_profiler != NULL)
+			_profiler->BeginSection(_section);
+	}
+
+	INLINE ~ProfileScope()
+	{
+		if (_profiler != NULL)
+			_profiler->EndSection(_section);
+	}
+
+private:
+	ProfileSection	_section;
+	Profiler *		_profiler;
+};
+
+#define PROFILE_SCOPE(section)		ProfileScope _profileScope##section(section)
+#define PROFILE_COUNT(counter)		Profiler::Count(counter)
+
+#define sProfiler (Profiler::getSingleton())
+
+#endif
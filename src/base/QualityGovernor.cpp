@@ -0,0 +1,132 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "stdafx.h"
+#include "QualityGovernor.h"
+#include "Graphic.h"
+#include "Log.h"
+
+initialiseSingleton(QualityGovernor);
+
+// used if the display doesn't report its refresh rate
+static const int DEFAULT_REFRESH_RATE = 60;
+
+static const char * LevelNames[qlCount] =
+{
+	"Full", "No reflections", "Short fades", "Reduced effects", "Reduced video"
+};
+
+QualityGovernor::QualityGovernor() : _level(qlFull), _budget(0.0f)
+{
+	ResetWindow();
+}
+
+const char * QualityGovernor::GetLevelName(QualityLevel level)
+{
+	if (level < 0 || level >= qlCount)
+		return "Unknown";
+
+	return LevelNames[level];
+}
+
+void QualityGovernor::DetectBudget()
+{
+	int refreshRate = 0;
+
+	SDL_DisplayMode mode;
+	if (Screen != NULL
+		&& SDL_GetWindowDisplayMode(Screen, &mode) == 0)
+		refreshRate = mode.refresh_rate;
+
+	if (refreshRate <= 0)
+		refreshRate = DEFAULT_REFRESH_RATE;
+
+	_budget = 1000.0f / refreshRate;
+	sLog.Info("QualityGovernor", "Frame budget %.2f ms (%d Hz)", _budget, refreshRate);
+}
+
+void QualityGovernor::ResetWindow()
+{
+	_windowPos = _windowCount = 0;
+	_windowSum = 0.0f;
+	_overSince = _underSince = 0;
+}
+
+void QualityGovernor::OnFrame(float workTime)
+{
+	if (_budget <= 0.0f)
+		DetectBudget();
+
+	// moving average over the last frames
+	if (_windowCount == QUALITY_WINDOW_FRAMES)
+		_windowSum -= _window[_windowPos];
+	else
+		++_windowCount;
+
+	_window[_windowPos] = workTime;
+	_windowSum += workTime;
+	_windowPos = (_windowPos + 1) % QUALITY_WINDOW_FRAMES;
+
+	if (_windowCount < QUALITY_WINDOW_FRAMES)
+		return;
+
+	float average = _windowSum / _windowCount;
+	Uint32 ticks = SDL_GetTicks();
+
+	// Only act if the condition holds for a while, and start over after each change,
+	// so a single hitch or the change itself doesn't make the level oscillate.
+	if (average > _budget * QUALITY_DOWNGRADE_RATIO)
+	{
+		_underSince = 0;
+		if (_overSince == 0)
+			_overSince = ticks;
+		else if (ticks - _overSince >= QUALITY_DOWNGRADE_DELAY
+			&& _level + 1 < qlCount)
+			SetLevel((QualityLevel) (_level + 1), average);
+	}
+	else if (average < _budget * QUALITY_UPGRADE_RATIO)
+	{
+		_overSince = 0;
+		if (_underSince == 0)
+			_underSince = ticks;
+		else if (ticks - _underSince >= QUALITY_UPGRADE_DELAY
+			&& _level > qlFull)
+			SetLevel((QualityLevel) (_level - 1), average);
+	}
+	else
+	{
+		_overSince = _underSince = 0;
+	}
+}
+
+void QualityGovernor::SetLevel(QualityLevel level, float averageTime)
+{
+	sLog.Info("QualityGovernor", "Average frame time %.2f ms (budget %.2f ms), quality %s to '%s'",
+		averageTime, _budget, level > _level ? "lowered" : "raised", GetLevelName(level));
+
+	_level = level;
+	ResetWindow();
+}
+
+QualityGovernor::~QualityGovernor()
+{
+}
@@ -0,0 +1,98 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _QUALITYGOVERNOR_H
+#define _QUALITYGOVERNOR_H
+#pragma once
+
+// number of frames the frame time is averaged over
+#define QUALITY_WINDOW_FRAMES		30
+
+// quality is lowered when the average frame time stays above
+// this share of the budget for QUALITY_DOWNGRADE_DELAY ms
+#define QUALITY_DOWNGRADE_RATIO		0.9f
+#define QUALITY_DOWNGRADE_DELAY		1000
+
+// and raised again when it stays below this share for QUALITY_UPGRADE_DELAY ms
+#define QUALITY_UPGRADE_RATIO		0.5f
+#define QUALITY_UPGRADE_DELAY		5000
+
+// Each level includes the reductions of the levels before it.
+enum QualityLevel
+{
+	qlFull,
+	qlNoReflections,	// no texture/text reflections
+	qlShortFades,		// screen fades take half as long
+	qlReducedEffects,	// fewer particles
+	qlReducedVideo,		// videos decoded at half resolution
+
+	qlCount
+};
+
+// Lowers the rendering quality in stages while frames take longer than the
+// display's refresh interval, and raises it again once there's headroom.
+// Fed once per frame by the main loop with the profiler's measured frame time.
+class QualityGovernor : public Singleton<QualityGovernor>
+{
+public:
+	QualityGovernor();
+
+	// workTime: time (in ms) spent on the frame, not counting vsync or the FPS limiter
+	void OnFrame(float workTime);
+
+	INLINE QualityLevel GetLevel() const { return _level; }
+	INLINE float GetBudget() const { return _budget; }
+	static const char * GetLevelName(QualityLevel level);
+
+	// Queries for the drawing code; full quality if there's no governor.
+	static INLINE QualityLevel CurrentLevel()
+	{
+		QualityGovernor * governor = getSingletonPtr();
+		return (governor != NULL) ? governor->_level : qlFull;
+	}
+
+	static INLINE bool ReflectionsEnabled() { return CurrentLevel() < qlNoReflections; }
+	static INLINE float FadeScale()         { return CurrentLevel() >= qlShortFades ? 0.5f : 1.0f; }
+	static INLINE float EffectDensity()     { return CurrentLevel() >= qlReducedEffects ? 0.3f : 1.0f; }
+	static INLINE float VideoScale()        { return CurrentLevel() >= qlReducedVideo ? 0.5f : 1.0f; }
+
+	~QualityGovernor();
+
+private:
+	void DetectBudget();
+	void SetLevel(QualityLevel level, float averageTime);
+	void ResetWindow();
+
+	QualityLevel	_level;
+	float			_budget;	// ms per frame, 0 until detected
+
+	float			_window[QUALITY_WINDOW_FRAMES];
+	Uint32			_windowPos, _windowCount;
+	float			_windowSum;
+
+	Uint32			_overSince;		// ticks since the average is over budget, 0 if it isn't
+	Uint32			_underSince;	// ticks since there's headroom, 0 if there isn't
+};
+
+#define sQuality (QualityGovernor::getSingleton())
+
+#endif
@@ -0,0 +1,173 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "stdafx.h"
+#include <time.h>
+
+#include "RenderBenchmark.h"
+#include "CommandLine.h"
+#include "Graphic.h"
+#include "Log.h"
+#include "PathUtils.h"
+
+#include "../menu/Display.h"
+#include "../menu/Menu.h"
+
+extern CMDParams Params;
+
+struct ScreenTiming
+{
+	std::string	Name;
+	Uint32		Frames;
+	double		Total;  // all in ms
+	double		Min;
+	double		Avg;
+	double		Max;
+	double		P95;
+};
+
+static bool RenderScreen(const std::string& name, Menu * screen, Uint32 frames, ScreenTiming * timing)
+{
+	const double frequency = (double) SDL_GetPerformanceFrequency();
+	std::vector<double> frameTimes;
+
+	frameTimes.reserve(frames);
+
+	sDisplay.NextScreen = NULL;
+	sDisplay.CurrentScreen = screen;
+
+	screen->OnShow();
+	screen->OnShowFinish();
+	screen->ShowFinish = true;
+
+	for (Uint32 i = 0; i < frames; i++)
+	{
+		Uint64 start = SDL_GetPerformanceCounter();
+
+		SDL_PumpEvents();
+		sDisplay.Draw();
+		SwapBuffers();
+
+		// Wait for the GPU so we measure the rendering, not just the command submission
+		glFinish();
+
+		frameTimes.push_back((SDL_GetPerformanceCounter() - start) * 1000.0 / frequency);
+	}
+
+	screen->OnHide();
+	screen->ShowFinish = false;
+
+	if (frameTimes.empty())
+		return false;
+
+	timing->Name = name;
+	timing->Frames = frames;
+	timing->Total = 0.0;
+	for (size_t i = 0; i < frameTimes.size(); i++)
+		timing->Total += frameTimes[i];
+
+	std::sort(frameTimes.begin(), frameTimes.end());
+	timing->Min = frameTimes.front();
+	timing->Max = frameTimes.back();
+	timing->Avg = timing->Total / frameTimes.size();
+	timing->P95 = frameTimes[(frameTimes.size() - 1) * 95 / 100];
+	return true;
+}
+
+static void WriteReport(const std::vector<ScreenTiming>& timings)
+{
+	time_t unixTime = time(NULL);
+	tm localTime = *localtime(&unixTime);
+	char filename[64];
+
+	snprintf(filename, sizeof(filename), "render_benchmark_%04u%02u%02u_%02u%02u%02u.csv",
+		1900 + localTime.tm_year, localTime.tm_mon + 1, localTime.tm_mday,
+		localTime.tm_hour, localTime.tm_min, localTime.tm_sec);
+
+	path reportPath = LogPath / filename;
+	FILE * fp = fopen(reportPath.generic_string().c_str(), "w");
+	if (fp == NULL)
+	{
+		sLog.Error("RunRenderBenchmark", "Failed to open %s for writing.", reportPath.generic_string().c_str());
+		return;
+	}
+
+	fprintf(fp, "screen,frames,total_ms,min_ms,avg_ms,max_ms,p95_ms,fps\n");
+	for (size_t i = 0; i < timings.size(); i++)
+	{
+		const ScreenTiming& t = timings[i];
+		fprintf(fp, "%s,%u,%.3f,%.3f,%.3f,%.3f,%.3f,%.1f\n",
+			t.Name.c_str(), t.Frames, t.Total, t.Min, t.Avg, t.Max, t.P95,
+			t.Avg > 0.0 ? 1000.0 / t.Avg : 0.0);
+	}
+
+	fclose(fp);
+	sLog.Status("RunRenderBenchmark", "Report written to %s", reportPath.generic_string().c_str());
+}
+
+bool RunRenderBenchmark()
+{
+	std::vector<std::string> screenNames;
+	std::vector<ScreenTiming> timings;
+
+	if (!Params.HeadlessScreens.empty())
+	{
+		StrSplit(Params.HeadlessScreens, ",", &screenNames);
+	}
+	else
+	{
+		const ScreenSlotList& slots = GetScreenSlots();
+		for (ScreenSlotList::const_iterator itr = slots.begin(); itr != slots.end(); ++itr)
+			screenNames.push_back((*itr)->GetName());
+	}
+
+	sLog.Status("RunRenderBenchmark", "Rendering %u frames for %u screens at %dx%d",
+		Params.HeadlessFrames, (Uint32) screenNames.size(), ScreenW, ScreenH);
+
+	for (size_t i = 0; i < screenNames.size(); i++)
+	{
+		std::string name = screenNames[i];
+		trim(name);
+
+		ScreenSlot * slot = FindScreenSlot(name);
+		if (slot == NULL)
+		{
+			sLog.Error("RunRenderBenchmark", "Unknown screen: %s", name.c_str());
+			continue;
+		}
+
+		ScreenTiming timing;
+		if (!RenderScreen(name, slot->GetScreen(), (Uint32) Params.HeadlessFrames, &timing))
+			continue;
+
+		sLog.Status("RunRenderBenchmark", "%-18s min %7.3f ms  avg %7.3f ms  max %7.3f ms  p95 %7.3f ms",
+			timing.Name.c_str(), timing.Min, timing.Avg, timing.Max, timing.P95);
+
+		timings.push_back(timing);
+	}
+
+	if (timings.empty())
+		return false;
+
+	WriteReport(timings);
+	return true;
+}
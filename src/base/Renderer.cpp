@@ -0,0 +1,251 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "stdafx.h"
+#include "Renderer.h"
+#include "RendererLegacy.h"
+#include "RendererGL33.h"
+#include "Log.h"
+
+initialiseSingleton(Renderer);
+
+void RenderMatrix::SetIdentity()
+{
+	for (int i = 0; i < 16; i++)
+		M[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+}
+
+// this = this * rhs
+void RenderMatrix::Multiply(const RenderMatrix& rhs)
+{
+	float result[16];
+	for (int col = 0; col < 4; col++)
+	{
+		for (int row = 0; row < 4; row++)
+		{
+			result[col * 4 + row] =
+				M[0 * 4 + row] * rhs.M[col * 4 + 0] +
+				M[1 * 4 + row] * rhs.M[col * 4 + 1] +
+				M[2 * 4 + row] * rhs.M[col * 4 + 2] +
+				M[3 * 4 + row] * rhs.M[col * 4 + 3];
+		}
+	}
+
+	memcpy(M, result, sizeof(M));
+}
+
+void RenderMatrix::Transform(float& x, float& y, float& z) const
+{
+	float tx = M[0] * x + M[4] * y + M[8] * z + M[12];
+	float ty = M[1] * x + M[5] * y + M[9] * z + M[13];
+	float tz = M[2] * x + M[6] * y + M[10] * z + M[14];
+	x = tx; y = ty; z = tz;
+}
+
+void Renderer::SetContextAttributes(RenderBackend backend)
+{
+	if (backend == rbGL33)
+	{
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+	}
+	else
+	{
+		// whatever the driver gives us, as long as it's compatible with the fixed-function pipeline
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 2);
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 1);
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, 0);
+	}
+}
+
+Renderer * Renderer::Create(RenderBackend backend)
+{
+	if (backend == rbGL33)
+	{
+		RendererGL33 * renderer = new RendererGL33();
+		if (renderer->Initialize())
+			return renderer;
+
+		delete renderer;
+		return NULL;
+	}
+
+	return new RendererLegacy();
+}
+
+bool Renderer::ParseBackend(const std::string& name, RenderBackend * backend)
+{
+	if (name == "legacy")
+		*backend = rbLegacy;
+	else if (name == "gl33")
+		*backend = rbGL33;
+	else
+		return false;
+
+	return true;
+}
+
+Renderer::Renderer() : _texture(0)
+{
+	_state.Color[0] = _state.Color[1] = _state.Color[2] = _state.Color[3] = 1.0f;
+	_state.Texturing = false;
+	_state.Blending = false;
+	_state.DepthTest = false;
+
+	_projection.SetIdentity();
+
+	RenderMatrix identity;
+	identity.SetIdentity();
+	_modelView.push_back(identity);
+}
+
+void Renderer::SetOrtho(float left, float right, float bottom, float top, float zNear, float zFar)
+{
+	_projection.SetIdentity();
+	_projection.M[0]  =  2.0f / (right - left);
+	_projection.M[5]  =  2.0f / (top - bottom);
+	_projection.M[10] = -2.0f / (zFar - zNear);
+	_projection.M[12] = -(right + left) / (right - left);
+	_projection.M[13] = -(top + bottom) / (top - bottom);
+	_projection.M[14] = -(zFar + zNear) / (zFar - zNear);
+}
+
+void Renderer::LoadIdentity()
+{
+	_modelView.back().SetIdentity();
+}
+
+void Renderer::PushMatrix()
+{
+	_modelView.push_back(_modelView.back());
+}
+
+void Renderer::PopMatrix()
+{
+	if (_modelView.size() > 1)
+		_modelView.pop_back();
+	else
+		sLog.Error("Renderer::PopMatrix", "Matrix stack underflow");
+}
+
+void Renderer::Translate(float x, float y, float z)
+{
+	RenderMatrix& m = _modelView.back();
+	m.M[12] += m.M[0] * x + m.M[4] * y + m.M[8]  * z;
+	m.M[13] += m.M[1] * x + m.M[5] * y + m.M[9]  * z;
+	m.M[14] += m.M[2] * x + m.M[6] * y + m.M[10] * z;
+	m.M[15] += m.M[3] * x + m.M[7] * y + m.M[11] * z;
+}
+
+void Renderer::Scale(float x, float y, float z)
+{
+	RenderMatrix& m = _modelView.back();
+	for (int i = 0; i < 4; i++)
+	{
+		m.M[i]     *= x;
+		m.M[4 + i] *= y;
+		m.M[8 + i] *= z;
+	}
+}
+
+void Renderer::MultMatrix(const float * matrix)
+{
+	RenderMatrix rhs;
+	memcpy(rhs.M, matrix, sizeof(rhs.M));
+	_modelView.back().Multiply(rhs);
+}
+
+void Renderer::GetModelView(double * matrix)
+{
+	const RenderMatrix& m = _modelView.back();
+	for (int i = 0; i < 16; i++)
+		matrix[i] = m.M[i];
+}
+
+void Renderer::GetProjection(double * matrix)
+{
+	for (int i = 0; i < 16; i++)
+		matrix[i] = _projection.M[i];
+}
+
+void Renderer::SetColor(float r, float g, float b, float a /*= 1.0f*/)
+{
+	_state.Color[0] = r;
+	_state.Color[1] = g;
+	_state.Color[2] = b;
+	_state.Color[3] = a;
+}
+
+void Renderer::BindTexture(GLuint texture)
+{
+	_texture = texture;
+}
+
+void Renderer::SetTexturing(bool enable)
+{
+	_state.Texturing = enable;
+}
+
+void Renderer::SetBlending(bool enable)
+{
+	_state.Blending = enable;
+}
+
+void Renderer::SetDepthTest(bool enable)
+{
+	_state.DepthTest = enable;
+}
+
+void Renderer::PushState()
+{
+	_stateStack.push_back(_state);
+}
+
+void Renderer::PopState()
+{
+	if (_stateStack.empty())
+	{
+		sLog.Error("Renderer::PopState", "State stack underflow");
+		return;
+	}
+
+	_state = _stateStack.back();
+	_stateStack.pop_back();
+}
+
+void Renderer::DrawRect(float x1, float y1, float x2, float y2, float z /*= 0.0f*/)
+{
+	RenderVertex vertices[4] =
+	{
+		MakeVertex(x1, y1, z),
+		MakeVertex(x1, y2, z),
+		MakeVertex(x2, y2, z),
+		MakeVertex(x2, y1, z)
+	};
+
+	DrawQuads(vertices, 4);
+}
+
+Renderer::~Renderer()
+{
+}
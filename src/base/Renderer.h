@@ -0,0 +1,141 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _RENDERER_H
+#define _RENDERER_H
+#pragma once
+
+enum RenderBackend
+{
+	rbLegacy,	// fixed-function OpenGL (immediate mode, display lists)
+	rbGL33		// OpenGL 3.3 core profile (shaders, streamed vertex buffers)
+};
+
+struct RenderVertex
+{
+	float X, Y, Z;
+	float U, V;
+	float R, G, B, A;
+};
+
+// column-major, as used by OpenGL
+struct RenderMatrix
+{
+	float M[16];
+
+	void SetIdentity();
+	void Multiply(const RenderMatrix& rhs);
+	void Transform(float& x, float& y, float& z) const;
+};
+
+// Abstracts the drawing calls used by textures, fonts and the display, so that
+// the fixed-function pipeline can be replaced by a shader based one.
+// The renderer mirrors the transformation matrices, current colour and
+// enable state, so these can be queried without touching OpenGL.
+class Renderer : public Singleton<Renderer>
+{
+public:
+	// Sets the SDL_GL_* attributes for the backend's context; call before creating the window/context.
+	static void SetContextAttributes(RenderBackend backend);
+
+	// Creates the renderer for an existing context. Returns NULL if the backend can't be used.
+	static Renderer * Create(RenderBackend backend);
+
+	static bool ParseBackend(const std::string& name, RenderBackend * backend);
+
+	virtual const char * GetName() = 0;
+	virtual RenderBackend GetBackend() = 0;
+	virtual bool SupportsDisplayLists() = 0;
+
+	// transformation (SetOrtho() replaces the projection, the others work on the modelview matrix)
+	virtual void SetOrtho(float left, float right, float bottom, float top, float zNear, float zFar);
+	virtual void LoadIdentity();
+	virtual void PushMatrix();
+	virtual void PopMatrix();
+	virtual void Translate(float x, float y, float z);
+	virtual void Scale(float x, float y, float z);
+	virtual void MultMatrix(const float * matrix);
+
+	void GetModelView(double * matrix);
+	void GetProjection(double * matrix);
+
+	// colour used for vertices built with MakeVertex() and for text
+	virtual void SetColor(float r, float g, float b, float a = 1.0f);
+	INLINE void SetColorv(const float * color) { SetColor(color[0], color[1], color[2], color[3]); }
+	INLINE const float * GetColor() const { return _state.Color; }
+
+	// state
+	virtual void BindTexture(GLuint texture);
+	virtual void SetTexturing(bool enable);
+	virtual void SetBlending(bool enable); // always (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA)
+	virtual void SetDepthTest(bool enable);
+
+	// saves/restores colour and enable state
+	virtual void PushState();
+	virtual void PopState();
+
+	// geometry, 4 vertices per quad / 2 per line
+	virtual void DrawQuads(const RenderVertex * vertices, Uint32 count) = 0;
+	virtual void DrawLines(const RenderVertex * vertices, Uint32 count) = 0;
+
+	// draws an untextured rectangle in the current colour
+	void DrawRect(float x1, float y1, float x2, float y2, float z = 0.0f);
+
+	// uploads an alpha-only texture (e.g. glyphs) into the bound texture
+	virtual void TexImageAlpha(GLsizei width, GLsizei height, const GLvoid * pixels) = 0;
+
+	// Submits batched geometry. Must be called before anything that reads or
+	// clears the framebuffer or changes the viewport.
+	virtual void Flush() {}
+
+	INLINE RenderVertex MakeVertex(float x, float y, float z = 0.0f, float u = 0.0f, float v = 0.0f)
+	{
+		RenderVertex vertex = { x, y, z, u, v,
+			_state.Color[0], _state.Color[1], _state.Color[2], _state.Color[3] };
+		return vertex;
+	}
+
+	virtual ~Renderer();
+
+protected:
+	Renderer();
+
+	struct RenderState
+	{
+		float	Color[4];
+		bool	Texturing;
+		bool	Blending;
+		bool	DepthTest;
+	};
+
+	RenderState					_state;
+	std::vector<RenderState>	_stateStack;
+
+	GLuint						_texture;
+
+	RenderMatrix				_projection;
+	std::vector<RenderMatrix>	_modelView; // stack, current matrix at the back
+};
+
+#define sRenderer (Renderer::getSingleton())
+
+#endif
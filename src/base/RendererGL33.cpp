@@ -0,0 +1,367 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "stdafx.h"
+#include "RendererGL33.h"
+#include "Log.h"
+
+static PFNGLCREATESHADERPROC			pglCreateShader            = NULL;
+static PFNGLSHADERSOURCEPROC			pglShaderSource            = NULL;
+static PFNGLCOMPILESHADERPROC			pglCompileShader           = NULL;
+static PFNGLGETSHADERIVPROC				pglGetShaderiv             = NULL;
+static PFNGLGETSHADERINFOLOGPROC		pglGetShaderInfoLog        = NULL;
+static PFNGLDELETESHADERPROC			pglDeleteShader            = NULL;
+static PFNGLCREATEPROGRAMPROC			pglCreateProgram           = NULL;
+static PFNGLATTACHSHADERPROC			pglAttachShader            = NULL;
+static PFNGLLINKPROGRAMPROC				pglLinkProgram             = NULL;
+static PFNGLGETPROGRAMIVPROC			pglGetProgramiv            = NULL;
+static PFNGLGETPROGRAMINFOLOGPROC		pglGetProgramInfoLog       = NULL;
+static PFNGLUSEPROGRAMPROC				pglUseProgram              = NULL;
+static PFNGLDELETEPROGRAMPROC			pglDeleteProgram           = NULL;
+static PFNGLGETUNIFORMLOCATIONPROC		pglGetUniformLocation      = NULL;
+static PFNGLUNIFORM1IPROC				pglUniform1i               = NULL;
+static PFNGLUNIFORMMATRIX4FVPROC		pglUniformMatrix4fv        = NULL;
+static PFNGLGENBUFFERSPROC				pglGenBuffers              = NULL;
+static PFNGLDELETEBUFFERSPROC			pglDeleteBuffers           = NULL;
+static PFNGLBINDBUFFERPROC				pglBindBuffer              = NULL;
+static PFNGLBUFFERDATAPROC				pglBufferData              = NULL;
+static PFNGLBUFFERSUBDATAPROC			pglBufferSubData           = NULL;
+static PFNGLGENVERTEXARRAYSPROC			pglGenVertexArrays         = NULL;
+static PFNGLDELETEVERTEXARRAYSPROC		pglDeleteVertexArrays      = NULL;
+static PFNGLBINDVERTEXARRAYPROC			pglBindVertexArray         = NULL;
+static PFNGLENABLEVERTEXATTRIBARRAYPROC	pglEnableVertexAttribArray = NULL;
+static PFNGLVERTEXATTRIBPOINTERPROC		pglVertexAttribPointer     = NULL;
+
+static const char * VertexShaderSource =
+	"#version 330 core\n"
+	"uniform mat4 uProjection;\n"
+	"layout(location = 0) in vec3 aPosition;\n"
+	"layout(location = 1) in vec2 aTexCoord;\n"
+	"layout(location = 2) in vec4 aColor;\n"
+	"out vec2 vTexCoord;\n"
+	"out vec4 vColor;\n"
+	"void main()\n"
+	"{\n"
+	"	vTexCoord = aTexCoord;\n"
+	"	vColor = aColor;\n"
+	"	gl_Position = uProjection * vec4(aPosition, 1.0);\n"
+	"}\n";
+
+// GL_MODULATE equivalent
+static const char * FragmentShaderSource =
+	"#version 330 core\n"
+	"uniform sampler2D uTexture;\n"
+	"uniform int uTexturing;\n"
+	"in vec2 vTexCoord;\n"
+	"in vec4 vColor;\n"
+	"out vec4 fragColor;\n"
+	"void main()\n"
+	"{\n"
+	"	if (uTexturing != 0)\n"
+	"		fragColor = vColor * texture(uTexture, vTexCoord);\n"
+	"	else\n"
+	"		fragColor = vColor;\n"
+	"}\n";
+
+RendererGL33::RendererGL33() : Renderer(),
+	_program(0), _projectionLocation(-1), _texturingLocation(-1),
+	_vao(0), _vbo(0), _ibo(0), _batchMode(GL_TRIANGLES)
+{
+	_batch.reserve(RENDERER_BATCH_VERTICES);
+}
+
+bool RendererGL33::LoadFunctions()
+{
+#define LOAD_GL_FUNCTION(type, name) \
+	if ((p##name = (type) SDL_GL_GetProcAddress(#name)) == NULL) \
+	{ \
+		sLog.Error("RendererGL33::LoadFunctions", "Missing OpenGL function %s", #name); \
+		return false; \
+	}
+
+	LOAD_GL_FUNCTION(PFNGLCREATESHADERPROC, glCreateShader);
+	LOAD_GL_FUNCTION(PFNGLSHADERSOURCEPROC, glShaderSource);
+	LOAD_GL_FUNCTION(PFNGLCOMPILESHADERPROC, glCompileShader);
+	LOAD_GL_FUNCTION(PFNGLGETSHADERIVPROC, glGetShaderiv);
+	LOAD_GL_FUNCTION(PFNGLGETSHADERINFOLOGPROC, glGetShaderInfoLog);
+	LOAD_GL_FUNCTION(PFNGLDELETESHADERPROC, glDeleteShader);
+	LOAD_GL_FUNCTION(PFNGLCREATEPROGRAMPROC, glCreateProgram);
+	LOAD_GL_FUNCTION(PFNGLATTACHSHADERPROC, glAttachShader);
+	LOAD_GL_FUNCTION(PFNGLLINKPROGRAMPROC, glLinkProgram);
+	LOAD_GL_FUNCTION(PFNGLGETPROGRAMIVPROC, glGetProgramiv);
+	LOAD_GL_FUNCTION(PFNGLGETPROGRAMINFOLOGPROC, glGetProgramInfoLog);
+	LOAD_GL_FUNCTION(PFNGLUSEPROGRAMPROC, glUseProgram);
+	LOAD_GL_FUNCTION(PFNGLDELETEPROGRAMPROC, glDeleteProgram);
+	LOAD_GL_FUNCTION(PFNGLGETUNIFORMLOCATIONPROC, glGetUniformLocation);
+	LOAD_GL_FUNCTION(PFNGLUNIFORM1IPROC, glUniform1i);
+	LOAD_GL_FUNCTION(PFNGLUNIFORMMATRIX4FVPROC, glUniformMatrix4fv);
+	LOAD_GL_FUNCTION(PFNGLGENBUFFERSPROC, glGenBuffers);
+	LOAD_GL_FUNCTION(PFNGLDELETEBUFFERSPROC, glDeleteBuffers);
+	LOAD_GL_FUNCTION(PFNGLBINDBUFFERPROC, glBindBuffer);
+	LOAD_GL_FUNCTION(PFNGLBUFFERDATAPROC, glBufferData);
+	LOAD_GL_FUNCTION(PFNGLBUFFERSUBDATAPROC, glBufferSubData);
+	LOAD_GL_FUNCTION(PFNGLGENVERTEXARRAYSPROC, glGenVertexArrays);
+	LOAD_GL_FUNCTION(PFNGLDELETEVERTEXARRAYSPROC, glDeleteVertexArrays);
+	LOAD_GL_FUNCTION(PFNGLBINDVERTEXARRAYPROC, glBindVertexArray);
+	LOAD_GL_FUNCTION(PFNGLENABLEVERTEXATTRIBARRAYPROC, glEnableVertexAttribArray);
+	LOAD_GL_FUNCTION(PFNGLVERTEXATTRIBPOINTERPROC, glVertexAttribPointer);
+
+#undef LOAD_GL_FUNCTION
+	return true;
+}
+
+GLuint RendererGL33::CompileShader(GLenum type, const char * source)
+{
+	GLuint shader = pglCreateShader(type);
+	pglShaderSource(shader, 1, &source, NULL);
+	pglCompileShader(shader);
+
+	GLint status = GL_FALSE;
+	pglGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+	if (status != GL_TRUE)
+	{
+		char infoLog[1024];
+		pglGetShaderInfoLog(shader, sizeof(infoLog), NULL, infoLog);
+		sLog.Error("RendererGL33::CompileShader", "Failed to compile shader: %s", infoLog);
+		pglDeleteShader(shader);
+		return 0;
+	}
+
+	return shader;
+}
+
+bool RendererGL33::BuildProgram()
+{
+	GLuint vertexShader = CompileShader(GL_VERTEX_SHADER, VertexShaderSource);
+	GLuint fragmentShader = CompileShader(GL_FRAGMENT_SHADER, FragmentShaderSource);
+	if (vertexShader == 0 || fragmentShader == 0)
+	{
+		if (vertexShader != 0)
+			pglDeleteShader(vertexShader);
+		if (fragmentShader != 0)
+			pglDeleteShader(fragmentShader);
+		return false;
+	}
+
+	_program = pglCreateProgram();
+	pglAttachShader(_program, vertexShader);
+	pglAttachShader(_program, fragmentShader);
+	pglLinkProgram(_program);
+
+	// flagged for deletion, freed along with the program
+	pglDeleteShader(vertexShader);
+	pglDeleteShader(fragmentShader);
+
+	GLint status = GL_FALSE;
+	pglGetProgramiv(_program, GL_LINK_STATUS, &status);
+	if (status != GL_TRUE)
+	{
+		char infoLog[1024];
+		pglGetProgramInfoLog(_program, sizeof(infoLog), NULL, infoLog);
+		sLog.Error("RendererGL33::BuildProgram", "Failed to link shader program: %s", infoLog);
+		return false;
+	}
+
+	_projectionLocation = pglGetUniformLocation(_program, "uProjection");
+	_texturingLocation = pglGetUniformLocation(_program, "uTexturing");
+
+	pglUseProgram(_program);
+	pglUniform1i(pglGetUniformLocation(_program, "uTexture"), 0);
+	pglUniformMatrix4fv(_projectionLocation, 1, GL_FALSE, _projection.M);
+	return true;
+}
+
+bool RendererGL33::Initialize()
+{
+	if (!LoadFunctions()
+		|| !BuildProgram())
+		return false;
+
+	pglGenVertexArrays(1, &_vao);
+	pglBindVertexArray(_vao);
+
+	pglGenBuffers(1, &_vbo);
+	pglBindBuffer(GL_ARRAY_BUFFER, _vbo);
+	pglBufferData(GL_ARRAY_BUFFER, RENDERER_BATCH_VERTICES * sizeof(RenderVertex), NULL, GL_STREAM_DRAW);
+
+	pglEnableVertexAttribArray(0);
+	pglVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(RenderVertex), (const GLvoid *) offsetof(RenderVertex, X));
+	pglEnableVertexAttribArray(1);
+	pglVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(RenderVertex), (const GLvoid *) offsetof(RenderVertex, U));
+	pglEnableVertexAttribArray(2);
+	pglVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(RenderVertex), (const GLvoid *) offsetof(RenderVertex, R));
+
+	// quads are drawn as two triangles each, the indices never change
+	std::vector<GLushort> indices;
+	indices.reserve(RENDERER_BATCH_VERTICES / 4 * 6);
+	for (GLushort i = 0; i < RENDERER_BATCH_VERTICES; i += 4)
+	{
+		indices.push_back(i);
+		indices.push_back(i + 1);
+		indices.push_back(i + 2);
+		indices.push_back(i);
+		indices.push_back(i + 2);
+		indices.push_back(i + 3);
+	}
+
+	// the element array binding is part of the VAO, leave it bound
+	pglGenBuffers(1, &_ibo);
+	pglBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _ibo);
+	pglBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), &indices[0], GL_STATIC_DRAW);
+
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	return true;
+}
+
+void RendererGL33::SetOrtho(float left, float right, float bottom, float top, float zNear, float zFar)
+{
+	Flush();
+	Renderer::SetOrtho(left, right, bottom, top, zNear, zFar);
+	pglUniformMatrix4fv(_projectionLocation, 1, GL_FALSE, _projection.M);
+}
+
+void RendererGL33::BindTexture(GLuint texture)
+{
+	if (texture != _texture)
+		Flush();
+
+	Renderer::BindTexture(texture);
+
+	// bind immediately as well, callers may upload into the texture
+	glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+void RendererGL33::SetTexturing(bool enable)
+{
+	if (enable != _state.Texturing)
+		Flush();
+
+	Renderer::SetTexturing(enable);
+}
+
+void RendererGL33::SetBlending(bool enable)
+{
+	if (enable != _state.Blending)
+		Flush();
+
+	Renderer::SetBlending(enable);
+}
+
+void RendererGL33::SetDepthTest(bool enable)
+{
+	if (enable != _state.DepthTest)
+		Flush();
+
+	Renderer::SetDepthTest(enable);
+}
+
+void RendererGL33::PopState()
+{
+	Flush();
+	Renderer::PopState();
+}
+
+void RendererGL33::DrawQuads(const RenderVertex * vertices, Uint32 count)
+{
+	Append(GL_TRIANGLES, vertices, count);
+}
+
+void RendererGL33::DrawLines(const RenderVertex * vertices, Uint32 count)
+{
+	Append(GL_LINES, vertices, count);
+}
+
+void RendererGL33::Append(GLenum mode, const RenderVertex * vertices, Uint32 count)
+{
+	if (mode != _batchMode)
+	{
+		Flush();
+		_batchMode = mode;
+	}
+
+	const RenderMatrix& modelView = _modelView.back();
+	for (Uint32 i = 0; i < count; i++)
+	{
+		if (_batch.size() >= RENDERER_BATCH_VERTICES)
+			Flush();
+
+		RenderVertex v = vertices[i];
+		modelView.Transform(v.X, v.Y, v.Z);
+		_batch.push_back(v);
+	}
+}
+
+void RendererGL33::Flush()
+{
+	if (_batch.empty())
+		return;
+
+	if (_state.Blending)
+		glEnable(GL_BLEND);
+	else
+		glDisable(GL_BLEND);
+
+	if (_state.DepthTest)
+		glEnable(GL_DEPTH_TEST);
+	else
+		glDisable(GL_DEPTH_TEST);
+
+	glBindTexture(GL_TEXTURE_2D, _texture);
+	pglUniform1i(_texturingLocation, _state.Texturing ? 1 : 0);
+
+	// orphan the previous contents so the driver doesn't have to wait for pending draws
+	pglBindBuffer(GL_ARRAY_BUFFER, _vbo);
+	pglBufferData(GL_ARRAY_BUFFER, RENDERER_BATCH_VERTICES * sizeof(RenderVertex), NULL, GL_STREAM_DRAW);
+	pglBufferSubData(GL_ARRAY_BUFFER, 0, _batch.size() * sizeof(RenderVertex), &_batch[0]);
+
+	GLsizei count = (GLsizei) _batch.size();
+	if (_batchMode == GL_TRIANGLES)
+		glDrawElements(GL_TRIANGLES, count / 4 * 6, GL_UNSIGNED_SHORT, NULL);
+	else
+		glDrawArrays(_batchMode, 0, count);
+
+	_batch.clear();
+}
+
+void RendererGL33::TexImageAlpha(GLsizei width, GLsizei height, const GLvoid * pixels)
+{
+	// GL_ALPHA is gone in the core profile, sample the red channel as alpha instead
+	static const GLint swizzle[] = { GL_ONE, GL_ONE, GL_ONE, GL_RED };
+
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, pixels);
+	glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+}
+
+RendererGL33::~RendererGL33()
+{
+	if (_ibo != 0)
+		pglDeleteBuffers(1, &_ibo);
+
+	if (_vbo != 0)
+		pglDeleteBuffers(1, &_vbo);
+
+	if (_vao != 0)
+		pglDeleteVertexArrays(1, &_vao);
+
+	if (_program != 0)
+		pglDeleteProgram(_program);
+}
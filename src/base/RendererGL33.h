@@ -0,0 +1,85 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _RENDERERGL33_H
+#define _RENDERERGL33_H
+#pragma once
+
+#include "Renderer.h"
+
+// maximum number of vertices batched before they're submitted (multiple of 4 and 2)
+#define RENDERER_BATCH_VERTICES	16384
+
+// OpenGL 3.3 core profile: a single shader program emulating the
+// modulated texturing used by the fixed-function path. Vertices are
+// transformed on the CPU and collected in a streamed vertex buffer until
+// the texture, enable state or primitive type changes.
+class RendererGL33 : public Renderer
+{
+public:
+	RendererGL33();
+
+	// Loads the required entry points and builds the shader program; false if unsupported.
+	bool Initialize();
+
+	const char * GetName() { return "gl33"; }
+	RenderBackend GetBackend() { return rbGL33; }
+	bool SupportsDisplayLists() { return false; }
+
+	void SetOrtho(float left, float right, float bottom, float top, float zNear, float zFar);
+
+	void BindTexture(GLuint texture);
+	void SetTexturing(bool enable);
+	void SetBlending(bool enable);
+	void SetDepthTest(bool enable);
+
+	void PopState();
+
+	void DrawQuads(const RenderVertex * vertices, Uint32 count);
+	void DrawLines(const RenderVertex * vertices, Uint32 count);
+
+	void TexImageAlpha(GLsizei width, GLsizei height, const GLvoid * pixels);
+
+	void Flush();
+
+	~RendererGL33();
+
+protected:
+	bool LoadFunctions();
+	GLuint CompileShader(GLenum type, const char * source);
+	bool BuildProgram();
+
+	void Append(GLenum mode, const RenderVertex * vertices, Uint32 count);
+
+	GLuint	_program;
+	GLint	_projectionLocation;
+	GLint	_texturingLocation;
+
+	GLuint	_vao;
+	GLuint	_vbo;
+	GLuint	_ibo;
+
+	GLenum						_batchMode; // GL_TRIANGLES (from quads) or GL_LINES
+	std::vector<RenderVertex>	_batch;     // transformed vertices waiting to be submitted
+};
+
+#endif
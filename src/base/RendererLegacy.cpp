@@ -0,0 +1,163 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "stdafx.h"
+#include "RendererLegacy.h"
+
+RendererLegacy::RendererLegacy() : Renderer()
+{
+	glMatrixMode(GL_MODELVIEW);
+	glLoadIdentity();
+}
+
+void RendererLegacy::SetOrtho(float left, float right, float bottom, float top, float zNear, float zFar)
+{
+	glMatrixMode(GL_PROJECTION);
+	glLoadIdentity();
+	glOrtho(left, right, bottom, top, zNear, zFar);
+	glMatrixMode(GL_MODELVIEW);
+
+	Renderer::SetOrtho(left, right, bottom, top, zNear, zFar);
+}
+
+void RendererLegacy::LoadIdentity()
+{
+	Renderer::LoadIdentity();
+	glLoadIdentity();
+}
+
+void RendererLegacy::PushMatrix()
+{
+	Renderer::PushMatrix();
+	glPushMatrix();
+}
+
+void RendererLegacy::PopMatrix()
+{
+	Renderer::PopMatrix();
+	glPopMatrix();
+}
+
+void RendererLegacy::Translate(float x, float y, float z)
+{
+	Renderer::Translate(x, y, z);
+	glTranslatef(x, y, z);
+}
+
+void RendererLegacy::Scale(float x, float y, float z)
+{
+	Renderer::Scale(x, y, z);
+	glScalef(x, y, z);
+}
+
+void RendererLegacy::MultMatrix(const float * matrix)
+{
+	Renderer::MultMatrix(matrix);
+	glMultMatrixf(matrix);
+}
+
+void RendererLegacy::SetColor(float r, float g, float b, float a /*= 1.0f*/)
+{
+	Renderer::SetColor(r, g, b, a);
+	glColor4f(r, g, b, a);
+}
+
+void RendererLegacy::BindTexture(GLuint texture)
+{
+	Renderer::BindTexture(texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+void RendererLegacy::SetTexturing(bool enable)
+{
+	Renderer::SetTexturing(enable);
+	if (enable)
+		glEnable(GL_TEXTURE_2D);
+	else
+		glDisable(GL_TEXTURE_2D);
+}
+
+void RendererLegacy::SetBlending(bool enable)
+{
+	Renderer::SetBlending(enable);
+	if (enable)
+	{
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	}
+	else
+	{
+		glDisable(GL_BLEND);
+	}
+}
+
+void RendererLegacy::SetDepthTest(bool enable)
+{
+	Renderer::SetDepthTest(enable);
+	if (enable)
+		glEnable(GL_DEPTH_TEST);
+	else
+		glDisable(GL_DEPTH_TEST);
+}
+
+void RendererLegacy::PushState()
+{
+	Renderer::PushState();
+	glPushAttrib(GL_CURRENT_BIT | GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT);
+}
+
+void RendererLegacy::PopState()
+{
+	Renderer::PopState();
+	glPopAttrib();
+}
+
+void RendererLegacy::DrawQuads(const RenderVertex * vertices, Uint32 count)
+{
+	Submit(GL_QUADS, vertices, count);
+}
+
+void RendererLegacy::DrawLines(const RenderVertex * vertices, Uint32 count)
+{
+	Submit(GL_LINES, vertices, count);
+}
+
+void RendererLegacy::Submit(GLenum mode, const RenderVertex * vertices, Uint32 count)
+{
+	glBegin(mode);
+	for (Uint32 i = 0; i < count; i++)
+	{
+		const RenderVertex& v = vertices[i];
+		glColor4f(v.R, v.G, v.B, v.A);
+		glTexCoord2f(v.U, v.V);
+		glVertex3f(v.X, v.Y, v.Z);
+	}
+	glEnd();
+
+	// vertex colours replace the current colour in GL, restore it
+	glColor4fv(_state.Color);
+}
+
+void RendererLegacy::TexImageAlpha(GLsizei width, GLsizei height, const GLvoid * pixels)
+{
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, width, height, 0, GL_ALPHA, GL_UNSIGNED_BYTE, pixels);
+}
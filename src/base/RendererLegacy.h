@@ -0,0 +1,66 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _RENDERERLEGACY_H
+#define _RENDERERLEGACY_H
+#pragma once
+
+#include "Renderer.h"
+
+// Fixed-function OpenGL: every call maps directly onto its GL 1.x counterpart.
+class RendererLegacy : public Renderer
+{
+public:
+	RendererLegacy();
+
+	const char * GetName() { return "legacy"; }
+	RenderBackend GetBackend() { return rbLegacy; }
+	bool SupportsDisplayLists() { return true; }
+
+	void SetOrtho(float left, float right, float bottom, float top, float zNear, float zFar);
+	void LoadIdentity();
+	void PushMatrix();
+	void PopMatrix();
+	void Translate(float x, float y, float z);
+	void Scale(float x, float y, float z);
+	void MultMatrix(const float * matrix);
+
+	void SetColor(float r, float g, float b, float a = 1.0f);
+
+	void BindTexture(GLuint texture);
+	void SetTexturing(bool enable);
+	void SetBlending(bool enable);
+	void SetDepthTest(bool enable);
+
+	void PushState();
+	void PopState();
+
+	void DrawQuads(const RenderVertex * vertices, Uint32 count);
+	void DrawLines(const RenderVertex * vertices, Uint32 count);
+
+	void TexImageAlpha(GLsizei width, GLsizei height, const GLvoid * pixels);
+
+protected:
+	void Submit(GLenum mode, const RenderVertex * vertices, Uint32 count);
+};
+
+#endif
@@ -0,0 +1,374 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "stdafx.h"
+#include <time.h>
+
+#include "Screenshot.h"
+#include "Graphic.h"
+#include "Log.h"
+#include "PathUtils.h"
+#include "Tracer.h"
+
+initialiseSingleton(ScreenshotMgr);
+
+// pixel buffer object entry points (OpenGL 1.5 / GL_ARB_pixel_buffer_object)
+static PFNGLGENBUFFERSPROC		pglGenBuffers    = NULL;
+static PFNGLDELETEBUFFERSPROC	pglDeleteBuffers = NULL;
+static PFNGLBINDBUFFERPROC		pglBindBuffer    = NULL;
+static PFNGLBUFFERDATAPROC		pglBufferData    = NULL;
+static PFNGLMAPBUFFERPROC		pglMapBuffer     = NULL;
+static PFNGLUNMAPBUFFERPROC		pglUnmapBuffer   = NULL;
+
+static const int SCREENSHOT_JPEG_QUALITY = 90;
+
+// IMG_SaveJPG() is only there from SDL_image 2.0.2 on; older ones save bursts as PNG.
+// (SDL_IMAGE_VERSION_ATLEAST() itself is missing from the older headers.)
+#if SDL_VERSIONNUM(SDL_IMAGE_MAJOR_VERSION, SDL_IMAGE_MINOR_VERSION, SDL_IMAGE_PATCHLEVEL) >= SDL_VERSIONNUM(2, 0, 2)
+#	define SCREENSHOT_JPEG_SUPPORTED 1
+#else
+#	define SCREENSHOT_JPEG_SUPPORTED 0
+#endif
+
+ScreenshotMgr::ScreenshotMgr()
+	: _captureRequested(false), _requestedFormat(ssfPNG),
+	_burstFrames(0), _burstIndex(0), _nextPbo(0),
+	_stopThread(false)
+{
+	memset(_pbo, 0, sizeof(_pbo));
+	memset(_pboSize, 0, sizeof(_pboSize));
+	memset(_pending, 0, sizeof(_pending));
+
+	InitPBO();
+
+	_thread = std::thread(&ScreenshotMgr::EncoderThread, this);
+}
+
+void ScreenshotMgr::InitPBO()
+{
+	if (!SDL_GL_ExtensionSupported("GL_ARB_pixel_buffer_object"))
+	{
+		sLog.Info("ScreenshotMgr", "Pixel buffer objects not supported, screenshots are read synchronously.");
+		return;
+	}
+
+	pglGenBuffers    = (PFNGLGENBUFFERSPROC)    SDL_GL_GetProcAddress("glGenBuffers");
+	pglDeleteBuffers = (PFNGLDELETEBUFFERSPROC) SDL_GL_GetProcAddress("glDeleteBuffers");
+	pglBindBuffer    = (PFNGLBINDBUFFERPROC)    SDL_GL_GetProcAddress("glBindBuffer");
+	pglBufferData    = (PFNGLBUFFERDATAPROC)    SDL_GL_GetProcAddress("glBufferData");
+	pglMapBuffer     = (PFNGLMAPBUFFERPROC)     SDL_GL_GetProcAddress("glMapBuffer");
+	pglUnmapBuffer   = (PFNGLUNMAPBUFFERPROC)   SDL_GL_GetProcAddress("glUnmapBuffer");
+
+	if (pglGenBuffers == NULL || pglDeleteBuffers == NULL || pglBindBuffer == NULL
+		|| pglBufferData == NULL || pglMapBuffer == NULL || pglUnmapBuffer == NULL)
+	{
+		sLog.Warn("ScreenshotMgr", "Failed to load pixel buffer object functions.");
+		return;
+	}
+
+	pglGenBuffers(SCREENSHOT_PBO_COUNT, _pbo);
+	PboSupported = true;
+}
+
+ScreenshotJob * ScreenshotMgr::CreateJob(ScreenshotFormat format)
+{
+	ScreenshotJob * job = new ScreenshotJob();
+	char name[64];
+
+	job->Format = format;
+	job->Width = ScreenW;
+	job->Height = ScreenH;
+	job->Screens = Screens;
+
+	if (_burstFrames > 0)
+	{
+		snprintf(name, sizeof(name), "%s_%04u", _burstName.c_str(), _burstIndex++);
+	}
+	else
+	{
+		time_t unixTime = time(NULL);
+		tm localTime = *localtime(&unixTime);
+
+		snprintf(name, sizeof(name), "screenshot_%04u%02u%02u_%02u%02u%02u_%03u",
+			1900 + localTime.tm_year, localTime.tm_mon + 1, localTime.tm_mday,
+			localTime.tm_hour, localTime.tm_min, localTime.tm_sec, SDL_GetTicks() % 1000);
+	}
+
+	job->BaseName = name;
+	return job;
+}
+
+void ScreenshotMgr::Capture(ScreenshotFormat format)
+{
+	_captureRequested = true;
+	_requestedFormat = format;
+}
+
+void ScreenshotMgr::ToggleBurst()
+{
+	if (_burstFrames > 0)
+	{
+		sLog.Status("ScreenshotMgr", "Burst %s stopped after %u frames", _burstName.c_str(), _burstIndex);
+		_burstFrames = 0;
+		return;
+	}
+
+	time_t unixTime = time(NULL);
+	tm localTime = *localtime(&unixTime);
+	char name[64];
+
+	snprintf(name, sizeof(name), "burst_%04u%02u%02u_%02u%02u%02u",
+		1900 + localTime.tm_year, localTime.tm_mon + 1, localTime.tm_mday,
+		localTime.tm_hour, localTime.tm_min, localTime.tm_sec);
+
+	_burstName = name;
+	_burstIndex = 0;
+	_burstFrames = SCREENSHOT_BURST_MAX;
+
+	sLog.Status("ScreenshotMgr", "Burst %s started", _burstName.c_str());
+}
+
+void ScreenshotMgr::OnFrameEnd()
+{
+	// Map the buffers that were filled a few frames ago
+	if (PboSupported)
+		CollectPBOs(false);
+
+	if (_burstFrames > 0)
+	{
+		// Burst frames are encoded as JPEG (where SDL_image can), PNG encoding can't keep up with the frame rate.
+		ReadFrame(CreateJob(ssfJPEG));
+		if (--_burstFrames == 0)
+			sLog.Status("ScreenshotMgr", "Burst %s finished (%u frames)", _burstName.c_str(), _burstIndex);
+	}
+
+	if (_captureRequested)
+	{
+		_captureRequested = false;
+		ReadFrame(CreateJob(_requestedFormat));
+	}
+}
+
+void ScreenshotMgr::ReadFrame(ScreenshotJob * job)
+{
+	Uint32 size = job->Width * job->Height * 4;
+
+	sRenderer.Flush();
+	glReadBuffer(GL_BACK);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+	if (!PboSupported)
+	{
+		job->Pixels.resize(size);
+		glReadPixels(0, 0, job->Width, job->Height, GL_RGBA, GL_UNSIGNED_BYTE, &job->Pixels[0]);
+		QueueJob(job);
+		return;
+	}
+
+	Uint32 slot = _nextPbo;
+	_nextPbo = (_nextPbo + 1) % SCREENSHOT_PBO_COUNT;
+
+	// All buffers in flight (more than one read per frame), so collect this one right away.
+	if (_pending[slot].Active)
+	{
+		_pending[slot].FramesLeft = 0;
+		CollectPBOs(true);
+	}
+
+	pglBindBuffer(GL_PIXEL_PACK_BUFFER, _pbo[slot]);
+	if (_pboSize[slot] != size)
+	{
+		pglBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+		_pboSize[slot] = size;
+	}
+
+	// With a pack buffer bound this only queues the transfer, the pixels are mapped a few frames later.
+	glReadPixels(0, 0, job->Width, job->Height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	pglBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	_pending[slot].Active = true;
+	_pending[slot].FramesLeft = SCREENSHOT_PBO_COUNT - 1;
+	_pending[slot].Job = job;
+}
+
+void ScreenshotMgr::CollectPBOs(bool force)
+{
+	for (int i = 0; i < SCREENSHOT_PBO_COUNT; i++)
+	{
+		PendingRead& pending = _pending[i];
+		if (!pending.Active)
+			continue;
+
+		if (pending.FramesLeft > 0 && !force)
+		{
+			--pending.FramesLeft;
+			continue;
+		}
+
+		if (pending.FramesLeft > 0)
+			continue;
+
+		ScreenshotJob * job = pending.Job;
+		pending.Active = false;
+		pending.Job = NULL;
+
+		pglBindBuffer(GL_PIXEL_PACK_BUFFER, _pbo[i]);
+		const Uint8 * data = (const Uint8 *) pglMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+		if (data != NULL)
+		{
+			job->Pixels.assign(data, data + _pboSize[i]);
+			pglUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			QueueJob(job);
+		}
+		else
+		{
+			sLog.Error("ScreenshotMgr", "Failed to map pixel buffer for %s.", job->BaseName.c_str());
+			delete job;
+		}
+
+		pglBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+}
+
+void ScreenshotMgr::QueueJob(ScreenshotJob * job)
+{
+	std::lock_guard<std::mutex> lock(_queueLock);
+
+	// Never let a burst pile up unbounded memory if the disk can't keep up.
+	// Single screenshots are always kept.
+	if (_queue.size() >= SCREENSHOT_QUEUE_MAX
+		&& job->Format == ssfJPEG)
+	{
+		sLog.Warn("ScreenshotMgr", "Encoder queue full, skipping %s.", job->BaseName.c_str());
+		delete job;
+		return;
+	}
+
+	_queue.push_back(job);
+	_queueCond.notify_one();
+}
+
+void ScreenshotMgr::EncoderThread()
+{
+	TRACE_THREAD_NAME("Screenshot encoder");
+
+	for (;;)
+	{
+		ScreenshotJob * job;
+
+		{
+			std::unique_lock<std::mutex> lock(_queueLock);
+			while (_queue.empty() && !_stopThread)
+				_queueCond.wait(lock);
+
+			// Finish the queued screenshots before stopping.
+			if (_queue.empty())
+				return;
+
+			job = _queue.front();
+			_queue.pop_front();
+		}
+
+		{
+			TRACE_SCOPE("Encode screenshot");
+			Encode(job);
+		}
+
+		delete job;
+	}
+}
+
+void ScreenshotMgr::Encode(ScreenshotJob * job)
+{
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+	const Uint32 rmask = 0xFF000000, gmask = 0x00FF0000, bmask = 0x0000FF00, amask = 0x000000FF;
+#else
+	const Uint32 rmask = 0x000000FF, gmask = 0x0000FF00, bmask = 0x00FF0000, amask = 0xFF000000;
+#endif
+
+	// Each screen of a multi-screen setup is written to its own file.
+	Uint32 screenW = job->Width / job->Screens;
+	Uint32 rowSize = job->Width * 4;
+
+	for (int screen = 0; screen < job->Screens; screen++)
+	{
+		SDL_Surface * surface = SDL_CreateRGBSurface(0, screenW, job->Height, 32, rmask, gmask, bmask, amask);
+		if (surface == NULL)
+		{
+			sLog.Error("ScreenshotMgr", "Failed to create surface for %s: %s", job->BaseName.c_str(), SDL_GetError());
+			return;
+		}
+
+		// OpenGL's rows start at the bottom
+		const Uint8 * src = &job->Pixels[0] + screen * screenW * 4;
+		for (Uint32 y = 0; y < job->Height; y++)
+			memcpy((Uint8 *) surface->pixels + y * surface->pitch,
+				src + (job->Height - 1 - y) * rowSize, screenW * 4);
+
+		std::string filename = job->BaseName;
+		if (job->Screens > 1)
+			filename += "_screen" + boost::lexical_cast<std::string>(screen + 1);
+
+		int result;
+#if SCREENSHOT_JPEG_SUPPORTED
+		if (job->Format == ssfJPEG)
+		{
+			filename += ".jpg";
+			result = IMG_SaveJPG(surface, (ScreenshotsPath / filename).generic_string().c_str(), SCREENSHOT_JPEG_QUALITY);
+		}
+		else
+#endif
+		{
+			filename += ".png";
+			result = IMG_SavePNG(surface, (ScreenshotsPath / filename).generic_string().c_str());
+		}
+
+		if (result != 0)
+			sLog.Error("ScreenshotMgr", "Failed to save %s: %s", filename.c_str(), SDL_GetError());
+		else
+			sLog.Info("ScreenshotMgr", "Saved %s", filename.c_str());
+
+		SDL_FreeSurface(surface);
+	}
+}
+
+ScreenshotMgr::~ScreenshotMgr()
+{
+	// Finish the reads still in flight so they get written, too.
+	if (PboSupported)
+	{
+		for (int i = 0; i < SCREENSHOT_PBO_COUNT; i++)
+			_pending[i].FramesLeft = 0;
+
+		CollectPBOs(true);
+		pglDeleteBuffers(SCREENSHOT_PBO_COUNT, _pbo);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_queueLock);
+		_stopThread = true;
+		_queueCond.notify_one();
+	}
+
+	if (_thread.joinable())
+		_thread.join();
+}
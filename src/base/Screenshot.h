@@ -0,0 +1,117 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _SCREENSHOT_H
+#define _SCREENSHOT_H
+#pragma once
+
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// number of pixel buffers readback rotates through; a capture is mapped
+// this many frames after glReadPixels() was issued, so the GPU never stalls us.
+#define SCREENSHOT_PBO_COUNT	3
+
+// maximum number of frames captured by a single burst
+#define SCREENSHOT_BURST_MAX	120
+
+// maximum number of captured frames waiting to be encoded; further burst frames are skipped
+#define SCREENSHOT_QUEUE_MAX	64
+
+enum ScreenshotFormat
+{
+	ssfPNG,
+	ssfJPEG
+};
+
+// A captured frame on its way to the encoder thread.
+struct ScreenshotJob
+{
+	std::string			BaseName; // without extension
+	ScreenshotFormat	Format;
+	Uint32				Width;
+	Uint32				Height;
+	int					Screens;
+	std::vector<Uint8>	Pixels;   // RGBA, bottom row first (as read from OpenGL)
+};
+
+class ScreenshotMgr : public Singleton<ScreenshotMgr>
+{
+public:
+	ScreenshotMgr();
+
+	// Requests a single screenshot of the next frame.
+	void Capture(ScreenshotFormat format = ssfPNG);
+
+	// Starts capturing every frame (up to SCREENSHOT_BURST_MAX), or stops a running burst.
+	void ToggleBurst();
+
+	INLINE bool IsBurstActive() { return _burstFrames > 0; }
+
+	// Must be called once per frame after drawing and before swapping buffers.
+	void OnFrameEnd();
+
+	~ScreenshotMgr();
+
+private:
+	struct PendingRead
+	{
+		bool				Active;
+		Uint32				FramesLeft; // until the buffer is mapped
+		ScreenshotJob *		Job;
+	};
+
+	void InitPBO();
+	void ReadFrame(ScreenshotJob * job);
+	void CollectPBOs(bool force);
+	void QueueJob(ScreenshotJob * job);
+	ScreenshotJob * CreateJob(ScreenshotFormat format);
+
+	void EncoderThread();
+	void Encode(ScreenshotJob * job);
+
+	bool	_captureRequested;
+	ScreenshotFormat	_requestedFormat;
+
+	Uint32	_burstFrames;   // frames left in the running burst
+	Uint32	_burstIndex;
+	std::string	_burstName;
+
+	// pixel buffer objects (only if PboSupported)
+	GLuint		_pbo[SCREENSHOT_PBO_COUNT];
+	Uint32		_pboSize[SCREENSHOT_PBO_COUNT];
+	PendingRead	_pending[SCREENSHOT_PBO_COUNT];
+	Uint32		_nextPbo;
+
+	// encoder thread
+	std::thread					_thread;
+	std::mutex					_queueLock;
+	std::condition_variable		_queueCond;
+	std::deque<ScreenshotJob *>	_queue;
+	bool						_stopThread;
+};
+
+#define sScreenshots (ScreenshotMgr::getSingleton())
+
+#endif
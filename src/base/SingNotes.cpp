@@ -21,3 +21,96 @@
  */
 
 #include "stdafx.h"
+#include "SingNotes.h"
+#include "NoteLaneRenderer.h"
+
+SingNotes::SingNotes()
+	: _timeline(NULL), _time(0.0f), _started(false)
+{
+}
+
+void SingNotes::Reset(const NoteTimeline * timeline)
+{
+	_timeline = timeline;
+	_time = 0.0f;
+	_started = false;
+
+	TrackCursor cursor = { 0, 0, true };
+	_cursors.assign(timeline != NULL ? timeline->GetTrackCount() : 0, cursor);
+}
+
+void SingNotes::Update(float time)
+{
+	if (time < _time)
+	{
+		Seek(time);
+		return;
+	}
+
+	_time = time;
+
+	for (size_t t = 0; t < _cursors.size(); t++)
+	{
+		const NoteTrack& track = _timeline->GetTrack((Uint32) t);
+		TrackCursor& cursor = _cursors[t];
+		Uint32 line = cursor.Line;
+
+		// over a whole song each note and line is stepped over once
+		while (line + 1 < track.GetLineCount() && track.LineStartTime[line + 1] <= time)
+			line++;
+
+		while (cursor.Note < track.GetNoteCount() && track.EndTime[cursor.Note] <= time)
+			cursor.Note++;
+
+		cursor.LineChanged = (line != cursor.Line || !_started);
+		cursor.Line = line;
+	}
+
+	_started = true;
+}
+
+void SingNotes::Seek(float time)
+{
+	_time = time;
+	_started = true;
+
+	for (size_t t = 0; t < _cursors.size(); t++)
+	{
+		const NoteTrack& track = _timeline->GetTrack((Uint32) t);
+		TrackCursor& cursor = _cursors[t];
+
+		// always redrawn, the line may be the same but the sung part isn't
+		cursor.Line = track.FindLine(time);
+		cursor.Note = track.FindNote(time);
+		cursor.LineChanged = true;
+	}
+}
+
+bool SingNotes::IsNoteActive(Uint32 track) const
+{
+	const NoteTrack& notes = _timeline->GetTrack(track);
+	Uint32 note = _cursors[track].Note;
+
+	return note < notes.GetNoteCount() && notes.StartTime[note] <= _time;
+}
+
+void SingNotes::GetLaneNotes(Uint32 track, std::vector<LaneNote> * notes) const
+{
+	notes->clear();
+
+	const NoteTrack& lines = _timeline->GetTrack(track);
+	Uint32 line = _cursors[track].Line;
+	if (line >= lines.GetLineCount())
+		return;
+
+	for (Uint32 i = lines.LineFirstNote[line]; i < lines.LineFirstNote[line + 1]; i++)
+	{
+		LaneNote note;
+		note.StartBeat = lines.StartBeat[i];
+		note.Length = lines.Length[i];
+		note.Tone = lines.Tone[i];
+		note.Golden = (lines.Type[i] == ntGolden || lines.Type[i] == ntRapGolden);
+		note.Freestyle = (lines.Type[i] == ntFreestyle);
+		notes->push_back(note);
+	}
+}
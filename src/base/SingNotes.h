@@ -0,0 +1,88 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _SINGNOTES_H
+#define _SINGNOTES_H
+#pragma once
+
+#include "Note.h"
+
+struct LaneNote;
+
+/**
+ * Where the sing loop is in each track of a NoteTimeline: the current line
+ * and the note being (or next to be) sung.
+ *
+ * Update() is called once per frame with the song time and moves each
+ * track's cursor forward over whatever has passed since the last frame,
+ * which is usually nothing, so a frame costs a couple of comparisons per
+ * track. Players only look up their track's state (see
+ * NoteTimeline::GetPlayerTrack()), so six players singing a duet still
+ * only advance two cursors. Going back in time seeks with a binary search.
+ */
+class SingNotes
+{
+public:
+	SingNotes();
+
+	// Starts over on the given timeline, which must outlive its use here.
+	void Reset(const NoteTimeline * timeline);
+
+	// Moves to the given song time (ms).
+	void Update(float time);
+
+	// Jumps to the given song time, e.g. for the medley start or the editor.
+	void Seek(float time);
+
+	INLINE float GetTime() const { return _time; }
+	INLINE float GetBeat() const { return _timeline != NULL ? _timeline->TimeToBeat(_time) : 0.0f; }
+
+	// the track's current line
+	INLINE Uint32 GetLine(Uint32 track) const { return _cursors[track].Line; }
+
+	// the track's note being sung, or the next one between notes
+	INLINE Uint32 GetNote(Uint32 track) const { return _cursors[track].Note; }
+
+	// Whether GetNote() is being sung right now rather than coming up.
+	bool IsNoteActive(Uint32 track) const;
+
+	// Whether the track's line changed with the last Update() or Seek().
+	INLINE bool LineChanged(Uint32 track) const { return _cursors[track].LineChanged; }
+
+	// Fills the notes of the track's current line for NoteLaneRenderer::SetLine().
+	void GetLaneNotes(Uint32 track, std::vector<LaneNote> * notes) const;
+
+protected:
+	struct TrackCursor
+	{
+		Uint32	Line;
+		Uint32	Note;
+		bool	LineChanged;
+	};
+
+	const NoteTimeline *		_timeline;
+	std::vector<TrackCursor>	_cursors;
+	float						_time;
+	bool						_started;	// so the first Update() reports the first lines
+};
+
+#endif
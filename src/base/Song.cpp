@@ -21,3 +21,355 @@
  */
 
 #include "stdafx.h"
+#include "Song.h"
+#include "SongParser.h"
+#include "Log.h"
+#include "Ini.h"
+#include "../shared/MappedFile.h"
+
+Song::Song()
+	: FileSize(0), LastModified(0), Year(0),
+	BPM(0.0f), Gap(0.0f), VideoGap(0.0f), Start(0.0f), Finish(0), PreviewStart(0.0f),
+	Relative(false), Resolution(4), NotesGap(0),
+	MedleyStartBeat(0), MedleyEndBeat(0),
+	FileEncoding(Encoding::Auto)
+{
+}
+
+// Song files come from all sorts of editors, so accept both "1,5" and "1.5".
+static float ParseSongFloat(const StringRef& value)
+{
+	char number[32];
+	size_t length = std::min(value.Length, sizeof(number) - 1);
+
+	memcpy(number, value.Data, length);
+	number[length] = '\0';
+	std::replace(number, number + length, ',', '.');
+	return (float) atof(number);
+}
+
+static int ParseSongInt(const StringRef& value)
+{
+	return (int) ParseSongFloat(value);
+}
+
+bool Song::ReadHeader(const path& filename)
+{
+	MappedFile file;
+	if (!file.Open(filename))
+		return false;
+
+	FileName = filename;
+	Path = filename.parent_path();
+	FileSize = file.GetSize();
+
+	boost::system::error_code error;
+	LastModified = boost::filesystem::last_write_time(filename, error);
+	if (error)
+		LastModified = 0;
+
+	if (IsXML())
+	{
+		if (!ParseXML(file.GetData(), file.GetSize(), false))
+			return false;
+
+		DecodeHeader();
+		return true;
+	}
+
+	SongParser parser(file.GetData(), file.GetSize());
+
+	// A UTF-8 BOM overrides whatever #ENCODING says.
+	if (parser.HasUTF8BOM())
+		FileEncoding = Encoding::UTF8;
+
+	StringRef tag, value;
+	while (parser.NextTag(&tag, &value))
+		ParseHeaderTag(tag, value);
+
+	if (Title.empty() || Artist.empty() || Mp3.empty() || BPM <= 0.0f)
+	{
+		sLog.Debug("Song::ReadHeader", "%s: missing #TITLE, #ARTIST, #MP3 or #BPM.", filename.generic_string().c_str());
+		return false;
+	}
+
+	DecodeHeader();
+	return true;
+}
+
+void Song::DecodeHeader()
+{
+	std::string * const texts[] =
+	{
+		&Title, &Artist, &Genre, &Edition, &Language, &Creator, &DuetSingerP1, &DuetSingerP2
+	};
+
+	const size_t textCount = sizeof(texts) / sizeof(texts[0]);
+
+	if (FileEncoding == Encoding::Auto || FileEncoding == Encoding::Locale)
+		FileEncoding = sIni.DefaultEncoding;
+
+	// Decided once for the whole file, so the lyrics are read the same way as the header.
+	if (FileEncoding == Encoding::Auto || FileEncoding == Encoding::Locale)
+	{
+		FileEncoding = Encoding::UTF8;
+		for (size_t i = 0; i < textCount; i++)
+		{
+			if (!IsValidUTF8(texts[i]->data(), texts[i]->length()))
+			{
+				FileEncoding = Encoding::CP1252;
+				break;
+			}
+		}
+	}
+
+	std::string decoded;
+	for (size_t i = 0; i < textCount; i++)
+	{
+		DecodeStringUTF8(*texts[i], FileEncoding, &decoded);
+		texts[i]->swap(decoded);
+	}
+}
+
+void Song::ParseHeaderTag(const StringRef& tag, const StringRef& value)
+{
+	if (tag.EqualsI("TITLE"))
+		Title = value.ToString();
+	else if (tag.EqualsI("ARTIST"))
+		Artist = value.ToString();
+	else if (tag.EqualsI("GENRE"))
+		Genre = value.ToString();
+	else if (tag.EqualsI("EDITION"))
+		Edition = value.ToString();
+	else if (tag.EqualsI("LANGUAGE"))
+		Language = value.ToString();
+	else if (tag.EqualsI("CREATOR"))
+		Creator = value.ToString();
+	else if (tag.EqualsI("YEAR"))
+		Year = ParseSongInt(value);
+	else if (tag.EqualsI("MP3"))
+		Mp3 = value.ToString();
+	else if (tag.EqualsI("COVER"))
+		Cover = value.ToString();
+	else if (tag.EqualsI("BACKGROUND"))
+		Background = value.ToString();
+	else if (tag.EqualsI("VIDEO"))
+		Video = value.ToString();
+	else if (tag.EqualsI("BPM"))
+		BPM = ParseSongFloat(value);
+	else if (tag.EqualsI("GAP"))
+		Gap = ParseSongFloat(value);
+	else if (tag.EqualsI("VIDEOGAP"))
+		VideoGap = ParseSongFloat(value);
+	else if (tag.EqualsI("START"))
+		Start = ParseSongFloat(value);
+	else if (tag.EqualsI("END"))
+		Finish = ParseSongInt(value);
+	else if (tag.EqualsI("PREVIEWSTART"))
+		PreviewStart = ParseSongFloat(value);
+	else if (tag.EqualsI("RELATIVE"))
+		Relative = value.EqualsI("yes");
+	else if (tag.EqualsI("RESOLUTION"))
+		Resolution = ParseSongInt(value);
+	else if (tag.EqualsI("NOTESGAP"))
+		NotesGap = ParseSongInt(value);
+	else if (tag.EqualsI("MEDLEYSTARTBEAT"))
+		MedleyStartBeat = ParseSongInt(value);
+	else if (tag.EqualsI("MEDLEYENDBEAT"))
+		MedleyEndBeat = ParseSongInt(value);
+	else if (tag.EqualsI("DUETSINGERP1") || tag.EqualsI("P1"))
+		DuetSingerP1 = value.ToString();
+	else if (tag.EqualsI("DUETSINGERP2") || tag.EqualsI("P2"))
+		DuetSingerP2 = value.ToString();
+	else if (tag.EqualsI("ENCODING"))
+	{
+		// the BOM wins
+		if (FileEncoding == Encoding::Auto)
+		{
+			std::string encoding = value.ToString();
+			strtoupper(encoding);
+			FileEncoding = Encoding::String2Enum(encoding, Encoding::Auto);
+		}
+	}
+}
+
+bool Song::LoadNotes()
+{
+	UnloadNotes();
+
+	MappedFile file;
+	if (!file.Open(FileName))
+	{
+		sLog.Error("Song::LoadNotes", "Failed to open %s", FileName.generic_string().c_str());
+		return false;
+	}
+
+	if (IsXML())
+		return ParseXML(file.GetData(), file.GetSize(), true);
+
+	// the header was read while scanning
+	SongParser parser(file.GetData(), file.GetSize());
+	StringRef tag, value;
+	while (parser.NextTag(&tag, &value))
+		;
+
+	// Notes before any P line belong to the first singer; P3 means both.
+	Tracks.resize(1);
+	int relativeOffset[2] = { 0, 0 };
+	size_t firstTrack = 0, lastTrack = 0;
+
+	SongNoteLine line;
+	while (parser.NextNoteLine(&line))
+	{
+		switch (line.Type)
+		{
+		case ':':
+		case '*':
+		case 'F':
+		case 'R':
+		case 'G':
+		{
+			if (line.ParamCount < 3)
+			{
+				sLog.Warn("Song::LoadNotes", "%s (%u): incomplete note.",
+					FileName.generic_string().c_str(), parser.GetLineNumber());
+				break;
+			}
+
+			SongNote note;
+			switch (line.Type)
+			{
+			case ':': note.Type = ntNormal; break;
+			case '*': note.Type = ntGolden; break;
+			case 'F': note.Type = ntFreestyle; break;
+			case 'R': note.Type = ntRap; break;
+			case 'G': note.Type = ntRapGolden; break;
+			}
+
+			note.Length = line.Params[1];
+			note.Tone = line.Params[2];
+			DecodeStringUTF8(line.Text.Data, line.Text.Length, FileEncoding, &note.Text);
+
+			for (size_t i = firstTrack; i <= lastTrack; i++)
+			{
+				SongTrack& track = Tracks[i];
+				note.Start = relativeOffset[i] + line.Params[0];
+
+				if (track.Lines.empty())
+				{
+					SongLine songLine;
+					songLine.Start = note.Start;
+					songLine.End = 0;
+					track.Lines.push_back(songLine);
+				}
+
+				track.Lines.back().Notes.push_back(note);
+			}
+		} break;
+
+		case '-':
+		{
+			if (line.ParamCount < 1)
+			{
+				sLog.Warn("Song::LoadNotes", "%s (%u): line break without a beat.",
+					FileName.generic_string().c_str(), parser.GetLineNumber());
+				break;
+			}
+
+			for (size_t i = firstTrack; i <= lastTrack; i++)
+			{
+				SongTrack& track = Tracks[i];
+
+				SongLine songLine;
+				songLine.Start = relativeOffset[i] + line.Params[0];
+				songLine.End = 0;
+
+				// In relative mode the second beat (or the first, if it's the only one)
+				// is where the following notes count from.
+				if (Relative)
+					relativeOffset[i] += line.Params[line.ParamCount >= 2 ? 1 : 0];
+
+				// two breaks in a row
+				if (!track.Lines.empty() && track.Lines.back().Notes.empty())
+					track.Lines.back() = songLine;
+				else
+					track.Lines.push_back(songLine);
+			}
+		} break;
+
+		case 'P':
+		{
+			int singer = (line.ParamCount >= 1 ? line.Params[0] : 0);
+			if (singer < 1 || singer > 3)
+			{
+				sLog.Warn("Song::LoadNotes", "%s (%u): unknown singer.",
+					FileName.generic_string().c_str(), parser.GetLineNumber());
+				break;
+			}
+
+			Tracks.resize(2);
+			firstTrack = (singer == 2 ? 1 : 0);
+			lastTrack = (singer == 1 ? 0 : 1);
+		} break;
+
+		case 'E':
+			break;
+
+		default:
+			sLog.Warn("Song::LoadNotes", "%s (%u): unknown line '%c'.",
+				FileName.generic_string().c_str(), parser.GetLineNumber(), line.Type);
+			break;
+		}
+	}
+
+	return FinishTracks();
+}
+
+bool Song::FinishTracks()
+{
+	bool hasNotes = false;
+	for (size_t i = 0; i < Tracks.size(); i++)
+	{
+		std::vector<SongLine>& lines = Tracks[i].Lines;
+
+		// a trailing break doesn't start a line
+		if (!lines.empty() && lines.back().Notes.empty())
+			lines.pop_back();
+
+		for (size_t j = 0; j < lines.size(); j++)
+		{
+			if (lines[j].Notes.empty())
+				continue;
+
+			const SongNote& lastNote = lines[j].Notes.back();
+			lines[j].End = lastNote.Start + lastNote.Length;
+		}
+
+		hasNotes |= !lines.empty();
+	}
+
+	if (!hasNotes)
+	{
+		sLog.Error("Song::LoadNotes", "%s has no notes.", FileName.generic_string().c_str());
+		UnloadNotes();
+		return false;
+	}
+
+	return true;
+}
+
+void Song::UnloadNotes()
+{
+	Tracks.clear();
+}
+
+bool Song::IsSongFileExtension(const char * extension)
+{
+	return STRCASECMP(extension, ".txt") == 0
+		|| STRCASECMP(extension, ".xml") == 0;
+}
+
+bool Song::IsXML() const
+{
+	return STRCASECMP(FileName.extension().generic_string().c_str(), ".xml") == 0;
+}
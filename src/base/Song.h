@@ -0,0 +1,142 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _SONG_H
+#define _SONG_H
+#pragma once
+
+enum NoteType
+{
+	ntFreestyle,	// F
+	ntNormal,		// :
+	ntGolden,		// *
+	ntRap,			// R
+	ntRapGolden		// G
+};
+
+struct SongNote
+{
+	NoteType		Type;
+	int				Start;		// beats
+	int				Length;		// beats
+	int				Tone;
+	std::string		Text;		// UTF-8
+};
+
+struct SongLine
+{
+	int				Start;		// beats
+	int				End;		// end of its last note
+	std::vector<SongNote>	Notes;
+};
+
+struct SongTrack
+{
+	std::vector<SongLine>	Lines;
+};
+
+/**
+ * A song as described by the header of its .txt file
+ * (the #TAG:value lines before the first note), or of its SingStar-style
+ * .xml file (see XMLSong.cpp).
+ *
+ * Scanning only reads the header; the notes are loaded by LoadNotes()
+ * once the song is about to be sung.
+ */
+class Song
+{
+public:
+	Song();
+
+	// Reads the header of the given song file.
+	// Returns false if it isn't readable or lacks any of the required tags.
+	bool ReadHeader(const path& filename);
+
+	// Reads the note section of FileName into Tracks (one per singer).
+	bool LoadNotes();
+	void UnloadNotes();
+	INLINE bool NotesLoaded() const { return !Tracks.empty(); }
+
+	// ".txt" or ".xml", in any case
+	static bool IsSongFileExtension(const char * extension);
+	bool IsXML() const;
+
+	INLINE bool HasMedley() const { return MedleyEndBeat > MedleyStartBeat; }
+	INLINE bool IsDuet() const { return !DuetSingerP1.empty() || !DuetSingerP2.empty(); }
+
+	path			Path;		// folder the song file is in
+	path			FileName;	// the song file itself
+	Uint64			FileSize;
+	time_t			LastModified;
+
+	// UTF-8, whatever the file's encoding
+	std::string		Title;
+	std::string		Artist;
+	std::string		Genre;
+	std::string		Edition;
+	std::string		Language;
+	std::string		Creator;
+	int				Year;
+
+	// relative to Path, as the file has them since they name files on disk
+	std::string		Mp3;
+	std::string		Cover;
+	std::string		Background;
+	std::string		Video;
+
+	float			BPM;
+	float			Gap;		// ms
+	float			VideoGap;	// s
+	float			Start;		// s
+	int				Finish;		// ms, 0 plays to the end
+	float			PreviewStart;	// s
+	bool			Relative;
+	int				Resolution;
+	int				NotesGap;
+
+	int				MedleyStartBeat;	// 0 without a medley part
+	int				MedleyEndBeat;
+
+	std::string		DuetSingerP1;	// only set for duets, UTF-8
+	std::string		DuetSingerP2;
+
+	eEncoding		FileEncoding;	// from #ENCODING or the BOM, otherwise settled by ReadHeader()
+
+	// empty until LoadNotes(), two for duets
+	std::vector<SongTrack>	Tracks;
+
+protected:
+	void ParseHeaderTag(const StringRef& tag, const StringRef& value);
+
+	// Settles FileEncoding if the file didn't and converts the header's texts to UTF-8.
+	void DecodeHeader();
+
+	// Reads the header, or with notes set, the notes of an .xml song (XMLSong.cpp).
+	bool ParseXML(const char * data, size_t size, bool notes);
+
+	// Drops trailing breaks, sets where lines end and checks there are notes at all.
+	bool FinishTracks();
+};
+
+typedef std::vector<Song *> SongList;
+
+#endif
@@ -0,0 +1,256 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "stdafx.h"
+#include "SongBenchmark.h"
+#include "Song.h"
+#include "Log.h"
+
+using namespace boost::filesystem;
+
+#define SONG_BENCHMARK_FOLDER_SIZE	100	// songs per generated folder
+#define SONG_BENCHMARK_LINES		60	// lines per generated song
+#define SONG_BENCHMARK_LINE_NOTES	6	// notes per line
+
+static const char * s_syllables[] = { " Hel", "lo", " world", " sing", "ing", " a", " song", "~" };
+
+// Roughly what a real song looks like: a dozen tags, a few hundred notes.
+static bool WriteSong(const path& filename, Uint32 index)
+{
+	FILE * fp = fopen(filename.generic_string().c_str(), "wb");
+	if (fp == NULL)
+		return false;
+
+	fprintf(fp,
+		"#TITLE:Benchmark Song %u\r\n"
+		"#ARTIST:Benchmark Artist %u\r\n"
+		"#LANGUAGE:English\r\n"
+		"#EDITION:SingStar\r\n"
+		"#GENRE:Pop\r\n"
+		"#YEAR:%u\r\n"
+		"#CREATOR:usdx\r\n"
+		"#MP3:Benchmark Song %u.mp3\r\n"
+		"#COVER:Benchmark Song %u [CO].jpg\r\n"
+		"#BACKGROUND:Benchmark Song %u [BG].jpg\r\n"
+		"#BPM:%u,5\r\n"
+		"#GAP:%u\r\n",
+		index, index / 10, 1960 + index % 60, index, index, index,
+		200 + index % 200, 1000 + index % 20000);
+
+	int beat = 0;
+	for (int line = 0; line < SONG_BENCHMARK_LINES; line++)
+	{
+		for (int note = 0; note < SONG_BENCHMARK_LINE_NOTES; note++)
+		{
+			int length = 1 + (index + note) % 4;
+			fprintf(fp, "%c %d %d %d%s\r\n", (note == 3 ? '*' : ':'), beat, length,
+				(int) ((index + line + note) % 12), s_syllables[(line + note) % 8]);
+
+			beat += length + 1;
+		}
+
+		beat += 4;
+		fprintf(fp, "- %d\r\n", beat - 2);
+	}
+
+	fprintf(fp, "E\r\n");
+	fclose(fp);
+	return true;
+}
+
+// The same song in the SingStar-style XML format, so both parsers get equal work.
+static bool WriteXMLSong(const path& filename, Uint32 index)
+{
+	FILE * fp = fopen(filename.generic_string().c_str(), "wb");
+	if (fp == NULL)
+		return false;
+
+	fprintf(fp,
+		"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\r\n"
+		"<!-- Title: Benchmark Song %u -->\r\n"
+		"<!-- Artist: Benchmark Artist %u -->\r\n"
+		"<!-- Language: English -->\r\n"
+		"<!-- Edition: SingStar -->\r\n"
+		"<!-- Creator: usdx -->\r\n"
+		"<!-- Mp3: Benchmark Song %u.mp3 -->\r\n"
+		"<!-- Cover: Benchmark Song %u [CO].jpg -->\r\n"
+		"<!-- Background: Benchmark Song %u [BG].jpg -->\r\n"
+		"<!-- Gap: %u -->\r\n"
+		"<MELODY xmlns=\"http://www.singstargame.com\" Version=\"1\" Tempo=\"%u\" FixedTempo=\"Yes\""
+		" Resolution=\"Semiquaver\" Genre=\"Pop\" Year=\"%u\">\r\n",
+		index, index / 10, index, index, index, 1000 + index % 20000,
+		200 + index % 200, 1960 + index % 60);
+
+	for (int line = 0; line < SONG_BENCHMARK_LINES; line++)
+	{
+		fprintf(fp, "<SENTENCE>\r\n");
+
+		for (int note = 0; note < SONG_BENCHMARK_LINE_NOTES; note++)
+		{
+			int length = 1 + (index + note) % 4;
+			const char * syllable = s_syllables[(line + note) % 8];
+
+			fprintf(fp, "<NOTE MidiNote=\"%d\" Duration=\"%d\" Lyric=\"%s\"%s />\r\n",
+				60 + (int) ((index + line + note) % 12), length,
+				(*syllable == ' ' ? syllable + 1 : syllable), (note == 3 ? " Bonus=\"Yes\"" : ""));
+
+			fprintf(fp, "<NOTE MidiNote=\"0\" Duration=\"1\" Lyric=\"\" />\r\n");
+		}
+
+		fprintf(fp, "<NOTE MidiNote=\"0\" Duration=\"4\" Lyric=\"\" />\r\n");
+		fprintf(fp, "</SENTENCE>\r\n");
+	}
+
+	fprintf(fp, "</MELODY>\r\n");
+	fclose(fp);
+	return true;
+}
+
+struct SongBenchmarkResult
+{
+	Uint32	Headers;
+	Uint32	Songs;
+	Uint32	Notes;
+	Uint64	Bytes;
+	double	HeaderTime;	// s
+	double	NoteTime;	// s
+};
+
+// The files were just written, so this measures the parser rather than the disk.
+static void MeasureSongs(const std::vector<path>& songFiles, SongBenchmarkResult * result)
+{
+	const double frequency = (double) SDL_GetPerformanceFrequency();
+
+	result->Headers = 0;
+	result->Bytes = 0;
+	Uint64 start = SDL_GetPerformanceCounter();
+
+	for (size_t i = 0; i < songFiles.size(); i++)
+	{
+		Song song;
+		if (song.ReadHeader(songFiles[i]))
+			result->Headers++;
+
+		result->Bytes += song.FileSize;
+	}
+
+	result->HeaderTime = std::max((SDL_GetPerformanceCounter() - start) / frequency, 0.000001);
+
+	result->Songs = 0;
+	result->Notes = 0;
+	start = SDL_GetPerformanceCounter();
+
+	for (size_t i = 0; i < songFiles.size(); i++)
+	{
+		Song song;
+		song.FileName = songFiles[i];
+		if (!song.LoadNotes())
+			continue;
+
+		result->Songs++;
+		for (size_t t = 0; t < song.Tracks.size(); t++)
+		{
+			const std::vector<SongLine>& lines = song.Tracks[t].Lines;
+			for (size_t l = 0; l < lines.size(); l++)
+				result->Notes += (Uint32) lines[l].Notes.size();
+		}
+	}
+
+	result->NoteTime = std::max((SDL_GetPerformanceCounter() - start) / frequency, 0.000001);
+}
+
+static void ReportSongs(const char * format, const SongBenchmarkResult& result)
+{
+	sLog.Status("RunSongBenchmark", "%s headers: %u files in %.3f s, %.0f headers/s",
+		format, result.Headers, result.HeaderTime, result.Headers / result.HeaderTime);
+	sLog.Status("RunSongBenchmark", "%s notes:   %u songs (%u notes, %.1f MB) in %.3f s, %.0f songs/s, %.0f notes/s, %.1f MB/s",
+		format, result.Songs, result.Notes, result.Bytes / (1024.0 * 1024.0), result.NoteTime,
+		result.Songs / result.NoteTime, result.Notes / result.NoteTime, result.Bytes / (1024.0 * 1024.0) / result.NoteTime);
+}
+
+bool RunSongBenchmark(int files)
+{
+	path corpus = temp_directory_path() / unique_path("usdx-songbench-%%%%-%%%%");
+	std::vector<path> songFiles, xmlFiles;
+
+	sLog.Status("RunSongBenchmark", "Generating %d song files of each format in %s", files, corpus.generic_string().c_str());
+
+	try
+	{
+		songFiles.reserve(files);
+		xmlFiles.reserve(files);
+		for (int i = 0; i < files; i++)
+		{
+			path folder = corpus / boost::lexical_cast<std::string>(i / SONG_BENCHMARK_FOLDER_SIZE);
+			if (i % SONG_BENCHMARK_FOLDER_SIZE == 0)
+				create_directories(folder);
+
+			path filename = folder / (boost::lexical_cast<std::string>(i) + ".txt");
+			if (!WriteSong(filename, (Uint32) i))
+			{
+				sLog.Error("RunSongBenchmark", "Failed to write %s", filename.generic_string().c_str());
+				remove_all(corpus);
+				return false;
+			}
+
+			songFiles.push_back(filename);
+
+			path xmlFilename = folder / (boost::lexical_cast<std::string>(i) + ".xml");
+			if (!WriteXMLSong(xmlFilename, (Uint32) i))
+			{
+				sLog.Error("RunSongBenchmark", "Failed to write %s", xmlFilename.generic_string().c_str());
+				remove_all(corpus);
+				return false;
+			}
+
+			xmlFiles.push_back(xmlFilename);
+		}
+	}
+	catch (const filesystem_error& e)
+	{
+		sLog.Error("RunSongBenchmark", "%s", e.what());
+		boost::system::error_code error;
+		remove_all(corpus, error);
+		return false;
+	}
+
+	SongBenchmarkResult text, xml;
+	MeasureSongs(songFiles, &text);
+	MeasureSongs(xmlFiles, &xml);
+
+	ReportSongs("Text", text);
+	ReportSongs("XML", xml);
+	sLog.Status("RunSongBenchmark", "XML takes %.2fx the time of text for headers, %.2fx for notes",
+		xml.HeaderTime / text.HeaderTime, xml.NoteTime / text.NoteTime);
+
+	sLog.BenchmarkResult(1, (Uint64) (text.HeaderTime * 1000000000.0), "Song headers");
+	sLog.BenchmarkResult(1, (Uint64) (text.NoteTime * 1000000000.0), "Song notes");
+	sLog.BenchmarkResult(1, (Uint64) (xml.HeaderTime * 1000000000.0), "XML song headers");
+	sLog.BenchmarkResult(1, (Uint64) (xml.NoteTime * 1000000000.0), "XML song notes");
+
+	boost::system::error_code error;
+	remove_all(corpus, error);
+
+	Uint32 count = (Uint32) songFiles.size();
+	return text.Headers == count && text.Songs == count
+		&& xml.Headers == count && xml.Songs == count;
+}
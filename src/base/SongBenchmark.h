@@ -0,0 +1,33 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _SONGBENCHMARK_H
+#define _SONGBENCHMARK_H
+#pragma once
+
+// Generates the given number of song files in a temporary folder, each both as
+// .txt and as the equivalent SingStar .xml, then parses their headers and notes
+// and reports the throughput of either format. The folder is removed afterwards.
+// Returns false if the files couldn't be generated or didn't parse.
+bool RunSongBenchmark(int files);
+
+#endif
@@ -0,0 +1,184 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "stdafx.h"
+#include "SongCatalog.h"
+#include "SongSearch.h"
+
+// the columns with a sort key; the folder is its own
+static const SongColumn s_keyedColumns[] = { scTitle, scArtist, scGenre, scEdition, scLanguage };
+
+SongCatalog::SongCatalog()
+{
+}
+
+Uint32 SongCatalog::Add(const Song& song)
+{
+	Uint32 index = GetCount();
+
+	_columns[scTitle].push_back(_strings.Intern(song.Title));
+	_columns[scArtist].push_back(_strings.Intern(song.Artist));
+	_columns[scGenre].push_back(_strings.Intern(song.Genre));
+	_columns[scEdition].push_back(_strings.Intern(song.Edition));
+	_columns[scLanguage].push_back(_strings.Intern(song.Language));
+	_columns[scCreator].push_back(_strings.Intern(song.Creator));
+	_columns[scCover].push_back(_strings.Intern(song.Cover));
+	_columns[scFolder].push_back(_strings.Intern(song.Path.generic_string()));
+	_columns[scFileName].push_back(_strings.Intern(song.FileName.filename().generic_string()));
+
+	_year.push_back((Uint16) std::max(0, std::min(song.Year, 0xFFFF)));
+
+	Uint8 flags = 0;
+	if (!song.Video.empty())
+		flags |= sfVideo;
+	if (song.IsDuet())
+		flags |= sfDuet;
+	if (song.HasMedley())
+		flags |= sfMedley;
+
+	_flags.push_back(flags);
+
+	std::string key;
+	for (size_t c = 0; c < SDL_arraysize(s_keyedColumns); c++)
+	{
+		SongColumn column = s_keyedColumns[c];
+
+		key.clear();
+		SongSearch::Fold(_strings.Get(_columns[column][index]), &key);
+		_sortKeys[column].push_back(_strings.Intern(key));
+	}
+
+	_orders.Add(index);
+	return index;
+}
+
+Uint32 SongCatalog::RemoveFolder(const std::string& folder, bool recursive, std::vector<Uint32> * moved)
+{
+	// Folders are interned, so songs directly in it are found by ID.
+	Uint32 folderId = _strings.Find(folder.c_str(), folder.size());
+	std::string prefix = folder + "/";
+
+	const std::vector<Uint32>& folders = _columns[scFolder];
+	Uint32 count = GetCount(), kept = 0;
+
+	// where every song moved, for the orders and the caller
+	std::vector<Uint32> remap;
+	if (_orders.IsBuilt() || moved != NULL)
+		remap.resize(count, SONG_ORDER_REMOVED);
+
+	for (Uint32 i = 0; i < count; i++)
+	{
+		Uint32 id = folders[i];
+		bool removed = (folderId != 0 && id == folderId)
+			|| (recursive && strncmp(_strings.Get(id), prefix.c_str(), prefix.size()) == 0);
+
+		if (removed)
+			continue;
+
+		if (kept != i)
+		{
+			for (int c = 0; c < scCount; c++)
+				_columns[c][kept] = _columns[c][i];
+
+			for (size_t c = 0; c < SDL_arraysize(s_keyedColumns); c++)
+				_sortKeys[s_keyedColumns[c]][kept] = _sortKeys[s_keyedColumns[c]][i];
+
+			_year[kept] = _year[i];
+			_flags[kept] = _flags[i];
+		}
+
+		if (!remap.empty())
+			remap[i] = kept;
+
+		kept++;
+	}
+
+	for (int c = 0; c < scCount; c++)
+		_columns[c].resize(kept);
+
+	for (size_t c = 0; c < SDL_arraysize(s_keyedColumns); c++)
+		_sortKeys[s_keyedColumns[c]].resize(kept);
+
+	_year.resize(kept);
+	_flags.resize(kept);
+
+	if (kept != count)
+		_orders.Remove(*this, remap);
+
+	if (moved != NULL)
+	{
+		moved->clear();
+		if (kept != count)
+			moved->swap(remap);
+	}
+
+	return count - kept;
+}
+
+void SongCatalog::Clear()
+{
+	for (int c = 0; c < scCount; c++)
+	{
+		std::vector<Uint32>().swap(_columns[c]);
+		std::vector<Uint32>().swap(_sortKeys[c]);
+	}
+
+	_orders.Clear();
+
+	std::vector<Uint16>().swap(_year);
+	std::vector<Uint8>().swap(_flags);
+	_strings.Clear();
+}
+
+void SongCatalog::UpdateOrders()
+{
+	if (!_orders.IsBuilt())
+		_orders.Build(*this);
+	else
+		_orders.Update(*this);
+}
+
+Song * SongCatalog::LoadSong(Uint32 index) const
+{
+	path filename = path(GetString(index, scFolder)) / GetString(index, scFileName);
+
+	Song * song = new Song();
+	if (!song->ReadHeader(filename))
+	{
+		delete song;
+		return NULL;
+	}
+
+	return song;
+}
+
+size_t SongCatalog::GetMemoryUsage() const
+{
+	size_t size = _strings.GetMemoryUsage()
+		+ _year.capacity() * sizeof(Uint16)
+		+ _flags.capacity() * sizeof(Uint8);
+
+	for (int c = 0; c < scCount; c++)
+		size += (_columns[c].capacity() + _sortKeys[c].capacity()) * sizeof(Uint32);
+
+	return size + _orders.GetMemoryUsage();
+}
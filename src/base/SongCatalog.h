@@ -0,0 +1,128 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _SONGCATALOG_H
+#define _SONGCATALOG_H
+#pragma once
+
+#include "Song.h"
+#include "SongOrder.h"
+#include "../shared/StringPool.h"
+
+enum SongColumn
+{
+	scTitle,
+	scArtist,
+	scGenre,
+	scEdition,
+	scLanguage,
+	scCreator,
+	scCover,
+	scFolder,
+	scFileName,
+	scCount
+};
+
+enum SongFlags
+{
+	sfVideo		= 0x01,
+	sfDuet		= 0x02,
+	sfMedley	= 0x04
+};
+
+/**
+ * What the song screen needs to list, filter and sort the library, stored
+ * column by column: interned string IDs, the year and packed flags.
+ * A filter or sort then only walks the columns it looks at, and 100k songs
+ * take a few MB rather than a few hundred bytes and a dozen allocations each.
+ *
+ * Everything else (audio, gap, BPM, ...) is only needed once a song is
+ * chosen, so LoadSong() reads it from the song file again.
+ *
+ * The columns the song screen sorts by also have a sort key each: the folded
+ * string (see SongSearch::Fold()), interned as well. The orders built from
+ * them follow the catalog as songs are added and removed (see SongOrders).
+ */
+class SongCatalog
+{
+public:
+	SongCatalog();
+
+	// Returns the index of the new entry.
+	Uint32 Add(const Song& song);
+
+	// Removes the songs of the folder (and its subfolders, if recursive).
+	// The entries after them move up. Returns how many were removed.
+	// If moved is given, it gets where every entry went (SONG_ORDER_REMOVED
+	// for the removed ones), or is left empty if there were none.
+	Uint32 RemoveFolder(const std::string& folder, bool recursive, std::vector<Uint32> * moved = NULL);
+
+	void Clear();
+
+	INLINE Uint32 GetCount() const { return (Uint32) _year.size(); }
+
+	INLINE Uint32 GetStringId(Uint32 index, SongColumn column) const { return _columns[column][index]; }
+	INLINE const char * GetString(Uint32 index, SongColumn column) const { return _strings.Get(_columns[column][index]); }
+	INLINE const char * GetTitle(Uint32 index) const { return GetString(index, scTitle); }
+	INLINE const char * GetArtist(Uint32 index) const { return GetString(index, scArtist); }
+	INLINE Uint16 GetYear(Uint32 index) const { return _year[index]; }
+	INLINE Uint8 GetFlags(Uint32 index) const { return _flags[index]; }
+	INLINE bool HasFlag(Uint32 index, SongFlags flag) const { return (_flags[index] & flag) != 0; }
+
+	// whole columns, for filtering and sorting
+	INLINE const std::vector<Uint32>& GetColumn(SongColumn column) const { return _columns[column]; }
+	INLINE const std::vector<Uint16>& GetYearColumn() const { return _year; }
+	INLINE const std::vector<Uint8>& GetFlagsColumn() const { return _flags; }
+	INLINE const StringPool& GetStrings() const { return _strings; }
+	INLINE Uint32 InternString(const char * str, size_t length) { return _strings.Intern(str, length); }
+
+	// Folders sort as they are, everything else by the folded string.
+	INLINE Uint32 GetSortKey(Uint32 index, SongColumn column) const
+	{
+		return (column == scFolder ? _columns[scFolder][index] : _sortKeys[column][index]);
+	}
+
+	// Sorts the songs added since the last call into the orders,
+	// or sorts everything if that hasn't been done yet.
+	void UpdateOrders();
+
+	// As of the last UpdateOrders().
+	INLINE const SongOrder& GetOrder(eSortingType sorting) const { return _orders.Get(sorting); }
+	INLINE const SongOrders& GetOrders() const { return _orders; }
+
+	// Reads the whole song header from its file, for the song which was chosen.
+	// Returns NULL if the file can't be read anymore.
+	Song * LoadSong(Uint32 index) const;
+
+	size_t GetMemoryUsage() const;
+
+protected:
+	StringPool				_strings;
+	std::vector<Uint32>		_columns[scCount];
+	std::vector<Uint32>		_sortKeys[scCount];	// only for the sorted columns
+	std::vector<Uint16>		_year;
+	std::vector<Uint8>		_flags;
+
+	SongOrders				_orders;
+};
+
+#endif
@@ -0,0 +1,141 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "stdafx.h"
+#include "SongIndex.h"
+#include "Database.h"
+#include "Log.h"
+
+SongIndexUpdate::~SongIndexUpdate()
+{
+	for (SongIndexFileMap::iterator itr = Files.begin(); itr != Files.end(); ++itr)
+		delete itr->second.Header;
+}
+
+SongIndex::SongIndex()
+	: _fileCount(0)
+{
+}
+
+bool SongIndex::Load()
+{
+	Clear();
+
+	if (Database::getSingletonPtr() == NULL)
+		return false;
+
+	try
+	{
+		sDatabase.LoadSongIndex(this);
+	}
+	catch (const Sqlite3Exception& e)
+	{
+		sLog.Error("SongIndex::Load", "%s", e.what());
+		Clear();
+		return false;
+	}
+
+	// Parents are only known once all folders are. A root's parent isn't
+	// in the index, and neither is any folder which was removed since.
+	for (FolderMap::iterator itr = _folders.begin(); itr != _folders.end(); ++itr)
+	{
+		FolderMap::iterator parent = _folders.find(itr->second.Parent);
+		if (parent != _folders.end() && parent != itr)
+			parent->second.Subfolders.push_back(itr->first);
+	}
+
+	return true;
+}
+
+void SongIndex::Clear()
+{
+	for (FolderMap::iterator itr = _folders.begin(); itr != _folders.end(); ++itr)
+	{
+		SongIndexFileMap& files = itr->second.Files;
+		for (SongIndexFileMap::iterator file = files.begin(); file != files.end(); ++file)
+			delete file->second.Header;
+	}
+
+	_folders.clear();
+	_fileCount = 0;
+}
+
+void SongIndex::AddFolder(const std::string& folder, const std::string& parent, time_t mtime)
+{
+	SongIndexFolder& entry = _folders[folder];
+	entry.Parent = parent;
+	entry.MTime = mtime;
+	entry.Visited = false;
+}
+
+void SongIndex::AddFile(const std::string& folder, const std::string& name, Uint64 size, time_t mtime, Song * header)
+{
+	FolderMap::iterator itr = _folders.find(folder);
+	if (itr == _folders.end())
+	{
+		delete header;
+		return;
+	}
+
+	SongIndexFile& file = itr->second.Files[name];
+	delete file.Header;
+
+	file.Size = size;
+	file.MTime = mtime;
+	file.Header = header;
+	_fileCount++;
+}
+
+SongIndexFolder * SongIndex::FindFolder(const std::string& folder)
+{
+	FolderMap::iterator itr = _folders.find(folder);
+	return (itr != _folders.end() ? &itr->second : NULL);
+}
+
+void SongIndex::GetUnvisitedFolders(std::vector<std::string> * folders) const
+{
+	for (FolderMap::const_iterator itr = _folders.begin(); itr != _folders.end(); ++itr)
+	{
+		if (!itr->second.Visited)
+			folders->push_back(itr->first);
+	}
+}
+
+void SongIndex::Write(const SongIndexUpdateList& updates, const std::vector<std::string>& removedFolders)
+{
+	if (Database::getSingletonPtr() == NULL)
+		return;
+
+	try
+	{
+		sDatabase.WriteSongIndex(updates, removedFolders);
+	}
+	catch (const Sqlite3Exception& e)
+	{
+		sLog.Error("SongIndex::Write", "%s", e.what());
+	}
+}
+
+SongIndex::~SongIndex()
+{
+	Clear();
+}
@@ -0,0 +1,108 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _SONGINDEX_H
+#define _SONGINDEX_H
+#pragma once
+
+#include <unordered_map>
+#include "Song.h"
+
+// bump whenever Song gains header fields or reads them differently, old indexes are then rebuilt
+#define SONG_INDEX_VERSION	3
+
+// what the index knows about a song file
+struct SongIndexFile
+{
+	Uint64	Size;
+	time_t	MTime;
+	Song *	Header;		// NULL if the file has no usable header
+};
+
+// by file name
+typedef std::map<std::string, SongIndexFile> SongIndexFileMap;
+
+struct SongIndexFolder
+{
+	std::string					Parent;
+	time_t						MTime;
+	std::vector<std::string>	Subfolders;
+	SongIndexFileMap			Files;
+	bool						Visited;
+};
+
+// A folder as found by a scan, to be (re)written to the index.
+struct SongIndexUpdate
+{
+	std::string			Folder;
+	std::string			Parent;
+	time_t				MTime;
+	SongIndexFileMap	Files;		// owns the headers
+
+	~SongIndexUpdate();
+};
+
+typedef std::vector<SongIndexUpdate *> SongIndexUpdateList;
+
+/**
+ * The song headers of the last scan, stored in the database, so a scan only
+ * has to read the song files which changed since.
+ *
+ * A folder whose modification time is unchanged still has the same files and
+ * subfolders, so those are taken from the index without listing the folder;
+ * each file is then validated by its own size and modification time.
+ */
+class SongIndex
+{
+public:
+	SongIndex();
+
+	// Loads the whole index from the database, replacing anything loaded before.
+	bool Load();
+	void Clear();
+
+	// Used by the database while loading.
+	void AddFolder(const std::string& folder, const std::string& parent, time_t mtime);
+	void AddFile(const std::string& folder, const std::string& name, Uint64 size, time_t mtime, Song * header);
+
+	// Each folder may only be looked up by the one job scanning it.
+	SongIndexFolder * FindFolder(const std::string& folder);
+
+	// Folders which no scan looked up since Load(), i.e. which are gone.
+	void GetUnvisitedFolders(std::vector<std::string> * folders) const;
+
+	INLINE Uint32 GetFolderCount() const { return (Uint32) _folders.size(); }
+	INLINE Uint32 GetFileCount() const { return _fileCount; }
+
+	// Writes the changes of a scan and deletes the removed folders.
+	static void Write(const SongIndexUpdateList& updates, const std::vector<std::string>& removedFolders);
+
+	~SongIndex();
+
+protected:
+	typedef std::unordered_map<std::string, SongIndexFolder> FolderMap;
+
+	FolderMap	_folders;
+	Uint32		_fileCount;
+};
+
+#endif
@@ -0,0 +1,362 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "stdafx.h"
+#include "SongOrder.h"
+#include "SongCatalog.h"
+#include "../shared/JobSystem.h"
+
+struct SortSpec
+{
+	SongColumn	Keys[3];	// compared in turn, scCount ends them early
+	SongColumn	Category;
+	bool		ByLetter;	// categories by the first letter rather than the whole key
+};
+
+// indexed by SortingType, and sorted like the original game does
+static const SortSpec s_sortSpecs[SortingType::Total] =
+{
+	{ { scEdition,	scArtist,	scTitle },	scEdition,	false },	// Edition
+	{ { scGenre,	scArtist,	scTitle },	scGenre,	false },	// Genre
+	{ { scLanguage,	scArtist,	scTitle },	scLanguage,	false },	// Language
+	{ { scFolder,	scArtist,	scTitle },	scFolder,	false },	// Folder
+	{ { scTitle,	scArtist,	scCount },	scTitle,	true },		// Title
+	{ { scArtist,	scTitle,	scCount },	scArtist,	true },		// Artist
+	{ { scArtist,	scTitle,	scCount },	scArtist,	false }		// Artist2
+};
+
+// every column a sorting compares
+static const SongColumn s_sortColumns[] = { scEdition, scGenre, scLanguage, scFolder, scTitle, scArtist };
+
+// Keys which don't start with a letter sort before all that do, so what's
+// listed under "#" stays together: digits, punctuation and other scripts.
+static INLINE int CompareSortKeys(const char * a, const char * b)
+{
+	bool letterA = (*a >= 'a' && *a <= 'z');
+	bool letterB = (*b >= 'a' && *b <= 'z');
+
+	if (letterA != letterB)
+		return letterA ? 1 : -1;
+
+	return strcmp(a, b);
+}
+
+// Orders songs by the strings of their sort keys, ties by their index.
+class SongKeyLess
+{
+public:
+	SongKeyLess(const SongCatalog& catalog, const SortSpec& spec)
+		: _catalog(catalog), _spec(spec) {}
+
+	bool operator()(Uint32 a, Uint32 b) const
+	{
+		for (int k = 0; k < 3 && _spec.Keys[k] != scCount; k++)
+		{
+			Uint32 keyA = _catalog.GetSortKey(a, _spec.Keys[k]);
+			Uint32 keyB = _catalog.GetSortKey(b, _spec.Keys[k]);
+
+			// keys are interned, so different IDs are different strings
+			if (keyA != keyB)
+				return CompareSortKeys(_catalog.GetStrings().Get(keyA), _catalog.GetStrings().Get(keyB)) < 0;
+		}
+
+		return a < b;
+	}
+
+private:
+	const SongCatalog&	_catalog;
+	const SortSpec&		_spec;
+};
+
+// The same by the ranks of their sort keys, which order like the strings do.
+class SongRankLess
+{
+public:
+	SongRankLess(const std::vector<Uint32> * ranks, const SortSpec& spec)
+		: _ranks(ranks), _spec(spec) {}
+
+	bool operator()(Uint32 a, Uint32 b) const
+	{
+		for (int k = 0; k < 3 && _spec.Keys[k] != scCount; k++)
+		{
+			const std::vector<Uint32>& ranks = _ranks[_spec.Keys[k]];
+			if (ranks[a] != ranks[b])
+				return ranks[a] < ranks[b];
+		}
+
+		return a < b;
+	}
+
+private:
+	const std::vector<Uint32> *	_ranks;
+	const SortSpec&				_spec;
+};
+
+class SortKeyLess
+{
+public:
+	SortKeyLess(const StringPool& strings) : _strings(strings) {}
+
+	bool operator()(Uint32 a, Uint32 b) const
+	{
+		return CompareSortKeys(_strings.Get(a), _strings.Get(b)) < 0;
+	}
+
+private:
+	const StringPool&	_strings;
+};
+
+SongOrders::SongOrders() : _built(false), _updateTime(0.0f)
+{
+	memset(_letterIds, 0, sizeof(_letterIds));
+}
+
+void SongOrders::Build(SongCatalog& catalog)
+{
+	Uint64 start = SDL_GetPerformanceCounter();
+	Uint32 count = catalog.GetCount();
+
+	Clear();
+
+	char letter[2] = { 'A', '\0' };
+	for (int i = 0; i < 26; i++, letter[0]++)
+		_letterIds[i] = catalog.InternString(letter, 1);
+	_letterIds[26] = catalog.InternString("#", 1);
+
+	// Rank every distinct key by its string once. Sorting then only compares
+	// integers, and does so in parallel as nothing is interned meanwhile.
+	std::vector<Uint32> keys;
+	keys.reserve(count * SDL_arraysize(s_sortColumns));
+
+	for (size_t c = 0; c < SDL_arraysize(s_sortColumns); c++)
+	{
+		for (Uint32 i = 0; i < count; i++)
+			keys.push_back(catalog.GetSortKey(i, s_sortColumns[c]));
+	}
+
+	std::sort(keys.begin(), keys.end());
+	keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+	std::vector<Uint32> byString(keys);
+	std::sort(byString.begin(), byString.end(), SortKeyLess(catalog.GetStrings()));
+
+	// by the key's position in keys
+	std::vector<Uint32> keyRanks(keys.size());
+	for (Uint32 r = 0; r < (Uint32) byString.size(); r++)
+		keyRanks[std::lower_bound(keys.begin(), keys.end(), byString[r]) - keys.begin()] = r;
+
+	std::vector<Uint32> ranks[scCount];
+	std::vector<JobHandle> rankJobs;
+
+	for (size_t c = 0; c < SDL_arraysize(s_sortColumns); c++)
+	{
+		SongColumn column = s_sortColumns[c];
+		std::vector<Uint32> * columnRanks = &ranks[column];
+
+		rankJobs.push_back(sJobs.Create([&catalog, &keys, &keyRanks, column, columnRanks, count]()
+		{
+			columnRanks->resize(count);
+			for (Uint32 i = 0; i < count; i++)
+			{
+				Uint32 key = catalog.GetSortKey(i, column);
+				(*columnRanks)[i] = keyRanks[std::lower_bound(keys.begin(), keys.end(), key) - keys.begin()];
+			}
+		}, jpInteractive));
+	}
+
+	std::vector<JobHandle> sortJobs;
+	for (int s = 0; s < SortingType::Total; s++)
+	{
+		eSortingType sorting = (eSortingType) s;
+
+		JobHandle job = sJobs.Create([this, &catalog, &ranks, sorting, count]()
+		{
+			std::vector<Uint32>& songs = _orders[sorting].Songs;
+
+			songs.resize(count);
+			for (Uint32 i = 0; i < count; i++)
+				songs[i] = i;
+
+			std::sort(songs.begin(), songs.end(), SongRankLess(ranks, s_sortSpecs[sorting]));
+			BuildCategories(catalog, sorting);
+		}, jpInteractive);
+
+		for (size_t i = 0; i < rankJobs.size(); i++)
+			sJobs.AddDependency(job, rankJobs[i]);
+
+		sortJobs.push_back(job);
+	}
+
+	for (size_t i = 0; i < rankJobs.size(); i++)
+		sJobs.Submit(rankJobs[i]);
+
+	for (size_t i = 0; i < sortJobs.size(); i++)
+		sJobs.Submit(sortJobs[i]);
+
+	// The main thread helps out meanwhile, but mustn't merge in more songs.
+	for (size_t i = 0; i < sortJobs.size(); i++)
+		sJobs.Wait(sortJobs[i], false);
+
+	_built = true;
+	_updateTime = (float) ((SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency());
+}
+
+void SongOrders::Update(const SongCatalog& catalog)
+{
+	if (_added.empty())
+		return;
+
+	Uint64 start = SDL_GetPerformanceCounter();
+
+	// the jobs' own copy, whatever is added meanwhile waits for the next update
+	std::vector<Uint32> added(_added);
+
+	std::vector<JobHandle> jobs;
+	for (int s = 0; s < SortingType::Total; s++)
+	{
+		eSortingType sorting = (eSortingType) s;
+
+		jobs.push_back(sJobs.Run([this, &catalog, &added, sorting]()
+		{
+			SongKeyLess less(catalog, s_sortSpecs[sorting]);
+			std::vector<Uint32>& songs = _orders[sorting].Songs;
+
+			std::vector<Uint32> sorted(added);
+			std::sort(sorted.begin(), sorted.end(), less);
+
+			std::vector<Uint32> merged;
+			merged.reserve(songs.size() + sorted.size());
+			std::merge(songs.begin(), songs.end(), sorted.begin(), sorted.end(), std::back_inserter(merged), less);
+
+			songs.swap(merged);
+			BuildCategories(catalog, sorting);
+		}, jpInteractive));
+	}
+
+	// Merging songs into the catalog meanwhile would move its columns and
+	// strings away from under the jobs, so main-thread jobs have to wait.
+	for (size_t i = 0; i < jobs.size(); i++)
+		sJobs.Wait(jobs[i], false);
+
+	_added.erase(_added.begin(), _added.begin() + added.size());
+	_updateTime = (float) ((SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency());
+}
+
+void SongOrders::Add(Uint32 index)
+{
+	// sorted in with everything else when building
+	if (_built)
+		_added.push_back(index);
+}
+
+void SongOrders::Remove(const SongCatalog& catalog, const std::vector<Uint32>& remap)
+{
+	if (!_built)
+		return;
+
+	for (int s = 0; s < SortingType::Total; s++)
+	{
+		std::vector<Uint32>& songs = _orders[s].Songs;
+		size_t kept = 0;
+
+		// moving them up keeps their order
+		for (size_t i = 0; i < songs.size(); i++)
+		{
+			if (remap[songs[i]] != SONG_ORDER_REMOVED)
+				songs[kept++] = remap[songs[i]];
+		}
+
+		songs.resize(kept);
+		BuildCategories(catalog, (eSortingType) s);
+	}
+
+	size_t kept = 0;
+	for (size_t i = 0; i < _added.size(); i++)
+	{
+		if (remap[_added[i]] != SONG_ORDER_REMOVED)
+			_added[kept++] = remap[_added[i]];
+	}
+
+	_added.resize(kept);
+}
+
+void SongOrders::Clear()
+{
+	for (int s = 0; s < SortingType::Total; s++)
+	{
+		std::vector<Uint32>().swap(_orders[s].Songs);
+		std::vector<SongCategory>().swap(_orders[s].Categories);
+	}
+
+	_added.clear();
+	_built = false;
+}
+
+void SongOrders::BuildCategories(const SongCatalog& catalog, eSortingType sorting)
+{
+	const SortSpec& spec = s_sortSpecs[sorting];
+	SongOrder& order = _orders[sorting];
+	Uint32 category = 0;
+
+	order.Categories.clear();
+	for (Uint32 i = 0; i < (Uint32) order.Songs.size(); i++)
+	{
+		Uint32 song = order.Songs[i];
+		Uint32 key = catalog.GetSortKey(song, spec.Category);
+		Uint32 nameId;
+
+		// Anything not starting with a letter is sorted in front of "A"
+		// (see CompareSortKeys()), so it's all one "#" category.
+		if (spec.ByLetter)
+		{
+			char first = catalog.GetStrings().Get(key)[0];
+			key = (first >= 'a' && first <= 'z' ? first - 'a' : 26);
+			nameId = _letterIds[key];
+		}
+		else
+		{
+			nameId = catalog.GetStringId(song, spec.Category);
+		}
+
+		if (order.Categories.empty() || key != category)
+		{
+			SongCategory next = { i, 0, nameId };
+			order.Categories.push_back(next);
+			category = key;
+		}
+
+		order.Categories.back().Count++;
+	}
+}
+
+size_t SongOrders::GetMemoryUsage() const
+{
+	size_t size = _added.capacity() * sizeof(Uint32);
+
+	for (int s = 0; s < SortingType::Total; s++)
+	{
+		size += _orders[s].Songs.capacity() * sizeof(Uint32)
+			+ _orders[s].Categories.capacity() * sizeof(SongCategory);
+	}
+
+	return size;
+}
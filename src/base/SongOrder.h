@@ -0,0 +1,93 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _SONGORDER_H
+#define _SONGORDER_H
+#pragma once
+
+class SongCatalog;
+
+// A run of songs in an order which share their category (edition, first letter, ...).
+struct SongCategory
+{
+	Uint32	Start;		// position in the order
+	Uint32	Count;
+	Uint32	NameId;		// catalog string
+};
+
+struct SongOrder
+{
+	std::vector<Uint32>			Songs;		// catalog indexes
+	std::vector<SongCategory>	Categories;
+};
+
+/**
+ * The catalog sorted and grouped for every SortingType, so that switching
+ * the sorting or the tabs only means picking another SongOrder.
+ *
+ * A full build ranks all distinct sort keys once, so the songs can be sorted
+ * by integers, and sorts the orders in parallel on the job system. After
+ * that, songs added are sorted on their own and merged into the orders, and
+ * removed songs are filtered out of them, both without sorting everything again.
+ */
+class SongOrders
+{
+public:
+	SongOrders();
+
+	// Sorts the whole catalog again.
+	void Build(SongCatalog& catalog);
+
+	// Merges the songs added since into the orders.
+	void Update(const SongCatalog& catalog);
+
+	// Notes a song added to the catalog, for the next Update().
+	void Add(Uint32 index);
+
+	// Drops removed songs from the orders, after the catalog moved the rest
+	// up: remap holds the new index of every old one, or SONG_ORDER_REMOVED.
+	void Remove(const SongCatalog& catalog, const std::vector<Uint32>& remap);
+
+	void Clear();
+
+	INLINE bool IsBuilt() const { return _built; }
+	INLINE bool IsUpToDate() const { return _built && _added.empty(); }
+	INLINE const SongOrder& Get(eSortingType sorting) const { return _orders[sorting]; }
+
+	// how long the last Build() or Update() took, in milliseconds
+	INLINE float GetUpdateTime() const { return _updateTime; }
+
+	size_t GetMemoryUsage() const;
+
+protected:
+	void BuildCategories(const SongCatalog& catalog, eSortingType sorting);
+
+	SongOrder				_orders[SortingType::Total];
+	std::vector<Uint32>		_added;		// catalog indexes, not sorted in yet
+	Uint32					_letterIds[27];	// category names for the letters, and "#"
+	bool					_built;
+	float					_updateTime;
+};
+
+#define SONG_ORDER_REMOVED	0xFFFFFFFF
+
+#endif
@@ -0,0 +1,232 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "stdafx.h"
+#include "SongParser.h"
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define SONG_PARSER_SSE2
+#	include <emmintrin.h>
+#	if defined(_MSC_VER)
+#		include <intrin.h>
+#	endif
+#endif
+
+SongParser::SongParser(const char * data, size_t size)
+	: _pos(data), _end(data + size), _lineNumber(0), _hasBOM(false)
+{
+	if (size >= 3
+		&& (Uint8) data[0] == 0xEF && (Uint8) data[1] == 0xBB && (Uint8) data[2] == 0xBF)
+	{
+		_hasBOM = true;
+		_pos += 3;
+	}
+}
+
+#if defined(SONG_PARSER_SSE2)
+static INLINE int FirstSetBit(int mask)
+{
+#	if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, (unsigned long) mask);
+	return (int) index;
+#	else
+	return __builtin_ctz((unsigned int) mask);
+#	endif
+}
+#endif
+
+const char * SongParser::FindLineEnd(const char * start, const char * end)
+{
+	const char * p = start;
+
+#if defined(SONG_PARSER_SSE2)
+	// 16 bytes at a time; only whole blocks, so we never read past the end of the mapping
+	const __m128i cr = _mm_set1_epi8('\r');
+	const __m128i lf = _mm_set1_epi8('\n');
+
+	while (end - p >= 16)
+	{
+		__m128i block = _mm_loadu_si128((const __m128i *) p);
+		int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, cr), _mm_cmpeq_epi8(block, lf)));
+		if (mask != 0)
+			return p + FirstSetBit(mask);
+
+		p += 16;
+	}
+#endif
+
+	while (p < end && *p != '\r' && *p != '\n')
+		p++;
+
+	return p;
+}
+
+bool SongParser::NextLine(StringRef * line)
+{
+	if (_pos >= _end)
+		return false;
+
+	const char * lineEnd = FindLineEnd(_pos, _end);
+	*line = StringRef(_pos, lineEnd - _pos);
+	_lineNumber++;
+
+	// "\r\n", "\n" or a lone "\r" (old Mac editors)
+	_pos = lineEnd;
+	if (_pos < _end && *_pos == '\r')
+		_pos++;
+	if (_pos < _end && *_pos == '\n')
+		_pos++;
+
+	return true;
+}
+
+bool SongParser::NextTag(StringRef * tag, StringRef * value)
+{
+	StringRef line;
+
+	for (;;)
+	{
+		const char * lineStart = _pos;
+		Uint32 lineNumber = _lineNumber;
+
+		if (!NextLine(&line))
+			return false;
+
+		line.Trim();
+		if (line.Empty())
+			continue;
+
+		// the first line that isn't a tag starts the notes, leave it for NextNoteLine()
+		if (line.Data[0] != '#')
+		{
+			_pos = lineStart;
+			_lineNumber = lineNumber;
+			return false;
+		}
+
+		const char * separator = (const char *) memchr(line.Data, ':', line.Length);
+		if (separator == NULL)
+			continue;
+
+		*tag = StringRef(line.Data + 1, separator - line.Data - 1);
+		*value = StringRef(separator + 1, line.Data + line.Length - separator - 1);
+		tag->Trim();
+		value->Trim();
+		return true;
+	}
+}
+
+static const char * ParseInt(const char * p, const char * end, int * result)
+{
+	while (p < end && (*p == ' ' || *p == '\t'))
+		p++;
+
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = (*p == '-');
+		p++;
+	}
+
+	if (p >= end || *p < '0' || *p > '9')
+		return NULL;
+
+	int value = 0;
+	while (p < end && *p >= '0' && *p <= '9')
+		value = value * 10 + (*p++ - '0');
+
+	*result = (negative ? -value : value);
+	return p;
+}
+
+bool SongParser::NextNoteLine(SongNoteLine * line)
+{
+	StringRef lineData;
+
+	for (;;)
+	{
+		if (!NextLine(&lineData))
+			return false;
+
+		// leading whitespace only; trailing spaces may be part of the note text
+		while (lineData.Length > 0 && (lineData.Data[0] == ' ' || lineData.Data[0] == '\t'))
+		{
+			lineData.Data++;
+			lineData.Length--;
+		}
+
+		// blank lines and whatever is left of the header
+		if (!lineData.Empty() && lineData.Data[0] != '#')
+			break;
+	}
+
+	const char * p = lineData.Data + 1;
+	const char * end = lineData.Data + lineData.Length;
+
+	line->Type = lineData.Data[0];
+	line->ParamCount = 0;
+	line->Text = StringRef();
+
+	int maxParams;
+	switch (line->Type)
+	{
+	case ':':
+	case '*':
+	case 'F':
+	case 'R':
+	case 'G':
+		maxParams = 3;
+		break;
+
+	case '-':
+		maxParams = 2;
+		break;
+
+	case 'P':
+		maxParams = 1;
+		break;
+
+	case 'E':
+		_pos = _end;
+		return true;
+
+	default:
+		return true;
+	}
+
+	while (line->ParamCount < maxParams)
+	{
+		const char * next = ParseInt(p, end, &line->Params[line->ParamCount]);
+		if (next == NULL)
+			break;
+
+		line->ParamCount++;
+		p = next;
+	}
+
+	// exactly one separator, the rest is the syllable
+	if (maxParams == 3 && line->ParamCount == 3 && p < end)
+		line->Text = StringRef(p + 1, end - p - 1);
+
+	return true;
+}
@@ -0,0 +1,71 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _SONGPARSER_H
+#define _SONGPARSER_H
+#pragma once
+
+// a line of the note section, e.g. ": 12 4 7 Hel" or "- 20"
+struct SongNoteLine
+{
+	char		Type;		// ':', '*', 'F', 'R', 'G', '-', 'P' or 'E'
+	int			Params[3];
+	int			ParamCount;
+	StringRef	Text;		// of notes, including its leading space (a word boundary)
+};
+
+/**
+ * Splits UltraStar .txt data (usually a MappedFile) into header tags and
+ * note lines without copying anything, so the results point into the data
+ * and are only valid as long as it is.
+ *
+ * Reading the header only touches the first few lines, so browsing stays
+ * cheap; the note section is only read when the song is about to be sung.
+ */
+class SongParser
+{
+public:
+	SongParser(const char * data, size_t size);
+
+	INLINE bool HasUTF8BOM() const { return _hasBOM; }
+	INLINE Uint32 GetLineNumber() const { return _lineNumber; }
+
+	// Reads the next #TAG:value line, returns false once the header is over.
+	bool NextTag(StringRef * tag, StringRef * value);
+
+	// Reads the next line of the note section (skipping the rest of the header),
+	// returns false at the end of the data. Nothing is read after an 'E' line.
+	bool NextNoteLine(SongNoteLine * line);
+
+	// Returns the first '\r' or '\n' in [start, end), or end.
+	static const char * FindLineEnd(const char * start, const char * end);
+
+protected:
+	bool NextLine(StringRef * line);
+
+	const char *	_pos;
+	const char *	_end;
+	Uint32			_lineNumber;
+	bool			_hasBOM;
+};
+
+#endif
@@ -0,0 +1,632 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "stdafx.h"
+#include "SongSearch.h"
+#include "SongCatalog.h"
+
+// Trigrams are hashed into this many posting lists. Songs which only share
+// a hash with the trigram looked for are weeded out with the rest.
+#define SONG_SEARCH_TRIGRAM_BITS	18
+#define SONG_SEARCH_TRIGRAM_LISTS	(1 << SONG_SEARCH_TRIGRAM_BITS)
+
+// Pairs have a list each.
+#define SONG_SEARCH_PAIR_LISTS		(1 << 16)
+
+// separates the artist from the title in the folded text
+#define SONG_SEARCH_SEPARATOR		'\n'
+
+// U+00C0 - U+00FF; empty for the two signs which aren't letters
+static const char * s_latin1Folded[64] =
+{
+	"a", "a", "a", "a", "a", "a", "ae", "c", "e", "e", "e", "e", "i", "i", "i", "i",
+	"d", "n", "o", "o", "o", "o", "o", "", "o", "u", "u", "u", "u", "y", "th", "ss",
+	"a", "a", "a", "a", "a", "a", "ae", "c", "e", "e", "e", "e", "i", "i", "i", "i",
+	"d", "n", "o", "o", "o", "o", "o", "", "o", "u", "u", "u", "u", "y", "th", "y"
+};
+
+// U+0100 - U+017F, except for the ligatures (see FoldCodepoint())
+static const char s_latinExtAFolded[] =
+	"aaaaaacccccccc" "dddd" "eeeeeeeeee" "gggggggg" "hhhh" "iiiiiiiiii" "ii" "jj" "kkk"
+	"llllllllll" "nnnnnnnnn" "oooooo" "oo" "rrrrrr" "ssssssss" "tttttt" "uuuuuuuuuuuu"
+	"ww" "yyy" "zzzzzz" "s";
+
+static INLINE Uint32 PairList(const char * text)
+{
+	return ((Uint8) text[0] << 8) | (Uint8) text[1];
+}
+
+static INLINE Uint32 TrigramList(const char * text)
+{
+	Uint32 key = ((Uint8) text[0] << 16) | ((Uint8) text[1] << 8) | (Uint8) text[2];
+	return (key * 2654435761u) >> (32 - SONG_SEARCH_TRIGRAM_BITS);
+}
+
+static INLINE Uint32 GramList(const char * text, size_t length)
+{
+	return (length == 2 ? PairList(text) : TrigramList(text));
+}
+
+// exact for letters and digits, which is all a folded single character can be
+static INLINE Uint64 CharBit(char c)
+{
+	Uint8 b = (Uint8) c;
+	if (b >= 'a' && b <= 'z')
+		return 1ULL << (b - 'a');
+
+	if (b >= '0' && b <= '9')
+		return 1ULL << (26 + b - '0');
+
+	if (b == ' ')
+		return 1ULL << 36;
+
+	// the bytes of everything else share the rest
+	return 1ULL << (37 + b % 27);
+}
+
+static INLINE Uint64 PairBit(char c1, char c2)
+{
+	return 1ULL << (((Uint8) c1 * 37 + (Uint8) c2) & 63);
+}
+
+// Reads one code point. Bytes which aren't valid UTF-8 are taken as Latin-1,
+// for the song files whose encoding wasn't recognised.
+static Uint32 DecodeCodepoint(const Uint8 *& p)
+{
+	Uint32 c = *p++;
+	if (c < 0x80)
+		return c;
+
+	int length = (c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : c >= 0xC0 ? 1 : 0);
+	if (length == 0)
+		return c;
+
+	Uint32 codepoint = c & (0x3F >> length);
+	for (int i = 0; i < length; i++)
+	{
+		if ((p[i] & 0xC0) != 0x80)
+			return c;
+
+		codepoint = (codepoint << 6) | (p[i] & 0x3F);
+	}
+
+	p += length;
+	return codepoint;
+}
+
+// Writes the code point as UTF-8 and terminates it.
+static void EncodeCodepoint(Uint32 c, char * buffer)
+{
+	if (c < 0x800)
+	{
+		*buffer++ = (char) (0xC0 | (c >> 6));
+	}
+	else
+	{
+		if (c < 0x10000)
+		{
+			*buffer++ = (char) (0xE0 | (c >> 12));
+		}
+		else
+		{
+			*buffer++ = (char) (0xF0 | (c >> 18));
+			*buffer++ = (char) (0x80 | ((c >> 12) & 0x3F));
+		}
+
+		*buffer++ = (char) (0x80 | ((c >> 6) & 0x3F));
+	}
+
+	*buffer++ = (char) (0x80 | (c & 0x3F));
+	*buffer = '\0';
+}
+
+// Returns what to append for the code point: its folded letters,
+// "" to drop it, or NULL if it separates words.
+static const char * FoldCodepoint(Uint32 c, char * buffer)
+{
+	if (c < 0x80)
+	{
+		if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9'))
+		{
+			buffer[0] = (char) c;
+			buffer[1] = '\0';
+			return buffer;
+		}
+
+		if (c >= 'A' && c <= 'Z')
+		{
+			buffer[0] = (char) (c + 'a' - 'A');
+			buffer[1] = '\0';
+			return buffer;
+		}
+
+		// "Don't", "T.A.T.U."
+		if (c == '\'' || c == '`' || c == '.')
+			return "";
+
+		return NULL;
+	}
+
+	if (c < 0xC0)
+		return (c == 0xB4 ? "" : NULL);
+
+	if (c < 0x100)
+		return (*s_latin1Folded[c - 0xC0] != '\0' ? s_latin1Folded[c - 0xC0] : NULL);
+
+	if (c < 0x180)
+	{
+		if (c == 0x132 || c == 0x133)
+			return "ij";
+
+		if (c == 0x152 || c == 0x153)
+			return "oe";
+
+		buffer[0] = s_latinExtAFolded[c - 0x100];
+		buffer[1] = '\0';
+		return buffer;
+	}
+
+	// typographic quotes and the rest of the general punctuation
+	if (c == 0x2018 || c == 0x2019)
+		return "";
+
+	if (c >= 0x2000 && c <= 0x206F)
+		return NULL;
+
+	// Greek and Cyrillic capitals, everything else is kept as it is
+	if (c >= 0x391 && c <= 0x3A9)
+		c += 0x20;
+	else if (c >= 0x410 && c <= 0x42F)
+		c += 0x20;
+	else if (c >= 0x400 && c <= 0x40F)
+		c += 0x50;
+
+	EncodeCodepoint(c, buffer);
+	return buffer;
+}
+
+void SongSearch::Fold(const char * text, std::string * result)
+{
+	const Uint8 * p = (const Uint8 *) text;
+	size_t start = result->size();
+	bool separate = false;
+	char buffer[8];
+
+	while (*p != '\0')
+	{
+		Uint32 c;
+		if (*p < 0x80)
+			c = *p++;
+		else
+			c = DecodeCodepoint(p);
+
+		const char * folded = FoldCodepoint(c, buffer);
+		if (folded == NULL)
+		{
+			// no leading or trailing spaces, and only one in between
+			separate = (result->size() > start);
+			continue;
+		}
+
+		if (*folded == '\0')
+			continue;
+
+		if (separate)
+		{
+			result->push_back(' ');
+			separate = false;
+		}
+
+		result->append(folded);
+	}
+}
+
+SongSearch::SongSearch()
+	: _stepField(ssfAll), _buildTime(0.0f), _searchTime(0.0f)
+{
+}
+
+void SongSearchSource::Gather(const SongCatalog& catalog)
+{
+	Uint32 count = catalog.GetCount();
+
+	Clear();
+	Artist.reserve(count);
+	Title.reserve(count);
+
+	// The pool's buffer moves as strings are added, hence the copy.
+	for (Uint32 i = 0; i < count; i++)
+	{
+		Artist.push_back((Uint32) Strings.size());
+		Strings.append(catalog.GetArtist(i));
+		Strings.push_back('\0');
+
+		Title.push_back((Uint32) Strings.size());
+		Strings.append(catalog.GetTitle(i));
+		Strings.push_back('\0');
+	}
+}
+
+void SongSearchSource::Clear()
+{
+	Strings.clear();
+	Artist.clear();
+	Title.clear();
+}
+
+void SongSearch::Build(const SongSearchSource& source)
+{
+	Uint64 start = SDL_GetPerformanceCounter();
+	Uint32 count = source.GetCount();
+
+	Clear();
+
+	_textStart.reserve(count + 1);
+	_titleStart.reserve(count);
+	_fieldStart.reserve(count);
+	_charMask.reserve(count);
+	_wordMask.reserve(count);
+	_wordPairMask.reserve(count);
+
+	for (Uint32 i = 0; i < count; i++)
+	{
+		Uint32 songStart = (Uint32) _text.size();
+		_textStart.push_back(songStart);
+
+		Fold(source.Strings.c_str() + source.Artist[i], &_text);
+
+		// there's no sensible artist this long, but the offset must fit
+		if (_text.size() - songStart > 0xFFFE)
+			_text.resize(songStart + 0xFFFE);
+
+		_text.push_back(SONG_SEARCH_SEPARATOR);
+		_titleStart.push_back((Uint16) (_text.size() - songStart));
+
+		Fold(source.Strings.c_str() + source.Title[i], &_text);
+
+		const char * text = _text.c_str() + songStart;
+		size_t length = _text.size() - songStart;
+		size_t titleStart = _titleStart.back();
+
+		// the first two characters of each, for the quickest ranking
+		Uint8 artist1 = (length > 1 ? text[1] : 0);
+		Uint8 title0 = (titleStart < length ? text[titleStart] : 0);
+		Uint8 title1 = (titleStart + 1 < length ? text[titleStart + 1] : 0);
+		_fieldStart.push_back((Uint8) text[0] | (artist1 << 8) | (title0 << 16) | ((Uint32) title1 << 24));
+
+		Uint64 charMask = 0, wordMask = 0, wordPairMask = 0;
+		for (size_t j = 0; j < length; j++)
+		{
+			if (text[j] == SONG_SEARCH_SEPARATOR)
+				continue;
+
+			Uint64 bit = CharBit(text[j]);
+			charMask |= bit;
+
+			if (j == 0 || text[j - 1] == ' ' || text[j - 1] == SONG_SEARCH_SEPARATOR)
+			{
+				wordMask |= bit;
+				if (j + 1 < length && text[j + 1] != SONG_SEARCH_SEPARATOR)
+					wordPairMask |= PairBit(text[j], text[j + 1]);
+			}
+		}
+
+		_charMask.push_back(charMask);
+		_wordMask.push_back(wordMask);
+		_wordPairMask.push_back(wordPairMask);
+	}
+
+	_textStart.push_back((Uint32) _text.size());
+
+	BuildPostings(2, SONG_SEARCH_PAIR_LISTS, &_pairs);
+	BuildPostings(3, SONG_SEARCH_TRIGRAM_LISTS, &_trigrams);
+
+	_buildTime = (float) ((SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency());
+}
+
+void SongSearch::BuildPostings(size_t gramLength, Uint32 listCount, Postings * postings)
+{
+	std::vector<Uint32>& listStart = postings->Start;
+	std::vector<Uint32>& songs = postings->Songs;
+	std::vector<Uint32> lists;
+
+	listStart.assign(listCount + 1, 0);
+
+	// Two passes over the folded text: first count how long each list is,
+	// then fill them. Songs are added in order, so every list ends up sorted.
+	Uint32 count = GetCount();
+	for (int pass = 0; pass < 2; pass++)
+	{
+		for (Uint32 i = 0; i < count; i++)
+		{
+			const char * text = _text.c_str() + _textStart[i];
+			Uint32 length = _textStart[i + 1] - _textStart[i];
+
+			lists.clear();
+			for (Uint32 j = 0; j + gramLength <= length; j++)
+			{
+				if (memchr(text + j, SONG_SEARCH_SEPARATOR, gramLength) == NULL)
+					lists.push_back(GramList(text + j, gramLength));
+			}
+
+			// each song goes into a list once
+			std::sort(lists.begin(), lists.end());
+			lists.erase(std::unique(lists.begin(), lists.end()), lists.end());
+
+			for (size_t j = 0; j < lists.size(); j++)
+			{
+				if (pass == 0)
+					listStart[lists[j] + 1]++;
+				else
+					songs[listStart[lists[j]]++] = i;
+			}
+		}
+
+		if (pass == 0)
+		{
+			for (Uint32 j = 0; j < listCount; j++)
+				listStart[j + 1] += listStart[j];
+
+			songs.resize(listStart[listCount]);
+		}
+	}
+
+	// filling moved every start to where the next list starts
+	for (Uint32 j = listCount; j > 0; j--)
+		listStart[j] = listStart[j - 1];
+	listStart[0] = 0;
+}
+
+void SongSearch::Clear()
+{
+	_text.clear();
+	_textStart.clear();
+	_titleStart.clear();
+	_fieldStart.clear();
+	_charMask.clear();
+	_wordMask.clear();
+	_wordPairMask.clear();
+	_pairs.Start.clear();
+	_pairs.Songs.clear();
+	_trigrams.Start.clear();
+	_trigrams.Songs.clear();
+	_steps.clear();
+}
+
+const std::vector<Uint32>& SongSearch::Search(const std::string& query, SongSearchField field)
+{
+	Uint64 start = SDL_GetPerformanceCounter();
+
+	std::string folded;
+	Fold(query.c_str(), &folded);
+
+	if (field != _stepField)
+	{
+		_steps.clear();
+		_stepField = field;
+	}
+
+	// back to the last query this one continues; backspace ends up right on it
+	while (!_steps.empty()
+		&& folded.compare(0, _steps.back().Query.size(), _steps.back().Query) != 0)
+		_steps.pop_back();
+
+	if (_steps.empty() || _steps.back().Query != folded)
+	{
+		const SearchStep * previous = (_steps.empty() || _steps.back().Query.empty() ? NULL : &_steps.back());
+
+		SearchStep step;
+		step.Query = folded;
+
+		if (!folded.empty() && GetCount() > 0)
+		{
+			std::vector<Uint32> candidates;
+			bool contained = FindCandidates(folded, previous, &candidates);
+
+			// the short queries with the most results don't need to look at the text
+			bool quick = (contained && field == ssfAll && folded.size() <= 2);
+
+			// Most results come from the shortest queries, where whether a song
+			// is taken or which rank it gets is a coin toss; so these loops
+			// write every song and only advance past the ones they keep.
+			std::vector<Uint32> ranked[3];
+			size_t rankCount[3] = { 0, 0, 0 };
+			for (int rank = 0; rank < 3; rank++)
+				ranked[rank].resize(candidates.size() + 1);
+
+			size_t matchCount = 0;
+			if (!quick)
+				step.Matches.resize(candidates.size() + 1);
+
+			for (size_t i = 0; i < candidates.size(); i++)
+			{
+				int rank = (quick
+					? QuickRank(candidates[i], folded)
+					: MatchRank(candidates[i], folded, field));
+
+				if (rank < 0)
+					continue;
+
+				// candidates are in catalog order, so the matches are too
+				if (!quick)
+					step.Matches[matchCount++] = candidates[i];
+
+				ranked[rank][rankCount[rank]++] = candidates[i];
+			}
+
+			if (quick)
+				step.Matches.swap(candidates);
+			else
+				step.Matches.resize(matchCount);
+
+			step.Results.reserve(step.Matches.size());
+			for (int rank = 0; rank < 3; rank++)
+				step.Results.insert(step.Results.end(), ranked[rank].begin(), ranked[rank].begin() + rankCount[rank]);
+		}
+
+		_steps.push_back(SearchStep());
+		_steps.back().Query.swap(step.Query);
+		_steps.back().Matches.swap(step.Matches);
+		_steps.back().Results.swap(step.Results);
+	}
+
+	_searchTime = (float) ((SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency());
+	return _steps.back().Results;
+}
+
+bool SongSearch::FindCandidates(const std::string& query, const SearchStep * previous, std::vector<Uint32> * candidates) const
+{
+	// a single character: the songs containing it, from their masks
+	if (query.size() == 1)
+	{
+		Uint64 bit = CharBit(query[0]);
+		Uint32 count = GetCount();
+
+		// see Search() on why this writes every song
+		candidates->resize(count + 1);
+		Uint32 * out = &(*candidates)[0];
+		Uint32 found = 0;
+
+		for (Uint32 i = 0; i < count; i++)
+		{
+			out[found] = i;
+			found += ((_charMask[i] & bit) != 0);
+		}
+
+		candidates->resize(found);
+
+		return true;
+	}
+
+	// a pair has its own list
+	if (query.size() == 2)
+	{
+		Uint32 list = PairList(query.c_str());
+		candidates->assign(_pairs.Songs.begin() + _pairs.Start[list],
+			_pairs.Songs.begin() + _pairs.Start[list + 1]);
+		return true;
+	}
+
+	// Longer ones start from the shortest of the previous query's matches
+	// and the lists of their trigrams.
+	const Uint32 * first = NULL;
+	const Uint32 * last = NULL;
+
+	if (previous != NULL)
+	{
+		if (previous->Matches.empty())
+			return false;
+
+		first = &previous->Matches[0];
+		last = first + previous->Matches.size();
+	}
+
+	for (size_t i = 0; i + 2 < query.size(); i++)
+	{
+		Uint32 list = TrigramList(query.c_str() + i);
+		Uint32 listStart = _trigrams.Start[list];
+		Uint32 listEnd = _trigrams.Start[list + 1];
+
+		if (listStart == listEnd)
+			return false;
+
+		if (first == NULL || listEnd - listStart < (Uint32) (last - first))
+		{
+			first = &_trigrams.Songs[listStart];
+			last = first + (listEnd - listStart);
+		}
+	}
+
+	candidates->assign(first, last);
+	return false;
+}
+
+int SongSearch::QuickRank(Uint32 song, const std::string& query) const
+{
+	Uint32 fieldStart = _fieldStart[song];
+
+	if (query.size() == 1)
+	{
+		Uint32 c = (Uint8) query[0];
+		if ((fieldStart & 0xFF) == c || ((fieldStart >> 16) & 0xFF) == c)
+			return 0;
+
+		return ((_wordMask[song] & CharBit(query[0])) ? 1 : 2);
+	}
+
+	Uint32 pair = (Uint8) query[0] | ((Uint8) query[1] << 8);
+	if ((fieldStart & 0xFFFF) == pair || (fieldStart >> 16) == pair)
+		return 0;
+
+	// the mask may be wrong about it starting a word, but never about it not
+	if (_wordPairMask[song] & PairBit(query[0], query[1]))
+		return MatchRank(song, query, ssfAll);
+
+	return 2;
+}
+
+int SongSearch::MatchRank(Uint32 song, const std::string& query, SongSearchField field) const
+{
+	const char * text = _text.c_str() + _textStart[song];
+	Uint32 length = _textStart[song + 1] - _textStart[song];
+	Uint32 titleStart = _titleStart[song];
+
+	Uint32 from = (field == ssfTitle ? titleStart : 0);
+	Uint32 to = (field == ssfArtist ? titleStart - 1 : length);
+
+	if (to - from < query.size())
+		return -1;
+
+	int best = -1;
+	const char * end = text + to - query.size() + 1;
+
+	for (const char * p = text + from; p < end; p++)
+	{
+		p = (const char *) memchr(p, query[0], end - p);
+		if (p == NULL)
+			break;
+
+		if (memcmp(p, query.c_str(), query.size()) != 0)
+			continue;
+
+		Uint32 offset = (Uint32) (p - text);
+		if (offset == 0 || offset == titleStart)
+			return 0;
+
+		int rank = (p[-1] == ' ' ? 1 : 2);
+		if (best < 0 || rank < best)
+			best = rank;
+	}
+
+	return best;
+}
+
+size_t SongSearch::GetMemoryUsage() const
+{
+	return _text.capacity()
+		+ _textStart.capacity() * sizeof(Uint32)
+		+ _titleStart.capacity() * sizeof(Uint16)
+		+ _fieldStart.capacity() * sizeof(Uint32)
+		+ (_charMask.capacity() + _wordMask.capacity() + _wordPairMask.capacity()) * sizeof(Uint64)
+		+ (_pairs.Start.capacity() + _pairs.Songs.capacity()) * sizeof(Uint32)
+		+ (_trigrams.Start.capacity() + _trigrams.Songs.capacity()) * sizeof(Uint32);
+}
@@ -0,0 +1,144 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _SONGSEARCH_H
+#define _SONGSEARCH_H
+#pragma once
+
+class SongCatalog;
+
+// matches the order of the jump-to screen's type options
+enum SongSearchField
+{
+	ssfAll,
+	ssfTitle,
+	ssfArtist
+};
+
+// The artists and titles to index, copied from the catalog on the main
+// thread, so the index can be built by a worker while the catalog changes.
+struct SongSearchSource
+{
+	std::string				Strings;	// null-terminated, back to back
+	std::vector<Uint32>		Artist;		// offsets into Strings, per song
+	std::vector<Uint32>		Title;
+
+	void Gather(const SongCatalog& catalog);
+	void Clear();
+
+	INLINE Uint32 GetCount() const { return (Uint32) Artist.size(); }
+};
+
+/**
+ * Substring search over the artists and titles of the SongCatalog, for
+ * the jump-to screen, which searches again on every keystroke.
+ *
+ * Both are folded once when building: lower case, accents removed and
+ * punctuation collapsed, so "Beyoncé" is found by "beyonce" and "AC/DC" by "ac dc".
+ * Queries of three or more characters start from the songs containing their
+ * rarest trigram. Shorter ones match most of the library, so they come from
+ * per-song character masks and an exact list per pair instead.
+ *
+ * While the user keeps typing, the songs matching the previous query are the
+ * only candidates for the next one, so a longer query only ever checks
+ * fewer songs. The previous queries are kept too, so backspace is free.
+ */
+class SongSearch
+{
+public:
+	SongSearch();
+
+	// Indexes all of the songs again, which invalidates any previous results.
+	// Results are indexes into the source, so the catalog's as it was gathered.
+	void Build(const SongSearchSource& source);
+	void Clear();
+
+	// Returns the catalog indexes of the matching songs, best first: matches
+	// at the start of the title or artist, then at the start of a word, then
+	// anywhere else. Songs rank in catalog order within each of these.
+	// Valid until the next call.
+	const std::vector<Uint32>& Search(const std::string& query, SongSearchField field);
+
+	INLINE Uint32 GetCount() const { return (Uint32) _titleStart.size(); }
+	INLINE float GetBuildTime() const { return _buildTime; }
+
+	// how long the last Search() took, in milliseconds
+	INLINE float GetSearchTime() const { return _searchTime; }
+
+	size_t GetMemoryUsage() const;
+
+	// Lower case, accents removed, apostrophes and dots dropped and any other
+	// punctuation collapsed into single spaces. Appends to result.
+	static void Fold(const char * text, std::string * result);
+
+protected:
+	struct SearchStep
+	{
+		std::string				Query;
+		std::vector<Uint32>		Matches;	// in catalog order
+		std::vector<Uint32>		Results;	// ranked
+	};
+
+	// the songs containing each pair or trigram, as one array of lists
+	struct Postings
+	{
+		std::vector<Uint32>		Start;		// one more than there are lists
+		std::vector<Uint32>		Songs;
+	};
+
+	void BuildPostings(size_t gramLength, Uint32 listCount, Postings * postings);
+
+	// Returns true if all of the candidates are known to match somewhere.
+	bool FindCandidates(const std::string& query, const SearchStep * previous, std::vector<Uint32> * candidates) const;
+
+	// Returns the rank of the best match, or -1 if there's none.
+	int MatchRank(Uint32 song, const std::string& query, SongSearchField field) const;
+
+	// The same for a song known to match one or two characters, mostly from the masks.
+	int QuickRank(Uint32 song, const std::string& query) const;
+
+	// folded "artist\ntitle" of every song, back to back
+	std::string				_text;
+	std::vector<Uint32>		_textStart;		// one more than there are songs
+	std::vector<Uint16>		_titleStart;	// relative to the song's text
+
+	// per song: the first two characters of the artist and the title, the
+	// characters it contains, the ones starting a word and a bloom filter
+	// of the pairs starting a word
+	std::vector<Uint32>		_fieldStart;
+	std::vector<Uint64>		_charMask;
+	std::vector<Uint64>		_wordMask;
+	std::vector<Uint64>		_wordPairMask;
+
+	// Pairs are looked up exactly, trigrams share hashed lists.
+	Postings				_pairs;
+	Postings				_trigrams;
+
+	// the queries typed so far, each a prefix of the next
+	std::vector<SearchStep>	_steps;
+	SongSearchField			_stepField;
+
+	float					_buildTime;
+	float					_searchTime;
+};
+
+#endif
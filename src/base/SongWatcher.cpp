@@ -0,0 +1,203 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "stdafx.h"
+#include "SongWatcher.h"
+#include "Song.h"
+#include "Log.h"
+#include "Tracer.h"
+
+#if defined(__linux__)
+#	include <unistd.h>
+#	include <poll.h>
+#	include <sys/inotify.h>
+
+// everything which can add, change or remove a song file or folder
+#	define SONG_WATCH_MASK	(IN_CREATE | IN_DELETE | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO \
+							| IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR)
+#endif
+
+SongWatcher::SongWatcher(const SongWatchFunction& onChange)
+	: _onChange(onChange), _fd(-1), _watchLimitHit(false), _stopThread(false)
+{
+#if defined(__linux__)
+	_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (_fd < 0)
+	{
+		sLog.Warn("SongWatcher", "inotify unavailable (%s), song folders won't be watched.", strerror(errno));
+		return;
+	}
+
+	_thread = std::thread(&SongWatcher::WatcherThread, this);
+#endif
+}
+
+void SongWatcher::Watch(const path& folder)
+{
+#if defined(__linux__)
+	if (_fd < 0)
+		return;
+
+	std::string name = folder.generic_string();
+	int wd = inotify_add_watch(_fd, name.c_str(), SONG_WATCH_MASK);
+
+	std::lock_guard<std::mutex> lock(_watchLock);
+	if (wd < 0)
+	{
+		// fs.inotify.max_user_watches, only worth mentioning once
+		if (errno == ENOSPC && !_watchLimitHit)
+		{
+			sLog.Warn("SongWatcher", "Out of inotify watches, not all song folders are watched.");
+			_watchLimitHit = true;
+		}
+
+		return;
+	}
+
+	// adding a folder twice returns the same descriptor
+	_folders[wd] = name;
+	_watches[name] = wd;
+#endif
+}
+
+bool SongWatcher::IsWatched(const path& folder)
+{
+	std::lock_guard<std::mutex> lock(_watchLock);
+	return _watches.find(folder.generic_string()) != _watches.end();
+}
+
+void SongWatcher::WatcherThread()
+{
+#if defined(__linux__)
+	TRACE_THREAD_NAME("Song watcher");
+
+	FolderSet changed;
+	Uint32 firstChange = 0, lastChange = 0;
+	bool overflow = false;
+
+	// aligned for the inotify_event structs in it
+	union
+	{
+		char			data[16384];
+		inotify_event	event;
+	} buffer;
+
+	while (!_stopThread)
+	{
+		pollfd pfd;
+		pfd.fd = _fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+
+		if (poll(&pfd, 1, SONG_WATCH_POLL) > 0)
+		{
+			ssize_t length;
+			while ((length = read(_fd, buffer.data, sizeof(buffer.data))) > 0)
+			{
+				std::lock_guard<std::mutex> lock(_watchLock);
+
+				for (char * p = buffer.data; p < buffer.data + length; )
+				{
+					const inotify_event * event = (const inotify_event *) p;
+					p += sizeof(inotify_event) + event->len;
+
+					if (event->mask & IN_Q_OVERFLOW)
+					{
+						overflow = true;
+						continue;
+					}
+
+					std::unordered_map<int, std::string>::iterator itr = _folders.find(event->wd);
+					if (itr == _folders.end())
+						continue;
+
+					// Only song files and folders matter, not covers, audio or editor backups.
+					bool relevant = (event->mask & (IN_ISDIR | IN_DELETE_SELF | IN_MOVE_SELF)) != 0;
+					if (!relevant && event->len > 0)
+					{
+						const char * extension = strrchr(event->name, '.');
+						relevant = (extension != NULL && Song::IsSongFileExtension(extension));
+					}
+
+					if (relevant)
+					{
+						changed.insert(itr->second);
+
+						lastChange = SDL_GetTicks();
+						if (firstChange == 0)
+							firstChange = lastChange;
+					}
+
+					// The folder is gone (or somewhere else, which we can't tell); the rescan
+					// of it notices. Moved folders are picked up again by their new parent's.
+					if (event->mask & (IN_IGNORED | IN_MOVE_SELF))
+					{
+						if (event->mask & IN_MOVE_SELF)
+							inotify_rm_watch(_fd, event->wd);
+
+						_watches.erase(itr->second);
+						_folders.erase(itr);
+					}
+				}
+			}
+		}
+
+		Uint32 ticks = SDL_GetTicks();
+		if (overflow)
+		{
+			sLog.Warn("SongWatcher", "Too many changes at once, rescanning all song folders.");
+			_onChange(FolderSet());
+
+			changed.clear();
+			firstChange = lastChange = 0;
+			overflow = false;
+		}
+		else if (!changed.empty()
+			&& (ticks - lastChange >= SONG_WATCH_DEBOUNCE || ticks - firstChange >= SONG_WATCH_MAX_DELAY))
+		{
+			_onChange(changed);
+
+			changed.clear();
+			firstChange = lastChange = 0;
+		}
+	}
+#endif
+}
+
+void SongWatcher::Stop()
+{
+	if (_thread.joinable())
+	{
+		_stopThread = true;
+		_thread.join();
+	}
+}
+
+SongWatcher::~SongWatcher()
+{
+	Stop();
+
+#if defined(__linux__)
+	if (_fd >= 0)
+		close(_fd);
+#endif
+}
@@ -0,0 +1,78 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _SONGWATCHER_H
+#define _SONGWATCHER_H
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include <functional>
+
+#define SONG_WATCH_DEBOUNCE		500		// ms without changes before a burst is handled
+#define SONG_WATCH_MAX_DELAY	5000	// ms, so an endless stream of changes is handled eventually
+#define SONG_WATCH_POLL			100		// ms, how often the thread checks for changes and whether to stop
+
+typedef std::set<std::string> FolderSet;
+
+// Called on the watcher thread with the folders which changed.
+// An empty set means changes were lost and everything has to be scanned again.
+typedef std::function<void(const FolderSet& folders)> SongWatchFunction;
+
+/**
+ * Watches the song folders for added, changed or removed song files and
+ * subfolders, and reports the affected folders once a burst of changes is over.
+ *
+ * Only implemented with inotify on Linux; elsewhere nothing is ever reported.
+ */
+class SongWatcher
+{
+public:
+	SongWatcher(const SongWatchFunction& onChange);
+
+	// Adds a folder (not its subfolders), may be called from any thread.
+	void Watch(const path& folder);
+	bool IsWatched(const path& folder);
+
+	// Stops reporting changes. Watch() may still be called, it just has no effect any more.
+	void Stop();
+
+	~SongWatcher();
+
+protected:
+	void WatcherThread();
+
+	SongWatchFunction		_onChange;
+
+	int						_fd;
+	std::mutex				_watchLock;
+	std::unordered_map<int, std::string>	_folders;	// by watch descriptor
+	std::unordered_map<std::string, int>	_watches;	// by folder
+	bool					_watchLimitHit;
+
+	std::thread				_thread;
+	std::atomic<bool>		_stopThread;
+};
+
+#endif
@@ -21,3 +21,708 @@
  */
 
 #include "stdafx.h"
+#include <thread>
+
+#include "Songs.h"
+#include "Log.h"
+#include "PathUtils.h"
+
+using namespace boost::filesystem;
+
+initialiseSingleton(Songs);
+
+extern PathSet SongPaths;
+
+// Follows indexes of the catalog through another removal, which moved each
+// entry to moved[entry]. Empty indexes stand for the catalog as it was.
+static void ComposeMoved(std::vector<Uint32> * indexes, const std::vector<Uint32>& moved)
+{
+	if (indexes->empty())
+	{
+		*indexes = moved;
+		return;
+	}
+
+	for (size_t i = 0; i < indexes->size(); i++)
+	{
+		Uint32& index = (*indexes)[i];
+		if (index != SONG_ORDER_REMOVED)
+			index = moved[index];
+	}
+}
+
+Songs::Songs()
+	: _revision(0), _search(new SongSearch()), _nextSearch(new SongSearch()),
+	_searchRevision(0), _searchBuildRevision(0), _searchBuildCleared(false),
+	_orderRevision(0), _mergeQueued(false),
+	_watcher(NULL), _pendingRescans(0), _shuttingDown(false),
+	_pendingFolders(0), _cancelScan(false),
+	_folderCount(0), _fileCount(0), _songCount(0), _indexedCount(0), _byteCount(0),
+	_scanId(0), _scanStart(0), _scanEnd(0), _lastProgress(0)
+{
+	// the list belongs to the main thread, so that's where changes are handled
+	_watcher = new SongWatcher([this](const FolderSet& folders)
+	{
+		if (!_shuttingDown)
+			sJobs.RunOnMainThread([this, folders]() { RescanFolders(folders); });
+	});
+}
+
+void Songs::StartScan()
+{
+	CancelScan();
+	ClearSongs();
+
+	_scanId++;
+	_folderCount = 0;
+	_fileCount = 0;
+	_songCount = 0;
+	_indexedCount = 0;
+	_byteCount = 0;
+	_scanStart = SDL_GetPerformanceCounter();
+	_scanEnd = 0;
+	_lastProgress = SDL_GetTicks();
+
+	// Held until all roots are queued, so the scan can't finish in between.
+	_pendingFolders = 1;
+	sJobs.Run(std::bind(&Songs::QueueRoots, this), jpBackground);
+}
+
+void Songs::QueueRoots()
+{
+	Uint64 start = SDL_GetPerformanceCounter();
+	if (_index.Load())
+	{
+		sLog.Status("Songs", "Loaded the song index (%u files in %u folders) in %.0f ms",
+			_index.GetFileCount(), _index.GetFolderCount(),
+			(SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency());
+	}
+
+	// PathSet is sorted, so a folder inside another song path directly follows it.
+	path lastRoot;
+	for (PathSet::const_iterator itr = SongPaths.begin(); itr != SongPaths.end() && !_cancelScan; ++itr)
+	{
+		const path& root = *itr;
+		if (!lastRoot.empty()
+			&& root.generic_string().compare(0, lastRoot.generic_string().size() + 1, lastRoot.generic_string() + "/") == 0)
+			continue;
+
+		boost::system::error_code error;
+		if (!is_directory(root, error))
+			continue;
+
+		sLog.Status("Songs", "Scanning %s", root.generic_string().c_str());
+		QueueFolder(root);
+		lastRoot = root;
+	}
+
+	FolderDone();
+}
+
+void Songs::CancelScan()
+{
+	// without workers, queued folders never finish
+	if (JobSystem::getSingletonPtr() == NULL)
+		return;
+
+	_cancelScan = true;
+	while (_pendingFolders.load() > 0 || _pendingRescans.load() > 0)
+		std::this_thread::yield();
+
+	_cancelScan = false;
+
+	// its FinishScan() may still be queued, it mustn't write a partial scan to the index
+	_scanId++;
+}
+
+SongScanStats Songs::GetScanStats() const
+{
+	SongScanStats stats;
+	stats.Folders = _folderCount;
+	stats.Files = _fileCount;
+	stats.Songs = _songCount;
+	stats.Indexed = _indexedCount;
+	stats.Bytes = _byteCount;
+
+	Uint64 end = (_scanEnd != 0 ? _scanEnd : SDL_GetPerformanceCounter());
+	stats.Seconds = (_scanStart != 0 ? (float) ((end - _scanStart) / (double) SDL_GetPerformanceFrequency()) : 0.0f);
+	return stats;
+}
+
+void Songs::QueueFolder(const path& folder)
+{
+	_pendingFolders++;
+	_folderCount++;
+	sJobs.Run(std::bind(&Songs::ScanFolder, this, folder), jpBackground);
+}
+
+// The folder's entry for the index, with the headers of all its song files.
+static SongIndexUpdate * MakeIndexUpdate(const path& folder, time_t mtime, const SongList& found, SongIndexFileMap& invalid)
+{
+	SongIndexUpdate * update = new SongIndexUpdate();
+	update->Folder = folder.generic_string();
+	update->Parent = folder.parent_path().generic_string();
+	update->MTime = mtime;
+	update->Files.swap(invalid);
+
+	for (size_t i = 0; i < found.size(); i++)
+	{
+		SongIndexFile entry;
+		entry.Size = found[i]->FileSize;
+		entry.MTime = found[i]->LastModified;
+		entry.Header = new Song(*found[i]);
+		update->Files[found[i]->FileName.filename().generic_string()] = entry;
+	}
+
+	return update;
+}
+
+void Songs::ScanFolder(const path& folder)
+{
+	_watcher->Watch(folder);
+
+	std::string folderName = folder.generic_string();
+	SongIndexFolder * indexed = _index.FindFolder(folderName);
+	if (indexed != NULL)
+		indexed->Visited = true;
+
+	boost::system::error_code error;
+	time_t folderTime = last_write_time(folder, error);
+
+	SongList found;
+	SongIndexFileMap invalid;
+	bool changed = true;
+	Uint32 files = 0;
+
+	if (indexed != NULL && !error && indexed->MTime == folderTime)
+	{
+		// Nothing was added, removed or renamed in here since the last scan,
+		// so there's no need to list it. The files themselves may still have changed.
+		changed = false;
+
+		for (size_t i = 0; i < indexed->Subfolders.size(); i++)
+			QueueFolder(indexed->Subfolders[i]);
+
+		for (SongIndexFileMap::const_iterator itr = indexed->Files.begin(); itr != indexed->Files.end() && !_cancelScan; ++itr)
+		{
+			files++;
+			if (ScanFile(folder / itr->first, &itr->second, &found, &invalid))
+				changed = true;
+		}
+	}
+	else
+	{
+		try
+		{
+			directory_iterator end;
+			for (directory_iterator itr(folder); itr != end && !_cancelScan; ++itr)
+			{
+				const path& p = itr->path();
+
+				if (is_directory(itr->status(error)))
+				{
+					// don't follow links to folders, they may well lead back up the tree
+					if (!is_symlink(itr->symlink_status(error)))
+						QueueFolder(p);
+
+					continue;
+				}
+
+				if (!Song::IsSongFileExtension(p.extension().generic_string().c_str()))
+					continue;
+
+				const SongIndexFile * indexedFile = NULL;
+				if (indexed != NULL)
+				{
+					SongIndexFileMap::const_iterator file = indexed->Files.find(p.filename().generic_string());
+					if (file != indexed->Files.end())
+						indexedFile = &file->second;
+				}
+
+				files++;
+				ScanFile(p, indexedFile, &found, &invalid);
+			}
+		}
+		catch (const filesystem_error& e)
+		{
+			sLog.Warn("Songs::ScanFolder", "%s", e.what());
+			changed = false;
+		}
+	}
+
+	_fileCount += files;
+	_songCount += (Uint32) found.size();
+
+	// a cancelled scan has only seen part of the folder
+	if (changed && !_cancelScan)
+	{
+		SongIndexUpdate * update = MakeIndexUpdate(folder, folderTime, found, invalid);
+
+		std::lock_guard<std::mutex> lock(_foundLock);
+		_indexUpdates.push_back(update);
+	}
+
+	if (!found.empty())
+		AddFound(found);
+
+	FolderDone();
+}
+
+bool Songs::ScanFile(const path& filename, const SongIndexFile * indexed, SongList * found, SongIndexFileMap * invalid)
+{
+	boost::system::error_code error;
+	SongIndexFile entry;
+	entry.Size = file_size(filename, error);
+	entry.MTime = (error ? 0 : last_write_time(filename, error));
+	entry.Header = NULL;
+
+	// gone since the folder was listed
+	if (error)
+		return true;
+
+	if (indexed != NULL
+		&& entry.Size == indexed->Size && entry.MTime == indexed->MTime)
+	{
+		if (indexed->Header != NULL)
+		{
+			found->push_back(new Song(*indexed->Header));
+			_indexedCount++;
+		}
+		else
+		{
+			(*invalid)[filename.filename().generic_string()] = entry;
+		}
+
+		return false;
+	}
+
+	Song * song = new Song();
+	bool valid = song->ReadHeader(filename);
+	_byteCount += entry.Size;
+
+	if (valid)
+	{
+		found->push_back(song);
+	}
+	else
+	{
+		delete song;
+		(*invalid)[filename.filename().generic_string()] = entry;
+	}
+
+	return true;
+}
+
+void Songs::FolderDone()
+{
+	// read before letting go, once the count is 0 CancelScan() may change it
+	Uint32 scanId = _scanId;
+
+	if (--_pendingFolders == 0)
+		sJobs.RunOnMainThread([this, scanId]() { FinishScan(scanId); });
+}
+
+void Songs::RescanFolders(const FolderSet& folders)
+{
+	if (_shuttingDown)
+		return;
+
+	if (folders.empty())
+	{
+		StartScan();
+		return;
+	}
+
+	// the scan may well see the changes anyway, but not necessarily all of them
+	if (IsScanning())
+	{
+		_deferredRescans.insert(folders.begin(), folders.end());
+		return;
+	}
+
+	sLog.Status("Songs", "%u song folders changed, reading them again", (Uint32) folders.size());
+
+	for (FolderSet::const_iterator itr = folders.begin(); itr != folders.end(); ++itr)
+	{
+		_pendingRescans++;
+		sJobs.Run(std::bind(&Songs::RescanFolder, this, path(*itr)), jpBackground);
+	}
+}
+
+void Songs::RescanFolder(const path& folder)
+{
+	FolderDelta delta;
+	SongIndexFileMap invalid;
+	SongIndexUpdate * update = NULL;
+
+	delta.Folder = folder.generic_string();
+	delta.Removed = false;
+
+	boost::system::error_code error;
+	time_t folderTime = last_write_time(folder, error);
+
+	if (error || !is_directory(folder, error))
+	{
+		delta.Removed = true;
+	}
+	else
+	{
+		_watcher->Watch(folder);
+
+		try
+		{
+			directory_iterator end;
+			for (directory_iterator itr(folder); itr != end && !_cancelScan; ++itr)
+			{
+				const path& p = itr->path();
+
+				if (is_directory(itr->status(error)))
+				{
+					// Added along with the folder. Known ones are watched and report their own changes.
+					if (!is_symlink(itr->symlink_status(error)) && !_watcher->IsWatched(p))
+					{
+						_pendingRescans++;
+						sJobs.Run(std::bind(&Songs::RescanFolder, this, p), jpBackground);
+					}
+
+					continue;
+				}
+
+				if (Song::IsSongFileExtension(p.extension().generic_string().c_str()))
+					ScanFile(p, NULL, &delta.Songs, &invalid);
+			}
+		}
+		catch (const filesystem_error& e)
+		{
+			sLog.Warn("Songs::RescanFolder", "%s", e.what());
+
+			// keep what we have, it's as good as anything
+			for (size_t i = 0; i < delta.Songs.size(); i++)
+				delete delta.Songs[i];
+
+			_pendingRescans--;
+			return;
+		}
+
+		update = MakeIndexUpdate(folder, folderTime, delta.Songs, invalid);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_foundLock);
+		_deltas.push_back(delta);
+
+		if (update != NULL)
+			_indexUpdates.push_back(update);
+		else
+			_removedFolders.push_back(delta.Folder);
+
+		QueueMerge();
+	}
+
+	_pendingRescans--;
+}
+
+void Songs::AddFound(SongList& found)
+{
+	std::lock_guard<std::mutex> lock(_foundLock);
+	_found.insert(_found.end(), found.begin(), found.end());
+	QueueMerge();
+}
+
+void Songs::QueueMerge()
+{
+	// one merge per frame at most, however many folders finish in between
+	if (!_mergeQueued && !_shuttingDown)
+	{
+		_mergeQueued = true;
+		sJobs.RunOnMainThread(std::bind(&Songs::MergeFound, this));
+	}
+}
+
+void Songs::MergeFound()
+{
+	// queued before ~Songs() started, what's left is freed by ClearSongs()
+	if (_shuttingDown)
+		return;
+
+	SongList found;
+	std::vector<FolderDelta> deltas;
+
+	{
+		std::lock_guard<std::mutex> lock(_foundLock);
+		found.swap(_found);
+		deltas.swap(_deltas);
+		_mergeQueued = false;
+	}
+
+	// The catalog keeps its own copy of what it needs.
+	for (size_t i = 0; i < deltas.size(); i++)
+	{
+		const FolderDelta& delta = deltas[i];
+		std::vector<Uint32> moved;
+		_catalog.RemoveFolder(delta.Folder, delta.Removed, &moved);
+
+		// so both indexes' results still point at the right songs
+		if (!moved.empty())
+		{
+			ComposeMoved(&_searchMoved, moved);
+			if (_searchBuild)
+				ComposeMoved(&_nextSearchMoved, moved);
+		}
+
+		for (size_t j = 0; j < delta.Songs.size(); j++)
+		{
+			_catalog.Add(*delta.Songs[j]);
+			delete delta.Songs[j];
+		}
+	}
+
+	for (size_t i = 0; i < found.size(); i++)
+	{
+		_catalog.Add(*found[i]);
+		delete found[i];
+	}
+
+	if (!found.empty() || !deltas.empty())
+		_revision++;
+
+	// a scan writes everything at once when it's done
+	if (!deltas.empty() && !IsScanning())
+		WriteIndex();
+
+	// and builds the index once too
+	if (!IsScanning())
+		UpdateSearch();
+
+	Uint32 ticks = SDL_GetTicks();
+	if (IsScanning()
+		&& ticks - _lastProgress >= SONG_SCAN_PROGRESS_INTERVAL)
+	{
+		SongScanStats stats = GetScanStats();
+		sLog.Status("Songs", "Scanning: %u songs in %u folders so far (%.0f files/s, %.1f MB/s)",
+			_catalog.GetCount(), stats.Folders,
+			stats.Files / stats.Seconds, stats.Bytes / (1024.0 * 1024.0) / stats.Seconds);
+
+		_lastProgress = ticks;
+	}
+}
+
+void Songs::FinishScan(Uint32 scanId)
+{
+	// a scan which was cancelled
+	if (scanId != _scanId)
+		return;
+
+	MergeFound();
+	_scanEnd = SDL_GetPerformanceCounter();
+
+	SongScanStats stats = GetScanStats();
+	float seconds = std::max(stats.Seconds, 0.001f);
+
+	sLog.Status("Songs", "Found %u songs (%u from the index) in %u files, %u folders in %.2f s: %.0f files/s, read %.1f MB at %.1f MB/s",
+		stats.Songs, stats.Indexed, stats.Files, stats.Folders, stats.Seconds,
+		stats.Files / seconds, stats.Bytes / (1024.0 * 1024.0), stats.Bytes / (1024.0 * 1024.0) / seconds);
+
+	sLog.Status("Songs", "Song catalog: %u songs, %u distinct strings, %.1f MB",
+		_catalog.GetCount(), _catalog.GetStrings().GetCount(), _catalog.GetMemoryUsage() / (1024.0 * 1024.0));
+
+	// Built now rather than when they're first needed. Later changes from the
+	// watcher may come in while singing, so those are left to the next use.
+	// The search index is built in the background either way.
+	UpdateOrders();
+	UpdateSearch();
+
+	std::vector<std::string> removedFolders;
+	_index.GetUnvisitedFolders(&removedFolders);
+	_index.Clear();
+
+	{
+		std::lock_guard<std::mutex> lock(_foundLock);
+		_removedFolders.insert(_removedFolders.end(), removedFolders.begin(), removedFolders.end());
+	}
+
+	WriteIndex();
+
+	// changes the watcher reported meanwhile
+	if (!_deferredRescans.empty())
+	{
+		FolderSet folders;
+		folders.swap(_deferredRescans);
+		RescanFolders(folders);
+	}
+}
+
+const std::vector<Uint32>& Songs::Search(const std::string& query, SongSearchField field)
+{
+	// Copying the strings for the next build takes a few ms, so that's only
+	// done here if the catalog changed again while the last one was running.
+	if (SwapSearch() && !IsScanning())
+		UpdateSearch();
+
+	const std::vector<Uint32>& results = _search->Search(query, field);
+	if (_searchMoved.empty())
+		return results;
+
+	// moving up keeps their order
+	_searchResults.clear();
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		Uint32 index = _searchMoved[results[i]];
+		if (index != SONG_ORDER_REMOVED)
+			_searchResults.push_back(index);
+	}
+
+	return _searchResults;
+}
+
+void Songs::UpdateSearch()
+{
+	SwapSearch();
+
+	// the changes made while building are picked up by the next one
+	if (_searchBuild || _searchRevision == _revision)
+		return;
+
+	_searchSource.Gather(_catalog);
+	_searchBuildRevision = _revision;
+	_searchBuildCleared = false;
+	_nextSearchMoved.clear();
+
+	SongSearch * search = _nextSearch;
+	const SongSearchSource * source = &_searchSource;
+	_searchBuild = sJobs.Run([search, source]() { search->Build(*source); }, jpBackground);
+}
+
+bool Songs::SwapSearch()
+{
+	if (!_searchBuild || !_searchBuild->IsFinished())
+		return false;
+
+	_searchBuild = JobHandle();
+	_searchSource.Clear();
+
+	if (!_searchBuildCleared)
+	{
+		std::swap(_search, _nextSearch);
+		_searchMoved.swap(_nextSearchMoved);
+		_searchRevision = _searchBuildRevision;
+
+		sLog.Status("Songs", "Search index: %u songs in %.1f ms, %.1f MB",
+			_search->GetCount(), _search->GetBuildTime(), _search->GetMemoryUsage() / (1024.0 * 1024.0));
+	}
+
+	_nextSearch->Clear();
+	_nextSearchMoved.clear();
+	return true;
+}
+
+const SongOrder& Songs::GetOrder(eSortingType sorting)
+{
+	UpdateOrders();
+	return _catalog.GetOrder(sorting);
+}
+
+void Songs::UpdateOrders()
+{
+	if (_orderRevision == _revision)
+		return;
+
+	// as of now, in case anything is merged while sorting
+	Uint32 revision = _revision;
+	bool build = !_catalog.GetOrders().IsBuilt();
+	_catalog.UpdateOrders();
+	_orderRevision = revision;
+
+	if (build)
+		sLog.Status("Songs", "Sorted %u songs in %.1f ms", _catalog.GetCount(), _catalog.GetOrders().GetUpdateTime());
+	else
+		sLog.Debug("Songs", "Sorted in changed songs in %.1f ms", _catalog.GetOrders().GetUpdateTime());
+}
+
+void Songs::WriteIndex()
+{
+	std::vector<std::string> removedFolders;
+	SongIndexUpdateList updates;
+
+	{
+		std::lock_guard<std::mutex> lock(_foundLock);
+		updates.swap(_indexUpdates);
+		removedFolders.swap(_removedFolders);
+	}
+
+	if (updates.empty() && removedFolders.empty())
+		return;
+
+	sLog.Status("Songs", "Updating the song index: %u changed folders, %u removed",
+		(Uint32) updates.size(), (Uint32) removedFolders.size());
+
+	JobHandle write = sJobs.Create([updates, removedFolders]()
+	{
+		SongIndex::Write(updates, removedFolders);
+
+		for (size_t i = 0; i < updates.size(); i++)
+			delete updates[i];
+	}, jpBackground);
+
+	// in order, and so waiting for the last write waits for all of them
+	if (_indexWrite)
+		sJobs.AddDependency(write, _indexWrite);
+
+	sJobs.Submit(write);
+	_indexWrite = write;
+}
+
+void Songs::ClearSongs()
+{
+	_catalog.Clear();
+	_revision++;
+
+	// An empty index is the empty catalog's; a build still running is of the old one.
+	_search->Clear();
+	_searchMoved.clear();
+	_searchRevision = _revision;
+	_searchBuildCleared = true;
+
+	std::lock_guard<std::mutex> lock(_foundLock);
+	for (SongList::iterator itr = _found.begin(); itr != _found.end(); ++itr)
+		delete *itr;
+
+	for (SongIndexUpdateList::iterator itr = _indexUpdates.begin(); itr != _indexUpdates.end(); ++itr)
+		delete *itr;
+
+	for (size_t i = 0; i < _deltas.size(); i++)
+	{
+		for (size_t j = 0; j < _deltas[i].Songs.size(); j++)
+			delete _deltas[i].Songs[j];
+	}
+
+	_found.clear();
+	_deltas.clear();
+	_indexUpdates.clear();
+	_removedFolders.clear();
+}
+
+Songs::~Songs()
+{
+	// Main-thread jobs still queued for us may run while waiting below
+	// (or never), so from here on they mustn't start anything new.
+	_shuttingDown = true;
+	_watcher->Stop();
+
+	CancelScan();
+
+	// the scan jobs are done with it
+	delete _watcher;
+	_watcher = NULL;
+
+	if (_indexWrite)
+		sJobs.Wait(_indexWrite);
+
+	if (_searchBuild)
+		sJobs.Wait(_searchBuild);
+
+	ClearSongs();
+
+	delete _search;
+	delete _nextSearch;
+}
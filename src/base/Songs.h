@@ -0,0 +1,190 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _SONGS_H
+#define _SONGS_H
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include "SongIndex.h"
+#include "SongCatalog.h"
+#include "SongSearch.h"
+#include "SongWatcher.h"
+#include "../shared/JobSystem.h"
+
+// interval (in ms) of the progress messages while scanning
+#define SONG_SCAN_PROGRESS_INTERVAL	1000
+
+struct SongScanStats
+{
+	Uint32	Folders;
+	Uint32	Files;		// song files found
+	Uint32	Songs;		// of which were usable
+	Uint32	Indexed;	// songs taken from the index without reading their file
+	Uint64	Bytes;
+	float	Seconds;
+};
+
+/**
+ * The song library.
+ *
+ * Scanning runs on the job system: every folder is a job, which queues its
+ * subfolders as new jobs (so idle workers steal whole subtrees) and reads the
+ * headers of its song files. Found songs are handed to the main thread in
+ * batches and added to the SongCatalog, so it grows while the scan is still running.
+ *
+ * Only files which changed since the last scan are read, the rest comes from
+ * the SongIndex; the folders which changed are written back once it's done.
+ *
+ * Afterwards the SongWatcher reports changed folders, which are read again
+ * on their own and replace their songs in the list (see RescanFolders()).
+ */
+class Songs : public Singleton<Songs>
+{
+public:
+	Songs();
+
+	// Drops the current list and scans all song paths in the background.
+	void StartScan();
+
+	// Stops a running scan and waits for its jobs.
+	void CancelScan();
+
+	// Reads the given folders again, and the subfolders which weren't known yet.
+	// Their songs are replaced once read; an empty set rescans everything.
+	// Waits for a running scan to finish first.
+	void RescanFolders(const FolderSet& folders);
+
+	INLINE bool IsScanning() const { return _pendingFolders.load() > 0; }
+	SongScanStats GetScanStats() const;
+
+	// Only to be used on the main thread, grows while a scan is running.
+	INLINE const SongCatalog& GetCatalog() const { return _catalog; }
+
+	// Changes whenever songs were added or removed, so views know when to refresh.
+	INLINE Uint32 GetRevision() const { return _revision; }
+
+	// Searches the catalog, see SongSearch::Search(). After changes the index
+	// is rebuilt in the background; until it's swapped in, the songs removed
+	// meanwhile are left out and the ones added aren't found yet.
+	// Only to be used on the main thread.
+	const std::vector<Uint32>& Search(const std::string& query, SongSearchField field);
+
+	// the index searched last, for its statistics
+	INLINE const SongSearch& GetSearch() const { return *_search; }
+
+	// The songs sorted and grouped by the given sorting, as the library is now.
+	// Only to be used on the main thread.
+	const SongOrder& GetOrder(eSortingType sorting);
+
+	~Songs();
+
+private:
+	void QueueRoots();
+	void QueueFolder(const path& folder);
+	void ScanFolder(const path& folder);
+
+	// Takes the header from the index if the file is unchanged, else reads it.
+	// Files without a usable header go to invalid, so they aren't read every time.
+	// Returns true if the file had to be read.
+	bool ScanFile(const path& filename, const SongIndexFile * indexed, SongList * found, SongIndexFileMap * invalid);
+
+	void FolderDone();
+	void RescanFolder(const path& folder);
+	void AddFound(SongList& found);
+	void QueueMerge();
+	void MergeFound();
+	void WriteIndex();
+	void FinishScan(Uint32 scanId);
+	void ClearSongs();
+	void UpdateOrders();
+
+	// Starts rebuilding the search index if it's behind and no build is running.
+	void UpdateSearch();
+
+	// Swaps in a finished build. Returns true if there was one.
+	bool SwapSearch();
+
+	SongCatalog				_catalog;
+	Uint32					_revision;
+
+	// The index searched, and the one a worker builds from a copy of the
+	// catalog's strings; neither is touched by the main thread meanwhile.
+	SongSearch *			_search;
+	SongSearch *			_nextSearch;
+	SongSearchSource		_searchSource;
+	JobHandle				_searchBuild;
+	Uint32					_searchRevision;		// the catalog _search was built from
+	Uint32					_searchBuildRevision;	// the same for _nextSearch
+	bool					_searchBuildCleared;	// the catalog was cleared while building
+
+	// Where the songs indexed moved to since, as songs were removed; empty
+	// while they're where they were.
+	std::vector<Uint32>		_searchMoved;
+	std::vector<Uint32>		_nextSearchMoved;
+	std::vector<Uint32>		_searchResults;
+
+	Uint32					_orderRevision;
+
+	// The songs of a folder which was read again, replacing the ones listed before.
+	struct FolderDelta
+	{
+		std::string	Folder;
+		bool		Removed;	// along with its subfolders
+		SongList	Songs;
+	};
+
+	// songs read by the workers, waiting for MergeFound() on the main thread
+	std::mutex				_foundLock;
+	SongList				_found;
+	std::vector<FolderDelta>	_deltas;
+	bool					_mergeQueued;
+
+	// loaded by the scan, freed once it's done
+	SongIndex				_index;
+	SongIndexUpdateList		_indexUpdates;		// guarded by _foundLock
+	std::vector<std::string>	_removedFolders;	// guarded by _foundLock
+	JobHandle				_indexWrite;
+
+	SongWatcher *			_watcher;
+	FolderSet				_deferredRescans;	// changed while scanning
+	std::atomic<int>		_pendingRescans;
+	std::atomic<bool>		_shuttingDown;	// no new rescans or merges once set
+
+	std::atomic<int>		_pendingFolders;
+	std::atomic<bool>		_cancelScan;
+
+	std::atomic<Uint32>		_folderCount;
+	std::atomic<Uint32>		_fileCount;
+	std::atomic<Uint32>		_songCount;
+	std::atomic<Uint32>		_indexedCount;
+	std::atomic<Uint64>		_byteCount;
+
+	Uint32					_scanId;	// tells a finished scan from a cancelled one
+	Uint64					_scanStart, _scanEnd;
+	Uint32					_lastProgress;
+};
+
+#define sSongs (Songs::getSingleton())
+
+#endif
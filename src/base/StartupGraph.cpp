@@ -0,0 +1,173 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "stdafx.h"
+#include "StartupGraph.h"
+#include "Log.h"
+#include "Tracer.h"
+
+StartupGraph::StartupGraph()
+	: _start(0), _end(0), _frequency(SDL_GetPerformanceFrequency()), _failed(false)
+{
+}
+
+int StartupGraph::Add(const char * name, const JobFunction& work, bool mainThread /*= false*/)
+{
+	Step * step = new Step();
+	step->Name = name;
+	step->Work = work;
+	step->MainThread = mainThread;
+	step->Start = step->End = 0;
+
+	_steps.push_back(step);
+	return (int) _steps.size() - 1;
+}
+
+void StartupGraph::Depends(int step, int dependency)
+{
+	assert(dependency < step);
+	_steps[step]->Dependencies.push_back(dependency);
+}
+
+void StartupGraph::Run(const StartupIdleFunction& idle)
+{
+	_start = SDL_GetPerformanceCounter();
+
+	for (size_t i = 0; i < _steps.size(); i++)
+	{
+		Step * step = _steps[i];
+		step->Job = sJobs.Create(std::bind(&StartupGraph::RunStep, this, step), jpInteractive, step->MainThread);
+
+		for (size_t d = 0; d < step->Dependencies.size(); d++)
+			sJobs.AddDependency(step->Job, _steps[step->Dependencies[d]]->Job);
+	}
+
+	for (size_t i = 0; i < _steps.size(); i++)
+		sJobs.Submit(_steps[i]->Job);
+
+	bool done;
+	do
+	{
+		sJobs.RunMainThreadJobs();
+
+		done = true;
+		for (size_t i = 0; i < _steps.size(); i++)
+		{
+			if (!_steps[i]->Job->IsFinished())
+			{
+				done = false;
+				break;
+			}
+		}
+
+		if (!done && idle)
+			idle();
+	} while (!done);
+
+	_end = SDL_GetPerformanceCounter();
+
+	if (_error != NULL)
+		std::rethrow_exception(_error);
+}
+
+void StartupGraph::RunStep(Step * step)
+{
+	// another step failed, startup will be aborted anyway
+	if (_failed)
+		return;
+
+	TRACE_SCOPE_DETAIL("Startup", step->Name.c_str());
+	step->Start = SDL_GetPerformanceCounter();
+
+	try
+	{
+		step->Work();
+	}
+	catch (...)
+	{
+		std::lock_guard<std::mutex> lock(_errorLock);
+		if (_error == NULL)
+			_error = std::current_exception();
+
+		_failed = true;
+
+		for (size_t i = 0; i < _steps.size(); i++)
+			sJobs.Cancel(_steps[i]->Job);
+	}
+
+	step->End = SDL_GetPerformanceCounter();
+}
+
+float StartupGraph::ToMs(Uint64 ticks)
+{
+	return (float) (ticks * 1000.0 / _frequency);
+}
+
+void StartupGraph::LogTimings()
+{
+	// Steps are stored in dependency order, so one pass finds the longest chain ending in each step.
+	std::vector<float> chainTime(_steps.size(), 0.0f);
+	std::vector<int> chainPrev(_steps.size(), -1);
+	int chainEnd = -1;
+	float sumTime = 0.0f;
+
+	for (size_t i = 0; i < _steps.size(); i++)
+	{
+		const Step * step = _steps[i];
+		float duration = ToMs(step->End - step->Start);
+
+		for (size_t d = 0; d < step->Dependencies.size(); d++)
+		{
+			int dep = step->Dependencies[d];
+			if (chainPrev[i] < 0 || chainTime[dep] > chainTime[chainPrev[i]])
+				chainPrev[i] = dep;
+		}
+
+		chainTime[i] = duration + (chainPrev[i] >= 0 ? chainTime[chainPrev[i]] : 0.0f);
+		if (chainEnd < 0 || chainTime[i] > chainTime[chainEnd])
+			chainEnd = (int) i;
+
+		sumTime += duration;
+
+		sLog.BenchmarkResult(1, (Uint64) (duration * 1000000.0), step->Name.c_str());
+
+		sLog.Status("Startup", "%-20s %8.2f ms (started at %8.2f ms, %s)",
+			step->Name.c_str(), duration, ToMs(step->Start - _start),
+			step->MainThread ? "main thread" : "worker");
+	}
+
+	if (chainEnd < 0)
+		return;
+
+	std::string path;
+	for (int i = chainEnd; i >= 0; i = chainPrev[i])
+		path = _steps[i]->Name + (path.empty() ? "" : " > ") + path;
+
+	sLog.Status("Startup", "Critical path: %s (%.2f ms)", path.c_str(), chainTime[chainEnd]);
+	sLog.Status("Startup", "Wall time: %.2f ms, sequential: %.2f ms", ToMs(_end - _start), sumTime);
+}
+
+StartupGraph::~StartupGraph()
+{
+	for (size_t i = 0; i < _steps.size(); i++)
+		delete _steps[i];
+}
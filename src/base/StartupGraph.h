@@ -0,0 +1,83 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _STARTUPGRAPH_H
+#define _STARTUPGRAPH_H
+#pragma once
+
+#include <exception>
+#include "../shared/JobSystem.h"
+
+typedef std::function<void()> StartupIdleFunction;
+
+/**
+ * Runs the startup steps as a dependency graph on the job system.
+ *
+ * Steps are added in an order which satisfies their dependencies (a step can
+ * only depend on steps added before it); everything whose dependencies are
+ * done runs concurrently. Steps touching OpenGL must be added as main-thread
+ * steps.
+ */
+class StartupGraph
+{
+public:
+	StartupGraph();
+
+	// Returns the step's ID for use with Depends().
+	int Add(const char * name, const JobFunction& work, bool mainThread = false);
+	void Depends(int step, int dependency);
+
+	// Runs all steps and returns once they are done, calling idle() on the
+	// main thread in between. An exception thrown by a step cancels the
+	// steps which haven't started yet and is rethrown here.
+	void Run(const StartupIdleFunction& idle);
+
+	// Logs each step's wall time and the critical path.
+	void LogTimings();
+
+	~StartupGraph();
+
+private:
+	struct Step
+	{
+		std::string			Name;
+		JobFunction			Work;
+		bool				MainThread;
+		std::vector<int>	Dependencies;
+		JobHandle			Job;
+
+		Uint64				Start, End;
+	};
+
+	void RunStep(Step * step);
+	float ToMs(Uint64 ticks);
+
+	std::vector<Step *>		_steps;
+	Uint64					_start, _end;
+	Uint64					_frequency;
+
+	std::mutex				_errorLock;
+	std::exception_ptr		_error;
+	std::atomic<bool>		_failed;
+};
+
+#endif
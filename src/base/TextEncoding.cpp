@@ -21,3 +21,306 @@
  */
 
 #include "stdafx.h"
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define TEXT_ENCODING_SSE2
+#	include <emmintrin.h>
+#endif
+
+// Code points of the bytes 0x80-0xFF. Bytes a code page leaves undefined
+// map to the C1 control of the same value, as Windows does.
+static const Uint16 s_cp1250[128] =
+{
+	0x20AC, 0x0081, 0x201A, 0x0083, 0x201E, 0x2026, 0x2020, 0x2021,
+	0x0088, 0x2030, 0x0160, 0x2039, 0x015A, 0x0164, 0x017D, 0x0179,
+	0x0090, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+	0x0098, 0x2122, 0x0161, 0x203A, 0x015B, 0x0165, 0x017E, 0x017A,
+	0x00A0, 0x02C7, 0x02D8, 0x0141, 0x00A4, 0x0104, 0x00A6, 0x00A7,
+	0x00A8, 0x00A9, 0x015E, 0x00AB, 0x00AC, 0x00AD, 0x00AE, 0x017B,
+	0x00B0, 0x00B1, 0x02DB, 0x0142, 0x00B4, 0x00B5, 0x00B6, 0x00B7,
+	0x00B8, 0x0105, 0x015F, 0x00BB, 0x013D, 0x02DD, 0x013E, 0x017C,
+	0x0154, 0x00C1, 0x00C2, 0x0102, 0x00C4, 0x0139, 0x0106, 0x00C7,
+	0x010C, 0x00C9, 0x0118, 0x00CB, 0x011A, 0x00CD, 0x00CE, 0x010E,
+	0x0110, 0x0143, 0x0147, 0x00D3, 0x00D4, 0x0150, 0x00D6, 0x00D7,
+	0x0158, 0x016E, 0x00DA, 0x0170, 0x00DC, 0x00DD, 0x0162, 0x00DF,
+	0x0155, 0x00E1, 0x00E2, 0x0103, 0x00E4, 0x013A, 0x0107, 0x00E7,
+	0x010D, 0x00E9, 0x0119, 0x00EB, 0x011B, 0x00ED, 0x00EE, 0x010F,
+	0x0111, 0x0144, 0x0148, 0x00F3, 0x00F4, 0x0151, 0x00F6, 0x00F7,
+	0x0159, 0x016F, 0x00FA, 0x0171, 0x00FC, 0x00FD, 0x0163, 0x02D9
+};
+
+static const Uint16 s_cp1252[128] =
+{
+	0x20AC, 0x0081, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+	0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0x008D, 0x017D, 0x008F,
+	0x0090, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+	0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x009D, 0x017E, 0x0178,
+	0x00A0, 0x00A1, 0x00A2, 0x00A3, 0x00A4, 0x00A5, 0x00A6, 0x00A7,
+	0x00A8, 0x00A9, 0x00AA, 0x00AB, 0x00AC, 0x00AD, 0x00AE, 0x00AF,
+	0x00B0, 0x00B1, 0x00B2, 0x00B3, 0x00B4, 0x00B5, 0x00B6, 0x00B7,
+	0x00B8, 0x00B9, 0x00BA, 0x00BB, 0x00BC, 0x00BD, 0x00BE, 0x00BF,
+	0x00C0, 0x00C1, 0x00C2, 0x00C3, 0x00C4, 0x00C5, 0x00C6, 0x00C7,
+	0x00C8, 0x00C9, 0x00CA, 0x00CB, 0x00CC, 0x00CD, 0x00CE, 0x00CF,
+	0x00D0, 0x00D1, 0x00D2, 0x00D3, 0x00D4, 0x00D5, 0x00D6, 0x00D7,
+	0x00D8, 0x00D9, 0x00DA, 0x00DB, 0x00DC, 0x00DD, 0x00DE, 0x00DF,
+	0x00E0, 0x00E1, 0x00E2, 0x00E3, 0x00E4, 0x00E5, 0x00E6, 0x00E7,
+	0x00E8, 0x00E9, 0x00EA, 0x00EB, 0x00EC, 0x00ED, 0x00EE, 0x00EF,
+	0x00F0, 0x00F1, 0x00F2, 0x00F3, 0x00F4, 0x00F5, 0x00F6, 0x00F7,
+	0x00F8, 0x00F9, 0x00FA, 0x00FB, 0x00FC, 0x00FD, 0x00FE, 0x00FF
+};
+
+// Length of the leading run of ASCII, which reads the same in every encoding.
+static size_t ASCIIPrefix(const char * text, size_t length)
+{
+	const char * p = text;
+	const char * end = text + length;
+
+#if defined(TEXT_ENCODING_SSE2)
+	while (end - p >= 16
+		&& _mm_movemask_epi8(_mm_loadu_si128((const __m128i *) p)) == 0)
+		p += 16;
+#endif
+
+	while (p < end && (Uint8) *p < 0x80)
+		p++;
+
+	return p - text;
+}
+
+#if defined(TEXT_ENCODING_SSE2)
+
+// Whatever a block's last bytes require of the next block's first ones.
+struct UTF8Carry
+{
+	Uint32	Continuations;	// must be continuation bytes
+	Uint32	AtLeastA0;		// after E0, otherwise it's overlong
+	Uint32	BelowA0;		// after ED, otherwise it's a surrogate
+	Uint32	AtLeast90;		// after F0, otherwise it's overlong
+	Uint32	Below90;		// after F4, otherwise it's above U+10FFFF
+};
+
+// Bit i is set if byte i is at least the given value.
+static INLINE Uint32 AtLeast(__m128i block, Uint8 value)
+{
+	return (Uint32) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(block, _mm_set1_epi8((char) value)), block));
+}
+
+static INLINE Uint32 Equal(__m128i block, Uint8 value)
+{
+	return (Uint32) _mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8((char) value)));
+}
+
+/**
+ * Checks 16 bytes at once, in bitmasks with a bit per byte: every lead byte
+ * marks the continuation bytes it needs, and the marks have to match the
+ * continuation bytes exactly. A lead byte where a continuation byte belongs
+ * breaks the match just like a stray continuation byte does. Marks for bytes
+ * past the block are carried into the next one.
+ */
+static INLINE bool CheckUTF8Block(__m128i block, UTF8Carry * carry)
+{
+	Uint32 nonASCII = (Uint32) _mm_movemask_epi8(block);
+	if (nonASCII == 0)
+		return carry->Continuations == 0;
+
+	// 0x80-0xBF are the only bytes below 0xC0 as signed chars
+	Uint32 continuations = (Uint32) _mm_movemask_epi8(_mm_cmplt_epi8(block, _mm_set1_epi8((char) 0xC0)));
+
+	Uint32 atLeastC2 = AtLeast(block, 0xC2);
+	Uint32 atLeastE0 = AtLeast(block, 0xE0);
+	Uint32 atLeastF0 = AtLeast(block, 0xF0);
+
+	// C0 and C1 could only start overlong sequences, F5 and above don't exist
+	if ((nonASCII & ~continuations & ~atLeastC2) != 0 || AtLeast(block, 0xF5) != 0)
+		return false;
+
+	Uint32 required = (atLeastC2 << 1) | (atLeastE0 << 2) | (atLeastF0 << 3) | carry->Continuations;
+	if ((required & 0xFFFF) != continuations)
+		return false;
+
+	Uint32 atLeastA0 = (Equal(block, 0xE0) << 1) | carry->AtLeastA0;
+	Uint32 belowA0   = (Equal(block, 0xED) << 1) | carry->BelowA0;
+	Uint32 atLeast90 = (Equal(block, 0xF0) << 1) | carry->AtLeast90;
+	Uint32 below90   = (Equal(block, 0xF4) << 1) | carry->Below90;
+
+	Uint32 blockA0 = AtLeast(block, 0xA0);
+	Uint32 block90 = AtLeast(block, 0x90);
+
+	if (((atLeastA0 & ~blockA0) | (belowA0 & blockA0) | (atLeast90 & ~block90) | (below90 & block90)) & 0xFFFF)
+		return false;
+
+	carry->Continuations = required >> 16;
+	carry->AtLeastA0 = atLeastA0 >> 16;
+	carry->BelowA0 = belowA0 >> 16;
+	carry->AtLeast90 = atLeast90 >> 16;
+	carry->Below90 = below90 >> 16;
+	return true;
+}
+
+bool IsValidUTF8(const char * text, size_t length)
+{
+	const char * p = text + ASCIIPrefix(text, length);
+	const char * end = text + length;
+	UTF8Carry carry = { 0, 0, 0, 0, 0 };
+
+	while (end - p >= 16)
+	{
+		if (!CheckUTF8Block(_mm_loadu_si128((const __m128i *) p), &carry))
+			return false;
+
+		p += 16;
+	}
+
+	// the rest is padded with ASCII, which ends any sequence that's still open
+	if (p < end)
+	{
+		char tail[16] = { 0 };
+		memcpy(tail, p, end - p);
+
+		if (!CheckUTF8Block(_mm_loadu_si128((const __m128i *) tail), &carry))
+			return false;
+	}
+
+	return carry.Continuations == 0;
+}
+
+#else
+
+bool IsValidUTF8(const char * text, size_t length)
+{
+	const Uint8 * p = (const Uint8 *) text + ASCIIPrefix(text, length);
+	const Uint8 * end = (const Uint8 *) text + length;
+
+	while (p < end)
+	{
+		Uint8 c = *p++;
+		if (c < 0x80)
+			continue;
+
+		int count;
+		Uint8 min = 0x80, max = 0xBF;	// of the second byte
+
+		if (c >= 0xC2 && c <= 0xDF)
+			count = 1;
+		else if (c >= 0xE0 && c <= 0xEF)
+		{
+			count = 2;
+			if (c == 0xE0)
+				min = 0xA0;
+			else if (c == 0xED)
+				max = 0x9F;
+		}
+		else if (c >= 0xF0 && c <= 0xF4)
+		{
+			count = 3;
+			if (c == 0xF0)
+				min = 0x90;
+			else if (c == 0xF4)
+				max = 0x8F;
+		}
+		else
+			return false;
+
+		if (end - p < count || *p < min || *p > max)
+			return false;
+
+		for (int i = 1; i < count; i++)
+		{
+			if ((p[i] & 0xC0) != 0x80)
+				return false;
+		}
+
+		p += count;
+	}
+
+	return true;
+}
+
+#endif
+
+// Appends the text, read as a single-byte code page.
+static void DecodeCodePage(const char * text, size_t length, const Uint16 * table, std::string * result)
+{
+	size_t offset = result->length();
+	if (length == 0)
+		return;
+
+	// no code page character takes more than 3 bytes
+	result->resize(offset + length * 3);
+	char * out = &(*result)[offset];
+
+	const char * p = text;
+	const char * end = text + length;
+
+	while (p < end)
+	{
+#if defined(TEXT_ENCODING_SSE2)
+		while (end - p >= 16)
+		{
+			__m128i block = _mm_loadu_si128((const __m128i *) p);
+			if (_mm_movemask_epi8(block) != 0)
+				break;
+
+			_mm_storeu_si128((__m128i *) out, block);
+			p += 16;
+			out += 16;
+		}
+
+		if (p == end)
+			break;
+#endif
+
+		Uint8 c = (Uint8) *p++;
+		if (c < 0x80)
+		{
+			*out++ = (char) c;
+			continue;
+		}
+
+		Uint16 codePoint = table[c - 0x80];
+		if (codePoint < 0x800)
+		{
+			*out++ = (char) (0xC0 | (codePoint >> 6));
+			*out++ = (char) (0x80 | (codePoint & 0x3F));
+		}
+		else
+		{
+			*out++ = (char) (0xE0 | (codePoint >> 12));
+			*out++ = (char) (0x80 | ((codePoint >> 6) & 0x3F));
+			*out++ = (char) (0x80 | (codePoint & 0x3F));
+		}
+	}
+
+	result->resize(out - result->data());
+}
+
+void DecodeStringUTF8(const char * text, size_t length, eEncoding encoding, std::string * result)
+{
+	// the ASCII is copied as it is whatever the encoding, so only the rest needs looking at
+	size_t ascii = ASCIIPrefix(text, length);
+	result->assign(text, ascii);
+
+	if (ascii == length)
+		return;
+
+	text += ascii;
+	length -= ascii;
+
+	switch (encoding)
+	{
+	case Encoding::CP1250:
+		DecodeCodePage(text, length, s_cp1250, result);
+		break;
+
+	case Encoding::CP1252:
+		DecodeCodePage(text, length, s_cp1252, result);
+		break;
+
+	default:
+		if (IsValidUTF8(text, length))
+			result->append(text, length);
+		else
+			DecodeCodePage(text, length, s_cp1252, result);
+		break;
+	}
+}
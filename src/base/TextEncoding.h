@@ -34,4 +34,19 @@
 
 #include <DefineImprovedEnum.h>
 
+// Returns true if the text is well-formed UTF-8: no stray continuation bytes,
+// truncated or overlong sequences, surrogates or code points above U+10FFFF.
+bool IsValidUTF8(const char * text, size_t length);
+
+// Replaces the result with the text converted to UTF-8. The result's buffer is
+// reused, so decoding many strings into the same one only allocates while it grows.
+// UTF8, Auto and Locale text that isn't valid UTF-8 is read as CP1252 instead,
+// so the result is always valid UTF-8. The text mustn't point into the result.
+void DecodeStringUTF8(const char * text, size_t length, eEncoding encoding, std::string * result);
+
+INLINE void DecodeStringUTF8(const std::string& text, eEncoding encoding, std::string * result)
+{
+	DecodeStringUTF8(text.data(), text.length(), encoding, result);
+}
+
 #endif
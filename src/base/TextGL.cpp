@@ -25,6 +25,7 @@
 #include "Font.h"
 #include "PathUtils.h"
 #include "Log.h"
+#include "Renderer.h"
 
 static size_t ActiveFont;
 static std::vector<GLFont> Fonts;
@@ -162,13 +163,13 @@ void glPrint(const char * format, ...)
 void glPrint(const std::string& text)
 {
 	GLFont& font = Fonts[ActiveFont];
-	glPushMatrix();
+	sRenderer.PushMatrix();
 		// Set font position
-		glTranslatef(font.X, font.Y + font.Font->GetAscender(), font.Z);
+		sRenderer.Translate(font.X, font.Y + font.Font->GetAscender(), font.Z);
 
 		// Draw string
 		font.Font->Print(text);
-	glPopMatrix();
+	sRenderer.PopMatrix();
 }
 
 // Reset settings for active font
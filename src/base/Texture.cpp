@@ -23,6 +23,9 @@
 #include "stdafx.h"
 #include "Texture.h"
 #include "Graphic.h"
+#include "Renderer.h"
+#include "Profiler.h"
+#include "QualityGovernor.h"
 
 void Texture::Draw()
 {
@@ -31,14 +34,14 @@ void Texture::Draw()
 			xt1, xt2, xt3, xt4,
 			yt1, yt2, yt3, yt4;
 
-	glColor4f(ColRGB.R * Int, ColRGB.G * Int, ColRGB.B * Int, Alpha);
-	glEnable(GL_TEXTURE_2D);
-	glEnable(GL_BLEND);
+	sRenderer.SetColor(ColRGB.R * Int, ColRGB.G * Int, ColRGB.B * Int, Alpha);
+	sRenderer.SetTexturing(true);
+	sRenderer.SetBlending(true);
 	glDepthRange(0, 10);
 	glDepthFunc(GL_LEQUAL);
-	glEnable(GL_DEPTH_TEST);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	glBindTexture(GL_TEXTURE_2D, TexNum);
+	sRenderer.SetDepthTest(true);
+	sRenderer.BindTexture(TexNum);
+	PROFILE_COUNT(pcTextureBinds);
 
 	x1 = X;
 	x2 = X;
@@ -71,53 +74,59 @@ void Texture::Draw()
 		y4 = (Y + H/2) + yt4 * cos(Rot) + xt4 * sin(Rot);
 	}
 
-	glBegin(GL_QUADS);
-		glTexCoord2f(TexX1*TexW, TexY1*TexH); glVertex3f(x1, y1, Z);
-		glTexCoord2f(TexX1*TexW, TexY2*TexH); glVertex3f(x2, y2, Z);
-		glTexCoord2f(TexX2*TexW, TexY2*TexH); glVertex3f(x3, y3, Z);
-		glTexCoord2f(TexX2*TexW, TexY1*TexH); glVertex3f(x4, y4, Z);
-	glEnd();
-
-	glDisable(GL_DEPTH_TEST); 
-	glDisable(GL_TEXTURE_2D);
-	glDisable(GL_BLEND);
+	RenderVertex vertices[4] =
+	{
+		sRenderer.MakeVertex(x1, y1, Z, TexX1*TexW, TexY1*TexH),
+		sRenderer.MakeVertex(x2, y2, Z, TexX1*TexW, TexY2*TexH),
+		sRenderer.MakeVertex(x3, y3, Z, TexX2*TexW, TexY2*TexH),
+		sRenderer.MakeVertex(x4, y4, Z, TexX2*TexW, TexY1*TexH)
+	};
+
+	sRenderer.DrawQuads(vertices, 4);
+	PROFILE_COUNT(pcDrawCalls);
+
+	sRenderer.SetDepthTest(false);
+	sRenderer.SetTexturing(false);
+	sRenderer.SetBlending(false);
 }
 
 void Texture::DrawReflection(float spacing)
 {
-	glEnable(GL_TEXTURE_2D);
-	glEnable(GL_BLEND);
+	// first thing to go on slow machines
+	if (!QualityGovernor::ReflectionsEnabled())
+		return;
+
+	sRenderer.SetTexturing(true);
+	sRenderer.SetBlending(true);
 
 	glDepthRange(0, 10);
 	glDepthFunc(GL_LEQUAL);
-	glEnable(GL_DEPTH_TEST);
-
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	glBindTexture(GL_TEXTURE_2D, TexNum);
-
-	glBegin(GL_QUADS);
-		// Top-left
-		glColorRGBInt(ColRGB, Alpha - 0.3f, Int);
-		glTexCoord2f(TexX1*TexW, TexY2*TexH);
-		glVertex3f(X, Y+H*ScaleH + spacing, Z);
-
-		// Bottom-left
-		glColorRGBInt(ColRGB, 0.0f, Int);
-		glTexCoord2f(TexX1*TexW, TexY1+TexH*0.5f);
-		glVertex3f(X, Y+H*ScaleH + H*ScaleH/2 + spacing, Z);
-
-		// Bottom-right
-		glColorRGBInt(ColRGB, 0.0f, Int);
-		glTexCoord2f(TexX2*TexW, TexY1+TexH*0.5f);
-		glVertex3f(X+W*ScaleW, Y+H*ScaleH + H*ScaleH/2 + spacing, Z);
-
-		// Top-right
-		glColorRGBInt(ColRGB, Alpha-0.3f, Int);
-		glTexCoord2f(TexX2*TexW, TexY2*TexH);
-		glVertex3f(X+W*ScaleW, Y+H*ScaleH + spacing, Z);
-	glEnd();
-
-	glDisable(GL_TEXTURE_2D);
-	glDisable(GL_DEPTH_TEST);
-	glDisable(GL_BLEND);
+	sRenderer.SetDepthTest(true);
+
+	sRenderer.BindTexture(TexNum);
+	PROFILE_COUNT(pcTextureBinds);
+
+	RenderVertex vertices[4];
+
+	// Top-left
+	glColorRGBInt(ColRGB, Alpha - 0.3f, Int);
+	vertices[0] = sRenderer.MakeVertex(X, Y+H*ScaleH + spacing, Z, TexX1*TexW, TexY2*TexH);
+
+	// Bottom-left
+	glColorRGBInt(ColRGB, 0.0f, Int);
+	vertices[1] = sRenderer.MakeVertex(X, Y+H*ScaleH + H*ScaleH/2 + spacing, Z, TexX1*TexW, TexY1+TexH*0.5f);
+
+	// Bottom-right
+	vertices[2] = sRenderer.MakeVertex(X+W*ScaleW, Y+H*ScaleH + H*ScaleH/2 + spacing, Z, TexX2*TexW, TexY1+TexH*0.5f);
+
+	// Top-right
+	glColorRGBInt(ColRGB, Alpha-0.3f, Int);
+	vertices[3] = sRenderer.MakeVertex(X+W*ScaleW, Y+H*ScaleH + spacing, Z, TexX2*TexW, TexY2*TexH);
+
+	sRenderer.DrawQuads(vertices, 4);
+	PROFILE_COUNT(pcDrawCalls);
+
+	sRenderer.SetTexturing(false);
+	sRenderer.SetDepthTest(false);
+	sRenderer.SetBlending(false);
 }
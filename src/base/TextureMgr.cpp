@@ -24,6 +24,9 @@
 #include "Log.h"
 #include "TextureMgr.h"
 #include "Graphic.h"
+#include "Profiler.h"
+#include "Tracer.h"
+#include "FlightRecorder.h"
 
 initialiseSingleton(TextureMgr);
 
@@ -55,10 +58,11 @@ Texture TextureMgr::CreateTexture(
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
 #if defined(BIG_ENDIAN)
-	glTexImage2D(GL_TEXTURE_2D, 0, 3, width, height, 0, GL_BGR, GL_UNSIGNED_BYTE, data);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_BGR, GL_UNSIGNED_BYTE, data);
 #else
-	glTexImage2D(GL_TEXTURE_2D, 0, 3, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
 #endif
+	PROFILE_COUNT(pcTextureUploads);
 
 	tex.TexNum = ActTex;
 	tex.Name = texturePath->generic_string();
@@ -142,6 +146,8 @@ Texture TextureMgr::LoadTexture(
 		|| texturePath->empty())
 		return tex;
 
+	TRACE_SCOPE_DETAIL("LoadTexture", texturePath->filename().generic_string().c_str());
+
 	SDL_Surface * texSurface = LoadSurfaceFromFile(*texturePath);
 	if (texSurface == NULL)
 	{
@@ -202,19 +208,20 @@ Texture TextureMgr::LoadTexture(
 		|| textureType == TextureType::Colorized)
 	{
 #if defined(BIG_ENDIAN)
-		glTexImage2D(GL_TEXTURE_2D, 0, 4, newWidth, newHeight, 0, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8_REV, texSurface->pixels);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, newWidth, newHeight, 0, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8_REV, texSurface->pixels);
 #else
-		glTexImage2D(GL_TEXTURE_2D, 0, 4, newWidth, newHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, texSurface->pixels);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, newWidth, newHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, texSurface->pixels);
 #endif
 	}
 	else
 	{
 #if defined(BIG_ENDIAN)
-		glTexImage2D(GL_TEXTURE_2D, 0, 3, newWidth, newHeight, 0, GL_BGR, GL_UNSIGNED_BYTE, texSurface->pixels);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, newWidth, newHeight, 0, GL_BGR, GL_UNSIGNED_BYTE, texSurface->pixels);
 #else
-		glTexImage2D(GL_TEXTURE_2D, 0, 3, newWidth, newHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, texSurface->pixels);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, newWidth, newHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, texSurface->pixels);
 #endif
 	}
+	PROFILE_COUNT(pcTextureUploads);
 
 	// Setup texture
 	tex.W = (float) oldWidth;
@@ -225,6 +232,8 @@ Texture TextureMgr::LoadTexture(
 	tex.Name = texturePath->generic_string();
 	tex.Alpha = 1.0f;
 
+	FlightRecorder::Record(fetTextureLoad, "%s (%dx%d)", tex.Name.c_str(), newWidth, newHeight);
+
 	UnloadSurface(texSurface);
 	return tex;
 }
@@ -261,6 +270,8 @@ void TextureMgr::UnloadTexture(
 	Texture& tex = (fromCache ? entry.TexCache : entry.Tex);
 	glDeleteTextures(1, (const GLuint *)&tex.TexNum);
 	tex.TexNum = 0;
+
+	FlightRecorder::Record(fetTextureUnload, "%s", lookupTex.Name.c_str());
 }
 
 TextureMgr::~TextureMgr()
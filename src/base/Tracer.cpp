@@ -0,0 +1,233 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "stdafx.h"
+#include <time.h>
+
+#include "Tracer.h"
+#include "Log.h"
+#include "PathUtils.h"
+
+initialiseSingleton(Tracer);
+
+bool Tracer::_enabled = false;
+
+// the calling thread's buffer, created on its first event
+static TRACE_THREAD_LOCAL TraceBuffer * ThreadBuffer = NULL;
+
+Tracer::Tracer()
+	: _start(SDL_GetPerformanceCounter()), _frequency(SDL_GetPerformanceFrequency())
+{
+	_enabled = true;
+	SetThreadName("Main");
+}
+
+TraceBuffer * Tracer::GetBuffer()
+{
+	if (ThreadBuffer != NULL)
+		return ThreadBuffer;
+
+	TraceBuffer * buffer = new TraceBuffer();
+	buffer->Open = 0;
+	buffer->DroppedOpen = 0;
+	buffer->Dropped = 0;
+	buffer->Events.reserve(4096);
+
+	{
+		std::lock_guard<std::mutex> lock(_buffersLock);
+		buffer->ThreadId = (Uint32) _buffers.size() + 1;
+		_buffers.push_back(buffer);
+	}
+
+	char name[32];
+	snprintf(name, sizeof(name), "Thread %u", buffer->ThreadId);
+	buffer->ThreadName = name;
+
+	ThreadBuffer = buffer;
+	return buffer;
+}
+
+void Tracer::Begin(const char * name, const char * detail /*= NULL*/)
+{
+	TraceBuffer * buffer = GetBuffer();
+	std::lock_guard<std::mutex> lock(buffer->Lock);
+
+	// A begin is only recorded with room left for its end and those of the
+	// begins still open, so the exported slices are always terminated.
+	if (buffer->Events.size() + buffer->Open + 2 > TRACE_MAX_EVENTS)
+	{
+		buffer->DroppedOpen++;
+		buffer->Dropped++;
+		return;
+	}
+
+	buffer->Open++;
+
+	TraceEvent event;
+	event.Name = name;
+	event.Time = SDL_GetPerformanceCounter();
+	event.Phase = 'B';
+
+	if (detail != NULL)
+	{
+		strncpy(event.Detail, detail, TRACE_DETAIL_SIZE - 1);
+		event.Detail[TRACE_DETAIL_SIZE - 1] = '\0';
+	}
+	else
+	{
+		event.Detail[0] = '\0';
+	}
+
+	buffer->Events.push_back(event);
+}
+
+void Tracer::End()
+{
+	TraceBuffer * buffer = GetBuffer();
+	std::lock_guard<std::mutex> lock(buffer->Lock);
+
+	// Scopes end in reverse order, and once a begin was dropped every later one is
+	// too (recording an end never frees room), so the innermost open begin is dropped first.
+	if (buffer->DroppedOpen > 0)
+	{
+		buffer->DroppedOpen--;
+		buffer->Dropped++;
+		return;
+	}
+
+	// a scope that began before tracing started
+	if (buffer->Open == 0)
+		return;
+
+	buffer->Open--;
+
+	TraceEvent event;
+	event.Name = NULL;
+	event.Time = SDL_GetPerformanceCounter();
+	event.Phase = 'E';
+	event.Detail[0] = '\0';
+
+	buffer->Events.push_back(event);
+}
+
+void Tracer::SetThreadName(const char * name)
+{
+	TraceBuffer * buffer = GetBuffer();
+	std::lock_guard<std::mutex> lock(buffer->Lock);
+	buffer->ThreadName = name;
+}
+
+// Writes a JSON string (without quotes).
+static void WriteJsonString(FILE * fp, const char * string)
+{
+	for (const char * p = string; *p != '\0'; p++)
+	{
+		if (*p == '"' || *p == '\\')
+			fprintf(fp, "\\%c", *p);
+		else if ((unsigned char) *p < 0x20)
+			fprintf(fp, "\\u%04x", (unsigned char) *p);
+		else
+			fputc(*p, fp);
+	}
+}
+
+bool Tracer::Export()
+{
+	time_t unixTime = time(NULL);
+	tm localTime = *localtime(&unixTime);
+	char filename[64];
+
+	snprintf(filename, sizeof(filename), "trace_%04u%02u%02u_%02u%02u%02u.json",
+		1900 + localTime.tm_year, localTime.tm_mon + 1, localTime.tm_mday,
+		localTime.tm_hour, localTime.tm_min, localTime.tm_sec);
+
+	path tracePath = LogPath / filename;
+	FILE * fp = fopen(tracePath.generic_string().c_str(), "w");
+	if (fp == NULL)
+	{
+		sLog.Error("Tracer::Export", "Failed to open %s for writing.", tracePath.generic_string().c_str());
+		return false;
+	}
+
+	std::lock_guard<std::mutex> buffersLock(_buffersLock);
+	Uint32 eventCount = 0, dropped = 0;
+	bool first = true;
+
+	fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+	for (size_t i = 0; i < _buffers.size(); i++)
+	{
+		TraceBuffer * buffer = _buffers[i];
+		std::lock_guard<std::mutex> lock(buffer->Lock);
+
+		fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"",
+			first ? "" : ",\n", buffer->ThreadId);
+		WriteJsonString(fp, buffer->ThreadName.c_str());
+		fprintf(fp, "\"}}");
+		first = false;
+
+		for (size_t e = 0; e < buffer->Events.size(); e++)
+		{
+			const TraceEvent& event = buffer->Events[e];
+			double us = (event.Time - _start) * 1000000.0 / _frequency;
+
+			fprintf(fp, ",\n{\"ph\":\"%c\",\"pid\":1,\"tid\":%u,\"ts\":%.3f",
+				event.Phase, buffer->ThreadId, us);
+
+			if (event.Phase == 'B')
+			{
+				fprintf(fp, ",\"name\":\"");
+				WriteJsonString(fp, event.Name);
+				if (event.Detail[0] != '\0')
+				{
+					fprintf(fp, ": ");
+					WriteJsonString(fp, event.Detail);
+				}
+				fprintf(fp, "\"");
+			}
+
+			fprintf(fp, "}");
+		}
+
+		eventCount += (Uint32) buffer->Events.size();
+		dropped += buffer->Dropped;
+	}
+
+	fprintf(fp, "\n]}\n");
+	fclose(fp);
+
+	sLog.Status("Tracer", "Wrote %u events from %u threads to %s (%u dropped)",
+		eventCount, (Uint32) _buffers.size(), tracePath.generic_string().c_str(), dropped);
+	return true;
+}
+
+Tracer::~Tracer()
+{
+	_enabled = false;
+
+	// Tracing isn't restarted, so the other threads' (now dangling) buffer pointers are never used again.
+	for (size_t i = 0; i < _buffers.size(); i++)
+		delete _buffers[i];
+
+	_buffers.clear();
+	ThreadBuffer = NULL;
+}
@@ -0,0 +1,126 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _TRACER_H
+#define _TRACER_H
+#pragma once
+
+#include <mutex>
+
+// events recorded per thread before that thread's recording stops
+#define TRACE_MAX_EVENTS	(256 * 1024)
+
+// room for the dynamic part of an event name (file name, startup step...)
+#define TRACE_DETAIL_SIZE	48
+
+#if defined(_MSC_VER)
+#	define TRACE_THREAD_LOCAL __declspec(thread)
+#else
+#	define TRACE_THREAD_LOCAL __thread
+#endif
+
+struct TraceEvent
+{
+	const char *	Name;	// must be a string literal, it's only dereferenced on export
+	Uint64			Time;	// performance counter
+	char			Phase;	// 'B'egin or 'E'nd
+	char			Detail[TRACE_DETAIL_SIZE];
+};
+
+// A thread's events; only its own thread appends, Export() reads under the lock.
+struct TraceBuffer
+{
+	Uint32					ThreadId;
+	std::string				ThreadName;
+	std::vector<TraceEvent>	Events;
+	Uint32					Open;			// recorded begins still waiting for their end
+	Uint32					DroppedOpen;	// dropped begins still waiting for their end
+	Uint32					Dropped;
+	std::mutex				Lock;
+};
+
+/**
+ * Records begin/end events per thread and writes them as Chrome trace-event
+ * JSON (load it in chrome://tracing or Perfetto).
+ *
+ * Only exists when started with --trace; TRACE_SCOPE costs one branch otherwise.
+ */
+class Tracer : public Singleton<Tracer>
+{
+public:
+	Tracer();
+
+	INLINE static bool IsEnabled() { return _enabled; }
+
+	void Begin(const char * name, const char * detail = NULL);
+	void End();
+
+	// Names the calling thread in the exported trace.
+	void SetThreadName(const char * name);
+
+	// Writes everything recorded so far to LogPath.
+	bool Export();
+
+	~Tracer();
+
+private:
+	TraceBuffer * GetBuffer();
+
+	static bool _enabled;
+
+	Uint64						_start;
+	Uint64						_frequency;
+
+	std::mutex					_buffersLock;
+	std::vector<TraceBuffer *>	_buffers;
+};
+
+#define sTracer (Tracer::getSingleton())
+
+class TraceScope
+{
+public:
+	INLINE TraceScope(const char * name, const char * detail = NULL)
+	{
+		if (Tracer::IsEnabled())
+			sTracer.Begin(name, detail);
+	}
+
+	INLINE ~TraceScope()
+	{
+		if (Tracer::IsEnabled())
+			sTracer.End();
+	}
+};
+
+#define TRACE_CONCAT_INNER(a, b)	a ## b
+#define TRACE_CONCAT(a, b)			TRACE_CONCAT_INNER(a, b)
+
+#define TRACE_SCOPE(name)					TraceScope TRACE_CONCAT(_traceScope, __LINE__)(name)
+// `detail` is only evaluated while tracing
+#define TRACE_SCOPE_DETAIL(name, detail)	TraceScope TRACE_CONCAT(_traceScope, __LINE__)(name, Tracer::IsEnabled() ? (detail) : NULL)
+
+// Names the calling thread, if tracing.
+#define TRACE_THREAD_NAME(name) \
+	do { if (Tracer::IsEnabled()) sTracer.SetThreadName(name); } while (0)
+
+#endif
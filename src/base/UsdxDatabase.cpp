@@ -1,6 +1,7 @@
 #include "stdafx.h"
 #include "UsdxDatabase.h"
 #include "Log.h"
+#include "SongIndex.h"
 #include <sqlite/sqlite3.h>
 
 /*
@@ -12,6 +13,9 @@ const int cDBVersion = 01; // 0.1
 static const char cUS_Scores[] = "us_scores";
 static const char cUS_Songs[] = "us_songs";
 static const char * cUS_Statistics_Info = "us_statistics_info";
+static const char cUS_SongIndex[] = "us_song_index";
+static const char cUS_SongFolders[] = "us_song_folders";
+static const char cUS_SongIndexInfo[] = "us_song_index_info";
 
 void UsdxDatabase::Initialize()
 {
@@ -95,6 +99,226 @@ void UsdxDatabase::Initialize()
 		if (TableExists("us_scores_101"))
 			ConvertFrom101To110();
 	}
+
+	InitializeSongIndex();
+}
+
+void UsdxDatabase::InitializeSongIndex()
+{
+	Sint32 version = 0;
+	if (TableExists(cUS_SongIndexInfo))
+	{
+		try
+		{
+			version = GetTableValue<Sint32>("SELECT [Version] FROM [%s];", cUS_SongIndexInfo);
+		}
+		catch (const Sqlite3NoRowsException&)
+		{
+		}
+	}
+
+	if (version == SONG_INDEX_VERSION)
+		return;
+
+	// The index is only a cache of the song files, so just start over.
+	if (version != 0)
+		sLog.Info("Database::Init", "Outdated song index found - rebuilding it");
+
+	FormattedExec("DROP TABLE IF EXISTS [%s];", cUS_SongIndex);
+	FormattedExec("DROP TABLE IF EXISTS [%s];", cUS_SongFolders);
+	FormattedExec("DROP TABLE IF EXISTS [%s];", cUS_SongIndexInfo);
+
+	FormattedExec(
+		"CREATE TABLE [%s] ("
+		"[Path] TEXT PRIMARY KEY, "
+		"[Parent] TEXT NOT NULL, "
+		"[MTime] INTEGER NOT NULL"
+		");", cUS_SongFolders);
+
+	FormattedExec(
+		"CREATE TABLE [%s] ("
+		"[Folder] TEXT NOT NULL, "
+		"[File] TEXT NOT NULL, "
+		"[Size] INTEGER NOT NULL, "
+		"[MTime] INTEGER NOT NULL, "
+		"[Valid] INTEGER NOT NULL, "
+		"[Title] TEXT, [Artist] TEXT, [Genre] TEXT, [Edition] TEXT, [Language] TEXT, [Creator] TEXT, "
+		"[Year] INTEGER, "
+		"[Mp3] TEXT, [Cover] TEXT, [Background] TEXT, [Video] TEXT, "
+		"[BPM] REAL, [Gap] REAL, [VideoGap] REAL, [Start] REAL, [Finish] INTEGER, [PreviewStart] REAL, "
+		"[Relative] INTEGER, [Resolution] INTEGER, [NotesGap] INTEGER, [Encoding] TEXT, "
+		"[MedleyStartBeat] INTEGER, [MedleyEndBeat] INTEGER, [DuetSingerP1] TEXT, [DuetSingerP2] TEXT, "
+		"PRIMARY KEY ([Folder], [File])"
+		");", cUS_SongIndex);
+
+	FormattedExec("CREATE TABLE [%s] ([Version] INTEGER);", cUS_SongIndexInfo);
+	FormattedExec("INSERT INTO [%s] ([Version]) VALUES(%d);", cUS_SongIndexInfo, SONG_INDEX_VERSION);
+}
+
+void UsdxDatabase::LoadSongIndex(SongIndex * index)
+{
+	char sql[512];
+
+	snprintf(sql, sizeof(sql), "SELECT [Path], [Parent], [MTime] FROM [%s];", cUS_SongFolders);
+	Sqlite3Statement folders(*this, sql);
+	while (folders.Step())
+		index->AddFolder(folders.GetString(0), folders.GetString(1), (time_t) folders.GetInt64(2));
+
+	snprintf(sql, sizeof(sql),
+		"SELECT [Folder], [File], [Size], [MTime], [Valid], "
+		"[Title], [Artist], [Genre], [Edition], [Language], [Creator], [Year], "
+		"[Mp3], [Cover], [Background], [Video], "
+		"[BPM], [Gap], [VideoGap], [Start], [Finish], [PreviewStart], "
+		"[Relative], [Resolution], [NotesGap], [Encoding], "
+		"[MedleyStartBeat], [MedleyEndBeat], [DuetSingerP1], [DuetSingerP2] "
+		"FROM [%s];", cUS_SongIndex);
+
+	Sqlite3Statement files(*this, sql);
+	while (files.Step())
+	{
+		std::string folder = files.GetString(0);
+		std::string name = files.GetString(1);
+		Song * song = NULL;
+
+		if (files.GetInt(4) != 0)
+		{
+			song = new Song();
+			song->Path = folder;
+			song->FileName = song->Path / name;
+			song->FileSize = (Uint64) files.GetInt64(2);
+			song->LastModified = (time_t) files.GetInt64(3);
+			song->Title = files.GetString(5);
+			song->Artist = files.GetString(6);
+			song->Genre = files.GetString(7);
+			song->Edition = files.GetString(8);
+			song->Language = files.GetString(9);
+			song->Creator = files.GetString(10);
+			song->Year = files.GetInt(11);
+			song->Mp3 = files.GetString(12);
+			song->Cover = files.GetString(13);
+			song->Background = files.GetString(14);
+			song->Video = files.GetString(15);
+			song->BPM = (float) files.GetDouble(16);
+			song->Gap = (float) files.GetDouble(17);
+			song->VideoGap = (float) files.GetDouble(18);
+			song->Start = (float) files.GetDouble(19);
+			song->Finish = files.GetInt(20);
+			song->PreviewStart = (float) files.GetDouble(21);
+			song->Relative = (files.GetInt(22) != 0);
+			song->Resolution = files.GetInt(23);
+			song->NotesGap = files.GetInt(24);
+			song->FileEncoding = Encoding::String2Enum(files.GetString(25), Encoding::Auto);
+			song->MedleyStartBeat = files.GetInt(26);
+			song->MedleyEndBeat = files.GetInt(27);
+			song->DuetSingerP1 = files.GetString(28);
+			song->DuetSingerP2 = files.GetString(29);
+		}
+
+		index->AddFile(folder, name, (Uint64) files.GetInt64(2), (time_t) files.GetInt64(3), song);
+	}
+}
+
+void UsdxDatabase::WriteSongIndex(const std::vector<SongIndexUpdate *>& updates, const std::vector<std::string>& removedFolders)
+{
+	char sql[512];
+
+	// files without a usable header are stored too, so they aren't read again
+	const Song invalid;
+
+	Exec("BEGIN TRANSACTION;");
+
+	try
+	{
+		snprintf(sql, sizeof(sql), "DELETE FROM [%s] WHERE [Folder] = ?;", cUS_SongIndex);
+		Sqlite3Statement deleteFiles(*this, sql);
+
+		// removed folders take their subfolders with them
+		snprintf(sql, sizeof(sql), "DELETE FROM [%s] WHERE [Folder] = ?1 OR substr([Folder], 1, length(?1) + 1) = ?1 || '/';", cUS_SongIndex);
+		Sqlite3Statement removeFiles(*this, sql);
+
+		snprintf(sql, sizeof(sql), "DELETE FROM [%s] WHERE [Path] = ?1 OR substr([Path], 1, length(?1) + 1) = ?1 || '/';", cUS_SongFolders);
+		Sqlite3Statement removeFolders(*this, sql);
+
+		snprintf(sql, sizeof(sql), "INSERT OR REPLACE INTO [%s] ([Path], [Parent], [MTime]) VALUES(?, ?, ?);", cUS_SongFolders);
+		Sqlite3Statement insertFolder(*this, sql);
+
+		snprintf(sql, sizeof(sql),
+			"INSERT OR REPLACE INTO [%s] VALUES("
+			"?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?);", cUS_SongIndex);
+		Sqlite3Statement insertFile(*this, sql);
+
+		for (size_t i = 0; i < removedFolders.size(); i++)
+		{
+			removeFiles.Bind(1, removedFolders[i]);
+			removeFiles.Step();
+			removeFiles.Reset();
+
+			removeFolders.Bind(1, removedFolders[i]);
+			removeFolders.Step();
+			removeFolders.Reset();
+		}
+
+		for (size_t i = 0; i < updates.size(); i++)
+		{
+			const SongIndexUpdate * update = updates[i];
+
+			deleteFiles.Bind(1, update->Folder);
+			deleteFiles.Step();
+			deleteFiles.Reset();
+
+			insertFolder.Bind(1, update->Folder);
+			insertFolder.Bind(2, update->Parent);
+			insertFolder.Bind(3, (Sint64) update->MTime);
+			insertFolder.Step();
+			insertFolder.Reset();
+
+			for (SongIndexFileMap::const_iterator itr = update->Files.begin(); itr != update->Files.end(); ++itr)
+			{
+				const SongIndexFile& file = itr->second;
+				const Song * song = (file.Header != NULL ? file.Header : &invalid);
+
+				insertFile.Bind(1, update->Folder);
+				insertFile.Bind(2, itr->first);
+				insertFile.Bind(3, (Sint64) file.Size);
+				insertFile.Bind(4, (Sint64) file.MTime);
+				insertFile.Bind(5, file.Header != NULL ? 1 : 0);
+				insertFile.Bind(6, song->Title);
+				insertFile.Bind(7, song->Artist);
+				insertFile.Bind(8, song->Genre);
+				insertFile.Bind(9, song->Edition);
+				insertFile.Bind(10, song->Language);
+				insertFile.Bind(11, song->Creator);
+				insertFile.Bind(12, song->Year);
+				insertFile.Bind(13, song->Mp3);
+				insertFile.Bind(14, song->Cover);
+				insertFile.Bind(15, song->Background);
+				insertFile.Bind(16, song->Video);
+				insertFile.Bind(17, (double) song->BPM);
+				insertFile.Bind(18, (double) song->Gap);
+				insertFile.Bind(19, (double) song->VideoGap);
+				insertFile.Bind(20, (double) song->Start);
+				insertFile.Bind(21, song->Finish);
+				insertFile.Bind(22, (double) song->PreviewStart);
+				insertFile.Bind(23, song->Relative ? 1 : 0);
+				insertFile.Bind(24, song->Resolution);
+				insertFile.Bind(25, song->NotesGap);
+				insertFile.Bind(26, Enum2String(song->FileEncoding));
+				insertFile.Bind(27, song->MedleyStartBeat);
+				insertFile.Bind(28, song->MedleyEndBeat);
+				insertFile.Bind(29, song->DuetSingerP1);
+				insertFile.Bind(30, song->DuetSingerP2);
+				insertFile.Step();
+				insertFile.Reset();
+			}
+		}
+	}
+	catch (const Sqlite3Exception&)
+	{
+		Exec("ROLLBACK;");
+		throw;
+	}
+
+	Exec("COMMIT;");
 }
 
 void UsdxDatabase::ConvertFrom101To110()
@@ -4,11 +4,20 @@
 
 #include "Sqlite3Database.h"
 
+class SongIndex;
+struct SongIndexUpdate;
+
 class UsdxDatabase : public Sqlite3Database
 {
 public:
 	void Initialize();
 	void ConvertFrom101To110();
+
+	void LoadSongIndex(SongIndex * index);
+	void WriteSongIndex(const std::vector<SongIndexUpdate *>& updates, const std::vector<std::string>& removedFolders);
+
+protected:
+	void InitializeSongIndex();
 };
 
 #endif
@@ -21,3 +21,592 @@
  */
 
 #include "stdafx.h"
+#include "XMLSong.h"
+#include "Song.h"
+#include "Log.h"
+
+static INLINE bool IsXMLSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static const char * FindString(const char * start, const char * end, const char * str, size_t length)
+{
+	while (end - start >= (ptrdiff_t) length)
+	{
+		start = (const char *) memchr(start, str[0], end - start - length + 1);
+		if (start == NULL)
+			return NULL;
+
+		if (memcmp(start, str, length) == 0)
+			return start;
+
+		start++;
+	}
+
+	return NULL;
+}
+
+static INLINE bool StartsWith(const char * start, const char * end, const char * str, size_t length)
+{
+	return end - start >= (ptrdiff_t) length && memcmp(start, str, length) == 0;
+}
+
+XMLReader::XMLReader(const char * data, size_t size)
+	: _start(data), _pos(data), _end(data + size),
+	_attributes(NULL), _attributesEnd(NULL), _pendingEnd(false)
+{
+	// UTF-8 BOM
+	if (StartsWith(_pos, _end, "\xEF\xBB\xBF", 3))
+		_pos += 3;
+}
+
+XMLToken XMLReader::Next()
+{
+	_attributes = _attributesEnd = NULL;
+
+	if (_pendingEnd)
+	{
+		_pendingEnd = false;
+		return xtEndElement;
+	}
+
+	while (_pos < _end)
+	{
+		if (*_pos != '<')
+		{
+			const char * textEnd = (const char *) memchr(_pos, '<', _end - _pos);
+			if (textEnd == NULL)
+				textEnd = _end;
+
+			_text = StringRef(_pos, textEnd - _pos);
+			_pos = textEnd;
+
+			// the whitespace between elements
+			if (!_text.Trim().Empty())
+				return xtText;
+
+			continue;
+		}
+
+		if (StartsWith(_pos, _end, "<!--", 4))
+		{
+			const char * commentEnd = FindString(_pos + 4, _end, "-->", 3);
+			if (commentEnd == NULL)
+				return Fail();
+
+			_text = StringRef(_pos + 4, commentEnd - _pos - 4);
+			_text.Trim();
+			_pos = commentEnd + 3;
+			return xtComment;
+		}
+
+		if (StartsWith(_pos, _end, "<![CDATA[", 9))
+		{
+			const char * cdataEnd = FindString(_pos + 9, _end, "]]>", 3);
+			if (cdataEnd == NULL)
+				return Fail();
+
+			_text = StringRef(_pos + 9, cdataEnd - _pos - 9);
+			_pos = cdataEnd + 3;
+			return xtText;
+		}
+
+		// <!DOCTYPE ...>, without an internal subset
+		if (StartsWith(_pos, _end, "<!", 2))
+		{
+			const char * declarationEnd = (const char *) memchr(_pos, '>', _end - _pos);
+			if (declarationEnd == NULL)
+				return Fail();
+
+			_pos = declarationEnd + 1;
+			continue;
+		}
+
+		// Processing instructions; only the XML declaration is of interest.
+		if (StartsWith(_pos, _end, "<?", 2))
+		{
+			const char * instructionEnd = FindString(_pos + 2, _end, "?>", 2);
+			if (instructionEnd == NULL)
+				return Fail();
+
+			const char * nameEnd = _pos + 2;
+			while (nameEnd < instructionEnd && !IsXMLSpace(*nameEnd))
+				nameEnd++;
+
+			_name = StringRef(_pos + 2, nameEnd - _pos - 2);
+			_pos = instructionEnd + 2;
+
+			if (_name.EqualsI("xml"))
+			{
+				_attributes = nameEnd;
+				_attributesEnd = instructionEnd;
+				return xtDeclaration;
+			}
+
+			continue;
+		}
+
+		bool endTag = StartsWith(_pos, _end, "</", 2);
+		const char * nameStart = _pos + (endTag ? 2 : 1);
+		const char * nameEnd = nameStart;
+
+		while (nameEnd < _end && !IsXMLSpace(*nameEnd) && *nameEnd != '/' && *nameEnd != '>')
+			nameEnd++;
+
+		if (nameEnd == nameStart)
+			return Fail();
+
+		// The tag ends at the first '>' outside of quotes.
+		const char * tagEnd = nameEnd;
+		char quote = '\0';
+		for (; tagEnd < _end; tagEnd++)
+		{
+			if (quote != '\0')
+			{
+				if (*tagEnd == quote)
+					quote = '\0';
+			}
+			else if (*tagEnd == '"' || *tagEnd == '\'')
+			{
+				quote = *tagEnd;
+			}
+			else if (*tagEnd == '>')
+			{
+				break;
+			}
+		}
+
+		if (tagEnd == _end)
+			return Fail();
+
+		// ss:MELODY is just MELODY
+		const char * colon = (const char *) memchr(nameStart, ':', nameEnd - nameStart);
+		if (colon != NULL)
+			nameStart = colon + 1;
+
+		_name = StringRef(nameStart, nameEnd - nameStart);
+		_pos = tagEnd + 1;
+
+		if (endTag)
+			return xtEndElement;
+
+		_pendingEnd = (tagEnd[-1] == '/');
+		_attributes = nameEnd;
+		_attributesEnd = (_pendingEnd ? tagEnd - 1 : tagEnd);
+		return xtStartElement;
+	}
+
+	return xtEnd;
+}
+
+bool XMLReader::NextAttribute(StringRef * name, StringRef * value)
+{
+	const char * p = _attributes;
+	const char * end = _attributesEnd;
+
+	while (p < end && IsXMLSpace(*p))
+		p++;
+
+	if (p >= end)
+		return false;
+
+	const char * nameStart = p;
+	while (p < end && *p != '=' && !IsXMLSpace(*p))
+		p++;
+
+	*name = StringRef(nameStart, p - nameStart);
+
+	while (p < end && IsXMLSpace(*p))
+		p++;
+
+	if (p >= end || *p != '=')
+		return false;
+
+	p++;
+	while (p < end && IsXMLSpace(*p))
+		p++;
+
+	if (p >= end || (*p != '"' && *p != '\''))
+		return false;
+
+	const char * valueEnd = (const char *) memchr(p + 1, *p, end - p - 1);
+	if (valueEnd == NULL)
+		return false;
+
+	*value = StringRef(p + 1, valueEnd - p - 1);
+	_attributes = valueEnd + 1;
+	return true;
+}
+
+Uint32 XMLReader::GetLineNumber() const
+{
+	return 1 + (Uint32) std::count(_start, _pos, '\n');
+}
+
+XMLToken XMLReader::Fail()
+{
+	_pos = _end;
+	return xtError;
+}
+
+void XMLReader::Decode(const StringRef& value, std::string * result)
+{
+	const char * p = value.Data;
+	const char * end = value.Data + value.Length;
+
+	while (p < end)
+	{
+		const char * amp = (const char *) memchr(p, '&', end - p);
+		if (amp == NULL)
+		{
+			result->append(p, end - p);
+			return;
+		}
+
+		result->append(p, amp - p);
+
+		const char * semicolon = (const char *) memchr(amp, ';', end - amp);
+		if (semicolon == NULL)
+		{
+			result->append(amp, end - amp);
+			return;
+		}
+
+		StringRef entity(amp + 1, semicolon - amp - 1);
+		if (entity.EqualsI("amp"))
+			result->push_back('&');
+		else if (entity.EqualsI("lt"))
+			result->push_back('<');
+		else if (entity.EqualsI("gt"))
+			result->push_back('>');
+		else if (entity.EqualsI("quot"))
+			result->push_back('"');
+		else if (entity.EqualsI("apos"))
+			result->push_back('\'');
+		else if (entity.Length > 1 && entity.Data[0] == '#')
+		{
+			bool hex = (entity.Data[1] == 'x' || entity.Data[1] == 'X');
+			Uint32 c = (Uint32) strtoul(entity.Data + (hex ? 2 : 1), NULL, hex ? 16 : 10);
+
+			// as UTF-8, which is what song XML files are in
+			if (c < 0x80)
+			{
+				result->push_back((char) c);
+			}
+			else if (c < 0x800)
+			{
+				result->push_back((char) (0xC0 | (c >> 6)));
+				result->push_back((char) (0x80 | (c & 0x3F)));
+			}
+			else if (c < 0x10000)
+			{
+				result->push_back((char) (0xE0 | (c >> 12)));
+				result->push_back((char) (0x80 | ((c >> 6) & 0x3F)));
+				result->push_back((char) (0x80 | (c & 0x3F)));
+			}
+			else
+			{
+				result->push_back((char) (0xF0 | (c >> 18)));
+				result->push_back((char) (0x80 | ((c >> 12) & 0x3F)));
+				result->push_back((char) (0x80 | ((c >> 6) & 0x3F)));
+				result->push_back((char) (0x80 | (c & 0x3F)));
+			}
+		}
+		else
+		{
+			// not one we know, so leave it as it is
+			result->append(amp, semicolon + 1 - amp);
+		}
+
+		p = semicolon + 1;
+	}
+}
+
+static int ParseXMLInt(const StringRef& value)
+{
+	char number[16];
+	size_t length = std::min(value.Length, sizeof(number) - 1);
+
+	memcpy(number, value.Data, length);
+	number[length] = '\0';
+	return atoi(number);
+}
+
+// Values with entities are decoded into buffer, the rest are used as they are.
+static StringRef DecodeXMLAttribute(const StringRef& value, std::string * buffer)
+{
+	if (memchr(value.Data, '&', value.Length) == NULL)
+		return value;
+
+	buffer->clear();
+	XMLReader::Decode(value, buffer);
+	return StringRef(buffer->data(), buffer->length());
+}
+
+static INLINE bool IsXMLYes(const StringRef& value)
+{
+	return value.EqualsI("yes") || value.EqualsI("true");
+}
+
+/**
+ * SingStar-style songs:
+ *
+ *   <MELODY Tempo="120" Resolution="Semiquaver" Genre="Pop" Year="1999">
+ *     <SENTENCE Singer="Solo 1">
+ *       <NOTE MidiNote="60" Duration="2" Lyric="Hel-" Bonus="Yes" />
+ *       <NOTE MidiNote="0" Duration="4" Lyric="" />
+ *
+ * MidiNote 0 is a rest. Durations count in the resolution's notes: sixteenths
+ * for a Semiquaver, thirty-seconds for a Demisemiquaver. A lyric ending in
+ * '-' continues its word on the next note. Duets either name the singer of
+ * every sentence (Solo 1, Solo 2 or Group) or have a TRACK element per singer.
+ *
+ * Anything else the .txt header has can be given by comments such as
+ * <!-- Title: ... -->, and the audio defaults to the file's name with ".mp3".
+ */
+bool Song::ParseXML(const char * data, size_t size, bool notes)
+{
+	XMLReader reader(data, size);
+	const std::string filename = FileName.generic_string();
+
+	// XML is UTF-8 unless its declaration says otherwise
+	if (!notes)
+		FileEncoding = Encoding::UTF8;
+
+	float tempo = 0.0f;
+	int beat = 0;
+	int trackCount = 0;
+	size_t firstTrack = 0, lastTrack = 0;
+	bool wordEnded = false;
+	bool headerDone = false;
+	std::string lyric;
+	std::string attribute;
+
+	if (notes)
+		Tracks.resize(1);
+
+	XMLToken token;
+	while (!headerDone && (token = reader.Next()) != xtEnd)
+	{
+		StringRef name, value;
+
+		switch (token)
+		{
+		case xtError:
+			sLog.Warn("Song::ParseXML", "%s (%u): malformed XML.", filename.c_str(), reader.GetLineNumber());
+			if (notes)
+				UnloadNotes();
+			return false;
+
+		case xtDeclaration:
+			while (reader.NextAttribute(&name, &value))
+			{
+				if (!notes && name.EqualsI("encoding"))
+				{
+					if (value.EqualsI("windows-1252") || value.EqualsI("iso-8859-1"))
+						FileEncoding = Encoding::CP1252;
+					else if (value.EqualsI("windows-1250"))
+						FileEncoding = Encoding::CP1250;
+				}
+			}
+			break;
+
+		case xtComment:
+		{
+			if (notes)
+				break;
+
+			// <!-- Tag: value -->
+			const StringRef& text = reader.GetText();
+			const char * colon = (const char *) memchr(text.Data, ':', text.Length);
+			if (colon == NULL)
+				break;
+
+			StringRef tag(text.Data, colon - text.Data);
+			StringRef tagValue(colon + 1, text.Data + text.Length - colon - 1);
+			ParseHeaderTag(tag.Trim(), tagValue.Trim());
+		} break;
+
+		case xtStartElement:
+		{
+			const StringRef& element = reader.GetName();
+
+			if (element.EqualsI("MELODY"))
+			{
+				if (notes)
+					break;
+
+				while (reader.NextAttribute(&name, &value))
+				{
+					if (name.EqualsI("Tempo"))
+						tempo = (float) atof(value.ToString().c_str());
+					else if (name.EqualsI("Resolution"))
+						Resolution = (value.EqualsI("Demisemiquaver") ? 8 : 4);
+					else
+						ParseHeaderTag(name, DecodeXMLAttribute(value, &attribute));
+				}
+			}
+			else if (element.EqualsI("TRACK"))
+			{
+				// every track starts from the beginning
+				trackCount++;
+				beat = 0;
+				firstTrack = lastTrack = (trackCount >= 2 ? 1 : 0);
+
+				if (notes && trackCount == 2)
+					Tracks.resize(2);
+
+				while (reader.NextAttribute(&name, &value))
+				{
+					if (name.EqualsI("Artist"))
+					{
+						std::string& singer = (trackCount >= 2 ? DuetSingerP2 : DuetSingerP1);
+						if (singer.empty())
+							singer = DecodeXMLAttribute(value, &attribute).ToString();
+					}
+				}
+			}
+			else if (element.EqualsI("SENTENCE"))
+			{
+				// The header is over; the library scan stops here.
+				if (!notes)
+				{
+					headerDone = true;
+					break;
+				}
+
+				while (reader.NextAttribute(&name, &value))
+				{
+					if (name.EqualsI("Singer") && trackCount == 0)
+					{
+						if (value.EqualsI("Solo 2"))
+							firstTrack = lastTrack = 1;
+						else if (value.EqualsI("Group"))
+							firstTrack = 0, lastTrack = 1;
+						else
+							firstTrack = lastTrack = 0;
+
+						if (lastTrack == 1)
+							Tracks.resize(2);
+					}
+				}
+
+				for (size_t i = firstTrack; i <= lastTrack; i++)
+				{
+					std::vector<SongLine>& lines = Tracks[i].Lines;
+
+					SongLine line;
+					line.Start = beat;
+					line.End = 0;
+
+					// an empty sentence
+					if (!lines.empty() && lines.back().Notes.empty())
+						lines.back() = line;
+					else
+						lines.push_back(line);
+				}
+
+				wordEnded = false;
+			}
+			else if (element.EqualsI("NOTE") && notes)
+			{
+				SongNote note;
+				note.Type = ntNormal;
+				note.Start = beat;
+				note.Length = 0;
+				note.Tone = 0;
+
+				int midiNote = 0;
+				bool continues = false;
+
+				while (reader.NextAttribute(&name, &value))
+				{
+					if (name.EqualsI("MidiNote"))
+					{
+						midiNote = ParseXMLInt(value);
+					}
+					else if (name.EqualsI("Duration"))
+					{
+						note.Length = ParseXMLInt(value);
+					}
+					else if (name.EqualsI("Lyric"))
+					{
+						// the txt format marks a new word by a leading space instead
+						if (wordEnded && value.Length > 0)
+							note.Text.push_back(' ');
+
+						continues = (value.Length > 0 && value.Data[value.Length - 1] == '-');
+						if (continues)
+							value.Length--;
+
+						DecodeStringUTF8(value.Data, value.Length, FileEncoding, &lyric);
+						if (lyric.find('&') != std::string::npos)
+							XMLReader::Decode(StringRef(lyric.data(), lyric.length()), &note.Text);
+						else
+							note.Text.append(lyric);
+					}
+					else if (name.EqualsI("Bonus") && IsXMLYes(value))
+					{
+						note.Type = (note.Type == ntRap ? ntRapGolden : ntGolden);
+					}
+					else if (name.EqualsI("FreeStyle") && IsXMLYes(value))
+					{
+						note.Type = ntFreestyle;
+					}
+					else if (name.EqualsI("Rap") && IsXMLYes(value))
+					{
+						note.Type = (note.Type == ntGolden ? ntRapGolden : ntRap);
+					}
+				}
+
+				if (note.Length <= 0)
+					break;
+
+				beat += note.Length;
+
+				// a rest
+				if (midiNote == 0)
+					break;
+
+				// MIDI 60 is the middle C, which is tone 0
+				note.Tone = midiNote - 60;
+				wordEnded = !continues;
+
+				for (size_t i = firstTrack; i <= lastTrack; i++)
+				{
+					std::vector<SongLine>& lines = Tracks[i].Lines;
+					if (lines.empty())
+					{
+						SongLine line;
+						line.Start = note.Start;
+						line.End = 0;
+						lines.push_back(line);
+					}
+
+					lines.back().Notes.push_back(note);
+				}
+			}
+		} break;
+
+		default:
+			break;
+		}
+	}
+
+	if (notes)
+		return FinishTracks();
+
+	BPM = tempo * Resolution / 4;
+
+	if (Mp3.empty())
+		Mp3 = FileName.stem().generic_string() + ".mp3";
+
+	if (Title.empty() || Artist.empty() || BPM <= 0.0f)
+	{
+		sLog.Debug("Song::ParseXML", "%s: missing title, artist or tempo.", filename.c_str());
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,86 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _XMLSONG_H
+#define _XMLSONG_H
+#pragma once
+
+enum XMLToken
+{
+	xtEnd,			// no more data
+	xtError,
+	xtDeclaration,	// <?xml ... ?>, its attributes can be read
+	xtStartElement,	// its attributes can be read
+	xtEndElement,	// also follows every empty element (<NOTE ... />)
+	xtText,
+	xtComment
+};
+
+/**
+ * A streaming XML reader for SingStar-style song files, and just enough XML
+ * for them: elements, attributes, comments, text and CDATA. There's no DTD
+ * support and no validation.
+ *
+ * Like SongParser it never copies: names, attribute values and text point
+ * into the data, which is usually a MappedFile. Only values containing
+ * entities have to be decoded (see Decode()).
+ */
+class XMLReader
+{
+public:
+	XMLReader(const char * data, size_t size);
+
+	// Reads up to the next token.
+	XMLToken Next();
+
+	// The element's name, without any namespace prefix.
+	INLINE const StringRef& GetName() const { return _name; }
+
+	// The text or comment, trimmed.
+	INLINE const StringRef& GetText() const { return _text; }
+
+	// Reads the next attribute of the current element or declaration.
+	bool NextAttribute(StringRef * name, StringRef * value);
+
+	// Where the reader is, for error messages.
+	Uint32 GetLineNumber() const;
+
+	// Appends the value with its entities (&amp;, &#233; ...) replaced.
+	static void Decode(const StringRef& value, std::string * result);
+
+protected:
+	XMLToken Fail();
+
+	const char *	_start;
+	const char *	_pos;
+	const char *	_end;
+
+	StringRef		_name;
+	StringRef		_text;
+
+	// the current element's attributes, not read yet
+	const char *	_attributes;
+	const char *	_attributesEnd;
+	bool			_pendingEnd;	// of an empty element
+};
+
+#endif
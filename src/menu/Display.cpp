@@ -29,6 +29,12 @@
 #include "../base/CommandLine.h"
 #include "../base/Graphic.h"
 #include "../base/TextGL.h"
+#include "../base/Profiler.h"
+#include "../base/Tracer.h"
+#include "../base/FlightRecorder.h"
+#include "../base/Screenshot.h"
+#include "../base/Renderer.h"
+#include "../base/QualityGovernor.h"
 
 #include "Menu.h"
 
@@ -69,7 +75,10 @@ Display::Display()
 	FPSCounter  = 0;
 	LastFPS     = 0;
 
+	ReplicaFailed = false;
+
 	glGenTextures(2, FadeTex);
+	glGenTextures(1, &ReplicaTex);
 	InitFadeTextures();
 
 	// set LastError for OSD to No Error
@@ -95,17 +104,27 @@ void Display::InitFadeTextures()
 		glBindTexture(GL_TEXTURE_2D, FadeTex[i]);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexImage2D(GL_TEXTURE_2D, 0, 3, TexW, TexH, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, TexW, TexH, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+		PROFILE_COUNT(pcTextureUploads);
 	}
+
+	glBindTexture(GL_TEXTURE_2D, ReplicaTex);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, TexW, TexH, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+	PROFILE_COUNT(pcTextureUploads);
 }
 
 bool Display::Draw()
 {
+	TRACE_SCOPE("Display::Draw");
+
 	for (int screen = 1; screen <= Screens; screen++)
 	{
 		ScreenAct = screen;
 		ScreenX = 0;
 
+		sRenderer.Flush();
 		glViewport((screen - 1) * ScreenW / Screens, 0, ScreenW / Screens, ScreenH);
 
 		// OK was pressed on the popup...
@@ -132,15 +151,36 @@ bool Display::Draw()
 			&& !BlackScreen)
 		{
 			// ePreDraw.CallHookChain(false);
-			CurrentScreen->Draw();
-			
-			// Popups
-			if (UIPopupError != NULL && UIPopupError->Visible)
-				UIPopupError->Draw();
-			else if (UIPopupInfo != NULL && UIPopupInfo->Visible)
-				UIPopupInfo->Draw();
-			else if (UIPopupCheck != NULL && UIPopupCheck->Visible)
-				UIPopupCheck->Draw();
+
+			// Screens showing the same content only draw it once (on the first screen),
+			// the others get a copy of it. If the copy fails, the remaining screens are drawn again.
+			bool replicate = (Screens > 1 && CanReplicateScreen());
+			if (replicate && screen > 1)
+			{
+				PROFILE_SCOPE(psDraw);
+				DrawReplica();
+			}
+			else
+			{
+				{
+					PROFILE_SCOPE(psDraw);
+					CurrentScreen->Draw();
+				}
+
+				// Popups
+				{
+					PROFILE_SCOPE(psPopups);
+					if (UIPopupError.IsCreated() && UIPopupError->Visible)
+						UIPopupError->Draw();
+					else if (UIPopupInfo.IsCreated() && UIPopupInfo->Visible)
+						UIPopupInfo->Draw();
+					else if (UIPopupCheck.IsCreated() && UIPopupCheck->Visible)
+						UIPopupCheck->Draw();
+				}
+
+				if (replicate)
+					CaptureReplica();
+			}
 
 			FadeStartTime = 0;
 			FadeEnabled = (sIni.ScreenFade == Switch::On && !FadeFailed);
@@ -156,6 +196,8 @@ bool Display::Draw()
 			// Can we fade now?
 			if (FadeEnabled && !FadeFailed)
 			{
+				PROFILE_SCOPE(psDraw);
+
 				// Create fading texture if we're just starting
 				if (FadeStartTime == 0)
 				{
@@ -177,7 +219,9 @@ bool Display::Draw()
 						InitFadeTextures();
 
 					// Copy screen to texture
-					glBindTexture(GL_TEXTURE_2D, FadeTex[screen - 1]);
+					sRenderer.Flush();
+					sRenderer.BindTexture(FadeTex[screen - 1]);
+					PROFILE_COUNT(pcTextureBinds);
 					glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, (screen - 1) * ScreenW / Screens, 
 						0, fadeCopyW, fadeCopyH);
 
@@ -213,6 +257,7 @@ bool Display::Draw()
 				// Draw black screen
 				else if (ScreenAct == 1)
 				{
+					sRenderer.Flush();
 					glClearColor(0, 0, 0, 1);
 					glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 				}
@@ -220,35 +265,40 @@ bool Display::Draw()
 				// and draw old screen over it... slowly fading out
 				float fadeStateSquare = 0.0f;
 				if (FadeStartTime > 0)
-					fadeStateSquare = sqr((float)(SDL_GetTicks() - FadeStartTime) / FADE_DURATION);
+					fadeStateSquare = sqr((float)(SDL_GetTicks() - FadeStartTime) / (FADE_DURATION * QualityGovernor::FadeScale()));
 
 				if (fadeStateSquare < 1)
 				{
 					float	fadeW = ((float)ScreenW / Screens) / (float) TexW,
 							fadeH = (float) ScreenH / (float) TexH;
 
-					glBindTexture(GL_TEXTURE_2D, FadeTex[screen - 1]);
+					sRenderer.BindTexture(FadeTex[screen - 1]);
+					PROFILE_COUNT(pcTextureBinds);
 
 					// TODO: check if glTexEnvi() gives any speed improvement
 					// glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
 					
-					glColor4f(1.0f, 1.0f, 1.0f, 1 - fadeStateSquare);
-
-					glEnable(GL_TEXTURE_2D);
-					glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-					glEnable(GL_BLEND);
-					glBegin(GL_QUADS);
-						glTexCoord2f((0+fadeStateSquare/2)*fadeW, (0+fadeStateSquare/2)*fadeH);
-						glVertex2f(0.0f, (float) RenderH);
-						glTexCoord2f((0+fadeStateSquare/2)*fadeW, (1-fadeStateSquare/2)*fadeH);
-						glVertex2f(0.0f, 0.0f);
-						glTexCoord2f((1-fadeStateSquare/2)*fadeW, (1-fadeStateSquare/2)*fadeH);
-						glVertex2f((float) RenderW, 0.0f);
-						glTexCoord2f((1-fadeStateSquare/2)*fadeW, (0+fadeStateSquare/2)*fadeH);
-						glVertex2f((float) RenderW, (float) RenderH);
-					glEnd();
-					glDisable(GL_BLEND);
-					glDisable(GL_TEXTURE_2D);
+					sRenderer.SetColor(1.0f, 1.0f, 1.0f, 1 - fadeStateSquare);
+
+					sRenderer.SetTexturing(true);
+					sRenderer.SetBlending(true);
+
+					RenderVertex vertices[4] =
+					{
+						sRenderer.MakeVertex(0.0f, (float) RenderH, 0.0f,
+							(0+fadeStateSquare/2)*fadeW, (0+fadeStateSquare/2)*fadeH),
+						sRenderer.MakeVertex(0.0f, 0.0f, 0.0f,
+							(0+fadeStateSquare/2)*fadeW, (1-fadeStateSquare/2)*fadeH),
+						sRenderer.MakeVertex((float) RenderW, 0.0f, 0.0f,
+							(1-fadeStateSquare/2)*fadeW, (1-fadeStateSquare/2)*fadeH),
+						sRenderer.MakeVertex((float) RenderW, (float) RenderH, 0.0f,
+							(1-fadeStateSquare/2)*fadeW, (0+fadeStateSquare/2)*fadeH)
+					};
+
+					sRenderer.DrawQuads(vertices, 4);
+					PROFILE_COUNT(pcDrawCalls);
+					sRenderer.SetBlending(false);
+					sRenderer.SetTexturing(false);
 
 					// reset to default
 					// glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULE);
@@ -261,10 +311,16 @@ bool Display::Draw()
 			}
 
 			// Fade out complete (if it was even fading to begin with...)
-			if (((FadeStartTime + FADE_DURATION < SDL_GetTicks()
+			if (((FadeStartTime + FADE_DURATION * QualityGovernor::FadeScale() < SDL_GetTicks()
 				|| (!FadeEnabled || FadeFailed))
 				&& (screen == Screens)))
 			{
+				ScreenSlot * fromSlot = FindScreenSlot(CurrentScreen);
+				ScreenSlot * toSlot = FindScreenSlot(NextScreen);
+				FlightRecorder::Record(fetScreen, "%s -> %s",
+					fromSlot != NULL ? fromSlot->GetName() : "?",
+					toSlot != NULL ? toSlot->GetName() : (BlackScreen ? "(quit)" : "?"));
+
 				FadeStartTime = 0;
 				DoneOnShow = false;
 				CurrentScreen->OnHide();
@@ -277,6 +333,9 @@ bool Display::Draw()
 
 				CurrentScreen->OnShowFinish();
 				CurrentScreen->ShowFinish = true;
+
+				// Construct the screens we'll probably need next while idle
+				QueueLikelyNextScreens(CurrentScreen);
 			}
 		}
 
@@ -286,12 +345,80 @@ bool Display::Draw()
 			DrawDebugInformation();
 
 		if (!BlackScreen)
+		{
+			PROFILE_SCOPE(psCursor);
 			DrawCursor();
+		}
 	}
 
 	return true;
 }
 
+void Display::SaveScreenshot()
+{
+	// The frame is read back asynchronously and encoded on the screenshot thread.
+	if (ScreenshotMgr::getSingletonPtr() != NULL)
+		sScreenshots.Capture(ssfPNG);
+}
+
+bool Display::CanReplicateScreen()
+{
+	return !ReplicaFailed
+		&& !CurrentScreen->HasPerScreenContent();
+}
+
+void Display::CaptureReplica()
+{
+	Uint32	copyW = ScreenW / Screens,
+			copyH = ScreenH;
+
+	// Clear OpenGL errors, so we only catch errors from the copy
+	glGetError();
+
+	// Fade and replica textures share their size, resize them after a window resize.
+	if (TexW < copyW || TexH < copyH)
+		InitFadeTextures();
+
+	sRenderer.Flush();
+	sRenderer.BindTexture(ReplicaTex);
+	PROFILE_COUNT(pcTextureBinds);
+	glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, copyW, copyH);
+
+	GLenum glError = glGetError();
+	if (glError != GL_NO_ERROR)
+	{
+		ReplicaFailed = true;
+		sLog.Error("Display::CaptureReplica", "Screen replication disabled, OpenGL error code: 0x%X", glError);
+	}
+}
+
+void Display::DrawReplica()
+{
+	float	texW = ((float)ScreenW / Screens) / (float) TexW,
+			texH = (float) ScreenH / (float) TexH;
+
+	sRenderer.SetDepthTest(false);
+	sRenderer.SetBlending(false);
+	sRenderer.SetTexturing(true);
+	sRenderer.BindTexture(ReplicaTex);
+	PROFILE_COUNT(pcTextureBinds);
+
+	sRenderer.SetColor(1.0f, 1.0f, 1.0f, 1.0f);
+
+	RenderVertex vertices[4] =
+	{
+		sRenderer.MakeVertex(0.0f, (float) RenderH, 0.0f, 0.0f, 0.0f),
+		sRenderer.MakeVertex(0.0f, 0.0f, 0.0f, 0.0f, texH),
+		sRenderer.MakeVertex((float) RenderW, 0.0f, 0.0f, texW, texH),
+		sRenderer.MakeVertex((float) RenderW, (float) RenderH, 0.0f, texW, 0.0f)
+	};
+
+	sRenderer.DrawQuads(vertices, 4);
+	PROFILE_COUNT(pcDrawCalls);
+
+	sRenderer.SetTexturing(false);
+}
+
 // called by MoveCursor and OnMouseButton to update last move and start fade in
 void Display::UpdateCursorFade()
 {
@@ -390,31 +517,29 @@ void Display::DrawCursor()
 			if (ScreenAct == 2)
 				DrawX -= RenderW;
 
-			glColor4f(1, 1, 1, Alpha);
-			glEnable(GL_TEXTURE_2D);
-			glEnable(GL_BLEND);
+			sRenderer.SetColor(1, 1, 1, Alpha);
+			sRenderer.SetTexturing(true);
+			sRenderer.SetBlending(true);
 
 			if (CursorPressed && TexCursorPressed.TexNum > 0)
-				glBindTexture(GL_TEXTURE_2D, TexCursorPressed.TexNum);
+				sRenderer.BindTexture(TexCursorPressed.TexNum);
 			else
-				glBindTexture(GL_TEXTURE_2D, TexCursorUnpressed.TexNum);
-
-			glBegin(GL_QUADS);
-				glTexCoord2i(0, 0);
-				glVertex2f(DrawX, CursorY);
-
-				glTexCoord2f(0, 1);
-				glVertex2f(DrawX, CursorY + 32);
+				sRenderer.BindTexture(TexCursorUnpressed.TexNum);
+			PROFILE_COUNT(pcTextureBinds);
 
-				glTexCoord2f(1, 1);
-				glVertex2f(DrawX + 32, CursorY + 32);
+			RenderVertex vertices[4] =
+			{
+				sRenderer.MakeVertex(DrawX, CursorY, 0.0f, 0, 0),
+				sRenderer.MakeVertex(DrawX, CursorY + 32, 0.0f, 0, 1),
+				sRenderer.MakeVertex(DrawX + 32, CursorY + 32, 0.0f, 1, 1),
+				sRenderer.MakeVertex(DrawX + 32, CursorY, 0.0f, 1, 0)
+			};
 
-				glTexCoord2f(1, 0);
-				glVertex2f(DrawX + 32, CursorY);
-			glEnd();
+			sRenderer.DrawQuads(vertices, 4);
+			PROFILE_COUNT(pcDrawCalls);
 
-			glDisable(GL_BLEND);
-			glDisable(GL_TEXTURE_2D);
+			sRenderer.SetBlending(false);
+			sRenderer.SetTexturing(false);
 		}
 	}
 }
@@ -422,21 +547,16 @@ void Display::DrawCursor()
 void Display::DrawDebugInformation()
 {
 	// White background for information
-	glEnable(GL_BLEND);
-	glColor4f(1, 1, 1, 0.5);
-	glBegin(GL_QUADS);
-		glVertex2i(RenderH + 90, 44);
-		glVertex2i(RenderH + 90, 0);
-		glVertex2i(RenderW, 0);
-		glVertex2i(RenderW, 44);
-	glEnd();
-	glDisable(GL_BLEND);
+	sRenderer.SetBlending(true);
+	sRenderer.SetColor(1, 1, 1, 0.5);
+	sRenderer.DrawRect((float) RenderH + 90, 57, (float) RenderW, 0);
+	sRenderer.SetBlending(false);
 
 	// set font specs
 	SetFontStyle(ftNormal);
 	SetFontSize(21);
 	SetFontItalic(false);
-	glColor4f(0, 0, 0, 1);
+	sRenderer.SetColor(0, 0, 0, 1);
 
 	// calculate fps
 	Uint32 Ticks = SDL_GetTicks();
@@ -461,10 +581,19 @@ void Display::DrawDebugInformation()
 
 	// lasterror
 	SetFontPos(695, 26);
-	glColor4f(1, 0, 0, 1);
+	sRenderer.SetColor(1, 0, 0, 1);
 	glPrint(OSD_LastError);
 
-	glColor4f(1, 1, 1, 1);
+	// quality level chosen by the governor
+	SetFontPos(695, 39);
+	sRenderer.SetColor(0, 0, 0, 1);
+	glPrint("Quality: %s", QualityGovernor::GetLevelName(QualityGovernor::CurrentLevel()));
+
+	// profiler overlay (toggled with F10)
+	if (Profiler::getSingletonPtr() != NULL)
+		sProfiler.Draw((float) RenderW - 300.0f, 59.0f, 300.0f, 160.0f);
+
+	sRenderer.SetColor(1, 1, 1, 1);
 }
 
 bool Display::ParseInput(Uint32 pressedKey, SDL_Keycode keyCode, bool pressedDown)
@@ -539,4 +668,5 @@ void Display::SetCursor()
 Display::~Display()
 {
 	glDeleteTextures(2, FadeTex);
+	glDeleteTextures(1, &ReplicaTex);
 }
@@ -59,6 +59,11 @@ public:
 	
 	void DrawDebugInformation();
 
+	// copies the first screen to ReplicaTex / draws it into the current screen
+	bool CanReplicateScreen();
+	void CaptureReplica();
+	void DrawReplica();
+
 	// called by MoveCursor and OnMouseButton to update last move and start fade in
 	void UpdateCursorFade();
 
@@ -79,6 +84,10 @@ private:
 	GLuint	FadeTex[2];
 	Uint32	TexW, TexH;
 
+	// multi-screen: the first screen is drawn once and copied to the others
+	GLuint	ReplicaTex;
+	bool	ReplicaFailed; // true if copying the screen failed, every screen is drawn then
+
 	Uint32	FPSCounter;
 	Uint32	LastFPS;
 	Uint32	NextFPSSwap;
@@ -22,23 +22,26 @@
 
 #include "stdafx.h"
 #include "DrawTexture.h"
+#include "../base/Renderer.h"
+#include "../base/Profiler.h"
 
 void DrawLine(float X1, float Y1, float X2, float Y2, RGB& ColRGB)
 {
-	glColor3f(ColRGB.R, ColRGB.G, ColRGB.B);
-	glBegin(GL_LINES);
-		glVertex2f(X1, Y1);
-		glVertex2f(X2, Y2);
-	glEnd();
+	sRenderer.SetColor(ColRGB.R, ColRGB.G, ColRGB.B);
+
+	RenderVertex vertices[2] =
+	{
+		sRenderer.MakeVertex(X1, Y1),
+		sRenderer.MakeVertex(X2, Y2)
+	};
+
+	sRenderer.DrawLines(vertices, 2);
+	PROFILE_COUNT(pcDrawCalls);
 }
 
 void DrawQuad(float X,  float Y,  float W,  float H,  RGB& ColRGB)
 {
-	glColor3f(ColRGB.R, ColRGB.G, ColRGB.B);
-	glBegin(GL_QUADS);
-		glVertex2f(X,     Y);
-		glVertex2f(X,     Y + H);
-		glVertex2f(X + W, Y + H);
-		glVertex2f(X + W, Y);
-	glEnd();
+	sRenderer.SetColor(ColRGB.R, ColRGB.G, ColRGB.B);
+	sRenderer.DrawRect(X, Y, X + W, Y + H);
+	PROFILE_COUNT(pcDrawCalls);
 }
@@ -192,6 +192,11 @@ public:
 	virtual void DrawBG();
 	virtual void DrawFG();
 	virtual void Draw();
+
+	// true if the screen draws something different on each screen (e.g. one player per screen).
+	// Otherwise it is drawn once per frame and replicated across all screens.
+	virtual bool HasPerScreenContent() { return false; }
+
 	virtual bool ParseInput(Uint32 pressedKey, SDL_Keycode keyCode, bool pressedDown);
 	virtual bool ParseTextInput(SDL_Event * event);
 	virtual bool ParseMouse(int mouseButton, bool btnDown, float x, float y);
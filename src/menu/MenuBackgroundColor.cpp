@@ -37,6 +37,7 @@ void MenuBackgroundColor::Draw()
 	if (ScreenAct != 1)
 		return;
 
+	sRenderer.Flush();
 	glClearColor(Color.R, Color.G, Color.B, 0.0f);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 }
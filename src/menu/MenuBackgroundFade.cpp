@@ -22,6 +22,8 @@
 
 #include "stdafx.h"
 #include "../base/Graphic.h"
+#include "../base/Renderer.h"
+#include "../base/Profiler.h"
 #include "../base/ThemeDefines.h"
 #include "../base/Skins.h"
 #include "../base/Texture.h"
@@ -64,19 +66,17 @@ void MenuBackgroundFade::Draw()
 
 	// Clear just once when in dual screen mode
 	if (ScreenAct == 1)
+	{
+		sRenderer.Flush();
 		glClear(GL_DEPTH_BUFFER_BIT);
+	}
 
-	glDisable(GL_TEXTURE_2D);
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	sRenderer.SetTexturing(false);
+	sRenderer.SetBlending(true);
 
 	glColorRGB(Color, Progress);
 
-	glBegin(GL_QUADS);
-		glVertex2i(0, 0);
-		glVertex2i(0, RenderH);
-		glVertex2i(RenderW, RenderH);
-		glVertex2i(RenderW, 0);
-	glEnd();
-	glDisable(GL_BLEND);
+	sRenderer.DrawRect(0, 0, (float) RenderW, (float) RenderH);
+	PROFILE_COUNT(pcDrawCalls);
+	sRenderer.SetBlending(false);
 }
@@ -34,5 +34,8 @@ void MenuBackgroundNone::Draw()
 {
 	// Clear just once when in dual screen mode
 	if (ScreenAct == 1)
+	{
+		sRenderer.Flush();
 		glClear(GL_DEPTH_BUFFER_BIT);
+	}
 }
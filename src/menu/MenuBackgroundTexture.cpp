@@ -22,6 +22,8 @@
 
 #include "stdafx.h"
 #include "../base/Graphic.h"
+#include "../base/Renderer.h"
+#include "../base/Profiler.h"
 #include "../base/ThemeDefines.h"
 #include "../base/Skins.h"
 #include "../base/TextureMgr.h"
@@ -59,30 +61,30 @@ void MenuBackgroundTexture::Draw()
 {
 	// Clear just once when in dual screen mode
 	if (ScreenAct == 1)
+	{
+		sRenderer.Flush();
 		glClear(GL_DEPTH_BUFFER_BIT);
+	}
 
 	glColorRGB(Color);
 
-	glEnable(GL_TEXTURE_2D);
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-	glBindTexture(GL_TEXTURE_2D, Tex.TexNum);
+	sRenderer.SetTexturing(true);
+	sRenderer.SetBlending(true);
 
-	glBegin(GL_QUADS);
-		glTexCoord2f(Tex.TexX1*Tex.TexW, Tex.TexY1*Tex.TexH);
-		glVertex2i(0, 0);
+	sRenderer.BindTexture(Tex.TexNum);
+	PROFILE_COUNT(pcTextureBinds);
 
-		glTexCoord2f(Tex.TexX1*Tex.TexW, Tex.TexY2*Tex.TexH);
-		glVertex2i(0, RenderH);
-
-		glTexCoord2f(Tex.TexX2*Tex.TexW, Tex.TexY2*Tex.TexH);
-		glVertex2i(RenderW, RenderH);
+	RenderVertex vertices[4] =
+	{
+		sRenderer.MakeVertex(0, 0, 0, Tex.TexX1*Tex.TexW, Tex.TexY1*Tex.TexH),
+		sRenderer.MakeVertex(0, (float) RenderH, 0, Tex.TexX1*Tex.TexW, Tex.TexY2*Tex.TexH),
+		sRenderer.MakeVertex((float) RenderW, (float) RenderH, 0, Tex.TexX2*Tex.TexW, Tex.TexY2*Tex.TexH),
+		sRenderer.MakeVertex((float) RenderW, 0, 0, Tex.TexX2*Tex.TexW, Tex.TexY1*Tex.TexH)
+	};
 
-		glTexCoord2f(Tex.TexX2*Tex.TexW, Tex.TexY1*Tex.TexH);
-		glVertex2i(RenderW, 0);
-	glEnd();
+	sRenderer.DrawQuads(vertices, 4);
+	PROFILE_COUNT(pcDrawCalls);
 
-	glDisable(GL_BLEND);
-	glDisable(GL_TEXTURE_2D);
+	sRenderer.SetBlending(false);
+	sRenderer.SetTexturing(false);
 }
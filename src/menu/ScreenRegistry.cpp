@@ -0,0 +1,197 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "stdafx.h"
+#include <deque>
+
+#include "ScreenRegistry.h"
+
+#include "../base/Log.h"
+#include "Display.h"
+#include "Menu.h"
+
+// minimum idle time left in a frame before a queued screen is constructed
+static const Uint32 PRELOAD_MIN_IDLE_MS = 4;
+
+struct LikelyNextScreens
+{
+	const char * Screen;
+	const char * Next[8];
+};
+
+// Screens usually shown after a screen, in order of likelihood.
+static const LikelyNextScreens LikelyNext[] =
+{
+	{ "Main",			{ "Name", "Level", "Song", "Options", "PopupCheck", NULL } },
+	{ "Name",			{ "Level", "Song", "Sing", NULL } },
+	{ "Level",			{ "Song", NULL } },
+	{ "Song",			{ "Sing", "SongMenu", "SongJumpTo", NULL } },
+	{ "Sing",			{ "Score", NULL } },
+	{ "Score",			{ "Top5", NULL } },
+	{ "Top5",			{ "Song", NULL } },
+	{ "Options",		{ "OptionsGame", "OptionsGraphics", "OptionsSound", "OptionsLyrics",
+						  "OptionsThemes", "OptionsRecord", "OptionsAdvanced", NULL } },
+	{ "PartyOptions",	{ "PartyPlayer", NULL } },
+	{ "PartyPlayer",	{ "PartyRounds", NULL } },
+	{ "PartyRounds",	{ "PartyNewRound", NULL } },
+	{ "PartyNewRound",	{ "Sing", "PartyScore", NULL } },
+	{ "PartyScore",		{ "PartyNewRound", "PartyWin", NULL } },
+	{ "StatMain",		{ "StatDetail", NULL } },
+};
+
+static std::deque<ScreenSlot *> PreloadQueue;
+
+ScreenSlot::ScreenSlot(const char * name, CreateFunc create)
+	: _name(name), _create(create), _screen(NULL), _constructTime(0.0f)
+{
+	GetScreenSlots().push_back(this);
+}
+
+Menu * ScreenSlot::GetScreen()
+{
+	if (_screen != NULL)
+		return _screen;
+
+	Uint64 start = SDL_GetPerformanceCounter();
+
+	sLog.BenchmarkStart(3);
+	_screen = _create();
+	sLog.BenchmarkEnd(3);
+	sLog.Benchmark(3, "====> Screen %s", _name);
+
+	_constructTime = (float) ((SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency());
+	sLog.Status("ScreenSlot", "Constructed screen %s in %.2f ms", _name, _constructTime);
+
+	return _screen;
+}
+
+void ScreenSlot::Destroy()
+{
+	delete _screen;
+	_screen = NULL;
+}
+
+ScreenSlotList& GetScreenSlots()
+{
+	// function-local so screens declared in any translation unit can register themselves
+	static ScreenSlotList slots;
+	return slots;
+}
+
+ScreenSlot * FindScreenSlot(const std::string& name)
+{
+	ScreenSlotList& slots = GetScreenSlots();
+	for (ScreenSlotList::const_iterator itr = slots.begin(); itr != slots.end(); ++itr)
+	{
+		if (STRCASECMP((*itr)->GetName(), name.c_str()) == 0)
+			return *itr;
+	}
+
+	return NULL;
+}
+
+ScreenSlot * FindScreenSlot(const Menu * screen)
+{
+	if (screen == NULL)
+		return NULL;
+
+	ScreenSlotList& slots = GetScreenSlots();
+	for (ScreenSlotList::const_iterator itr = slots.begin(); itr != slots.end(); ++itr)
+	{
+		if ((*itr)->IsCreated() && (*itr)->GetScreen() == screen)
+			return *itr;
+	}
+
+	return NULL;
+}
+
+void QueueLikelyNextScreens(const Menu * screen)
+{
+	ScreenSlot * slot = FindScreenSlot(screen);
+	if (slot == NULL)
+		return;
+
+	// Only the most recent screen's guesses are relevant.
+	PreloadQueue.clear();
+
+	for (size_t i = 0; i < sizeof(LikelyNext) / sizeof(LikelyNext[0]); i++)
+	{
+		if (STRCASECMP(LikelyNext[i].Screen, slot->GetName()) != 0)
+			continue;
+
+		for (int j = 0; LikelyNext[i].Next[j] != NULL; j++)
+		{
+			ScreenSlot * next = FindScreenSlot(LikelyNext[i].Next[j]);
+			if (next != NULL && !next->IsCreated())
+				PreloadQueue.push_back(next);
+		}
+
+		break;
+	}
+}
+
+void PreloadScreens(Uint32 idleMs)
+{
+	// Don't interfere with screen transitions.
+	if (idleMs < PRELOAD_MIN_IDLE_MS
+		|| sDisplay.NextScreen != NULL)
+		return;
+
+	while (!PreloadQueue.empty())
+	{
+		ScreenSlot * slot = PreloadQueue.front();
+		PreloadQueue.pop_front();
+
+		// One screen per frame at most
+		if (!slot->IsCreated())
+		{
+			slot->GetScreen();
+			return;
+		}
+	}
+}
+
+void LogScreenConstructTimes()
+{
+	float total = 0.0f;
+
+	ScreenSlotList& slots = GetScreenSlots();
+	for (ScreenSlotList::const_iterator itr = slots.begin(); itr != slots.end(); ++itr)
+	{
+		if (!(*itr)->IsCreated())
+			continue;
+
+		sLog.Info("ScreenSlot", "%-22s %8.2f ms", (*itr)->GetName(), (*itr)->GetConstructTime());
+		total += (*itr)->GetConstructTime();
+	}
+
+	sLog.Info("ScreenSlot", "%-22s %8.2f ms", "Total", total);
+}
+
+void DestroyScreens()
+{
+	PreloadQueue.clear();
+
+	ScreenSlotList& slots = GetScreenSlots();
+	for (ScreenSlotList::const_iterator itr = slots.begin(); itr != slots.end(); ++itr)
+		(*itr)->Destroy();
+}
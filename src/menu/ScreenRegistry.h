@@ -0,0 +1,104 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _SCREENREGISTRY_H
+#define _SCREENREGISTRY_H
+#pragma once
+
+class Menu;
+
+// A screen that is only constructed when it's first used.
+class ScreenSlot
+{
+public:
+	typedef Menu * (*CreateFunc)();
+
+	ScreenSlot(const char * name, CreateFunc create);
+
+	// Returns the screen, constructing it if necessary.
+	Menu * GetScreen();
+
+	// Deletes the screen; it is constructed again on next use.
+	void Destroy();
+
+	INLINE bool IsCreated() const { return _screen != NULL; }
+	INLINE const char * GetName() const { return _name; }
+
+	// time it took to construct the screen in ms (0 if not constructed yet)
+	INLINE float GetConstructTime() const { return _constructTime; }
+
+protected:
+	const char *	_name;
+	CreateFunc		_create;
+	Menu *			_screen;
+	float			_constructTime;
+};
+
+// Typed access to a lazily constructed screen; replaces the raw UI* screen pointers.
+// Comparing against a Menu pointer never constructs the screen.
+template <class T>
+class LazyScreen : public ScreenSlot
+{
+public:
+	LazyScreen(const char * name)
+		: ScreenSlot(name, &LazyScreen::CreateScreen)
+	{
+	}
+
+	INLINE T * Get() { return static_cast<T *>(GetScreen()); }
+	INLINE T * operator->() { return Get(); }
+	INLINE operator T *() { return Get(); }
+
+	friend INLINE bool operator==(const Menu * lhs, const LazyScreen& rhs) { return rhs._screen != NULL && lhs == rhs._screen; }
+	friend INLINE bool operator!=(const Menu * lhs, const LazyScreen& rhs) { return !(lhs == rhs); }
+	friend INLINE bool operator==(const LazyScreen& lhs, const Menu * rhs) { return rhs == lhs; }
+	friend INLINE bool operator!=(const LazyScreen& lhs, const Menu * rhs) { return !(rhs == lhs); }
+
+	// Exact matches for plain Menu pointers, which would otherwise be ambiguous
+	// with comparing the pointers after operator T *().
+	friend INLINE bool operator==(Menu * lhs, const LazyScreen& rhs) { return (const Menu *) lhs == rhs; }
+	friend INLINE bool operator!=(Menu * lhs, const LazyScreen& rhs) { return !((const Menu *) lhs == rhs); }
+	friend INLINE bool operator==(const LazyScreen& lhs, Menu * rhs) { return (const Menu *) rhs == lhs; }
+	friend INLINE bool operator!=(const LazyScreen& lhs, Menu * rhs) { return !((const Menu *) rhs == lhs); }
+
+private:
+	static Menu * CreateScreen() { return new T(); }
+};
+
+typedef std::vector<ScreenSlot *> ScreenSlotList;
+
+// all screens in declaration order
+ScreenSlotList& GetScreenSlots();
+ScreenSlot * FindScreenSlot(const std::string& name);
+ScreenSlot * FindScreenSlot(const Menu * screen);
+
+// Queues the screens that are likely to be shown after the given one for preloading.
+void QueueLikelyNextScreens(const Menu * screen);
+
+// Constructs the next queued screen if the frame has enough idle time left.
+// Screens create textures, so this must run on the main thread.
+void PreloadScreens(Uint32 idleMs);
+
+void LogScreenConstructTimes();
+void DestroyScreens();
+
+#endif
@@ -130,7 +130,9 @@ void ScreenOptionsGame::SaveAndReturn()
 
 void ScreenOptionsGame::RefreshSongs()
 {
-	if (sIni.Sorting != OldSorting
+	// A song screen constructed later picks up the new settings by itself.
+	if ((sIni.Sorting != OldSorting
 		|| sIni.Tabs != OldTabs)
+		&& UISong.IsCreated())
 		UISong->Refresh();
 }
@@ -26,6 +26,9 @@
 
 class ScreenScore : public Menu
 {
+public:
+	// each screen shows its own players
+	bool HasPerScreenContent() { return true; }
 };
 
 #endif
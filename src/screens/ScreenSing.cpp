@@ -22,9 +22,39 @@
 
 #include "stdafx.h"
 #include "../menu/Menu.h"
+#include "../base/Graphic.h"
+#include "../base/GraphicClasses.h"
+#include "../base/Ini.h"
 #include "ScreenSing.h"
 
+void ScreenSing::OnShow()
+{
+	Menu::OnShow();
+
+	// no notes or stars left over from the previous song
+	for (int player = 0; player < MAX_PLAYERS; player++)
+		NoteLanes.ClearLine(player);
+
+	sEffects.KillAll();
+}
+
+void ScreenSing::Draw()
+{
+	Menu::Draw();
+
+	// each screen draws its own players, but the twinkles only spawn once a frame
+	int playerCount = IPlayersVals[sIni.Players];
+	if (ScreenAct == 1)
+		NoteLanes.SpawnTwinkles(Screens, playerCount);
+
+	NoteLanes.DrawScreen(ScreenAct, Screens, playerCount);
+
+	// golden note twinkles, perfect note stars, ...
+	sEffects.Draw();
+}
+
 void ScreenSing::Finish()
 {
 	// TODO
+	sEffects.KillAll();
 }
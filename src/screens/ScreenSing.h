@@ -24,10 +24,19 @@
 #define _SCREEN_SING_H
 #pragma once
 
+#include "../base/NoteLaneRenderer.h"
+
 class ScreenSing : public Menu
 {
 public:
+	void OnShow();
+	void Draw();
 	void Finish();
+
+	// each screen shows its own players
+	bool HasPerScreenContent() { return true; }
+
+	NoteLaneRenderer NoteLanes;
 };
 
 #endif
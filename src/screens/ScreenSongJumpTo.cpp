@@ -21,3 +21,138 @@
  */
 
 #include "stdafx.h"
+#include "../base/Graphic.h"
+#include "../base/Log.h"
+#include "../base/Music.h"
+#include "../base/Songs.h"
+#include "../base/Themes.h"
+#include "../menu/Menu.h"
+#include "ScreenSong.h"
+#include "ScreenSongJumpTo.h"
+
+ScreenSongJumpTo::ScreenSongJumpTo() : Menu(), SearchType(ssfAll)
+{
+	ThemeSongJumpTo * theme = sThemes.SongJumpTo;
+
+	LoadFromTheme(theme);
+
+	AddButton(theme->ButtonSearchText);
+	if (Buttons[0].Texts.empty())
+		AddButtonText(14.0f, 20.0f, "");
+
+	theme->SelectSlideType.ShowArrows = true;
+	theme->SelectSlideType.OneItemOnly = true;
+	AddSelectSlide(theme->SelectSlideType, &SearchType, theme->IType, SDL_arraysize(theme->IType));
+
+	TextFound = AddText(theme->TextFound);
+
+	SetInteraction(0);
+}
+
+void ScreenSongJumpTo::OnShow()
+{
+	Menu::OnShow();
+
+	Buttons[0].Texts[0].SetText("");
+	Texts[TextFound].SetText("");
+	Results.clear();
+
+	SetInteraction(0);
+}
+
+bool ScreenSongJumpTo::ParseInput(Uint32 pressedKey, SDL_Keycode keyCode, bool pressedDown)
+{
+	if (!pressedDown)
+		return true;
+
+	switch (pressedKey)
+	{
+		case SDLK_ESCAPE:
+			Results.clear();
+			FadeTo(UISong, SoundBack);
+			break;
+
+		case SDLK_RETURN:
+			FadeTo(UISong, SoundStart);
+			break;
+
+		case SDLK_BACKSPACE:
+			if (SelInteraction == 0)
+			{
+				Buttons[0].Texts[0].DeleteLastLetter();
+				Search();
+			}
+			break;
+
+		case SDLK_DOWN:
+			InteractNext();
+			break;
+
+		case SDLK_UP:
+			InteractPrev();
+			break;
+
+		case SDLK_RIGHT:
+		case SDLK_LEFT:
+			if (SelInteraction == 1)
+			{
+				if (pressedKey == SDLK_RIGHT
+					? InteractInc()
+					: InteractDec())
+				{
+					sSoundLib.PlaySound(SoundOption);
+					Search();
+				}
+			}
+			break;
+	}
+
+	return true;
+}
+
+bool ScreenSongJumpTo::ParseTextInput(SDL_Event * event)
+{
+	if (SelInteraction == 0
+		&& event->type == SDL_TEXTINPUT)
+	{
+		MenuText& menuText = Buttons[0].Texts[0];
+		menuText.SetText(menuText.GetText() + event->text.text);
+		Search();
+	}
+
+	return true;
+}
+
+void ScreenSongJumpTo::Search()
+{
+	const ThemeSongJumpTo * theme = sThemes.SongJumpTo;
+	const std::string& query = Buttons[0].Texts[0].GetText();
+	Results = sSongs.Search(query, (SongSearchField) SearchType);
+
+	sLog.Debug("ScreenSongJumpTo", "\"%s\": %u songs in %.3f ms",
+		query.c_str(), (Uint32) Results.size(), sSongs.GetSearch().GetSearchTime());
+
+	if (query.empty())
+	{
+		Texts[TextFound].SetText("");
+	}
+	else if (Results.empty())
+	{
+		Texts[TextFound].SetText(theme->NoSongsFound);
+	}
+	else
+	{
+		// The text comes from the language file, so it's never used as a format:
+		// only its %d is replaced by the count.
+		std::string found = theme->SongsFound;
+		size_t pos = found.find("%d");
+		if (pos != std::string::npos)
+		{
+			char count[16];
+			snprintf(count, sizeof(count), "%u", (Uint32) Results.size());
+			found.replace(pos, 2, count);
+		}
+
+		Texts[TextFound].SetText(found);
+	}
+}
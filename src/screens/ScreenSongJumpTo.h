@@ -26,6 +26,22 @@
 
 class ScreenSongJumpTo : public Menu
 {
+public:
+	ScreenSongJumpTo();
+
+	virtual void OnShow();
+	virtual bool ParseInput(Uint32 pressedKey, SDL_Keycode keyCode, bool pressedDown);
+	virtual bool ParseTextInput(SDL_Event * event);
+
+	// Catalog indexes of the songs found, best first.
+	std::vector<Uint32> Results;
+
+protected:
+	// Searches again for what's typed, on every change.
+	void Search();
+
+	Uint32	SearchType;	// a SongSearchField
+	int		TextFound;
 };
 
 #endif
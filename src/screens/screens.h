@@ -60,49 +60,49 @@
 #include "../screens/ScreenPopup.h"
 
 // Screens
-extern ScreenLoading			* UILoading;
-extern ScreenMain				* UIMain;
-extern ScreenName				* UIName;
-extern ScreenLevel				* UILevel;
-extern ScreenSong				* UISong;
-extern ScreenSing				* UISing;
-extern ScreenScore				* UIScore;
-extern ScreenTop5				* UITop5;
-extern ScreenOptions			* UIOptions;
-extern ScreenOptionsGame		* UIOptionsGame;
-extern ScreenOptionsGraphics	* UIOptionsGraphics;
-extern ScreenOptionsSound		* UIOptionsSound;
-extern ScreenOptionsLyrics		* UIOptionsLyrics;
-extern ScreenOptionsThemes		* UIOptionsThemes;
-extern ScreenOptionsRecord		* UIOptionsRecord;
-extern ScreenOptionsAdvanced	* UIOptionsAdvanced;
-extern ScreenEditSub			* UIEditSub;
-extern ScreenEdit				* UIEdit;
-extern ScreenEditConvert		* UIEditConvert;
-extern ScreenEditHeader			* UIEditHeader;
-extern ScreenOpen				* UIOpen;
+extern LazyScreen<ScreenLoading>			UILoading;
+extern LazyScreen<ScreenMain>				UIMain;
+extern LazyScreen<ScreenName>				UIName;
+extern LazyScreen<ScreenLevel>				UILevel;
+extern LazyScreen<ScreenSong>				UISong;
+extern LazyScreen<ScreenSing>				UISing;
+extern LazyScreen<ScreenScore>				UIScore;
+extern LazyScreen<ScreenTop5>				UITop5;
+extern LazyScreen<ScreenOptions>			UIOptions;
+extern LazyScreen<ScreenOptionsGame>		UIOptionsGame;
+extern LazyScreen<ScreenOptionsGraphics>	UIOptionsGraphics;
+extern LazyScreen<ScreenOptionsSound>		UIOptionsSound;
+extern LazyScreen<ScreenOptionsLyrics>		UIOptionsLyrics;
+extern LazyScreen<ScreenOptionsThemes>		UIOptionsThemes;
+extern LazyScreen<ScreenOptionsRecord>		UIOptionsRecord;
+extern LazyScreen<ScreenOptionsAdvanced>	UIOptionsAdvanced;
+extern LazyScreen<ScreenEditSub>			UIEditSub;
+extern LazyScreen<ScreenEdit>				UIEdit;
+extern LazyScreen<ScreenEditConvert>		UIEditConvert;
+extern LazyScreen<ScreenEditHeader>			UIEditHeader;
+extern LazyScreen<ScreenOpen>				UIOpen;
 
-extern ScreenSongMenu			* UISongMenu;
-extern ScreenSongJumpTo			* UISongJumpTo;
+extern LazyScreen<ScreenSongMenu>			UISongMenu;
+extern LazyScreen<ScreenSongJumpTo>			UISongJumpTo;
 
 // Party screens
-extern ScreenPartyNewRound		* UIPartyNewRound;
-extern ScreenPartyScore			* UIPartyScore;
-extern ScreenPartyWin			* UIPartyWin;
-extern ScreenPartyOptions		* UIPartyOptions;
-extern ScreenPartyPlayer		* UIPartyPlayer;
-extern ScreenPartyRounds		* UIPartyRounds;
+extern LazyScreen<ScreenPartyNewRound>		UIPartyNewRound;
+extern LazyScreen<ScreenPartyScore>			UIPartyScore;
+extern LazyScreen<ScreenPartyWin>			UIPartyWin;
+extern LazyScreen<ScreenPartyOptions>		UIPartyOptions;
+extern LazyScreen<ScreenPartyPlayer>		UIPartyPlayer;
+extern LazyScreen<ScreenPartyRounds>		UIPartyRounds;
 
 // Stats screens
-extern ScreenStatMain			* UIStatMain;
-extern ScreenStatDetail			* UIStatDetail;
+extern LazyScreen<ScreenStatMain>			UIStatMain;
+extern LazyScreen<ScreenStatDetail>			UIStatDetail;
 
 // Credits screen
-extern ScreenCredits			* UICredits;
+extern LazyScreen<ScreenCredits>			UICredits;
 
 // Popups
-extern ScreenPopupCheck			* UIPopupCheck;
-extern ScreenPopupError			* UIPopupError;
-extern ScreenPopupInfo			* UIPopupInfo;
+extern LazyScreen<ScreenPopupCheck>			UIPopupCheck;
+extern LazyScreen<ScreenPopupError>			UIPopupError;
+extern LazyScreen<ScreenPopupInfo>			UIPopupInfo;
 
 #endif
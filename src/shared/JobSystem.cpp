@@ -0,0 +1,347 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "stdafx.h"
+#include "JobSystem.h"
+#include "../base/Log.h"
+#include "../base/Tracer.h"
+
+initialiseSingleton(JobSystem);
+
+Job::Job(const JobFunction& work, JobPriority priority, bool mainThread)
+	: _work(work), _priority(priority), _mainThread(mainThread),
+	_state(jsPending), _cancelled(false), _pendingCount(1)
+{
+}
+
+JobSystem::JobSystem(Uint32 workerCount /*= 0*/)
+	: _mainThreadId(std::this_thread::get_id()), _nextQueue(0), _queuedCount(0), _stopThreads(false)
+{
+	if (workerCount == 0)
+	{
+		Uint32 cores = std::thread::hardware_concurrency();
+		workerCount = (cores > 1 ? cores - 1 : 1);
+	}
+
+	for (Uint32 i = 0; i < workerCount; i++)
+		_queues.push_back(new WorkQueue());
+
+	// Workers take this lock before touching anything, so they can't look at _workers while it's still growing.
+	std::lock_guard<std::mutex> lock(_sleepLock);
+	for (Uint32 i = 0; i < workerCount; i++)
+		_workers.push_back(std::thread(&JobSystem::WorkerThread, this, i));
+
+	sLog.Info("JobSystem", "Started %u worker threads.", workerCount);
+}
+
+JobHandle JobSystem::Create(const JobFunction& work, JobPriority priority /*= jpBackground*/, bool mainThread /*= false*/)
+{
+	return std::make_shared<Job>(work, priority, mainThread);
+}
+
+void JobSystem::AddDependency(const JobHandle& job, const JobHandle& dependency)
+{
+	job->_pendingCount.fetch_add(1, std::memory_order_relaxed);
+
+	{
+		std::lock_guard<std::mutex> lock(dependency->_continuationLock);
+		if (!dependency->IsFinished())
+		{
+			dependency->_continuations.push_back(job);
+			return;
+		}
+	}
+
+	// already finished, so nothing is left to wait for
+	if (dependency->GetState() == jsCancelled)
+		job->_cancelled.store(true, std::memory_order_relaxed);
+
+	Release(job);
+}
+
+void JobSystem::Submit(const JobHandle& job)
+{
+	Release(job);
+}
+
+JobHandle JobSystem::Run(const JobFunction& work, JobPriority priority /*= jpBackground*/)
+{
+	JobHandle job = Create(work, priority);
+	Submit(job);
+	return job;
+}
+
+JobHandle JobSystem::RunOnMainThread(const JobFunction& work)
+{
+	JobHandle job = Create(work, jpInteractive, true);
+	Submit(job);
+	return job;
+}
+
+void JobSystem::Cancel(const JobHandle& job)
+{
+	// Queued jobs are dropped when they're dequeued, pending ones when their dependencies finish.
+	job->_cancelled.store(true, std::memory_order_relaxed);
+}
+
+void JobSystem::Wait(const JobHandle& job, bool runMainThreadJobs /*= true*/)
+{
+	int workerIndex = GetWorkerIndex();
+	bool isMainThread = runMainThreadJobs && (std::this_thread::get_id() == _mainThreadId);
+
+	while (!job->IsFinished())
+	{
+		if (isMainThread && TryRunMainThreadJob())
+			continue;
+
+		if (!TryRunOne(workerIndex))
+			std::this_thread::yield();
+	}
+}
+
+void JobSystem::RunMainThreadJobs(Uint32 budgetMs /*= JOBS_MAINTHREAD_BUDGET*/)
+{
+	Uint32 start = SDL_GetTicks();
+
+	do
+	{
+		if (!TryRunMainThreadJob())
+			break;
+	} while (SDL_GetTicks() - start < budgetMs);
+}
+
+void JobSystem::WorkerThread(Uint32 index)
+{
+	// wait for the constructor to finish starting the other workers
+	{
+		std::lock_guard<std::mutex> lock(_sleepLock);
+	}
+
+	if (Tracer::IsEnabled())
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "Worker %u", index + 1);
+		sTracer.SetThreadName(name);
+	}
+
+	while (true)
+	{
+		if (TryRunOne((int) index))
+			continue;
+
+		std::unique_lock<std::mutex> lock(_sleepLock);
+		while (!_stopThreads && _queuedCount.load() == 0)
+			_sleepCond.wait(lock);
+
+		if (_stopThreads)
+			break;
+	}
+}
+
+int JobSystem::GetWorkerIndex() const
+{
+	std::thread::id id = std::this_thread::get_id();
+	for (size_t i = 0; i < _workers.size(); i++)
+	{
+		if (_workers[i].get_id() == id)
+			return (int) i;
+	}
+
+	return -1;
+}
+
+void JobSystem::Enqueue(const JobHandle& job)
+{
+	job->_state.store(jsQueued, std::memory_order_release);
+
+	if (job->_mainThread)
+	{
+		std::lock_guard<std::mutex> lock(_mainThreadLock);
+		_mainThreadJobs.push_back(job);
+		return;
+	}
+
+	// Workers keep what they spawn, everything else is spread over the pool.
+	int queueIndex = GetWorkerIndex();
+	if (queueIndex < 0)
+		queueIndex = (int) (_nextQueue.fetch_add(1, std::memory_order_relaxed) % _queues.size());
+
+	WorkQueue * queue = _queues[queueIndex];
+	{
+		std::lock_guard<std::mutex> lock(queue->Lock);
+		queue->Jobs[job->_priority].push_back(job);
+	}
+
+	_queuedCount.fetch_add(1);
+
+	std::lock_guard<std::mutex> lock(_sleepLock);
+	_sleepCond.notify_one();
+}
+
+bool JobSystem::TryRunOne(int workerIndex)
+{
+	JobHandle job = PopJob(workerIndex);
+	if (job == NULL)
+		return false;
+
+	Execute(job);
+	return true;
+}
+
+bool JobSystem::TryRunMainThreadJob()
+{
+	JobHandle job;
+
+	{
+		std::lock_guard<std::mutex> lock(_mainThreadLock);
+		if (_mainThreadJobs.empty())
+			return false;
+
+		job = _mainThreadJobs.front();
+		_mainThreadJobs.pop_front();
+	}
+
+	Execute(job);
+	return true;
+}
+
+JobHandle JobSystem::PopJob(int workerIndex)
+{
+	if (_queuedCount.load() == 0)
+		return JobHandle();
+
+	Uint32 queueCount = (Uint32) _queues.size();
+	Uint32 first = (workerIndex < 0 ? 0 : (Uint32) workerIndex);
+
+	for (int priority = 0; priority < jpCount; priority++)
+	{
+		// own queue first (newest job, its data is most likely still cached), then steal the oldest from the others
+		for (Uint32 i = 0; i < queueCount; i++)
+		{
+			WorkQueue * queue = _queues[(first + i) % queueCount];
+			std::deque<JobHandle>& jobs = queue->Jobs[priority];
+			std::lock_guard<std::mutex> lock(queue->Lock);
+
+			if (jobs.empty())
+				continue;
+
+			JobHandle job;
+			if (i == 0 && workerIndex >= 0)
+			{
+				job = jobs.back();
+				jobs.pop_back();
+			}
+			else
+			{
+				job = jobs.front();
+				jobs.pop_front();
+			}
+
+			_queuedCount.fetch_sub(1);
+			return job;
+		}
+	}
+
+	return JobHandle();
+}
+
+void JobSystem::Execute(const JobHandle& job)
+{
+	if (job->IsCancelled())
+	{
+		Finish(job, jsCancelled);
+		return;
+	}
+
+	job->_state.store(jsRunning, std::memory_order_release);
+	TRACE_SCOPE(job->_mainThread ? "Main thread job" : "Job");
+
+	try
+	{
+		job->_work();
+	}
+	catch (const std::exception& e)
+	{
+		sLog.Error("JobSystem", "Job threw an exception: %s", e.what());
+	}
+	catch (...)
+	{
+		sLog.Error("JobSystem", "Job threw an unknown exception.");
+	}
+
+	// release anything captured by the job right away, the handle may be kept around for a while
+	job->_work = JobFunction();
+
+	Finish(job, job->IsCancelled() ? jsCancelled : jsDone);
+}
+
+void JobSystem::Finish(const JobHandle& job, JobState state)
+{
+	std::vector<JobHandle> continuations;
+
+	{
+		std::lock_guard<std::mutex> lock(job->_continuationLock);
+		job->_state.store(state, std::memory_order_release);
+		continuations.swap(job->_continuations);
+	}
+
+	for (size_t i = 0; i < continuations.size(); i++)
+	{
+		if (state == jsCancelled)
+			continuations[i]->_cancelled.store(true, std::memory_order_relaxed);
+
+		Release(continuations[i]);
+	}
+}
+
+void JobSystem::Release(const JobHandle& job)
+{
+	if (job->_pendingCount.fetch_sub(1) != 1)
+		return;
+
+	if (job->IsCancelled())
+		Finish(job, jsCancelled);
+	else
+		Enqueue(job);
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(_sleepLock);
+		_stopThreads = true;
+		_sleepCond.notify_all();
+	}
+
+	for (size_t i = 0; i < _workers.size(); i++)
+	{
+		if (_workers[i].joinable())
+			_workers[i].join();
+	}
+
+	// Whatever is still queued is dropped.
+	for (size_t i = 0; i < _queues.size(); i++)
+		delete _queues[i];
+
+	_queues.clear();
+	_mainThreadJobs.clear();
+}
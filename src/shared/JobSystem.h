@@ -0,0 +1,180 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _JOBSYSTEM_H
+#define _JOBSYSTEM_H
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// time (in ms) the main loop spends on main-thread continuations per frame
+#define JOBS_MAINTHREAD_BUDGET	4
+
+enum JobPriority
+{
+	jpInteractive,	// the user is waiting on it (current screen, song preview)
+	jpBackground,	// scanning, cache warming etc.
+
+	jpCount
+};
+
+enum JobState
+{
+	jsPending,		// created, waiting for dependencies or Submit()
+	jsQueued,
+	jsRunning,
+	jsDone,
+	jsCancelled
+};
+
+class Job;
+typedef std::shared_ptr<Job> JobHandle;
+typedef std::function<void()> JobFunction;
+
+class Job
+{
+public:
+	Job(const JobFunction& work, JobPriority priority, bool mainThread);
+
+	// Long-running jobs should poll this and return early.
+	INLINE bool IsCancelled() const { return _cancelled.load(std::memory_order_relaxed); }
+	INLINE bool IsFinished() const
+	{
+		JobState state = (JobState) _state.load(std::memory_order_acquire);
+		return state == jsDone || state == jsCancelled;
+	}
+
+	INLINE JobState GetState() const { return (JobState) _state.load(std::memory_order_acquire); }
+	INLINE JobPriority GetPriority() const { return _priority; }
+	INLINE bool IsMainThread() const { return _mainThread; }
+
+private:
+	JobFunction				_work;
+	JobPriority				_priority;
+	bool					_mainThread;
+
+	std::atomic<int>		_state;
+	std::atomic<bool>		_cancelled;
+
+	// 1 for the pending Submit() call, plus one per unfinished dependency
+	std::atomic<int>		_pendingCount;
+
+	std::mutex				_continuationLock;
+	std::vector<JobHandle>	_continuations;
+
+	friend class JobSystem;
+};
+
+/**
+ * Runs jobs on one worker thread per spare core.
+ *
+ * Every worker owns a deque per priority: it pushes and pops its own jobs at
+ * the back and steals from the front of the others' when it runs dry.
+ * Interactive jobs are always taken before background ones.
+ *
+ * Jobs flagged as main-thread jobs (GL uploads, UI updates) are collected in
+ * a separate queue which usdxMainLoop() drains once per frame.
+ */
+class JobSystem : public Singleton<JobSystem>
+{
+public:
+	// workerCount 0 picks one worker per core, minus the main thread
+	JobSystem(Uint32 workerCount = 0);
+
+	// Creates a job without queueing it, so dependencies can be added first.
+	JobHandle Create(const JobFunction& work, JobPriority priority = jpBackground, bool mainThread = false);
+
+	// `job` will not start before `dependency` has finished. Must be called before Submit().
+	// If the dependency gets cancelled, so does `job`.
+	void AddDependency(const JobHandle& job, const JobHandle& dependency);
+
+	// Queues the job as soon as all of its dependencies are done.
+	void Submit(const JobHandle& job);
+
+	// Create() + Submit()
+	JobHandle Run(const JobFunction& work, JobPriority priority = jpBackground);
+
+	// Schedules `work` on the render thread; use it to hand results back from workers.
+	JobHandle RunOnMainThread(const JobFunction& work);
+
+	// Jobs which have not started yet are skipped, running jobs may poll Job::IsCancelled().
+	void Cancel(const JobHandle& job);
+
+	// Blocks until the job is finished, running other jobs in the meantime.
+	// Pass false to keep the main thread from running main-thread jobs while
+	// waiting, when those could change what the job is working on.
+	void Wait(const JobHandle& job, bool runMainThreadJobs = true);
+
+	// Runs queued main-thread jobs until the budget (in ms) is used up.
+	// At least one job is run per call, so the queue can't starve.
+	void RunMainThreadJobs(Uint32 budgetMs = JOBS_MAINTHREAD_BUDGET);
+
+	INLINE Uint32 GetWorkerCount() const { return (Uint32) _workers.size(); }
+	INLINE Uint32 GetQueuedCount() const { return (Uint32) _queuedCount.load(std::memory_order_relaxed); }
+
+	~JobSystem();
+
+private:
+	// Deques are short-lived and only contended when stealing, so a plain lock is enough.
+	struct WorkQueue
+	{
+		std::mutex				Lock;
+		std::deque<JobHandle>	Jobs[jpCount];
+	};
+
+	void WorkerThread(Uint32 index);
+	int GetWorkerIndex() const;
+
+	void Enqueue(const JobHandle& job);
+	bool TryRunOne(int workerIndex);
+	bool TryRunMainThreadJob();
+	JobHandle PopJob(int workerIndex);
+
+	void Execute(const JobHandle& job);
+	void Finish(const JobHandle& job, JobState state);
+	void Release(const JobHandle& job);
+
+	std::vector<std::thread>	_workers;
+	std::vector<WorkQueue *>	_queues;
+	std::thread::id				_mainThreadId;
+
+	// round-robin target for jobs submitted from outside the pool
+	std::atomic<Uint32>			_nextQueue;
+	std::atomic<int>			_queuedCount;
+
+	std::mutex					_sleepLock;
+	std::condition_variable		_sleepCond;
+	bool						_stopThreads;
+
+	std::mutex					_mainThreadLock;
+	std::deque<JobHandle>		_mainThreadJobs;
+};
+
+#define sJobs (JobSystem::getSingleton())
+
+#endif
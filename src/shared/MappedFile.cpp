@@ -0,0 +1,158 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "stdafx.h"
+#include "MappedFile.h"
+
+#if defined(WIN32)
+#	include <windows.h>
+#else
+#	include <fcntl.h>
+#	include <unistd.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#endif
+
+MappedFile::MappedFile()
+	: _open(false), _data(NULL), _size(0)
+#if defined(WIN32)
+	, _file(INVALID_HANDLE_VALUE), _mapping(NULL)
+#endif
+{
+}
+
+#if defined(WIN32)
+
+bool MappedFile::Open(const path& filename)
+{
+	Close();
+
+	_file = CreateFileW(filename.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (_file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(_file, &size)
+		|| (Uint64) size.QuadPart > (Uint64) SIZE_MAX)
+	{
+		Close();
+		return false;
+	}
+
+	_size = (size_t) size.QuadPart;
+	_open = true;
+
+	// mapping an empty file fails, there's nothing to map anyway
+	if (_size == 0)
+		return true;
+
+	_mapping = CreateFileMappingW(_file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (_mapping == NULL)
+	{
+		Close();
+		return false;
+	}
+
+	_data = (const char *) MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+	if (_data == NULL)
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (_data != NULL)
+		UnmapViewOfFile(_data);
+
+	if (_mapping != NULL)
+		CloseHandle(_mapping);
+
+	if (_file != INVALID_HANDLE_VALUE)
+		CloseHandle(_file);
+
+	_file = INVALID_HANDLE_VALUE;
+	_mapping = NULL;
+	_data = NULL;
+	_size = 0;
+	_open = false;
+}
+
+#else
+
+bool MappedFile::Open(const path& filename)
+{
+	Close();
+
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	_size = (size_t) st.st_size;
+	_open = true;
+
+	if (_size > 0)
+	{
+		void * data = mmap(NULL, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED)
+		{
+			close(fd);
+			Close();
+			return false;
+		}
+
+		madvise(data, _size, MADV_SEQUENTIAL);
+		_data = (const char *) data;
+	}
+
+	// the mapping stays valid without the descriptor
+	close(fd);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (_data != NULL)
+		munmap((void *) _data, _size);
+
+	_data = NULL;
+	_size = 0;
+	_open = false;
+}
+
+#endif
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
@@ -0,0 +1,60 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _MAPPEDFILE_H
+#define _MAPPEDFILE_H
+#pragma once
+
+/**
+ * A read-only memory mapping of a whole file.
+ * Empty files open fine, but have no data.
+ */
+class MappedFile
+{
+public:
+	MappedFile();
+
+	bool Open(const path& filename);
+	void Close();
+
+	INLINE bool IsOpen() const { return _open; }
+	INLINE const char * GetData() const { return _data; }
+	INLINE size_t GetSize() const { return _size; }
+
+	~MappedFile();
+
+protected:
+	bool		_open;
+	const char *_data;
+	size_t		_size;
+
+#if defined(WIN32)
+	void *		_file;
+	void *		_mapping;
+#endif
+
+private:
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+};
+
+#endif
@@ -223,3 +223,77 @@ Sqlite3Database::~Sqlite3Database()
 {
 	Close();
 }
+
+Sqlite3Statement::Sqlite3Statement(Sqlite3Database& database, const char * sql)
+	: _database(database._database), _statement(nullptr)
+{
+	if (sqlite3_prepare_v2(_database, sql, -1, &_statement, nullptr) != SQLITE_OK)
+		throw Sqlite3Exception(_database != nullptr ? sqlite3_errmsg(_database) : "database not open");
+}
+
+void Sqlite3Statement::Bind(int index, int value)
+{
+	if (sqlite3_bind_int(_statement, index, value) != SQLITE_OK)
+		throw Sqlite3Exception(sqlite3_errmsg(_database));
+}
+
+void Sqlite3Statement::Bind(int index, Sint64 value)
+{
+	if (sqlite3_bind_int64(_statement, index, value) != SQLITE_OK)
+		throw Sqlite3Exception(sqlite3_errmsg(_database));
+}
+
+void Sqlite3Statement::Bind(int index, double value)
+{
+	if (sqlite3_bind_double(_statement, index, value) != SQLITE_OK)
+		throw Sqlite3Exception(sqlite3_errmsg(_database));
+}
+
+void Sqlite3Statement::Bind(int index, const std::string& value)
+{
+	if (sqlite3_bind_text(_statement, index, value.c_str(), (int) value.size(), SQLITE_TRANSIENT) != SQLITE_OK)
+		throw Sqlite3Exception(sqlite3_errmsg(_database));
+}
+
+bool Sqlite3Statement::Step()
+{
+	int r = sqlite3_step(_statement);
+	if (r == SQLITE_ROW)
+		return true;
+
+	if (r != SQLITE_DONE)
+		throw Sqlite3Exception(sqlite3_errmsg(_database));
+
+	return false;
+}
+
+void Sqlite3Statement::Reset()
+{
+	sqlite3_reset(_statement);
+}
+
+int Sqlite3Statement::GetInt(int column)
+{
+	return sqlite3_column_int(_statement, column);
+}
+
+Sint64 Sqlite3Statement::GetInt64(int column)
+{
+	return sqlite3_column_int64(_statement, column);
+}
+
+double Sqlite3Statement::GetDouble(int column)
+{
+	return sqlite3_column_double(_statement, column);
+}
+
+std::string Sqlite3Statement::GetString(int column)
+{
+	const char * text = (const char *) sqlite3_column_text(_statement, column);
+	return (text != nullptr ? std::string(text, sqlite3_column_bytes(_statement, column)) : std::string());
+}
+
+Sqlite3Statement::~Sqlite3Statement()
+{
+	sqlite3_finalize(_statement);
+}
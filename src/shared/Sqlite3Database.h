@@ -51,6 +51,45 @@ public:
 
 protected:
 	struct sqlite3 * _database;
+
+	friend class Sqlite3Statement;
+};
+
+/**
+ * A prepared statement, for queries run many times or with values that
+ * shouldn't be formatted into the SQL. Columns and parameters as in SQLite:
+ * parameters count from 1, columns from 0.
+ */
+class Sqlite3Statement
+{
+public:
+	Sqlite3Statement(Sqlite3Database& database, const char * sql);
+
+	void Bind(int index, int value);
+	void Bind(int index, Sint64 value);
+	void Bind(int index, double value);
+	void Bind(int index, const std::string& value);
+
+	// Returns true while there are rows to read.
+	bool Step();
+
+	// Makes the statement runnable again, keeping its bound values.
+	void Reset();
+
+	int GetInt(int column);
+	Sint64 GetInt64(int column);
+	double GetDouble(int column);
+	std::string GetString(int column);
+
+	~Sqlite3Statement();
+
+protected:
+	struct sqlite3 *		_database;
+	struct sqlite3_stmt *	_statement;
+
+private:
+	Sqlite3Statement(const Sqlite3Statement&);
+	Sqlite3Statement& operator=(const Sqlite3Statement&);
 };
 
 #endif
@@ -0,0 +1,129 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "stdafx.h"
+#include "StringPool.h"
+
+#define STRING_POOL_INITIAL_SLOTS	1024	// power of two
+
+StringPool::StringPool()
+{
+	Clear();
+}
+
+// FNV-1a
+Uint32 StringPool::Hash(const char * str, size_t length)
+{
+	Uint32 hash = 2166136261U;
+	for (size_t i = 0; i < length; i++)
+	{
+		hash ^= (Uint8) str[i];
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+Uint32 StringPool::Intern(const char * str, size_t length)
+{
+	if (length == 0)
+		return 0;
+
+	// at most half full, so probing stays short
+	if ((_count + 1) * 2 > _slots.size())
+		Rehash(_slots.size() * 2);
+
+	size_t mask = _slots.size() - 1;
+	size_t slot = Hash(str, length) & mask;
+
+	while (_slots[slot] != 0)
+	{
+		const char * existing = &_data[_slots[slot]];
+		if (strncmp(existing, str, length) == 0 && existing[length] == '\0')
+			return _slots[slot];
+
+		slot = (slot + 1) & mask;
+	}
+
+	Uint32 id = (Uint32) _data.size();
+	_data.insert(_data.end(), str, str + length);
+	_data.push_back('\0');
+
+	_slots[slot] = id;
+	_count++;
+	return id;
+}
+
+Uint32 StringPool::Find(const char * str, size_t length) const
+{
+	if (length == 0)
+		return 0;
+
+	size_t mask = _slots.size() - 1;
+	size_t slot = Hash(str, length) & mask;
+
+	while (_slots[slot] != 0)
+	{
+		const char * existing = &_data[_slots[slot]];
+		if (strncmp(existing, str, length) == 0 && existing[length] == '\0')
+			return _slots[slot];
+
+		slot = (slot + 1) & mask;
+	}
+
+	return 0;
+}
+
+void StringPool::Rehash(size_t slotCount)
+{
+	std::vector<Uint32> slots(slotCount, 0);
+	size_t mask = slotCount - 1;
+
+	for (size_t i = 0; i < _slots.size(); i++)
+	{
+		Uint32 id = _slots[i];
+		if (id == 0)
+			continue;
+
+		const char * str = &_data[id];
+		size_t slot = Hash(str, strlen(str)) & mask;
+		while (slots[slot] != 0)
+			slot = (slot + 1) & mask;
+
+		slots[slot] = id;
+	}
+
+	_slots.swap(slots);
+}
+
+size_t StringPool::GetMemoryUsage() const
+{
+	return _data.capacity() + _slots.capacity() * sizeof(Uint32);
+}
+
+void StringPool::Clear()
+{
+	// the empty string, so no real string gets ID 0
+	_data.assign(1, '\0');
+	_slots.assign(STRING_POOL_INITIAL_SLOTS, 0);
+	_count = 0;
+}
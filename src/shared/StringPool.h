@@ -0,0 +1,64 @@
+/* UltraStar Deluxe - Karaoke Game
+ *
+ * UltraStar Deluxe is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING. If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _STRINGPOOL_H
+#define _STRINGPOOL_H
+#pragma once
+
+/**
+ * Interned strings, stored back to back in one buffer.
+ *
+ * Every distinct string is stored once and identified by its offset in the
+ * buffer, so equal strings have equal IDs and a column of them is just a
+ * column of Uint32s. ID 0 is always the empty string. Strings are never
+ * removed, only all of them at once by Clear().
+ */
+class StringPool
+{
+public:
+	StringPool();
+
+	// Returns the ID of the string, adding it if it's new.
+	Uint32 Intern(const char * str, size_t length);
+	INLINE Uint32 Intern(const std::string& str) { return Intern(str.c_str(), str.size()); }
+
+	// Returns the ID of the string without adding it, 0 if it isn't in the pool.
+	Uint32 Find(const char * str, size_t length) const;
+
+	// Null-terminated; only valid until the next Intern().
+	INLINE const char * Get(Uint32 id) const { return &_data[id]; }
+
+	INLINE Uint32 GetCount() const { return _count; }
+	size_t GetMemoryUsage() const;
+
+	void Clear();
+
+protected:
+	static Uint32 Hash(const char * str, size_t length);
+	void Rehash(size_t slotCount);
+
+	std::vector<char>	_data;
+	std::vector<Uint32>	_slots;		// open addressing; IDs, 0 for a free slot
+	Uint32				_count;
+};
+
+#endif
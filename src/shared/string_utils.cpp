@@ -77,3 +77,29 @@ void StrSplit(const std::string& src, const std::string& sep, std::vector<std::s
 	if (!s.empty()) 
 		result->push_back(s);
 }
+
+bool StringRef::EqualsI(const char * str) const
+{
+	for (size_t i = 0; i < Length; i++)
+	{
+		if (str[i] == '\0'
+			|| tolower((Uint8) Data[i]) != tolower((Uint8) str[i]))
+			return false;
+	}
+
+	return str[Length] == '\0';
+}
+
+StringRef& StringRef::Trim()
+{
+	while (Length > 0 && safe_isspace((Uint8) Data[0]))
+	{
+		Data++;
+		Length--;
+	}
+
+	while (Length > 0 && safe_isspace((Uint8) Data[Length - 1]))
+		Length--;
+
+	return *this;
+}
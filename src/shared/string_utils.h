@@ -102,4 +102,23 @@ bool ExtractResolution(const std::string& str, int* w, int* h);
 int strpos(const char * haystack, const char * needle); 
 void StrSplit(const std::string& src, const std::string& sep, std::vector<std::string> * result);
 
+// A view of characters owned by someone else (e.g. a mapped file), not null-terminated.
+struct StringRef
+{
+	const char *	Data;
+	size_t			Length;
+
+	StringRef() : Data(NULL), Length(0) {}
+	StringRef(const char * data, size_t length) : Data(data), Length(length) {}
+
+	INLINE bool Empty() const { return Length == 0; }
+	INLINE std::string ToString() const { return std::string(Data, Length); }
+
+	// Case-insensitive (ASCII only) comparison with a null-terminated string.
+	bool EqualsI(const char * str) const;
+
+	// Drops whitespace from both ends.
+	StringRef& Trim();
+};
+
 #endif